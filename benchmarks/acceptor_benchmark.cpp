@@ -0,0 +1,99 @@
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "paxos/acceptorlog.hpp"
+#include "paxos/logging.hpp"
+#include "paxos/roles.hpp"
+
+#include "benchmark.hpp"
+
+
+class NullSender : public paxos::Sender
+{
+public:
+
+    void Reply(paxos::Message message) override
+    {
+    }
+
+    void ReplyAll(paxos::Message message) override
+    {
+    }
+};
+
+
+//
+// Each round is one prepare and one accept for the next decree, the way an
+// acceptor sees them from a stable leader. Every round persists the promised
+// and the accepted decree once.
+//
+void Run(std::string name,
+         std::shared_ptr<paxos::Storage<paxos::Decree>> promised,
+         std::shared_ptr<paxos::Storage<paxos::Decree>> accepted,
+         std::shared_ptr<paxos::VoteStorage> votes,
+         int rounds)
+{
+    auto context = std::make_shared<paxos::AcceptorContext>(
+        promised, accepted, votes, std::chrono::milliseconds(1000));
+    auto sender = std::make_shared<NullSender>();
+
+    paxos::Replica replica("host", 8080);
+    std::string content(64, 'x');
+    benchmark::Measure(name + " prepare+accept", rounds, [&](int i)
+    {
+        paxos::Decree decree(replica, i + 1, content,
+                             paxos::DecreeType::UserDecree);
+        decree.root_number = i + 1;
+        paxos::HandlePrepare(
+            paxos::Message(decree, replica, replica,
+                           paxos::MessageType::PrepareMessage),
+            context,
+            sender);
+        paxos::HandleAccept(
+            paxos::Message(decree, replica, replica,
+                           paxos::MessageType::AcceptMessage),
+            context,
+            sender);
+
+        //
+        // The learner retires the previous vote once it has been learned.
+        //
+        context->accepted_votes->Retire(i);
+    });
+}
+
+
+int main(int argc, char** argv)
+{
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 2000;
+
+    paxos::DisableLogging();
+
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+
+    Run("decree files",
+        std::make_shared<paxos::PersistentDecree>(
+            directory.string(), paxos::PROMISED_DECREE_FILENAME),
+        std::make_shared<paxos::PersistentDecree>(
+            directory.string(), paxos::ACCEPTED_DECREE_FILENAME),
+        std::make_shared<paxos::VolatileVotes>(),
+        rounds);
+
+    auto log = std::make_shared<paxos::AcceptorLog>(directory.string());
+    Run("acceptor log",
+        std::make_shared<paxos::AcceptorLogStorage>(
+            log, paxos::AcceptorField::Promised),
+        std::make_shared<paxos::AcceptorLogStorage>(
+            log, paxos::AcceptorField::Accepted),
+        std::make_shared<paxos::AcceptorLogVotes>(log),
+        rounds);
+
+    boost::filesystem::remove_all(directory);
+    return 0;
+}
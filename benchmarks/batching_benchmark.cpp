@@ -0,0 +1,156 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "paxos/logging.hpp"
+#include "paxos/roles.hpp"
+
+#include "benchmark.hpp"
+
+
+//
+// Single replica wired back to itself. Messages are encoded with the binary
+// codec and queued rather than dispatched inline because handlers send while
+// holding their context locks.
+//
+class LoopbackSender : public paxos::Sender
+{
+public:
+
+    void Reply(paxos::Message message) override
+    {
+        queue.push_back(paxos::BinaryCodec::Serialize(message));
+    }
+
+    void ReplyAll(paxos::Message message) override
+    {
+        Reply(message);
+    }
+
+    std::deque<std::string> queue;
+};
+
+
+class LoopbackReceiver : public paxos::Receiver
+{
+public:
+
+    void RegisterCallback(paxos::Callback&& callback,
+                          paxos::MessageType type) override
+    {
+        registered_map[type].push_back(std::move(callback));
+    }
+
+    void Dispatch(const std::string& content)
+    {
+        auto message = paxos::BinaryCodec::Deserialize<paxos::Message>(content);
+        for (paxos::Callback& callback : registered_map[message.type])
+        {
+            callback(message);
+        }
+    }
+
+private:
+
+    std::unordered_map<paxos::MessageType,
+                       std::vector<paxos::Callback>> registered_map;
+};
+
+
+double Run(size_t batch_max_bytes, size_t content_size, int burst,
+           int proposals)
+{
+    paxos::Replica replica("localhost", 8080);
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(replica);
+
+    int applied = 0;
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss),
+        std::make_shared<paxos::CompositeHandler>(
+            [&applied](std::string entry) { applied += 1; }));
+
+    auto signal = std::make_shared<paxos::Signal>();
+    auto proposer = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal);
+    proposer->batch_max_bytes = batch_max_bytes;
+    auto acceptor = std::make_shared<paxos::AcceptorContext>(
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::VolatileVotes>(),
+        std::chrono::milliseconds(0));
+    auto learner = std::make_shared<paxos::LearnerContext>(replicaset, ledger);
+    auto updater = std::make_shared<paxos::UpdaterContext>(ledger);
+
+    auto receiver = std::make_shared<LoopbackReceiver>();
+    auto sender = std::make_shared<LoopbackSender>();
+    paxos::RegisterProposer(receiver, sender, proposer);
+    paxos::RegisterAcceptor(receiver, sender, acceptor);
+    paxos::RegisterLearner(receiver, sender, learner);
+    paxos::RegisterUpdater(receiver, sender, updater);
+
+    std::string content(content_size, 'x');
+    return benchmark::Time(proposals / burst, [&](int round)
+    {
+        //
+        // Clients submit a burst of proposals and wait for all of them to be
+        // applied before submitting the next burst.
+        //
+        for (int i=0; i<burst; i++)
+        {
+            sender->Reply(
+                paxos::Message(
+                    paxos::Decree(replica, -1, content,
+                                  paxos::DecreeType::UserDecree),
+                    replica,
+                    replica,
+                    paxos::MessageType::RequestMessage));
+        }
+
+        while (applied < (round + 1) * burst)
+        {
+            if (sender->queue.empty())
+            {
+                //
+                // Stand in for the parliament's periodic flush of stuck
+                // proposals.
+                //
+                sender->Reply(
+                    paxos::Message(paxos::Decree(), replica, replica,
+                                   paxos::MessageType::RequestMessage));
+            }
+            auto next = sender->queue.front();
+            sender->queue.pop_front();
+            receiver->Dispatch(next);
+        }
+    });
+}
+
+
+int main(int argc, char** argv)
+{
+    int proposals = argc > 1 ? std::atoi(argv[1]) : 2048;
+    int burst = 32;
+    size_t content_size = 64;
+
+    paxos::DisableLogging();
+
+    for (size_t batch_max_bytes : { 0, 256, 1024, 4096, 16384 })
+    {
+        benchmark::Report(
+            "proposals batch_max_bytes=" + std::to_string(batch_max_bytes),
+            proposals,
+            Run(batch_max_bytes, content_size, burst, proposals));
+    }
+    return 0;
+}
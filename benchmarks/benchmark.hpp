@@ -0,0 +1,62 @@
+#ifndef __BENCHMARK_HPP_INCLUDED__
+#define __BENCHMARK_HPP_INCLUDED__
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+
+namespace benchmark
+{
+
+
+//
+// Prevent the optimizer from discarding results that are otherwise unused.
+//
+template <typename T>
+void DoNotOptimize(const T& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+
+//
+// Runs the operation for the given number of iterations and returns the
+// elapsed wall clock time in seconds.
+//
+inline double Time(int iterations, std::function<void(int)> operation)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i=0; i<iterations; i++)
+    {
+        operation(i);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+
+inline void Report(std::string name, int iterations, double seconds)
+{
+    std::printf("%-48s %10d ops %12.0f ops/s %10.3f us/op\n",
+                name.c_str(),
+                iterations,
+                iterations / seconds,
+                seconds * 1e6 / iterations);
+}
+
+
+inline void Measure(std::string name,
+                    int iterations,
+                    std::function<void(int)> operation)
+{
+    Report(name, iterations, Time(iterations, operation));
+}
+
+
+}
+
+
+#endif
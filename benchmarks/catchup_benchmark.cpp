@@ -0,0 +1,150 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "paxos/logging.hpp"
+#include "paxos/roles.hpp"
+
+#include "benchmark.hpp"
+
+
+//
+// Up to date replica and lagging replica wired to each other. Messages are
+// encoded with the binary codec so serialization cost is part of every round
+// trip, and each delivery waits latency to stand in for the network.
+//
+class LoopbackSender : public paxos::Sender
+{
+public:
+
+    void Reply(paxos::Message message) override
+    {
+        queue.push_back(paxos::BinaryCodec::Serialize(message));
+    }
+
+    void ReplyAll(paxos::Message message) override
+    {
+        Reply(message);
+    }
+
+    std::deque<std::string> queue;
+};
+
+
+class LoopbackReceiver : public paxos::Receiver
+{
+public:
+
+    void RegisterCallback(paxos::Callback&& callback,
+                          paxos::MessageType type) override
+    {
+        registered_map[type].push_back(std::move(callback));
+    }
+
+    void Dispatch(const std::string& content)
+    {
+        auto message = paxos::BinaryCodec::Deserialize<paxos::Message>(content);
+        for (paxos::Callback& callback : registered_map[message.type])
+        {
+            callback(message);
+        }
+    }
+
+private:
+
+    std::unordered_map<paxos::MessageType,
+                       std::vector<paxos::Callback>> registered_map;
+};
+
+
+void Run(int lag, size_t window, std::chrono::microseconds latency)
+{
+    paxos::Replica replica("localhost", 8080);
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(replica);
+
+    //
+    // Stream backed queues cannot roll over so they are sized to hold the
+    // whole run.
+    //
+    std::string content(64, 'x');
+    std::stringstream leader_stream, follower_stream;
+    auto leader_ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(
+            leader_stream, 0x40000000));
+    for (int i=1; i<=lag; i++)
+    {
+        leader_ledger->Append(
+            paxos::Decree(replica, i, content, paxos::DecreeType::UserDecree));
+    }
+    auto follower_ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(
+            follower_stream, 0x40000000));
+
+    auto updater = std::make_shared<paxos::UpdaterContext>(leader_ledger);
+    updater->update_window_entries = window;
+    auto learner = std::make_shared<paxos::LearnerContext>(
+        replicaset, follower_ledger);
+
+    auto receiver = std::make_shared<LoopbackReceiver>();
+    auto sender = std::make_shared<LoopbackSender>();
+    paxos::RegisterLearner(receiver, sender, learner);
+    paxos::RegisterUpdater(receiver, sender, updater);
+
+    int round_trips = 0;
+    double seconds = benchmark::Time(1, [&](int)
+    {
+        sender->Reply(
+            paxos::Message(follower_ledger->Tail(), replica, replica,
+                           paxos::MessageType::UpdateMessage));
+        while (!sender->queue.empty())
+        {
+            auto next = sender->queue.front();
+            sender->queue.pop_front();
+            if (latency.count() > 0)
+            {
+                std::this_thread::sleep_for(latency);
+            }
+            receiver->Dispatch(next);
+            round_trips += 1;
+        }
+    });
+
+    if (follower_ledger->Tail().number != lag)
+    {
+        std::fprintf(stderr, "catch-up stopped at %d of %d\n",
+                     follower_ledger->Tail().number, lag);
+        std::exit(1);
+    }
+
+    benchmark::Report(
+        "decrees lag=" + std::to_string(lag) +
+        " window=" + std::to_string(window) +
+        " messages=" + std::to_string(round_trips),
+        lag,
+        seconds);
+}
+
+
+int main(int argc, char** argv)
+{
+    auto latency = std::chrono::microseconds(
+        argc > 1 ? std::atoi(argv[1]) : 50);
+
+    paxos::DisableLogging();
+
+    for (int lag : { 1000, 10000, 100000 })
+    {
+        for (size_t window : { 1, 64, 256, 1024 })
+        {
+            Run(lag, window, latency);
+        }
+    }
+    return 0;
+}
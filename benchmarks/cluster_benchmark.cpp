@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "paxos/logging.hpp"
+#include "paxos/simulation.hpp"
+
+#include "benchmark.hpp"
+
+
+//
+// Commit latency in virtual microseconds at the given quantile.
+//
+double Percentile(std::vector<int64_t>& latencies, double q)
+{
+    if (latencies.empty())
+    {
+        return 0;
+    }
+    size_t index = std::min(latencies.size() - 1,
+                            static_cast<size_t>(q * latencies.size()));
+    std::nth_element(latencies.begin(), latencies.begin() + index,
+                     latencies.end());
+    return latencies[index];
+}
+
+
+//
+// Replica zero keeps window proposals outstanding and proposes the next one
+// whenever one of its own is applied, until decrees have been applied. Commit
+// latency runs from the proposal to the proposer applying it. Throughput is
+// reported both in wall clock time, which is the cost of running every role
+// of every replica in this process, and in virtual time.
+//
+void Run(std::string name,
+         size_t replicas,
+         int window,
+         paxos::NetworkConditions conditions,
+         int decrees)
+{
+    std::unordered_map<std::string, int64_t> proposed;
+    std::vector<int64_t> latencies;
+    latencies.reserve(decrees);
+    int next = 0;
+
+    paxos::SimulatedCluster* simulation = nullptr;
+    auto propose = [&]()
+    {
+        std::string entry = "decree" + std::to_string(next++);
+        proposed[entry] = simulation->GetClock().Now().count();
+        simulation->GetParliament(0).SendProposal(entry);
+    };
+
+    paxos::SimulatedCluster cluster(
+        replicas, conditions, 1,
+        [&](size_t replica, std::string entry)
+        {
+            auto found = proposed.find(entry);
+            if (replica != 0 || found == proposed.end())
+            {
+                return;
+            }
+            latencies.push_back(
+                simulation->GetClock().Now().count() - found->second);
+            proposed.erase(found);
+            if (next < decrees)
+            {
+                propose();
+            }
+        });
+    simulation = &cluster;
+    cluster.GetParliament(0).SetPipelineWindow(window);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i=0; i<window && next < decrees; i++)
+    {
+        propose();
+    }
+    bool done = cluster.GetClock().RunUntil(
+        [&]() { return latencies.size() >= static_cast<size_t>(decrees); },
+        std::chrono::seconds(3600));
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    double virtual_seconds = cluster.GetClock().Now().count() / 1e6;
+    std::printf("%-40s %8zu decrees %10.0f decrees/s wall %10.0f decrees/s virtual"
+                "   p50 %7.0f us  p99 %7.0f us  p999 %7.0f us%s\n",
+                name.c_str(),
+                latencies.size(),
+                latencies.size() / elapsed.count(),
+                latencies.size() / virtual_seconds,
+                Percentile(latencies, 0.5),
+                Percentile(latencies, 0.99),
+                Percentile(latencies, 0.999),
+                done ? "" : "  (stalled)");
+}
+
+
+int main(int argc, char** argv)
+{
+    int decrees = argc > 1 ? std::atoi(argv[1]) : 5000;
+
+    paxos::DisableLogging();
+
+    paxos::NetworkConditions lan(std::chrono::microseconds(200),
+                                 std::chrono::microseconds(100));
+    paxos::NetworkConditions lossy(std::chrono::microseconds(200),
+                                   std::chrono::microseconds(100),
+                                   0.01,
+                                   0.01);
+
+    for (size_t replicas : { 3, 5, 7 })
+    {
+        std::string prefix = "nodes=" + std::to_string(replicas);
+        Run(prefix + " window=1", replicas, 1, lan, decrees);
+        Run(prefix + " window=8", replicas, 8, lan, decrees);
+        Run(prefix + " window=1 loss=1%", replicas, 1, lossy, decrees);
+    }
+    return 0;
+}
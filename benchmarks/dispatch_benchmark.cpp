@@ -0,0 +1,101 @@
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "paxos/logging.hpp"
+#include "paxos/receiver.hpp"
+
+#include "benchmark.hpp"
+
+
+//
+// Server that never receives anything so that messages are handed to the
+// receiver directly.
+//
+class IdleServer
+{
+public:
+
+    IdleServer(std::string address, short port)
+    {
+    }
+
+    void RegisterAction(std::function<void(const std::string& content)> action)
+    {
+    }
+
+    void Start()
+    {
+    }
+};
+
+
+int main(int argc, char** argv)
+{
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 2000000;
+
+    paxos::DisableLogging();
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    paxos::NetworkReceiver<IdleServer, paxos::BinaryCodec> receiver(
+        "localhost", 8080, replicaset);
+
+    //
+    // Every role registers several callbacks; a bound context and sender make
+    // each std::function large enough to allocate when copied.
+    //
+    int handled = 0;
+    auto context = std::make_shared<paxos::Context>();
+    for (int type=0; type<static_cast<int>(paxos::MessageTypeCount); type++)
+    {
+        for (int i=0; i<2; i++)
+        {
+            receiver.RegisterCallback(
+                paxos::Callback(
+                    std::bind(
+                        [&handled](const paxos::Message& message,
+                                   std::shared_ptr<paxos::Context> context,
+                                   std::shared_ptr<paxos::ReplicaSet> replicaset)
+                        {
+                            handled += 1;
+                        },
+                        std::placeholders::_1, context, replicaset)),
+                static_cast<paxos::MessageType>(type));
+        }
+    }
+
+    paxos::Message message(
+        paxos::Decree(paxos::Replica("localhost", 8080), 1, "content",
+                      paxos::DecreeType::UserDecree),
+        paxos::Replica(),
+        paxos::Replica("localhost", 8080),
+        paxos::MessageType::AcceptMessage);
+    std::string encoded = paxos::BinaryCodec::Serialize(message);
+
+    //
+    // Copying the registered callbacks per message is what dispatch used to
+    // cost on top of decoding.
+    //
+    benchmark::Measure("copy callbacks per message (previous)", iterations,
+                       [&](int)
+    {
+        auto callbacks = receiver.GetRegisteredCallbacks(message.type);
+        benchmark::DoNotOptimize(callbacks);
+    });
+
+    benchmark::Measure("decode message", iterations, [&](int)
+    {
+        auto decoded = paxos::BinaryCodec::Deserialize<paxos::Message>(encoded);
+        benchmark::DoNotOptimize(decoded);
+    });
+
+    benchmark::Measure("decode and dispatch message", iterations, [&](int)
+    {
+        receiver.ProcessContent(encoded);
+    });
+
+    benchmark::DoNotOptimize(handled);
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include "paxos/ledger.hpp"
+#include "paxos/wal.hpp"
+
+#include "benchmark.hpp"
+
+
+void Run(std::string name,
+         std::shared_ptr<paxos::BaseQueue<paxos::Decree>> queue,
+         int decrees)
+{
+    paxos::Ledger ledger(queue);
+
+    std::string content(64, 'x');
+    for (int i=1; i<=decrees; i++)
+    {
+        ledger.Append(
+            paxos::Decree(paxos::Replica("host", 8080), i, content,
+                          paxos::DecreeType::UserDecree));
+    }
+
+    std::string suffix = " " + std::to_string(decrees) + " decrees";
+
+    benchmark::Measure(name + " tail" + suffix, 1000,
+        [&](int)
+        {
+            benchmark::DoNotOptimize(ledger.Tail());
+        });
+
+    //
+    // Walk the ledger the way HandleUpdate does when a replica catches up.
+    //
+    int visited = 0;
+    benchmark::Report(name + " catch-up walk" + suffix, decrees,
+        benchmark::Time(1, [&](int)
+        {
+            auto current = ledger.Head();
+            while (current.root_number != 0)
+            {
+                visited += 1;
+                current = ledger.Next(current);
+            }
+        }));
+
+    if (visited != decrees)
+    {
+        std::printf("walk visited %d of %d decrees\n", visited, decrees);
+        std::exit(1);
+    }
+}
+
+
+//
+// Append decrees whose handler takes handler_cost, applying them inline or on
+// the applier thread. Appends are reported separately from the time the
+// applier needs to catch up.
+//
+void RunApply(std::string name,
+              size_t max_lag,
+              std::chrono::microseconds handler_cost,
+              int decrees)
+{
+    std::stringstream ss;
+    paxos::Ledger ledger(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss, 0x40000000),
+        std::make_shared<paxos::CompositeHandler>([handler_cost](std::string)
+        {
+            auto end = std::chrono::steady_clock::now() + handler_cost;
+            while (std::chrono::steady_clock::now() < end)
+            {
+            }
+        }));
+    ledger.SetAsynchronousApply(max_lag);
+
+    std::string content(64, 'x');
+    std::string suffix = " " + std::to_string(decrees) + " decrees";
+    double append = benchmark::Time(decrees, [&](int i)
+        {
+            ledger.Append(
+                paxos::Decree(paxos::Replica("host", 8080), i + 1, content,
+                              paxos::DecreeType::UserDecree));
+        });
+    double drain = benchmark::Time(1, [&](int) { ledger.WaitForApplied(); });
+
+    benchmark::Report(name + " append" + suffix, decrees, append);
+    benchmark::Report(name + " append and apply" + suffix, decrees,
+                      append + drain);
+}
+
+
+//
+// Apply throughput of decrees spread over 64 conflict keys, timed from the
+// first append until every decree is applied. Workers beyond the cores
+// available add handoffs rather than throughput.
+//
+void RunParallelApply(size_t workers,
+                      std::chrono::microseconds handler_cost,
+                      int decrees)
+{
+    std::stringstream ss;
+    paxos::Ledger ledger(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss, 0x40000000),
+        std::make_shared<paxos::CompositeHandler>([handler_cost](std::string)
+        {
+            auto end = std::chrono::steady_clock::now() + handler_cost;
+            while (std::chrono::steady_clock::now() < end)
+            {
+            }
+        }));
+    ledger.SetConflictKey(paxos::DecreeType::UserDecree,
+                          [](std::string entry) { return entry; });
+    ledger.SetAsynchronousApply(4096, workers);
+
+    double apply = benchmark::Time(decrees, [&](int i)
+        {
+            ledger.Append(
+                paxos::Decree(paxos::Replica("host", 8080), i + 1,
+                              "key" + std::to_string(i % 64),
+                              paxos::DecreeType::UserDecree));
+        });
+    apply += benchmark::Time(1, [&](int) { ledger.WaitForApplied(); });
+
+    benchmark::Report(
+        "parallel apply 20us handler " + std::to_string(workers) +
+            " workers " + std::to_string(std::thread::hardware_concurrency()) +
+            " cores " + std::to_string(decrees) + " decrees",
+        decrees,
+        apply);
+}
+
+
+int main(int argc, char** argv)
+{
+    paxos::DisableLogging();
+
+    RunApply("inline apply 20us handler", 0,
+             std::chrono::microseconds(20), 1000);
+    RunApply("async apply 20us handler", 4096,
+             std::chrono::microseconds(20), 1000);
+
+    for (size_t workers : { 1, 2, 4, 8 })
+    {
+        RunParallelApply(workers, std::chrono::microseconds(20), 4000);
+    }
+
+    for (int decrees : { 100, 1000, 10000 })
+    {
+        std::stringstream ss;
+        Run("rollover",
+            std::make_shared<paxos::RolloverQueue<paxos::Decree>>(
+                ss, 0x40000000),
+            decrees);
+
+        //
+        // Small segments so that most of the walk reads sealed, memory
+        // mapped segments.
+        //
+        auto directory = boost::filesystem::temp_directory_path() /
+                         boost::filesystem::unique_path();
+        Run("wal",
+            std::make_shared<paxos::WriteAheadLog<paxos::Decree>>(
+                directory.string(), "ledger", paxos::SyncPolicy::Never,
+                std::chrono::milliseconds(0), 0x10000),
+            decrees);
+        boost::filesystem::remove_all(directory);
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "paxos/logging.hpp"
+#include "paxos/roles.hpp"
+
+#include "benchmark.hpp"
+
+
+class NullSender : public paxos::Sender
+{
+public:
+
+    void Reply(paxos::Message message) override
+    {
+    }
+
+    void ReplyAll(paxos::Message message) override
+    {
+    }
+};
+
+
+//
+// Each round is one prepare and one accept against volatile storage, so the
+// handlers themselves and the log records they emit are all that is timed.
+// Records are written to paxos.log only; the console sink is switched off.
+//
+void Run(std::string name, paxos::LogLevel level, int rounds)
+{
+    auto context = std::make_shared<paxos::AcceptorContext>(
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::VolatileVotes>(),
+        std::chrono::milliseconds(1000));
+    auto sender = std::make_shared<NullSender>();
+
+    paxos::SetLogLevel(level);
+
+    paxos::Replica replica("host", 8080);
+    std::string content(64, 'x');
+    benchmark::Measure(name + " prepare+accept", rounds, [&](int i)
+    {
+        paxos::Decree decree(replica, i + 1, content,
+                             paxos::DecreeType::UserDecree);
+        decree.root_number = i + 1;
+        paxos::HandlePrepare(
+            paxos::Message(decree, replica, replica,
+                           paxos::MessageType::PrepareMessage),
+            context,
+            sender);
+        paxos::HandleAccept(
+            paxos::Message(decree, replica, replica,
+                           paxos::MessageType::AcceptMessage),
+            context,
+            sender);
+    });
+
+    paxos::FlushLogging();
+}
+
+
+int main(int argc, char** argv)
+{
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+    paxos::SetConsoleLogging(false);
+
+    Run("logging off", paxos::LogLevel::Off, rounds);
+    Run("logging warning", paxos::LogLevel::Warning, rounds);
+    Run("logging info", paxos::LogLevel::Info, rounds);
+    return 0;
+}
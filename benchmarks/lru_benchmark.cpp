@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "paxos/decree.hpp"
+#include "paxos/lru_map.hpp"
+#include "paxos/replicaset.hpp"
+
+#include "benchmark.hpp"
+
+
+//
+// The ordered map and deque based lru_map the hashed one replaced, kept here
+// as the baseline.
+//
+template <class Key, class T, class Compare>
+class ordered_lru_map
+{
+public:
+
+    using iterator = typename std::map<Key, T, Compare>::iterator;
+
+    ordered_lru_map(size_t capacity)
+        : capacity(capacity)
+    {
+    }
+
+    T& operator[](const Key e)
+    {
+        if (map.find(e) != map.end())
+        {
+            return map[e];
+        }
+        queue.push_back(e);
+        if (queue.size() > capacity)
+        {
+            auto front = queue[0];
+            queue.pop_front();
+            map.erase(front);
+        }
+        return map[e];
+    }
+
+    iterator find(const Key e)
+    {
+        return map.find(e);
+    }
+
+    void erase(const Key e)
+    {
+        for (size_t i=0; i<queue.size(); i++)
+        {
+            if (Compare{}(queue.at(i), e))
+            {
+                queue.erase(queue.begin() + i);
+                break;
+            }
+        }
+        map.erase(e);
+    }
+
+    iterator end()
+    {
+        return map.end();
+    }
+
+private:
+
+    size_t capacity;
+
+    std::map<Key, T, Compare> map;
+
+    std::deque<Key> queue;
+};
+
+
+//
+// Promise handling as the proposer sees it: every decree is looked up, added
+// to, counted three times for three replicas and erased once it has a quorum,
+// while older decrees that never reach a quorum pile up to capacity.
+//
+template <typename Map, typename Key>
+void Run(std::string name, std::vector<paxos::Decree>& decrees, size_t capacity)
+{
+    Map map(capacity);
+    benchmark::Measure(name, decrees.size(), [&](int i)
+    {
+        Key key(decrees[i]);
+        for (int reply=0; reply<3; reply++)
+        {
+            if (map.find(key) == map.end())
+            {
+                map[key] = std::make_shared<paxos::ReplicaSet>();
+            }
+            map[key]->Add(paxos::Replica("replica", reply));
+        }
+        if (i % 2 == 0)
+        {
+            map.erase(key);
+        }
+    });
+}
+
+
+int main(int argc, char** argv)
+{
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+    std::vector<paxos::Decree> decrees;
+    for (int i=1; i<=iterations; i++)
+    {
+        decrees.emplace_back(paxos::Replica("leader.example.com", 8080), i, "",
+                             paxos::DecreeType::UserDecree);
+    }
+
+    for (size_t capacity : { 256, 4096 })
+    {
+        std::string suffix = " capacity=" + std::to_string(capacity);
+        Run<ordered_lru_map<paxos::Decree,
+                            std::shared_ptr<paxos::ReplicaSet>,
+                            paxos::compare_map_decree>,
+            paxos::Decree>(
+            "ordered lru_map" + suffix, decrees, capacity);
+        Run<paxos::lru_map<paxos::DecreeId,
+                           std::shared_ptr<paxos::ReplicaSet>,
+                           paxos::hash_map_decree,
+                           paxos::equal_map_decree>,
+            paxos::DecreeId>(
+            "hashed lru_map" + suffix, decrees, capacity);
+    }
+    return 0;
+}
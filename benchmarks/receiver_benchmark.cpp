@@ -0,0 +1,106 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "paxos/logging.hpp"
+#include "paxos/receiver.hpp"
+#include "paxos/sender.hpp"
+
+#include "benchmark.hpp"
+
+
+//
+// One role per context. Each handler holds its role lock for a while to stand
+// in for the ledger and decree file I/O the real handlers do.
+//
+struct RoleContext : public paxos::Context
+{
+    std::mutex mutex;
+};
+
+
+double Run(size_t threads, short port, int messages, int connections,
+           std::chrono::microseconds work)
+{
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    paxos::NetworkReceiver<paxos::AsynchronousServer, paxos::BinaryCodec>
+        receiver("127.0.0.1", port, replicaset, threads);
+
+    std::atomic<int> handled(0);
+    std::vector<paxos::MessageType> types {
+        paxos::MessageType::RequestMessage,
+        paxos::MessageType::PrepareMessage,
+        paxos::MessageType::AcceptedMessage,
+        paxos::MessageType::UpdateMessage,
+    };
+    for (paxos::MessageType type : types)
+    {
+        auto context = std::make_shared<RoleContext>();
+        receiver.RegisterCallback(
+            paxos::Callback(
+                [context, &handled, work](const paxos::Message& message)
+                {
+                    std::lock_guard<std::mutex> lock(context->mutex);
+                    std::this_thread::sleep_for(work);
+                    handled += 1;
+                },
+                context),
+            type);
+    }
+
+    std::vector<std::unique_ptr<paxos::BoostTransport>> transports;
+    for (int i=0; i<connections; i++)
+    {
+        transports.emplace_back(
+            new paxos::BoostTransport("127.0.0.1", port));
+    }
+
+    std::string content(128, 'x');
+    return benchmark::Time(1, [&](int)
+    {
+        for (int i=0; i<messages; i++)
+        {
+            paxos::Message message(
+                paxos::Decree(paxos::Replica("127.0.0.1", port), i, content,
+                              paxos::DecreeType::UserDecree),
+                paxos::Replica(),
+                paxos::Replica("127.0.0.1", port),
+                types[i % types.size()]);
+            transports[i % connections]->Write(
+                paxos::BinaryCodec::Serialize(message));
+        }
+        while (handled < messages)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+}
+
+
+int main(int argc, char** argv)
+{
+    int messages = argc > 1 ? std::atoi(argv[1]) : 20000;
+    auto work = std::chrono::microseconds(argc > 2 ? std::atoi(argv[2]) : 20);
+    int connections = 4;
+
+    paxos::DisableLogging();
+
+    //
+    // Servers keep their port until the process exits so every run listens
+    // on a port of its own.
+    //
+    short port = 19100;
+    for (size_t threads : { 0, 1, 2, 4, 8 })
+    {
+        benchmark::Report(
+            "messages threads=" + std::to_string(threads),
+            messages,
+            Run(threads, port++, messages, connections, work));
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "paxos/serialization.hpp"
+
+#include "benchmark.hpp"
+
+
+paxos::Message CreateMessage(size_t content_size)
+{
+    return paxos::Message(
+        paxos::Decree(
+            paxos::Replica("replica-hostname.example.com", 8080),
+            123456,
+            std::string(content_size, 'x'),
+            paxos::DecreeType::UserDecree),
+        paxos::Replica("replica-hostname.example.com", 8080),
+        paxos::Replica("another-hostname.example.com", 8081),
+        paxos::MessageType::AcceptMessage);
+}
+
+
+template <typename Codec>
+bool RoundTrip(const paxos::Message& expected)
+{
+    auto actual = Codec::template Deserialize<paxos::Message>(
+        Codec::Serialize(expected));
+    return actual.type == expected.type &&
+           actual.decree.number == expected.decree.number &&
+           actual.decree.root_number == expected.decree.root_number &&
+           actual.decree.content == expected.decree.content &&
+           actual.decree.author.hostname == expected.decree.author.hostname &&
+           actual.from.port == expected.from.port &&
+           actual.to.hostname == expected.to.hostname;
+}
+
+
+template <typename Codec>
+void Run(std::string codec, size_t content_size, int iterations)
+{
+    auto message = CreateMessage(content_size);
+    auto encoded = Codec::Serialize(message);
+    std::string suffix = " " + std::to_string(content_size) + "B";
+
+    if (!RoundTrip<Codec>(message))
+    {
+        std::printf("%s round trip failed\n", codec.c_str());
+        std::exit(1);
+    }
+
+    benchmark::Measure(codec + " serialize" + suffix, iterations,
+        [&](int)
+        {
+            benchmark::DoNotOptimize(Codec::Serialize(message));
+        });
+    benchmark::Measure(codec + " deserialize" + suffix, iterations,
+        [&](int)
+        {
+            benchmark::DoNotOptimize(
+                Codec::template Deserialize<paxos::Message>(encoded));
+        });
+    benchmark::Measure(codec + " round trip" + suffix, iterations,
+        [&](int)
+        {
+            benchmark::DoNotOptimize(
+                Codec::template Deserialize<paxos::Message>(
+                    Codec::Serialize(message)));
+        });
+    std::printf("%-48s %10zu bytes\n", (codec + " encoded size" + suffix).c_str(),
+                encoded.size());
+}
+
+
+int main(int argc, char** argv)
+{
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+    for (size_t content_size : {0, 64, 4096})
+    {
+        Run<paxos::TextCodec>("text", content_size, iterations);
+        Run<paxos::BinaryCodec>("binary", content_size, iterations);
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "paxos/decree.hpp"
+#include "paxos/logging.hpp"
+#include "paxos/wal.hpp"
+
+#include "benchmark.hpp"
+
+
+//
+// Appends decrees from several threads the way Ledger::Append does: the
+// enqueue happens under the ledger lock so decrees stay in order, and the wait
+// for durability happens outside of it.
+//
+double Run(std::shared_ptr<paxos::BaseQueue<paxos::Decree>> queue,
+           int threads,
+           int appends)
+{
+    std::mutex mutex;
+    int root_number = 0;
+    std::string content(64, 'x');
+
+    return benchmark::Time(1, [&](int)
+    {
+        std::vector<std::thread> workers;
+        for (int t=0; t<threads; t++)
+        {
+            workers.push_back(std::thread([&]()
+            {
+                for (int i=0; i<appends / threads; i++)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        root_number += 1;
+                        queue->Enqueue(
+                            paxos::Decree(paxos::Replica("host", 8080),
+                                          root_number, content,
+                                          paxos::DecreeType::UserDecree));
+                    }
+                    queue->Sync();
+                }
+            }));
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    });
+}
+
+
+int main(int argc, char** argv)
+{
+    //
+    // Pass a directory on the device under test; the system temporary
+    // directory is often memory backed and makes fdatasync free.
+    //
+    auto directory = boost::filesystem::path(argc > 1 ? argv[1] : ".") /
+                     boost::filesystem::unique_path();
+    int appends = 2000;
+
+    paxos::DisableLogging();
+
+    std::vector<std::pair<std::string, paxos::SyncPolicy>> policies {
+        { "always", paxos::SyncPolicy::Always },
+        { "interval", paxos::SyncPolicy::Interval },
+        { "never", paxos::SyncPolicy::Never },
+    };
+
+    for (int threads : { 1, 8 })
+    {
+        std::string suffix = " threads=" + std::to_string(threads);
+
+        boost::filesystem::create_directories(directory);
+        benchmark::Report(
+            "rollover queue" + suffix,
+            appends,
+            Run(std::make_shared<paxos::RolloverQueue<paxos::Decree>>(
+                    directory.string(), "ledger", 0x40000000),
+                threads, appends));
+        boost::filesystem::remove_all(directory);
+
+        for (auto& policy : policies)
+        {
+            boost::filesystem::create_directories(directory);
+            benchmark::Report(
+                "wal " + policy.first + suffix,
+                appends,
+                Run(std::make_shared<paxos::WriteAheadLog<paxos::Decree>>(
+                        directory.string(), "ledger", policy.second),
+                    threads, appends));
+            boost::filesystem::remove_all(directory);
+        }
+    }
+    return 0;
+}
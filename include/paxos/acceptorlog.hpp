@@ -0,0 +1,216 @@
+#ifndef __ACCEPTORLOG_HPP_INCLUDED__
+#define __ACCEPTORLOG_HPP_INCLUDED__
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "paxos/decree.hpp"
+#include "paxos/fields.hpp"
+
+
+namespace paxos
+{
+
+
+enum class AcceptorField
+{
+    Promised,
+    Accepted
+};
+
+
+struct AcceptorRecord
+{
+    AcceptorField field;
+    Decree decree;
+
+    AcceptorRecord()
+        : field(AcceptorField::Promised), decree()
+    {
+    }
+
+    AcceptorRecord(AcceptorField f, Decree d)
+        : field(f), decree(d)
+    {
+    }
+};
+
+
+template <typename Archive>
+void serialize(Archive& ar, AcceptorRecord& obj, const unsigned int version)
+{
+    ar & obj.field;
+    ar & obj.decree;
+}
+
+
+struct AcceptorState
+{
+    Decree promised;
+    Decree accepted;
+
+    //
+    // Votes that have not been learned yet keyed by root number. The accepted
+    // decree is the vote with the highest root.
+    //
+    std::map<int, Decree> votes;
+};
+
+
+class AcceptorLogException : public std::runtime_error
+{
+public:
+
+    AcceptorLogException(const std::string& what)
+        : std::runtime_error(what)
+    {
+    }
+};
+
+
+/*
+ * Promised and accepted decrees of an acceptor kept in one append-only file.
+ * Every update appends a single record framed by a 32-bit little-endian
+ * length and a CRC-32 and is synced before Put returns, so a promise or an
+ * accept costs one sequential write. Each accepted record is also a vote for
+ * its root and the accepted decree is the vote with the highest root; an
+ * accepted record without content retires the votes up to its root. On
+ * startup the records are replayed and a torn record at the end is cut off.
+ * Once the file holds compact_records records it is rewritten with just the
+ * current state next to the log and renamed over it.
+ */
+class AcceptorLog
+{
+public:
+
+    AcceptorLog(std::string dirname,
+                std::string filename=ACCEPTOR_LOG_FILENAME,
+                size_t compact_records=1024);
+
+    ~AcceptorLog();
+
+    Decree Get(AcceptorField field);
+
+    void Put(AcceptorField field, const Decree& decree);
+
+    //
+    // Record a vote, e.g. for a root below the accepted decree. Nothing is
+    // written if the same vote is already recorded, as it is when the vote
+    // was just put as the accepted decree.
+    //
+    void Vote(const Decree& decree);
+
+    //
+    // Votes for root numbers of at least root_number in root order.
+    //
+    std::vector<Decree> Votes(int root_number);
+
+    //
+    // Forget votes up to root_number. They are dropped from the file on the
+    // next compaction.
+    //
+    void Retire(int root_number);
+
+    //
+    // Rewrite the log so that it only holds the current state.
+    //
+    void Compact();
+
+    size_t Records();
+
+    //
+    // Read the state stored in a log without opening it for writing, e.g. to
+    // copy the state of a log another thread is appending to.
+    //
+    static AcceptorState Load(std::string dirname,
+                              std::string filename=ACCEPTOR_LOG_FILENAME);
+
+private:
+
+    std::string dirname;
+
+    std::string path;
+
+    size_t compact_records;
+
+    int fd;
+
+    size_t records;
+
+    AcceptorState state;
+
+    std::mutex mutex;
+
+    static size_t replay(const std::string& content,
+                         AcceptorState& state,
+                         size_t& records);
+
+    static void apply(const AcceptorRecord& record, AcceptorState& state);
+
+    static std::string frame(const AcceptorRecord& record);
+
+    void append(const AcceptorRecord& record);
+
+    void write_all(int fd, const std::string& buffer);
+
+    void sync_file(int fd);
+
+    void sync_directory();
+
+    void compact();
+};
+
+
+//
+// Exposes one field of an acceptor log as storage so that it can back the
+// fields of an acceptor context.
+//
+class AcceptorLogStorage : public Storage<Decree>
+{
+public:
+
+    AcceptorLogStorage(std::shared_ptr<AcceptorLog> log, AcceptorField field);
+
+    Decree Get();
+
+    void Put(Decree decree);
+
+private:
+
+    std::shared_ptr<AcceptorLog> log;
+
+    AcceptorField field;
+};
+
+
+//
+// Exposes the votes of an acceptor log so that they can back the votes of an
+// acceptor context.
+//
+class AcceptorLogVotes : public VoteStorage
+{
+public:
+
+    AcceptorLogVotes(std::shared_ptr<AcceptorLog> log);
+
+    void Put(Decree decree);
+
+    std::vector<Decree> From(int root_number);
+
+    void Retire(int root_number);
+
+private:
+
+    std::shared_ptr<AcceptorLog> log;
+};
+
+
+}
+
+
+#endif
@@ -2,6 +2,13 @@
 #define __BOOTSTRAP_HPP_INCLUDED__
 
 #include <fstream>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
@@ -9,6 +16,7 @@
 #include <boost/range/iterator_range.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include "paxos/acceptorlog.hpp"
 #include "paxos/fields.hpp"
 #include "paxos/file.hpp"
 #include "paxos/replicaset.hpp"
@@ -26,7 +34,52 @@ class Listener
 };
 
 
-template<typename Server>
+//
+// Manifest sent ahead of the files of a bootstrap.
+//
+const std::string BootstrapManifestFilename = "paxos.manifest";
+
+
+//
+// Suffix of the staging file a file listed in the manifest is written to
+// until the bootstrap commits.
+//
+const std::string BootstrapPartialSuffix = ".partial";
+
+
+//
+// CRC-32 of the first size bytes of the file at path.
+//
+uint32_t BootstrapFileChecksum(std::string path, uint64_t size);
+
+
+//
+// Move the staged files into place and write the replica set last. Staged
+// files are synced and a staged replica set records that the bootstrap is
+// committing before anything is renamed, so RecoverBootstrap can finish the
+// commit after a crash. Renaming the replica set into place completes it.
+//
+bool CommitBootstrap(const std::vector<std::string>& staged,
+                     std::string replicaset,
+                     std::string content);
+
+
+//
+// Finish a commit a crash interrupted, or remove the staged files of a
+// bootstrap that never committed. Run before a replica reads its files.
+//
+void RecoverBootstrap(std::string directory);
+
+
+/*
+ * Receives bootstrap files. Chunks may arrive on several connections at once
+ * and in any order. Files listed in a manifest are staged beside their final
+ * names and only renamed into place when the final replica set file arrives
+ * and every one of them verifies. The replica set is renamed last and marks
+ * the commit, which RecoverBootstrap completes if a crash interrupts it, so a
+ * replica never starts on a mix of old and new files.
+ */
+template<typename Server, typename Codec=TextCodec>
 class BootstrapListener : public Listener
 {
 public:
@@ -34,44 +87,253 @@ public:
     BootstrapListener(
         std::shared_ptr<ReplicaSet>& legislators,
         std::string address,
-        short port)
+        short port,
+        std::function<void()> bootstrapped=[](){})
         : server(boost::make_shared<Server>(address, port))
     {
-        server->RegisterAction([this, &legislators](std::string content){
-            // write out file
-            BootstrapFile bootstrap = Deserialize<BootstrapFile>(content);
-            std::fstream file(
-                bootstrap.name,
-                std::ios::out | std::ios::trunc | std::ios::binary);
-            file << bootstrap.content;
+        server->RegisterAction([this, &legislators, bootstrapped](
+                                   std::string content) -> bool {
+            BootstrapFile bootstrap =
+                Codec::template Deserialize<BootstrapFile>(content);
+
+            if (bootstrap.probe > 0)
+            {
+                return reuse(bootstrap);
+            }
 
             //
-            // We should ensure that the files are flushed to disk to prevent
-            // situations where roles on the node operate using data from
-            // previous replica set.
+            // A corrupt chunk is not written. The ack tells the sender to
+            // send it again from the same offset.
             //
-            file.flush();
+            if (BootstrapChecksum(bootstrap.content) != bootstrap.checksum)
+            {
+                return false;
+            }
+
+            if (boost::algorithm::ends_with(bootstrap.name,
+                                            BootstrapManifestFilename))
+            {
+                return stage(Codec::template Deserialize<BootstrapManifest>(
+                    bootstrap.content));
+            }
 
             if (boost::algorithm::ends_with(bootstrap.name, ReplicasetFilename))
             {
+                //
+                // The empty replica set that opens a bootstrap discards
+                // anything staged by an earlier one that never finished.
+                //
+                std::lock_guard<std::mutex> lock(mutex);
+                if (bootstrap.content.empty())
+                {
+                    discard();
+                    if (!write(bootstrap.name, bootstrap, true))
+                    {
+                        return false;
+                    }
+                }
+                else if (!commit(bootstrap.name, bootstrap.content))
+                {
+                    return false;
+                }
                 legislators =  LoadReplicaSet(
                     std::stringstream(bootstrap.content));
+                bootstrapped();
+                return true;
             }
+
+            std::string name = staged_name(bootstrap.name);
+            return write(name, bootstrap,
+                         name == bootstrap.name && bootstrap.offset == 0);
         });
         server->Start();
     }
 
 private:
 
+    //
+    // Write a chunk at its offset. Staged files are not truncated because
+    // their chunks may arrive in any order; stage() clears them instead.
+    //
+    bool write(const std::string& name,
+               const BootstrapFile& bootstrap,
+               bool truncate)
+    {
+        int fd = ::open(name.c_str(),
+                        O_WRONLY | O_CREAT | (truncate ? O_TRUNC : 0),
+                        0644);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        size_t written = 0;
+        while (written < bootstrap.content.size())
+        {
+            ssize_t result = ::pwrite(fd,
+                                      bootstrap.content.data() + written,
+                                      bootstrap.content.size() - written,
+                                      bootstrap.offset + written);
+            if (result < 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            written += result;
+        }
+        ::close(fd);
+        return true;
+    }
+
+    bool stage(const BootstrapManifest& manifest)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        discard();
+        for (const auto& entry : manifest.files)
+        {
+            boost::system::error_code ec;
+            boost::filesystem::remove(entry.name + BootstrapPartialSuffix, ec);
+            staged[entry.name] = entry;
+        }
+        return true;
+    }
+
+    //
+    // Answer a probe. When the file already on disk holds the probed bytes
+    // they are copied into the staging file and the sender skips the chunk.
+    //
+    bool reuse(const BootstrapFile& probe)
+    {
+        std::string name = staged_name(probe.name);
+        if (name == probe.name)
+        {
+            return false;
+        }
+
+        int fd = ::open(probe.name.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        std::string content(probe.probe, '\0');
+        size_t read = 0;
+        while (read < content.size())
+        {
+            ssize_t result = ::pread(fd, &content[read], content.size() - read,
+                                     probe.offset + read);
+            if (result <= 0)
+            {
+                break;
+            }
+            read += result;
+        }
+        ::close(fd);
+
+        if (read != content.size() ||
+            BootstrapChecksum(content) != probe.checksum)
+        {
+            return false;
+        }
+        return write(name, BootstrapFile(name, content, probe.offset), false);
+    }
+
+    //
+    // Called with the mutex held.
+    //
+    void discard()
+    {
+        for (const auto& entry : staged)
+        {
+            boost::system::error_code ec;
+            boost::filesystem::remove(entry.first + BootstrapPartialSuffix, ec);
+        }
+        staged.clear();
+    }
+
+    std::string staged_name(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (staged.find(name) == staged.end())
+        {
+            return name;
+        }
+        return name + BootstrapPartialSuffix;
+    }
+
+    //
+    // Verify every staged file and commit them along with the replica set.
+    // Nothing is renamed unless all of them verify. Called with the mutex
+    // held.
+    //
+    bool commit(const std::string& replicaset, const std::string& content)
+    {
+        std::vector<std::string> names;
+        for (const auto& entry : staged)
+        {
+            std::string partial = entry.first + BootstrapPartialSuffix;
+            boost::system::error_code ec;
+            uint64_t size = boost::filesystem::file_size(partial, ec);
+            if (ec || size != entry.second.size ||
+                BootstrapFileChecksum(partial, size) != entry.second.checksum)
+            {
+                return false;
+            }
+            names.push_back(entry.first);
+        }
+        if (!CommitBootstrap(names, replicaset, content))
+        {
+            return false;
+        }
+        staged.clear();
+        return true;
+    }
+
     boost::shared_ptr<Server> server;
+
+    std::mutex mutex;
+
+    std::unordered_map<std::string, BootstrapManifestEntry> staged;
 };
 
 
+//
+// Largest chunk of a file held in memory while bootstrapping.
+//
+const size_t BootstrapChunkSize = 1 << 20;
+
+
+//
+// Attempts made to send a chunk before a bootstrap gives up.
+//
+const size_t BootstrapRetries = 5;
+
+
+//
+// Connections a bootstrap sends chunks over in parallel.
+//
+const size_t BootstrapStreams = 4;
+
+
+//
+// Send a replica everything it needs to join. An empty replica set goes
+// first and the real one last; in between a manifest lists every other file,
+// whose chunks are then sent from streams threads at once. With more than one
+// stream sender must be safe to call concurrently. Memory stays bounded by
+// streams chunks of chunk_size however large the ledger is.
+//
+// When prober is given each chunk of a replicated file is first offered as a
+// probe and only sent if prober returns false, so a replica that rejoins with
+// most of its ledger on disk receives just the chunks that differ.
+//
 void SendBootstrap(
     std::string local_directory,
     std::string remote_directory,
     std::vector<boost::filesystem::directory_entry> filepaths,
-    std::function<void(BootstrapFile)> sender);
+    std::function<void(BootstrapFile)> sender,
+    size_t chunk_size=BootstrapChunkSize,
+    size_t streams=1,
+    std::function<bool(BootstrapFile)> prober=nullptr);
 
 
 }
@@ -12,7 +12,7 @@ namespace paxos
 {
 
 
-using MessageHandler = std::function<void(Message message)>;
+using MessageHandler = std::function<void(const Message& message)>;
 
 class Callback
 {
@@ -20,11 +20,22 @@ public:
 
     Callback(MessageHandler message_handler);
 
-    void operator()(Message message);
+    //
+    // Callbacks registered with the same context belong to the same role and
+    // are never run concurrently by a multi-threaded receiver.
+    //
+    Callback(MessageHandler message_handler,
+             std::shared_ptr<Context> context);
+
+    void operator()(const Message& message) const;
+
+    Context* GetContext() const;
 
 private:
 
     MessageHandler message_handler;
+
+    std::shared_ptr<Context> context;
 };
 
 
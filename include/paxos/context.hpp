@@ -11,6 +11,7 @@
 #include <mutex>
 #include <queue>
 #include <tuple>
+#include <unordered_set>
 #include <vector>
 
 #include "paxos/decree.hpp"
@@ -29,6 +30,16 @@ namespace paxos
 
 struct Context
 {
+    //
+    // Roles read the time through their context so that a simulation can run
+    // them on a virtual clock.
+    //
+    std::function<std::chrono::high_resolution_clock::time_point()> now;
+
+    Context()
+        : now(std::chrono::high_resolution_clock::now)
+    {
+    }
 };
 
 
@@ -37,11 +48,11 @@ struct ProposerContext : public Context
     std::shared_ptr<Ledger>& ledger;
     Field<Decree> highest_proposed_decree;
     std::shared_ptr<ReplicaSet>& replicaset;
-    paxos::lru_map<Decree, std::shared_ptr<ReplicaSet>, compare_map_decree> promise_map;
-    std::set<Decree, compare_decree> ntie_map;
-    paxos::lru_map<Decree, std::tuple<std::shared_ptr<ReplicaSet>, bool>, compare_map_decree> nprepare_map;
-    paxos::lru_set<Decree, compare_root_decree> resume_map;
-    paxos::lru_map<Decree, std::shared_ptr<ReplicaSet>, compare_map_decree> naccept_map;
+    paxos::lru_map<DecreeId, VoteSet, hash_map_decree, equal_map_decree> promise_map;
+    std::unordered_set<DecreeId, hash_decree, equal_decree> ntie_map;
+    paxos::lru_map<DecreeId, std::tuple<VoteSet, bool>, hash_map_decree, equal_map_decree> nprepare_map;
+    paxos::lru_set<DecreeId, hash_root_decree, equal_root_decree> resume_map;
+    paxos::lru_map<DecreeId, VoteSet, hash_map_decree, equal_map_decree> naccept_map;
     std::deque<std::tuple<std::string, DecreeType, paxos::Replica>> requested_values;
 
     std::mutex mutex;
@@ -52,6 +63,46 @@ struct ProposerContext : public Context
     std::shared_ptr<Pause> pause;
     std::shared_ptr<Signal>& signal;
 
+    //
+    // Number of consecutive root decrees that a stable leader may have in
+    // flight at once. A window of one disables multi-paxos so that every
+    // decree runs a full prepare and promise round. Learners request updates
+    // for holes larger than ten decrees, so the window should stay below that.
+    //
+    int pipeline_window;
+
+    //
+    // Set once a prepare for leader_decree gathered a quorum of promises.
+    // While set, new requests skip phase 1 and reuse the prepared ballot.
+    //
+    bool is_leader;
+    Decree leader_decree;
+
+    //
+    // Accepts issued by the leader under leader_decree keyed by root number.
+    //
+    std::map<int, Decree> inflight_decrees;
+
+    //
+    // Accepts that were in flight when the leader stepped down keyed by root
+    // number. A quorum may already have chosen any of them, so each is driven
+    // again at its own root and only proposed anew once the ledger holds a
+    // different decree at that root.
+    //
+    std::map<int, Decree> recovering_decrees;
+
+    //
+    // Batching coalesces queued user decrees into a single batch decree of at
+    // most batch_max_bytes of content. A size of zero disables batching. When
+    // batch_max_delay is set a request may wait that long for the batch to
+    // fill before a prepare is sent; batch_deadline is when the wait ends and
+    // batch_timer nudges the proposer then.
+    //
+    size_t batch_max_bytes;
+    std::chrono::milliseconds batch_max_delay;
+    std::chrono::high_resolution_clock::time_point batch_deadline;
+    Timer batch_timer;
+
     ProposerContext(
         std::shared_ptr<ReplicaSet>& replicaset_,
         std::shared_ptr<Ledger>& ledger_,
@@ -74,7 +125,16 @@ struct ProposerContext : public Context
           nacktie_time(std::chrono::high_resolution_clock::now()),
           interval(std::chrono::milliseconds(1000)),
           pause(pause),
-          signal(signal)
+          signal(signal),
+          pipeline_window(1),
+          is_leader(false),
+          leader_decree(),
+          inflight_decrees(),
+          recovering_decrees(),
+          batch_max_bytes(0),
+          batch_max_delay(std::chrono::milliseconds(0)),
+          batch_deadline(),
+          batch_timer()
     {
     }
 };
@@ -84,7 +144,13 @@ struct AcceptorContext : public Context
 {
     Field<Decree> promised_decree;
     Field<Decree> accepted_decree;
-    paxos::lru_set<Decree, compare_decree> accepted_set;
+
+    //
+    // Votes for every root that has not been learned yet, including roots
+    // below the accepted decree that a pipelining leader resent.
+    //
+    std::shared_ptr<VoteStorage> accepted_votes;
+    paxos::lru_set<DecreeId, hash_decree, equal_decree> accepted_set;
     std::chrono::high_resolution_clock::time_point accepted_time;
     std::chrono::milliseconds interval;
     std::mutex mutex;
@@ -92,10 +158,12 @@ struct AcceptorContext : public Context
     AcceptorContext(
         std::shared_ptr<Storage<Decree>> promised_decree_,
         std::shared_ptr<Storage<Decree>> accepted_decree_,
+        std::shared_ptr<VoteStorage> accepted_votes_,
         std::chrono::milliseconds interval_
     )
         : promised_decree(promised_decree_),
           accepted_decree(accepted_decree_),
+          accepted_votes(accepted_votes_),
           accepted_set(256),
           accepted_time(std::chrono::high_resolution_clock::now()),
           interval(interval_),
@@ -108,7 +176,7 @@ struct AcceptorContext : public Context
 struct LearnerContext : public Context
 {
     std::shared_ptr<ReplicaSet>& replicaset;
-    paxos::lru_map<Decree, std::shared_ptr<ReplicaSet>, compare_map_decree> accepted_map;
+    paxos::lru_map<DecreeId, VoteSet, hash_map_decree, equal_map_decree> accepted_map;
     std::shared_ptr<Ledger>& ledger;
     std::priority_queue<Decree, std::vector<Decree>, ascending_decree> tracked_future_decrees;
     bool is_observer;
@@ -134,10 +202,21 @@ struct UpdaterContext : public Context
 {
     std::shared_ptr<Ledger>& ledger;
 
+    //
+    // Catch-up replies carry a contiguous run of at most update_window_entries
+    // decrees and update_window_bytes of content. The lagging replica asks for
+    // the next run only once it has appended the previous one. A window of one
+    // entry answers every update with a single decree.
+    //
+    std::atomic<size_t> update_window_entries;
+    std::atomic<size_t> update_window_bytes;
+
     UpdaterContext(
         std::shared_ptr<Ledger>& ledger_
     )
-        : ledger(ledger_)
+        : ledger(ledger_),
+          update_window_entries(1),
+          update_window_bytes(0x100000)
     {
     }
 };
@@ -1,7 +1,9 @@
 #ifndef __DECREE_HPP_INCLUDED__
 #define __DECREE_HPP_INCLUDED__
 
+#include <functional>
 #include <string>
+#include <type_traits>
 
 #include "paxos/replicaset.hpp"
 
@@ -25,7 +27,13 @@ enum class DecreeType
     //
     // Remove node decree.
     //
-    RemoveReplicaDecree
+    RemoveReplicaDecree,
+
+    //
+    // Several user decrees passed as one round of paxos. The content is a
+    // binary archive of the user decree contents in proposal order.
+    //
+    BatchDecree
 };
 
 
@@ -75,33 +83,33 @@ struct Decree
     }
 };
 
-int CompareDecrees(Decree lhs, Decree rhs);
+int CompareDecrees(const Decree& lhs, const Decree& rhs);
 
-int CompareRootDecrees(Decree lhs, Decree rhs);
+int CompareRootDecrees(const Decree& lhs, const Decree& rhs);
 
-bool IsDecreeHigher(Decree lhs, Decree rhs);
+bool IsDecreeHigher(const Decree& lhs, const Decree& rhs);
 
-bool IsDecreeHigherOrEqual(Decree lhs, Decree rhs);
+bool IsDecreeHigherOrEqual(const Decree& lhs, const Decree& rhs);
 
-bool IsDecreeEqual(Decree lhs, Decree rhs);
+bool IsDecreeEqual(const Decree& lhs, const Decree& rhs);
 
-bool IsDecreeIdentical(Decree lhs, Decree rhs);
+bool IsDecreeIdentical(const Decree& lhs, const Decree& rhs);
 
-bool IsDecreeLower(Decree lhs, Decree rhs);
+bool IsDecreeLower(const Decree& lhs, const Decree& rhs);
 
-bool IsDecreeLowerOrEqual(Decree lhs, Decree rhs);
+bool IsDecreeLowerOrEqual(const Decree& lhs, const Decree& rhs);
 
-bool IsDecreeOrdered(Decree lhs, Decree rhs);
+bool IsDecreeOrdered(const Decree& lhs, const Decree& rhs);
 
-bool IsRootDecreeOrdered(Decree lhs, Decree rhs);
+bool IsRootDecreeOrdered(const Decree& lhs, const Decree& rhs);
 
-bool IsRootDecreeEqual(Decree lhs, Decree rhs);
+bool IsRootDecreeEqual(const Decree& lhs, const Decree& rhs);
 
-bool IsRootDecreeHigher(Decree lhs, Decree rhs);
+bool IsRootDecreeHigher(const Decree& lhs, const Decree& rhs);
 
-bool IsRootDecreeLower(Decree lhs, Decree rhs);
+bool IsRootDecreeLower(const Decree& lhs, const Decree& rhs);
 
-bool IsRootDecreeHigherOrEqual(Decree lhs, Decree rhs);
+bool IsRootDecreeHigherOrEqual(const Decree& lhs, const Decree& rhs);
 
 struct compare_decree
 {
@@ -139,6 +147,98 @@ struct compare_map_decree
     }
 };
 
+/*
+ * DecreeId identifies a decree without its content so that maps and sets kept
+ * per decree neither copy nor compare payloads. The author is an interned
+ * replica id.
+ */
+
+struct DecreeId
+{
+    int number;
+
+    int root_number;
+
+    ReplicaId author;
+
+    DecreeId()
+        : number(), root_number(), author()
+    {
+    }
+
+    explicit DecreeId(const Decree& decree)
+        : number(decree.number),
+          root_number(decree.root_number),
+          author(InternReplica(decree.author))
+    {
+    }
+};
+
+static_assert(std::is_trivially_copyable<DecreeId>::value,
+              "DecreeId must stay trivially copyable");
+
+//
+// Hash and equality pairs over decree ids matching the equivalence of the
+// decree comparators. Ids are equal under hash_decree when their number and
+// root number match, under hash_root_decree when their root numbers match and
+// under hash_map_decree when their author matches too.
+//
+inline size_t combine_hash(size_t seed, size_t value)
+{
+    return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+struct hash_decree
+{
+    size_t operator()(const DecreeId& id) const
+    {
+        return combine_hash(std::hash<int>()(id.number),
+                            std::hash<int>()(id.root_number));
+    }
+};
+
+struct equal_decree
+{
+    bool operator()(const DecreeId& lhs, const DecreeId& rhs) const
+    {
+        return lhs.number == rhs.number && lhs.root_number == rhs.root_number;
+    }
+};
+
+struct hash_root_decree
+{
+    size_t operator()(const DecreeId& id) const
+    {
+        return std::hash<int>()(id.root_number);
+    }
+};
+
+struct equal_root_decree
+{
+    bool operator()(const DecreeId& lhs, const DecreeId& rhs) const
+    {
+        return lhs.root_number == rhs.root_number;
+    }
+};
+
+struct hash_map_decree
+{
+    size_t operator()(const DecreeId& id) const
+    {
+        return combine_hash(hash_decree()(id), std::hash<ReplicaId>()(id.author));
+    }
+};
+
+struct equal_map_decree
+{
+    bool operator()(const DecreeId& lhs, const DecreeId& rhs) const
+    {
+        return lhs.number == rhs.number &&
+               lhs.root_number == rhs.root_number &&
+               lhs.author == rhs.author;
+    }
+};
+
 struct ascending_decree
 {
     bool operator()(const Decree& lhs, const Decree& rhs) const
@@ -2,6 +2,16 @@
 #define __FIELDS_HPP_INCLUDED__
 
 #include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <boost/filesystem.hpp>
 
@@ -14,12 +24,20 @@ namespace paxos
 
 const std::string LEDGER_FILENAME = "paxos.ledger";
 
+const std::string LEDGER_LOG_FILENAME = "paxos.wal";
+
+const std::string SNAPSHOT_FILENAME = "paxos.snapshot";
+
+const std::string APPLIED_DECREE_FILENAME = "paxos.applied_decree";
+
 const std::string HIGHEST_PROPOSED_DECREE_FILENAME = "paxos.highest_proposed_decree";
 
 const std::string PROMISED_DECREE_FILENAME = "paxos.promised_decree";
 
 const std::string ACCEPTED_DECREE_FILENAME = "paxos.accepted_decree";
 
+const std::string ACCEPTOR_LOG_FILENAME = "paxos.acceptor";
+
 
 template <typename T>
 class Storage
@@ -29,6 +47,14 @@ public:
     virtual T Get() = 0;
 
     virtual void Put(T data) = 0;
+
+    //
+    // Drop anything cached after the underlying files were replaced, e.g. by
+    // a bootstrap.
+    //
+    virtual void Reload()
+    {
+    }
 };
 
 
@@ -108,35 +134,173 @@ private:
 };
 
 
+class StorageException : public std::runtime_error
+{
+public:
+
+    StorageException(const std::string& what)
+        : std::runtime_error(what)
+    {
+    }
+};
+
+
+/*
+ * File backed storage whose Put returns only once the value is on disk. The
+ * value is written to a sibling temporary file, synced and renamed over the
+ * original so a crash leaves either the previous or the new value, never a
+ * torn mix of both.
+ */
 template <typename T>
-class PersistentStorageWrapper : public Storage<T>
+class DurableStorage : public Storage<T>
 {
 public:
 
-    PersistentStorageWrapper(std::string dirname, std::string filename)
+    DurableStorage(std::string dirname, std::string filename)
+        : dirname(dirname),
+          path((boost::filesystem::path(dirname) /
+                boost::filesystem::path(filename)).string()),
+          temporary(path + ".tmp")
+    {
+    }
+
+    T Get()
+    {
+        T data = T();
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (file && file.peek() != std::ifstream::traits_type::eof())
+        {
+            data = Deserialize<T>(file);
+        }
+
+        return data;
+    }
+
+    void Put(T value)
     {
-        std::string fullpath((boost::filesystem::path(dirname) /
-                              boost::filesystem::path(filename)).string());
-        if (!boost::filesystem::exists(fullpath))
+        std::string element_as_string = Serialize<T>(value);
+
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            throw StorageException("unable to open " + temporary);
+        }
+        size_t written = 0;
+        while (written < element_as_string.size())
+        {
+            ssize_t result = ::write(fd,
+                                     element_as_string.data() + written,
+                                     element_as_string.size() - written);
+            if (result < 0)
+            {
+                ::close(fd);
+                throw StorageException("write failed on " + temporary);
+            }
+            written += result;
+        }
+        if (sync_file(fd) != 0)
         {
-            std::fstream f(fullpath, std::ios::out | std::ios::trunc);
+            ::close(fd);
+            throw StorageException("fdatasync failed on " + temporary);
         }
-        store = std::make_shared<PersistentStorage<T>>(dirname, filename);
+        ::close(fd);
+
+        if (::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            throw StorageException("unable to rename " + temporary);
+        }
+        sync_directory();
+    }
+
+private:
+
+    std::string dirname;
+
+    std::string path;
+
+    std::string temporary;
+
+    static int sync_file(int fd)
+    {
+#ifdef __APPLE__
+        return ::fsync(fd);
+#else
+        return ::fdatasync(fd);
+#endif
+    }
+
+    void sync_directory()
+    {
+        //
+        // The rename is only durable once the directory entry is synced.
+        //
+        int fd = ::open(dirname.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw StorageException("unable to open " + dirname);
+        }
+        int result = ::fsync(fd);
+        ::close(fd);
+        if (result != 0)
+        {
+            throw StorageException("fsync failed on " + dirname);
+        }
+    }
+};
+
+
+/*
+ * Write-through cache in front of another storage. The value is read from the
+ * underlying storage once and served from memory afterwards; every Put still
+ * goes to the underlying storage before the cached copy changes.
+ */
+template <typename T>
+class CachedStorage : public Storage<T>
+{
+public:
+
+    CachedStorage(std::shared_ptr<Storage<T>> store)
+        : store(store),
+          data(store->Get())
+    {
+    }
+
+    CachedStorage(std::string dirname, std::string filename)
+        : CachedStorage(
+              std::make_shared<DurableStorage<T>>(dirname, filename))
+    {
     }
 
     T Get()
     {
-        return store->Get();
+        std::lock_guard<std::mutex> lock(mutex);
+        return data;
     }
 
     void Put(T value)
     {
+        std::lock_guard<std::mutex> lock(mutex);
         store->Put(value);
+        data = std::move(value);
+    }
+
+    //
+    // Re-read the underlying storage after it was replaced behind our back,
+    // e.g. by files written during bootstrap.
+    //
+    void Reload()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        data = store->Get();
     }
 
 private:
 
-    std::shared_ptr<PersistentStorage<T>> store;
+    std::shared_ptr<Storage<T>> store;
+
+    std::mutex mutex;
+
+    T data;
 };
 
 
@@ -156,7 +320,7 @@ public:
         return *this;
     }
 
-    Field& operator=(T& value)
+    Field& operator=(const T& value)
     {
         store->Put(value);
         return *this;
@@ -167,19 +331,82 @@ public:
         return store->Get();
     }
 
+    void Reload()
+    {
+        store->Reload();
+    }
+
 private:
 
     std::shared_ptr<Storage<T>> store;
 };
 
 
-using PersistentDecree = PersistentStorageWrapper<Decree>;
+using PersistentDecree = CachedStorage<Decree>;
 
 using VolatileDecree = VolatileStorage<Decree>;
 
 using DecreeField = Field<Decree>;
 
 
+/*
+ * Votes of an acceptor keyed by root number. A stable leader keeps a window
+ * of root decrees in flight, so an acceptor may hold a vote for several roots
+ * at once and has to return each of them when it is prepared again. A vote
+ * replaces an earlier one for the same root.
+ */
+class VoteStorage
+{
+public:
+
+    virtual ~VoteStorage()
+    {
+    }
+
+    virtual void Put(Decree decree) = 0;
+
+    //
+    // Votes for root numbers of at least root_number in root order.
+    //
+    virtual std::vector<Decree> From(int root_number) = 0;
+
+    //
+    // Forget votes up to root_number once they have been learned.
+    //
+    virtual void Retire(int root_number) = 0;
+};
+
+
+class VolatileVotes : public VoteStorage
+{
+public:
+
+    void Put(Decree decree)
+    {
+        votes[decree.root_number] = decree;
+    }
+
+    std::vector<Decree> From(int root_number)
+    {
+        std::vector<Decree> from;
+        for (auto it = votes.lower_bound(root_number); it != votes.end(); ++it)
+        {
+            from.push_back(it->second);
+        }
+        return from;
+    }
+
+    void Retire(int root_number)
+    {
+        votes.erase(votes.begin(), votes.upper_bound(root_number));
+    }
+
+private:
+
+    std::map<int, Decree> votes;
+};
+
+
 }
 
 
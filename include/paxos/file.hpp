@@ -1,7 +1,11 @@
 #ifndef __FILE_HPP_INCLUDED__
 #define __FILE_HPP_INCLUDED__
 
+#include <cstdint>
 #include <string>
+#include <vector>
+
+#include <boost/crc.hpp>
 
 
 namespace paxos
@@ -16,24 +20,88 @@ struct BootstrapMetadata
 };
 
 
+//
+// CRC-32 of a bootstrap chunk's content.
+//
+inline uint32_t BootstrapChecksum(const std::string& content)
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(content.data(), content.size());
+    return crc.checksum();
+}
+
+
+//
+// One chunk of a file sent during bootstrap. Content is written at offset in
+// the named file, and a chunk at offset zero truncates the file first, so a
+// file that fits in one chunk is sent exactly as before.
+//
+// A chunk with a nonzero probe carries no content. It asks whether the
+// replica already holds probe bytes at offset whose CRC-32 is checksum, so
+// that a returning replica is only sent what it is missing.
+//
 struct BootstrapFile
 {
     std::string name;
 
     std::string content;
 
+    uint64_t offset;
+
+    uint32_t checksum;
+
+    uint32_t probe;
+
     BootstrapFile()
-        : name(), content()
+        : name(),
+          content(),
+          offset(0),
+          checksum(BootstrapChecksum("")),
+          probe(0)
     {
     }
 
-    BootstrapFile(std::string name, std::string content)
-        : name(name), content(content)
+    BootstrapFile(std::string name, std::string content, uint64_t offset=0)
+        : name(name),
+          content(content),
+          offset(offset),
+          checksum(BootstrapChecksum(this->content)),
+          probe(0)
     {
     }
 };
 
 
+struct BootstrapManifestEntry
+{
+    std::string name;
+
+    uint64_t size;
+
+    uint32_t checksum;
+
+    BootstrapManifestEntry()
+        : name(), size(0), checksum(0)
+    {
+    }
+
+    BootstrapManifestEntry(std::string name, uint64_t size, uint32_t checksum)
+        : name(name), size(size), checksum(checksum)
+    {
+    }
+};
+
+
+//
+// Files a bootstrap is about to send with the size and CRC-32 each must have
+// once all of its chunks have arrived.
+//
+struct BootstrapManifest
+{
+    std::vector<BootstrapManifestEntry> files;
+};
+
+
 }
 
 
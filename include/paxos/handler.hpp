@@ -1,7 +1,14 @@
 #ifndef __HANDLER_HPP_INCLUDED__
 #define __HANDLER_HPP_INCLUDED__
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "paxos/decree.hpp"
@@ -20,11 +27,25 @@ namespace paxos
 using Handler = std::function<void(std::string entry)>;
 
 
+//
+// Extracts the conflict key of a decree entry. Entries with different keys
+// commute and may be applied in parallel. An empty key conflicts with every
+// other entry.
+//
+using KeyExtractor = std::function<std::string(std::string entry)>;
+
+
 class DecreeHandler
 {
 public:
 
     virtual void operator()(std::string entry) = 0;
+
+    //
+    // Entries sharing a conflict key are always applied in ledger order. The
+    // default empty key applies every entry in ledger order.
+    //
+    virtual std::string ConflictKey(const std::string& entry);
 };
 
 
@@ -54,6 +75,78 @@ private:
 };
 
 
+/*
+ * Attaches a key extractor to another handler, declaring which of its entries
+ * commute so that the ledger may apply them in parallel.
+ */
+class KeyedHandler : public DecreeHandler
+{
+public:
+
+    KeyedHandler(std::shared_ptr<DecreeHandler> handler, KeyExtractor key);
+
+    virtual void operator()(std::string entry) override;
+
+    virtual std::string ConflictKey(const std::string& entry) override;
+
+private:
+
+    std::shared_ptr<DecreeHandler> handler;
+
+    KeyExtractor key;
+};
+
+
+/*
+ * Snapshot handlers capture and reinstate the application state built from
+ * every decree applied so far. A snapshot lets the ledger drop the decrees it
+ * covers and lets a lagging replica catch up without replaying them.
+ */
+
+class SnapshotHandler
+{
+public:
+
+    virtual std::string Take() = 0;
+
+    virtual void Restore(std::string snapshot) = 0;
+};
+
+
+class CallbackSnapshotHandler : public SnapshotHandler
+{
+public:
+
+    CallbackSnapshotHandler(std::function<std::string()> take,
+                            Handler restore);
+
+    virtual std::string Take() override;
+
+    virtual void Restore(std::string snapshot) override;
+
+private:
+
+    std::function<std::string()> take;
+
+    Handler restore;
+};
+
+
+//
+// Send the files in directory to the replica a decree adds. Returns whether
+// every file was sent.
+//
+bool SendReplicaBootstrap(std::string directory, UpdateReplicaSetDecree decree);
+
+
+/*
+ * Adds a replica to the replica set. The replica that authored the decree
+ * also bootstraps the new replica. Its files are staged on the handler path
+ * so that they are sent as of this decree: sealed log segments are hard
+ * linked and every file that may still change in place is copied. Transfers
+ * run one at a time on a single thread so that the ledger keeps applying.
+ * The signal is set as each transfer ends.
+ */
 class HandleAddReplica : public DecreeHandler
 {
 public:
@@ -65,7 +158,12 @@ public:
         std::shared_ptr<Signal> signal,
         std::function<void(
             std::shared_ptr<ReplicaSet>,
-            std::ostream&)> save_replicaset=SaveReplicaSet);
+            std::ostream&)> save_replicaset=SaveReplicaSet,
+        std::function<bool(
+            std::string,
+            UpdateReplicaSetDecree)> send_bootstrap=SendReplicaBootstrap);
+
+    ~HandleAddReplica();
 
     virtual void operator()(std::string entry) override;
 
@@ -82,6 +180,24 @@ private:
     std::function<void(
         std::shared_ptr<ReplicaSet>,
         std::ostream&)> save_replicaset;
+
+    std::function<bool(std::string, UpdateReplicaSetDecree)> send_bootstrap;
+
+    void bootstrap_loop();
+
+    //
+    // Staging directories waiting to be sent, with the decree that added
+    // their replica.
+    //
+    std::deque<std::pair<std::string, UpdateReplicaSetDecree>> bootstraps;
+
+    bool is_stopping;
+
+    std::mutex mutex;
+
+    std::condition_variable bootstraps_ready;
+
+    std::thread bootstrapper;
 };
 
 
@@ -1,12 +1,20 @@
 #ifndef __LEDGER_HPP_INCLUDED__
 #define __LEDGER_HPP_INCLUDED__
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "paxos/customhash.hpp"
 #include "paxos/decree.hpp"
+#include "paxos/fields.hpp"
 #include "paxos/handler.hpp"
 #include "paxos/logging.hpp"
 #include "paxos/queue.hpp"
@@ -16,21 +24,134 @@ namespace paxos
 {
 
 
+//
+// Decrees applied between two writes of the applied record. Writing it is a
+// synchronous replace, so it is amortized over this many decrees.
+//
+const int AppliedRecordInterval = 64;
+
+
 class Ledger
 {
 public:
 
-    Ledger(std::shared_ptr<RolloverQueue<Decree>> decrees);
+    Ledger(std::shared_ptr<BaseQueue<Decree>> decrees);
 
-    Ledger(std::shared_ptr<RolloverQueue<Decree>> decrees,
+    Ledger(std::shared_ptr<BaseQueue<Decree>> decrees,
            std::shared_ptr<DecreeHandler> handler);
 
+    Ledger(std::shared_ptr<BaseQueue<Decree>> decrees,
+           std::shared_ptr<DecreeHandler> handler,
+           std::shared_ptr<Storage<Decree>> snapshot);
+
+    //
+    // Record the last applied decree in applied so that decrees which were
+    // durable but not yet applied when the process stopped are applied again
+    // by Replay. Without it every decree found on open counts as applied.
+    // The record is written once every AppliedRecordInterval decrees and when
+    // the ledger closes, so a crash may apply up to that many decrees again.
+    //
+    Ledger(std::shared_ptr<BaseQueue<Decree>> decrees,
+           std::shared_ptr<DecreeHandler> handler,
+           std::shared_ptr<Storage<Decree>> snapshot,
+           std::shared_ptr<Storage<Decree>> applied);
+
     ~Ledger();
 
+    //
+    // Handlers may be registered or replaced at any time. Inline appends see
+    // the change from the next decree and the applier from its next batch.
+    //
     void RegisterHandler(DecreeType key,
                          std::shared_ptr<DecreeHandler> handler);
 
-    void Append(Decree decree);
+    void RegisterSnapshotHandler(std::shared_ptr<SnapshotHandler> handler);
+
+    //
+    // Take a snapshot automatically once interval decrees have been appended
+    // since the last one. An interval of zero disables automatic snapshots.
+    //
+    void SetSnapshotInterval(int interval);
+
+    //
+    // Run decree handlers on a dedicated thread, in ledger order, so that a
+    // slow handler does not hold up the roles appending decrees. Append
+    // blocks once max_lag decrees are waiting to be applied, and waits for
+    // system decrees such as replica set changes to be applied before it
+    // returns. A max_lag of zero runs handlers inline, which is the default.
+    //
+    // With more than one worker the applier spreads user entries over that
+    // many threads by the conflict key of the user decree handler. Entries
+    // with the same key run on the same thread in ledger order and an entry
+    // with an empty key waits for, and holds back, every other entry.
+    //
+    // Appends wait for the applier, so a handler must not wait on a lock
+    // held by whoever is appending. The roles call WaitForCapacity before
+    // taking their locks, but a message carrying several decrees or a system
+    // decree still waits for the applier under the learner lock.
+    //
+    void SetAsynchronousApply(size_t max_lag, size_t workers=1);
+
+    //
+    // Attach a key extractor to the handler registered for key so that its
+    // entries can be applied in parallel. The extractor applies from the same
+    // point a newly registered handler would.
+    //
+    void SetConflictKey(DecreeType key, KeyExtractor extractor);
+
+    void Append(const Decree& decree);
+
+    //
+    // Re-read the decrees, the snapshot and the applied decree after their
+    // files were replaced on disk, e.g. by a bootstrap.
+    //
+    void Reload();
+
+    //
+    // Run the handlers for every decree after the last recorded applied
+    // decree. Call it once the handlers are registered and before decrees
+    // are appended. The record is written after handlers run, so a handler
+    // may see the last few decrees again after a crash.
+    //
+    void Replay();
+
+    //
+    // Root number of the last decree appended.
+    //
+    int CommitIndex();
+
+    //
+    // Root number of the last decree whose handlers have run.
+    //
+    int AppliedIndex();
+
+    //
+    // Block until Append would not have to wait for the applier to catch up.
+    //
+    void WaitForCapacity();
+
+    //
+    // Block until every appended decree has been applied.
+    //
+    void WaitForApplied();
+
+    //
+    // Snapshot the application state at the tail of the ledger and remove
+    // every decree the snapshot covers.
+    //
+    bool TakeSnapshot();
+
+    //
+    // Replace the application state and the ledger with a snapshot received
+    // from another replica. Snapshots behind our tail are ignored.
+    //
+    bool RestoreSnapshot(const Decree& snapshot);
+
+    //
+    // The last snapshot taken or restored. Its root number is the last decree
+    // it covers and its content is the application state.
+    //
+    Decree Snapshot();
 
     void Remove();
 
@@ -42,13 +163,133 @@ public:
 
     Decree Next(Decree previous);
 
+    //
+    // Contiguous run of decrees following previous. The run holds at most
+    // max_entries decrees and stops before max_bytes of content unless the
+    // first decree alone is larger.
+    //
+    std::vector<Decree> Range(Decree previous,
+                              size_t max_entries,
+                              size_t max_bytes);
+
 private:
 
-    std::shared_ptr<RolloverQueue<Decree>> decrees;
+    using HandlerMap =
+        std::unordered_map<DecreeType, std::shared_ptr<DecreeHandler>>;
+
+    std::shared_ptr<BaseQueue<Decree>> decrees;
+
+    DecreeField snapshot;
+
+    //
+    // Copy of the last snapshot without its content so that Tail can fall
+    // back to it without reading the snapshot from storage.
+    //
+    Decree snapshot_tail;
+
+    int snapshot_interval;
+
+    std::shared_ptr<SnapshotHandler> snapshot_handler;
 
     std::recursive_mutex mutex;
 
-    std::unordered_map<DecreeType, std::shared_ptr<DecreeHandler>> handlers;
+    //
+    // Guarded by mutex. The applier works from a copy taken per batch.
+    //
+    HandlerMap handlers;
+
+    std::atomic<int> commit_index;
+
+    std::atomic<int> applied_index;
+
+    //
+    // Last applied decree without its content, or null when the ledger does
+    // not track it.
+    //
+    std::shared_ptr<Storage<Decree>> applied_decree;
+
+    //
+    // Last applied decree and the root number applied_decree last stored.
+    // Guarded by record_mutex.
+    //
+    Decree last_applied;
+
+    int recorded_index;
+
+    std::mutex record_mutex;
+
+    //
+    // Decrees enqueued but not yet handed to the handlers because the ledger
+    // has not synced them, with the time each was appended.
+    //
+    std::deque<std::pair<Decree, std::chrono::steady_clock::time_point>> unsynced;
+
+    //
+    // Decrees appended but not yet applied, with the time each was queued.
+    // Decrees stay queued while they are being applied so the queue is only
+    // empty once everything appended has been applied.
+    //
+    std::deque<std::pair<Decree, std::chrono::steady_clock::time_point>> applying;
+
+    size_t max_apply_lag;
+
+    bool is_stopping;
+
+    std::mutex apply_mutex;
+
+    std::condition_variable apply_ready;
+
+    std::condition_variable applied;
+
+    std::thread applier;
+
+    size_t apply_lanes;
+
+    //
+    // Entries of the batch being applied split by conflict key. Lane zero is
+    // run by the applier and each other lane by its own worker. Only the
+    // applier starts workers and fills the lanes.
+    //
+    std::vector<std::vector<
+        std::pair<DecreeHandler*, const std::string*>>> lanes;
+
+    std::vector<std::thread> lane_workers;
+
+    uint64_t lane_generation;
+
+    size_t lanes_pending;
+
+    bool lanes_stopping;
+
+    std::mutex lane_mutex;
+
+    std::condition_variable lanes_ready;
+
+    std::condition_variable lanes_done;
+
+    void apply(const Decree& decree, const HandlerMap& handlers);
+
+    void record_applied(Decree decree);
+
+    void flush_applied();
+
+    bool has_capacity();
+
+    void load_indexes();
+
+    void apply_loop();
+
+    void apply_parallel(
+        const std::vector<
+            std::pair<Decree, std::chrono::steady_clock::time_point>*>& batch,
+        size_t lane_count,
+        const HandlerMap& handlers);
+
+    void run_lanes();
+
+    void lane_loop(size_t lane, uint64_t generation);
+
+    bool take_snapshot();
 };
 
 
@@ -2,6 +2,8 @@
 #define __LOGGING_HPP_INCLUDED__
 
 
+#include <atomic>
+
 #include <boost/log/common.hpp>
 
 
@@ -13,15 +15,59 @@ enum class LogLevel
 {
     Info,
     Warning,
-    Error
+    Error,
+    Off
 };
 
-#define LOG(level) BOOST_LOG_SEV(global_logger::get(), level)
+//
+// Records below the runtime log level are dropped before the logger is
+// touched, so nothing streamed into a disabled record is evaluated.
+//
+#define LOG(level)                                                            \
+    if (!paxos::IsLogLevelEnabled(level)) {} else                             \
+        BOOST_LOG_SEV(global_logger::get(), level)
 
 BOOST_LOG_GLOBAL_LOGGER(global_logger, boost::log::sources::severity_logger_mt<LogLevel>)
 
+//
+// Diagnostic log written to the working directory, which may be the replica
+// directory as well.
+//
+const std::string LogFilename = "paxos.log";
+
 const int LogFileRotationSize = 10 * 1024 * 1024;
 
+//
+// Records wait in a bounded queue until the sink threads format and write
+// them. Records arriving while the queue is full are dropped rather than
+// stalling the caller.
+//
+const size_t LogQueueSize = 8192;
+
+
+extern std::atomic<int> log_level;
+
+
+inline bool IsLogLevelEnabled(LogLevel level)
+{
+    return static_cast<int>(level) >= log_level.load(std::memory_order_relaxed);
+}
+
+
+void SetLogLevel(LogLevel level);
+
+
+LogLevel GetLogLevel();
+
+
+void SetConsoleLogging(bool enabled);
+
+
+//
+// Block until every queued record has been written.
+//
+void FlushLogging();
+
 
 void DisableLogging();
 
@@ -1,77 +1,172 @@
 #ifndef __LRU_MAP_HPP_INCLUDED__
 #define __LRU_MAP_HPP_INCLUDED__
 
-#include <deque>
 #include <functional>
-#include <map>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
 
 
 namespace paxos
 {
 
 
-template <class Key, class T, class Compare=std::less<Key>>
+/*
+ * Map holding at most capacity entries. Entries are indexed by hash and
+ * threaded on an intrusive doubly linked list from least to most recently
+ * used, so insert, find, erase and eviction are all constant time. Assigning
+ * through operator[] marks an entry as most recently used; iteration visits
+ * entries from least to most recently used.
+ */
+template <class Key,
+          class T,
+          class Hash=std::hash<Key>,
+          class KeyEqual=std::equal_to<Key>>
 class lru_map
 {
+private:
+
+    struct Entry
+    {
+        T value;
+        const Key* key;
+        Entry* prev;
+        Entry* next;
+    };
+
+    using map_type = std::unordered_map<Key, Entry, Hash, KeyEqual>;
+
 public:
 
-    using map_type = std::map<Key, T>;
-    using iterator = typename map_type::iterator;
+    class iterator
+    {
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<const Key&, T&>;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type;
+
+        struct pointer
+        {
+            value_type value;
+
+            value_type* operator->()
+            {
+                return &value;
+            }
+        };
+
+        iterator(Entry* entry=nullptr)
+            : entry(entry)
+        {
+        }
+
+        reference operator*() const
+        {
+            return reference(*entry->key, entry->value);
+        }
+
+        pointer operator->() const
+        {
+            return pointer { **this };
+        }
+
+        iterator& operator++()
+        {
+            entry = entry->next;
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator previous = *this;
+            entry = entry->next;
+            return previous;
+        }
+
+        bool operator==(const iterator& other) const
+        {
+            return entry == other.entry;
+        }
+
+        bool operator!=(const iterator& other) const
+        {
+            return entry != other.entry;
+        }
+
+    private:
+
+        Entry* entry;
+    };
 
     lru_map(size_t capacity)
-        : capacity(capacity)
+        : capacity(capacity),
+          map(),
+          oldest(nullptr),
+          newest(nullptr)
     {
+        map.reserve(capacity + 1);
     }
 
+    lru_map(const lru_map&) = delete;
+
+    lru_map& operator=(const lru_map&) = delete;
+
     T&
-    operator[](const Key e)
+    operator[](const Key& e)
     {
-        if (map.find(e) != map.end())
+        auto found = map.find(e);
+        if (found != map.end())
         {
-            return map[e];
+            unlink(&found->second);
+            link(&found->second);
+            return found->second.value;
         }
 
-        queue.push_back(e);
-        if (queue.size() > capacity)
+        if (map.size() >= capacity && oldest != nullptr)
         {
-            // remove
-            auto front = queue[0];
-            queue.pop_front();
-            map.erase(front);
+            evict();
         }
-        return map[e];
+        auto inserted = map.emplace(e, Entry { T(), nullptr, nullptr, nullptr });
+        Entry* entry = &inserted.first->second;
+        entry->key = &inserted.first->first;
+        link(entry);
+        return entry->value;
     }
 
     iterator
-    find(const Key e)
+    find(const Key& e)
     {
-        return map.find(e);
+        auto found = map.find(e);
+        if (found == map.end())
+        {
+            return end();
+        }
+        return iterator(&found->second);
     }
 
     void
-    erase(const Key e)
+    erase(const Key& e)
     {
-        for (int i=0; i<queue.size(); i++)
+        auto found = map.find(e);
+        if (found != map.end())
         {
-            if (Compare{}(queue.at(i), e))
-            {
-                queue.erase(queue.begin() + i);
-                break;
-            }
+            unlink(&found->second);
+            map.erase(found);
         }
-        map.erase(e);
     }
 
     iterator
     begin()
     {
-        return map.begin();
+        return iterator(oldest);
     }
 
     iterator
     end()
     {
-        return map.end();
+        return iterator();
     }
 
     size_t
@@ -84,9 +179,57 @@ private:
 
     size_t capacity;
 
-    std::map<Key, T, Compare> map;
+    //
+    // Nodes of an unordered map keep their address until erased, which is
+    // what lets the recency list point straight at them.
+    //
+    map_type map;
+
+    Entry* oldest;
+
+    Entry* newest;
+
+    void link(Entry* entry)
+    {
+        entry->prev = newest;
+        entry->next = nullptr;
+        if (newest != nullptr)
+        {
+            newest->next = entry;
+        }
+        else
+        {
+            oldest = entry;
+        }
+        newest = entry;
+    }
+
+    void unlink(Entry* entry)
+    {
+        if (entry->prev != nullptr)
+        {
+            entry->prev->next = entry->next;
+        }
+        else
+        {
+            oldest = entry->next;
+        }
+        if (entry->next != nullptr)
+        {
+            entry->next->prev = entry->prev;
+        }
+        else
+        {
+            newest = entry->prev;
+        }
+    }
 
-    std::deque<Key> queue;
+    void evict()
+    {
+        Entry* entry = oldest;
+        unlink(entry);
+        map.erase(map.find(*entry->key));
+    }
 };
 
 
@@ -94,4 +237,3 @@ private:
 
 
 #endif
-
@@ -1,57 +1,141 @@
 #ifndef __LRU_SET_HPP_INCLUDED__
 #define __LRU_SET_HPP_INCLUDED__
 
-#include <deque>
 #include <functional>
-#include <set>
+#include <unordered_map>
 
 
 namespace paxos
 {
 
 
-template <class Key, class Compare=std::less<Key>>
+/*
+ * Set holding at most capacity keys, indexed by hash and threaded on an
+ * intrusive recency list the same way as lru_map. Inserting a key that is
+ * already present marks it as most recently used.
+ */
+template <class Key,
+          class Hash=std::hash<Key>,
+          class KeyEqual=std::equal_to<Key>>
 class lru_set
 {
 public:
 
     lru_set(size_t capacity)
-        : capacity(capacity)
+        : capacity(capacity),
+          set(),
+          oldest(nullptr),
+          newest(nullptr)
     {
+        set.reserve(capacity + 1);
     }
 
+    lru_set(const lru_set&) = delete;
+
+    lru_set& operator=(const lru_set&) = delete;
+
     void
-    insert(Key e)
+    insert(const Key& e)
     {
-        if (contains(e))
+        auto found = set.find(e);
+        if (found != set.end())
         {
+            unlink(&found->second);
+            link(&found->second);
             return;
         }
 
-        queue.push_back(e);
-        if (queue.size() > capacity)
+        if (set.size() >= capacity && oldest != nullptr)
         {
-            // remove
-            auto front = queue[0];
-            queue.pop_front();
-            set.erase(front);
+            evict();
         }
-        set.insert(e);
+        auto inserted = set.emplace(e, Entry { nullptr, nullptr, nullptr });
+        Entry* entry = &inserted.first->second;
+        entry->key = &inserted.first->first;
+        link(entry);
     }
 
     bool
-    contains(Key e)
+    contains(const Key& e) const
     {
         return set.find(e) != set.end();
     }
 
+    void
+    erase(const Key& e)
+    {
+        auto found = set.find(e);
+        if (found != set.end())
+        {
+            unlink(&found->second);
+            set.erase(found);
+        }
+    }
+
+    size_t
+    size() const
+    {
+        return set.size();
+    }
+
 private:
 
+    struct Entry
+    {
+        const Key* key;
+        Entry* prev;
+        Entry* next;
+    };
+
     size_t capacity;
 
-    std::set<Key, Compare> set;
+    std::unordered_map<Key, Entry, Hash, KeyEqual> set;
+
+    Entry* oldest;
 
-    std::deque<Key> queue;
+    Entry* newest;
+
+    void link(Entry* entry)
+    {
+        entry->prev = newest;
+        entry->next = nullptr;
+        if (newest != nullptr)
+        {
+            newest->next = entry;
+        }
+        else
+        {
+            oldest = entry;
+        }
+        newest = entry;
+    }
+
+    void unlink(Entry* entry)
+    {
+        if (entry->prev != nullptr)
+        {
+            entry->prev->next = entry->next;
+        }
+        else
+        {
+            oldest = entry->next;
+        }
+        if (entry->next != nullptr)
+        {
+            entry->next->prev = entry->prev;
+        }
+        else
+        {
+            newest = entry->prev;
+        }
+    }
+
+    void evict()
+    {
+        Entry* entry = oldest;
+        unlink(entry);
+        set.erase(set.find(*entry->key));
+    }
 };
 
 
@@ -0,0 +1,90 @@
+#ifndef __MAPPED_HPP_INCLUDED__
+#define __MAPPED_HPP_INCLUDED__
+
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace paxos
+{
+
+
+/*
+ * Read-only memory mapping of a whole file. Only map files that are no longer
+ * written to; the mapping does not follow the file if it grows or shrinks.
+ */
+
+class MappedFile
+{
+public:
+
+    MappedFile(std::string path)
+        : address(nullptr), length(0)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return;
+        }
+
+        struct stat status;
+        if (::fstat(fd, &status) == 0 && status.st_size > 0)
+        {
+            void* mapping = ::mmap(nullptr, status.st_size, PROT_READ,
+                                   MAP_SHARED, fd, 0);
+            if (mapping != MAP_FAILED)
+            {
+                address = static_cast<const char*>(mapping);
+                length = status.st_size;
+            }
+        }
+
+        //
+        // The mapping stays valid after the descriptor is closed.
+        //
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (address != nullptr)
+        {
+            ::munmap(const_cast<char*>(address), length);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool IsMapped() const
+    {
+        return address != nullptr;
+    }
+
+    const char* Data() const
+    {
+        return address;
+    }
+
+    size_t Size() const
+    {
+        return length;
+    }
+
+private:
+
+    const char* address;
+
+    size_t length;
+};
+
+
+}
+
+
+#endif
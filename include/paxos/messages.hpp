@@ -1,6 +1,8 @@
 #ifndef __MESSAGES_HPP_INCLUDED__
 #define __MESSAGES_HPP_INCLUDED__
 
+#include <ostream>
+
 #include "paxos/decree.hpp"
 #include "paxos/replicaset.hpp"
 
@@ -64,10 +66,29 @@ enum class MessageType
     //
     // UpdatedMessage sent to update a replica that has fallen behind.
     //
-    UpdatedMessage
+    UpdatedMessage,
+
+    //
+    // SnapshotMessage sent instead of UpdatedMessage when the decrees a
+    // replica is missing have been compacted into a snapshot.
+    //
+    SnapshotMessage,
+
+    //
+    // UpdatedRangeMessage sent to update a replica with a contiguous run of
+    // decrees at once. The decree content holds the binary archive of the run.
+    //
+    UpdatedRangeMessage
 };
 
 
+//
+// Number of message types. Keep in step with the last MessageType above.
+//
+const size_t MessageTypeCount =
+    static_cast<size_t>(MessageType::UpdatedRangeMessage) + 1;
+
+
 struct Message
 {
     Decree decree;
@@ -87,7 +108,14 @@ struct Message
 };
 
 
-Message Response(Message message, MessageType type);
+Message Response(const Message& message, MessageType type);
+
+
+//
+// Writes the routing fields and decree header of a message as key=value
+// pairs for logging. The decree content is summarized by its size.
+//
+std::ostream& operator<<(std::ostream& os, const Message& message);
 
 
 }
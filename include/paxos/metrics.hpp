@@ -0,0 +1,228 @@
+#ifndef __METRICS_HPP_INCLUDED__
+#define __METRICS_HPP_INCLUDED__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "paxos/decree.hpp"
+
+
+namespace paxos
+{
+
+
+//
+// Number of cache line sized cells a counter is striped across. Threads are
+// spread over the stripes round robin as they first touch a counter.
+//
+const size_t CounterStripes = 16;
+
+
+/*
+ * Counter striped across cache lines. Each thread adds to its own stripe so
+ * that handler threads bumping the same counter do not contend on one cache
+ * line. Reading the value sums the stripes.
+ */
+class Counter
+{
+public:
+
+    Counter();
+
+    Counter(const Counter&) = delete;
+
+    Counter& operator=(const Counter&) = delete;
+
+    void Add(uint64_t n=1);
+
+    uint64_t Value() const;
+
+private:
+
+    struct alignas(64) Stripe
+    {
+        std::atomic<uint64_t> value;
+    };
+
+    std::array<Stripe, CounterStripes> stripes;
+};
+
+
+struct HistogramSnapshot
+{
+    uint64_t count;
+
+    uint64_t sum;
+
+    std::vector<uint64_t> buckets;
+
+    HistogramSnapshot()
+        : count(), sum(), buckets()
+    {
+    }
+
+    //
+    // Upper bound of the bucket holding the q-th quantile, or zero when the
+    // histogram is empty.
+    //
+    uint64_t Quantile(double q) const;
+};
+
+
+/*
+ * Log-linear histogram in the style of HdrHistogram. Values below eight get
+ * their own bucket and every power of two above that is split into eight
+ * linear sub-buckets, which bounds the relative error of a bucket to 12.5%
+ * over the whole uint64_t range. Recording is a single relaxed atomic
+ * increment per bucket plus the striped count and sum.
+ */
+class Histogram
+{
+public:
+
+    static const int SubBucketBits = 3;
+
+    static const size_t SubBuckets = 1 << SubBucketBits;
+
+    static const size_t BucketCount = (64 - SubBucketBits + 1) * SubBuckets;
+
+    Histogram();
+
+    Histogram(const Histogram&) = delete;
+
+    Histogram& operator=(const Histogram&) = delete;
+
+    void Record(uint64_t value);
+
+    HistogramSnapshot Snapshot() const;
+
+    static size_t BucketIndex(uint64_t value);
+
+    static uint64_t BucketUpperBound(size_t index);
+
+private:
+
+    std::array<std::atomic<uint64_t>, BucketCount> buckets;
+
+    Counter count;
+
+    Counter sum;
+};
+
+
+/*
+ * Times a protocol phase per decree without taking a lock. Start stamps the
+ * decree into a slot picked by its hash and Stop records the elapsed
+ * microseconds into a histogram if the slot still belongs to the decree.
+ * Decrees that collide on a slot overwrite each other, so under heavy
+ * pipelining some samples are lost rather than misattributed.
+ */
+class PhaseTimer
+{
+public:
+
+    static const size_t Slots = 1024;
+
+    PhaseTimer();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    void Start(const Decree& decree);
+
+    bool Stop(const Decree& decree, Histogram& histogram);
+
+private:
+
+    struct Slot
+    {
+        std::atomic<uint64_t> key;
+        std::atomic<int64_t> start;
+    };
+
+    std::array<Slot, Slots> slots;
+
+    static uint64_t key(const Decree& decree);
+};
+
+
+struct MetricsSnapshot
+{
+    std::map<std::string, uint64_t> counters;
+
+    std::map<std::string, HistogramSnapshot> histograms;
+};
+
+
+/*
+ * Counters and latency histograms for the paxos phases, the ledger and the
+ * network. Latencies are recorded in microseconds.
+ */
+struct Metrics
+{
+    Counter requests;
+    Counter prepares;
+    Counter promises;
+    Counter nacks;
+    Counter nack_ties;
+    Counter accepts;
+    Counter accepted;
+    Counter ledger_appends;
+    Counter messages_sent;
+    Counter bytes_sent;
+    Counter messages_dropped;
+    Counter messages_received;
+    Counter bytes_received;
+
+    Histogram prepare_promise_latency;
+    Histogram accept_accepted_latency;
+    Histogram ledger_append_latency;
+    Histogram send_latency;
+    Histogram receive_latency;
+    Histogram apply_latency;
+
+    PhaseTimer prepare_timer;
+    PhaseTimer accept_timer;
+
+    MetricsSnapshot Snapshot() const;
+};
+
+
+//
+// Metrics are process wide, the same way the logger is. Every parliament in
+// the process records into the one registry.
+//
+Metrics& GlobalMetrics();
+
+
+//
+// Microseconds elapsed since start on the steady clock.
+//
+uint64_t ElapsedMicroseconds(std::chrono::steady_clock::time_point start);
+
+
+//
+// Write the snapshot in the Prometheus text exposition format. Counters are
+// named paxos_<name>_total and latency histograms paxos_<name>_seconds.
+//
+void WritePrometheus(std::ostream& os, const MetricsSnapshot& snapshot);
+
+
+//
+// Write the snapshot in the Prometheus text format to a temporary file and
+// rename it over filename, so a scraper never reads a partial dump.
+//
+void WritePrometheusFile(std::string filename, const MetricsSnapshot& snapshot);
+
+
+}
+
+
+#endif
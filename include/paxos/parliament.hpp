@@ -1,15 +1,19 @@
 #ifndef __PAXOS_HPP_INCLUDED__
 #define __PAXOS_HPP_INCLUDED__
 
+#include <chrono>
 #include <functional>
 #include <map>
 #include <memory>
 
+#include <paxos/acceptorlog.hpp>
 #include <paxos/bootstrap.hpp>
 #include <paxos/decree.hpp>
+#include <paxos/metrics.hpp>
 #include <paxos/replicaset.hpp>
 #include <paxos/roles.hpp>
 #include <paxos/sender.hpp>
+#include <paxos/wal.hpp>
 
 
 namespace paxos
@@ -27,9 +31,15 @@ class Parliament
 {
 public:
 
+    //
+    // Messages are handled by a pool of threads with each role serialized on
+    // its own strand. Zero threads handles every message on the I/O thread.
+    //
     Parliament(Replica legislator,
                std::string location=".",
-               Handler accept_handler=[](std::string entry){});
+               Handler accept_handler=[](std::string entry){},
+               SyncPolicy sync_policy=SyncPolicy::Always,
+               size_t threads=4);
 
     Parliament(Replica legislator,
                std::shared_ptr<ReplicaSet> legislators,
@@ -56,8 +66,86 @@ public:
 
     void SetInactive();
 
+    //
+    // Allow a stable leader to pipeline up to window decrees after a single
+    // prepare round. A window of one disables multi-paxos.
+    //
+    void SetPipelineWindow(int window);
+
+    //
+    // Coalesce queued proposals into batch decrees of up to max_bytes, waiting
+    // at most max_delay for a batch to fill. A max_bytes of zero disables
+    // batching.
+    //
+    void SetBatching(size_t max_bytes,
+                     std::chrono::milliseconds max_delay=std::chrono::milliseconds(0));
+
+    //
+    // Stream catch-up to lagging replicas in runs of up to max_entries decrees
+    // and max_bytes of content per round trip.
+    //
+    void SetUpdateWindow(size_t max_entries, size_t max_bytes);
+
+    //
+    // Register callbacks that capture and restore the application state. A
+    // snapshot allows the ledger to be compacted and is shipped to replicas
+    // that fall behind the compacted decrees.
+    //
+    void SetSnapshotHandler(std::function<std::string()> take,
+                            Handler restore);
+
+    //
+    // Snapshot and compact the ledger every interval decrees. An interval of
+    // zero only snapshots when TakeSnapshot is called.
+    //
+    void SetSnapshotInterval(int interval);
+
+    bool TakeSnapshot();
+
+    //
+    // Run the accept handler on its own thread so that a slow handler does
+    // not stall consensus. Up to max_lag decrees may wait to be applied
+    // before the ledger pushes back. Zero runs the handler inline.
+    //
+    // With more than one worker, accepted values whose conflict keys differ
+    // are handed to the accept handler on several threads at once. Values
+    // sharing a key still arrive in ledger order.
+    //
+    // The learner may wait for the accept handler while holding its lock, so
+    // the handler must not call back into the parliament, e.g. through
+    // GetAbsenteeBallots.
+    //
+    void SetAsynchronousApply(size_t max_lag, size_t workers=1);
+
+    //
+    // Declare which accepted values commute. Values are applied in parallel
+    // only once a key extractor is set, and a value with an empty key is
+    // applied on its own.
+    //
+    void SetConflictKey(KeyExtractor key);
+
+    //
+    // Root number of the last decree written to the ledger and of the last
+    // decree the accept handler has seen.
+    //
+    int GetCommitIndex();
+
+    int GetAppliedIndex();
+
     AbsenteeBallots GetAbsenteeBallots(int max_ballots);
 
+    //
+    // Snapshot the phase latencies and message counters. Metrics are shared
+    // by every parliament in the process.
+    //
+    MetricsSnapshot GetMetrics();
+
+    //
+    // Write the metrics snapshot to filename in the Prometheus text format,
+    // for example into the directory of a node exporter textfile collector.
+    //
+    void DumpMetrics(std::string filename);
+
 private:
 
     Replica legislator;
@@ -68,12 +156,23 @@ private:
 
     std::shared_ptr<Sender> sender;
 
-    std::shared_ptr<Listener> bootstrap;
+    std::shared_ptr<PersistentDecree> highest_proposed_decree;
+
+    std::shared_ptr<AcceptorLog> acceptor_log;
 
+    //
+    // Declared ahead of the bootstrap listener, which reloads it.
+    //
     std::shared_ptr<Ledger> ledger;
 
+    std::shared_ptr<Listener> bootstrap;
+
     std::shared_ptr<LearnerContext> learner;
 
+    std::shared_ptr<ProposerContext> proposer;
+
+    std::shared_ptr<UpdaterContext> updater;
+
     std::string location;
 
     std::shared_ptr<Signal> signal;
@@ -2,7 +2,10 @@
 #define __PAUSE_HPP_INCLUDED__
 
 #include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
+#include <thread>
 
 #include <boost/asio.hpp>
 
@@ -43,6 +46,47 @@ private:
 };
 
 
+/*
+ * Runs a callback once after a delay on a thread owned by the timer, so
+ * scheduling never blocks the caller and never starts more than one thread.
+ * Starting the timer again replaces the pending callback. Destroying the
+ * timer cancels a callback that has not yet run.
+ */
+class Timer
+{
+public:
+
+    Timer();
+
+    ~Timer();
+
+    Timer(const Timer&) = delete;
+
+    Timer& operator=(const Timer&) = delete;
+
+    void Start(std::chrono::milliseconds delay,
+               std::function<void(void)> callback);
+
+    void Cancel();
+
+private:
+
+    std::mutex mutex;
+
+    std::condition_variable changed;
+
+    std::chrono::steady_clock::time_point deadline;
+
+    std::function<void(void)> callback;
+
+    bool is_stopping;
+
+    std::thread thread;
+
+    void run();
+};
+
+
 }
 
 
@@ -1,9 +1,13 @@
 #ifndef __QUEUE_HPP_INCLUDED__
 #define __QUEUE_HPP_INCLUDED__
 
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
+#include <iomanip>
 #include <mutex>
+#include <utility>
+#include <vector>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
@@ -63,12 +67,59 @@ private:
 
 public:
 
-    virtual void Enqueue(T e) = 0;
+    virtual ~BaseQueue()
+    {
+    }
+
+    virtual void Enqueue(const T& e) = 0;
 
     virtual void Dequeue() = 0;
 
     virtual T Last() = 0;
 
+    //
+    // Element at the given position counting from the first element, or a
+    // default element if the queue is shorter than that.
+    //
+    virtual T At(size_t position)
+    {
+        for (T element : *this)
+        {
+            if (position == 0)
+            {
+                return element;
+            }
+            position -= 1;
+        }
+        return T();
+    }
+
+    virtual size_t Size()
+    {
+        size_t size = 0;
+        for (Iterator it = begin(); it != end(); ++it)
+        {
+            size += 1;
+        }
+        return size;
+    }
+
+    //
+    // Block until enqueued elements are as durable as the queue promises.
+    // Queues that write through on every enqueue have nothing to do.
+    //
+    virtual void Sync()
+    {
+    }
+
+    //
+    // Re-read the queue after its files were replaced on disk, e.g. by a
+    // bootstrap. Queues without files have nothing to do.
+    //
+    virtual void Reload()
+    {
+    }
+
     Iterator begin()
     {
         return Iterator(this, getFirstElementIndex());
@@ -86,7 +137,7 @@ class VolatileQueue : public BaseQueue<T>
 {
 public:
 
-    void Enqueue(T e)
+    void Enqueue(const T& e)
     {
         data.push_back(e);
     }
@@ -112,7 +163,7 @@ private:
         return data[index];
     }
 
-    int64_t getElementSizeAt(int64_t index)
+    int64_t getElementSizeAt(int64_t)
     {
         return 1;
     }
@@ -193,7 +244,7 @@ public:
     {
         stream.seekg(0, std::ios::beg);
 
-        std::string buffer;
+        std::string buffer(INDEX_SIZE, '\0');
         stream.read(&buffer[0], INDEX_SIZE);
         boost::trim(buffer);
         start_position = std::stoi(buffer);
@@ -203,7 +254,7 @@ public:
         end_position = std::stoi(buffer);
     }
 
-    void Enqueue(T e)
+    void Enqueue(const T& e)
     {
         std::lock_guard<std::recursive_mutex> lock(mutex);
 
@@ -314,14 +365,14 @@ private:
 
 
 template <typename T>
-class RolloverQueue
+class RolloverQueue : public BaseQueue<T>
 {
 private:
 
     std::streampos get_first_position()
     {
         stream.seekg(0 * INDEX_SIZE, std::ios::beg);
-        std::string buffer;
+        std::string buffer(INDEX_SIZE, '\0');
         stream.read(&buffer[0], INDEX_SIZE);
         boost::trim(buffer);
         try
@@ -356,6 +407,142 @@ private:
         return stream.tellg();
     }
 
+    T read_element(size_t ordinal)
+    {
+        std::string buffer(offsets[ordinal].second, '\0');
+        stream.clear();
+        stream.seekg(offsets[ordinal].first, std::ios::beg);
+        stream.read(&buffer[0], buffer.size());
+        return Deserialize<T>(buffer);
+    }
+
+    void load_index()
+    {
+        //
+        // Trust the side index only if it agrees with the queue header,
+        // otherwise rebuild it with a single pass over the queue.
+        //
+        offsets.clear();
+        if (!index_filename.empty() &&
+            boost::filesystem::exists(index_filename))
+        {
+            std::ifstream index_stream(index_filename, std::ios::binary);
+            std::string buffer(INDEX_SIZE, '\0');
+            while (index_stream.read(&buffer[0], INDEX_SIZE))
+            {
+                int64_t offset = std::stoll(boost::trim_copy(buffer));
+                if (!index_stream.read(&buffer[0], INDEX_SIZE))
+                {
+                    break;
+                }
+                int64_t length = std::stoll(boost::trim_copy(buffer));
+                offsets.push_back(std::make_pair(offset, length));
+            }
+        }
+
+        auto last = get_last_position();
+        auto eof = get_eof_position();
+        bool is_valid = last == UNINITIALIZED ?
+            offsets.empty() :
+            !offsets.empty() &&
+            offsets.front().first == HEADER_SIZE &&
+            offsets.back().first == last &&
+            offsets.back().first + offsets.back().second <= eof;
+
+        if (!is_valid)
+        {
+            rebuild_index();
+        }
+        locate_first();
+    }
+
+    void rebuild_index()
+    {
+        offsets.clear();
+
+        auto last = get_last_position();
+        auto eof = get_eof_position();
+        if (last != UNINITIALIZED && last < eof)
+        {
+            std::string content(static_cast<size_t>(eof), '\0');
+            stream.clear();
+            stream.seekg(0, std::ios::beg);
+            stream.read(&content[0], content.size());
+
+            int64_t position = HEADER_SIZE;
+            while (position <= last)
+            {
+                int64_t length = Serialize<T>(Deserialize<T>(
+                    content.data() + position,
+                    content.size() - position)).length();
+                offsets.push_back(std::make_pair(position, length));
+                position += length;
+            }
+        }
+        save_index();
+    }
+
+    void save_index()
+    {
+        if (index_filename.empty())
+        {
+            return;
+        }
+
+        index_file.close();
+        index_file.open(index_filename,
+                        std::ios::out | std::ios::trunc | std::ios::binary);
+        for (const auto& offset : offsets)
+        {
+            index_file << std::setw(INDEX_SIZE) << offset.first;
+            index_file << std::setw(INDEX_SIZE) << offset.second;
+        }
+        index_file.flush();
+        index_file.close();
+        index_file.open(index_filename,
+                        std::ios::out | std::ios::app | std::ios::binary);
+    }
+
+    void append_index(int64_t offset, int64_t length)
+    {
+        offsets.push_back(std::make_pair(offset, length));
+        if (!index_filename.empty())
+        {
+            index_file << std::setw(INDEX_SIZE) << offset;
+            index_file << std::setw(INDEX_SIZE) << length;
+            index_file.flush();
+        }
+    }
+
+    void open_file()
+    {
+        file.close();
+        file.clear();
+        if (!boost::filesystem::exists(filename))
+        {
+            file.open(filename, std::ios::out | std::ios::app | std::ios::binary);
+            file << std::setw(INDEX_SIZE) << HEADER_SIZE;
+            file << std::setw(INDEX_SIZE) << UNINITIALIZED;
+            file.flush();
+            file.close();
+        }
+        file.open(filename, std::ios::out | std::ios::in | std::ios::binary);
+    }
+
+    void locate_first()
+    {
+        //
+        // Dequeue only advances the first position in the header, so find
+        // the ordinal of the element it points at.
+        //
+        int64_t first = get_first_position();
+        auto it = std::lower_bound(
+            offsets.begin(),
+            offsets.end(),
+            std::make_pair(first, static_cast<int64_t>(0)));
+        first_ordinal = it - offsets.begin();
+    }
+
     std::fstream file;
 
     std::iostream& stream;
@@ -364,6 +551,19 @@ private:
 
     std::streampos rollover_size;
 
+    //
+    // Offset and length of every element written since the last rollover.
+    // File backed queues persist it to a side file so that reopening a large
+    // queue does not need to parse every element.
+    //
+    std::vector<std::pair<int64_t, int64_t>> offsets;
+
+    size_t first_ordinal;
+
+    std::string index_filename;
+
+    std::fstream index_file;
+
     constexpr static const int64_t INDEX_SIZE = 10;
 
     constexpr static const int64_t UNINITIALIZED = 0;
@@ -376,56 +576,25 @@ private:
     //
     constexpr static const int64_t DEFAULT_ROLLOVER_SIZE = 0x100000;
 
-    class Iterator
+    T getElementAt(int64_t index)
     {
-    public:
-
-        Iterator(
-            std::iostream& stream,
-            std::streampos position,
-            std::streampos rollover
-        )
-            : stream(stream),
-              position(position),
-              rollover(rollover)
-        {
-        }
-
-        T operator*()
-        {
-            stream.seekg(position, std::ios::beg);
-
-            return Deserialize<T>(stream);
-        }
-
-        Iterator& operator++()
-        {
-            if (position <= rollover)
-            {
-                stream.seekg(position, std::ios::beg);
-                position += Serialize<T>(Deserialize<T>(stream)).length();
-            }
-            else
-            {
-                position = HEADER_SIZE;
-            }
-
-            return *this;
-        }
-
-        bool operator!=(const Iterator& iterator)
-        {
-            return position != iterator.position;
-        }
-
-    private:
+        return read_element(index);
+    }
 
-        std::iostream& stream;
+    int64_t getElementSizeAt(int64_t)
+    {
+        return 1;
+    }
 
-        std::streampos position;
+    int64_t getFirstElementIndex()
+    {
+        return first_ordinal;
+    }
 
-        std::streampos rollover;
-    };
+    int64_t getLastElementIndex()
+    {
+        return offsets.size();
+    }
 
 public:
 
@@ -440,7 +609,12 @@ public:
              std::ios::out | std::ios::in | std::ios::binary),
         stream(rhs.stream),
         filename(rhs.filename),
-        rollover_size(rhs.rollover_size)
+        rollover_size(rhs.rollover_size),
+        offsets(rhs.offsets),
+        first_ordinal(rhs.first_ordinal),
+        index_filename(rhs.index_filename),
+        index_file(rhs.index_filename,
+                   std::ios::out | std::ios::app | std::ios::binary)
     {
     }
 
@@ -449,6 +623,10 @@ public:
         rollover_size = rhs.rollover_size;
         file.swap(rhs.file);
         filename = rhs.filename;
+        offsets.swap(rhs.offsets);
+        first_ordinal = rhs.first_ordinal;
+        index_filename = rhs.index_filename;
+        index_file.swap(rhs.index_file);
         return *this;
     }
 
@@ -462,18 +640,21 @@ public:
         stream(file),
         filename((boost::filesystem::path(dirname) /
                   boost::filesystem::path(filename)).string()),
-        rollover_size(rollover_size)
+        rollover_size(rollover_size),
+        offsets(),
+        first_ordinal(0),
+        index_filename(this->filename + ".index"),
+        index_file()
     {
-        auto path = (boost::filesystem::path(dirname) /
-                     boost::filesystem::path(filename)).string();
-        if (!boost::filesystem::exists(path))
+        if (!boost::filesystem::exists(this->filename))
         {
-            file.open(path, std::ios::out | std::ios::app | std::ios::binary);
-            file << std::setw(INDEX_SIZE) << HEADER_SIZE;
-            file << std::setw(INDEX_SIZE) << UNINITIALIZED;
-            file.flush();
-            file.close();
-            file.open(path, std::ios::out | std::ios::in | std::ios::binary);
+            open_file();
+        }
+        load_index();
+        if (!index_file.is_open())
+        {
+            index_file.open(index_filename,
+                            std::ios::out | std::ios::app | std::ios::binary);
         }
     }
 
@@ -481,7 +662,11 @@ public:
         std::iostream& stream,
         std::streampos rollover_size=DEFAULT_ROLLOVER_SIZE
     ) : stream(stream),
-        rollover_size(rollover_size)
+        rollover_size(rollover_size),
+        offsets(),
+        first_ordinal(0),
+        index_filename(),
+        index_file()
     {
         stream.seekg(0, std::ios::end);
         if (stream.tellg() < HEADER_SIZE)
@@ -489,22 +674,18 @@ public:
             stream << std::setw(INDEX_SIZE) << HEADER_SIZE;
             stream << std::setw(INDEX_SIZE) << UNINITIALIZED;
         }
+        load_index();
     }
 
-    void Enqueue(T e)
+    void Enqueue(const T& e)
     {
         std::string element_as_string = Serialize<T>(e);
         auto size = element_as_string.length();
 
-        std::streampos position = get_last_position();
-        if (position == UNINITIALIZED)
-        {
-            position = HEADER_SIZE;
-        }
-        else
+        std::streampos position = HEADER_SIZE;
+        if (!offsets.empty())
         {
-            stream.seekg(position, std::ios::beg);
-            position += Serialize<T>(Deserialize<T>(stream)).length();
+            position = offsets.back().first + offsets.back().second;
         }
 
         if (rollover_size < position + static_cast<std::streampos>(size))
@@ -514,6 +695,13 @@ public:
             boost::filesystem::rename(filename, filename + ".0");
             file.open(filename, std::ios::out | std::ios::app | std::ios::binary);
 
+            index_file.close();
+            if (boost::filesystem::exists(index_filename))
+            {
+                boost::filesystem::rename(index_filename,
+                                          filename + ".0.index");
+            }
+
             position = HEADER_SIZE;
             stream.seekp(0 * INDEX_SIZE, std::ios::beg);
             stream << std::setw(INDEX_SIZE) << position;
@@ -542,15 +730,20 @@ public:
         stream.seekp(1 * INDEX_SIZE, std::ios::beg);
         stream << std::setw(INDEX_SIZE) << position;
         stream.flush();
+
+        append_index(position, size);
     }
 
     void Dequeue()
     {
-        auto position = get_first_position();
-        stream.seekg(position, std::ios::beg);
+        if (first_ordinal >= offsets.size())
+        {
+            return;
+        }
 
-        auto next = position + static_cast<std::streampos>(
-            Serialize<T>(Deserialize<T>(stream)).length());
+        auto next = offsets[first_ordinal].first +
+                    offsets[first_ordinal].second;
+        first_ordinal += 1;
 
         stream.seekp(0 * INDEX_SIZE, std::ios::beg);
         stream << std::setw(INDEX_SIZE) << next;
@@ -558,36 +751,52 @@ public:
 
     T Last()
     {
-        auto position = get_last_position();
+        if (offsets.empty())
+        {
+            return T();
+        }
+        return read_element(offsets.size() - 1);
+    }
 
-        stream.seekg(position, std::ios::beg);
-        return Deserialize<T>(stream);
+    //
+    // Random access to the element at the given position counting from the
+    // first element of the queue.
+    //
+    T At(size_t position)
+    {
+        if (first_ordinal + position >= offsets.size())
+        {
+            return T();
+        }
+        return read_element(first_ordinal + position);
     }
 
-    Iterator begin()
+    size_t Size()
     {
-        return Iterator(stream, get_first_position(), rollover_size);
+        return offsets.size() - first_ordinal;
     }
 
-    Iterator end()
+    //
+    // Reopen the queue file and load its offsets index again, trusting the
+    // side index only if it agrees with the new file as on open.
+    //
+    void Reload()
     {
-        auto first = get_first_position();
-        auto last = get_last_position();
-        auto eof = get_eof_position();
-        if (last == UNINITIALIZED || last == eof)
+        if (!index_filename.empty())
         {
-            last = first;
+            open_file();
+            index_file.close();
         }
-        else
+        stream.clear();
+        load_index();
+        if (!index_filename.empty() && !index_file.is_open())
         {
-            stream.seekg(last, std::ios::beg);
-            last += Serialize<T>(Deserialize<T>(stream)).length();
+            index_file.open(index_filename,
+                            std::ios::out | std::ios::app | std::ios::binary);
         }
-        return Iterator(stream, last, rollover_size);
     }
 };
 
-
 }
 
 
@@ -1,18 +1,28 @@
 #ifndef __RECEIVER_HPP_INCLUDED__
 #define __RECEIVER_HPP_INCLUDED__
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
 #include <typeindex>
 #include <typeinfo>
 #include <unordered_map>
 #include <vector>
 
+#include <boost/asio.hpp>
+
 #include <boost/make_shared.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include "paxos/callback.hpp"
 #include "paxos/customhash.hpp"
 #include "paxos/messages.hpp"
+#include "paxos/serialization.hpp"
 #include "paxos/server.hpp"
 
 
@@ -27,26 +37,71 @@ public:
     virtual void RegisterCallback(Callback&& callback, MessageType type) = 0;
 };
 
-template<typename Server>
+template<typename Server, typename Codec=TextCodec>
 class NetworkReceiver : public Receiver
 {
 public:
 
+    //
+    // With threads set, callbacks are dispatched to a pool of that many
+    // threads through one strand per role so that roles run in parallel
+    // while each role still handles one message at a time. Without threads,
+    // callbacks run on the server thread that received the message.
+    //
     NetworkReceiver(std::string address,
                     short port,
-                    const std::shared_ptr<ReplicaSet>& replicaset)
-        : server(boost::make_shared<Server>(address, port)),
-          replicaset(replicaset)
+                    const std::shared_ptr<ReplicaSet>& replicaset,
+                    size_t threads=0)
+        : server(make_server(
+              address,
+              port,
+              threads,
+              std::integral_constant<
+                  bool,
+                  std::is_constructible<
+                      Server, std::string, short, size_t>::value>())),
+          replicaset(replicaset),
+          registration_mutex(),
+          table(nullptr),
+          tables(),
+          dispatch_service(),
+          work(threads > 0
+               ? new boost::asio::io_service::work(dispatch_service)
+               : nullptr)
     {
-        server->RegisterAction([this](std::string content){
+        tables.emplace_back(new DispatchTable());
+        table.store(tables.back().get(), std::memory_order_release);
+
+        for (size_t i=0; i<threads; i++)
+        {
+            workers.emplace_back([this]() { dispatch_service.run(); });
+        }
+
+        server->RegisterAction([this](const std::string& content){
             ProcessContent(content);
         });
         server->Start();
     }
 
-    void ProcessContent(std::string content)
+    ~NetworkReceiver()
+    {
+        work.reset();
+        dispatch_service.stop();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    void ProcessContent(const std::string& content)
     {
-        Message message = Deserialize<Message>(content);
+        //
+        // The message is decoded straight out of the server's receive buffer
+        // and then handed to every callback by reference, so the decree
+        // payload is copied once between the socket and the ledger.
+        //
+        Message message = Codec::template Deserialize<Message>(
+            content.data(), content.size());
 
         if (!replicaset->Contains(message.from) &&
             !message.from.hostname.empty() && message.from.port != 0)
@@ -59,45 +114,136 @@ public:
             return;
         }
 
-        for (Callback callback : GetRegisteredCallbacks(message.type))
+        const std::vector<Registration>& registrations =
+            get_registrations(message.type);
+
+        //
+        // Messages bound for a strand outlive this call so the message is
+        // moved into shared storage the first time a strand needs it.
+        //
+        const Message* current = &message;
+        std::shared_ptr<const Message> shared;
+        for (const Registration& registration : registrations)
         {
-            callback(message);
+            if (registration.strand == nullptr)
+            {
+                registration.callback(*current);
+                continue;
+            }
+            if (shared == nullptr)
+            {
+                shared = std::make_shared<const Message>(std::move(message));
+                current = shared.get();
+            }
+            const Registration* target = &registration;
+            registration.strand->post([target, shared]()
+            {
+                target->callback(*shared);
+            });
         }
     }
 
     void RegisterCallback(Callback&& callback, MessageType type) override
     {
-        if (registered_map.find(type) == registered_map.end())
+        std::lock_guard<std::mutex> lock(registration_mutex);
+
+        boost::asio::io_service::strand* strand = nullptr;
+        if (work != nullptr && callback.GetContext() != nullptr)
         {
-            registered_map[type] = std::vector<Callback> { std::move(callback) };
+            auto& owned = strands[callback.GetContext()];
+            if (owned == nullptr)
+            {
+                owned.reset(new boost::asio::io_service::strand(
+                    dispatch_service));
+            }
+            strand = owned.get();
         }
-        else
+
+        //
+        // Publish a new immutable table rather than changing the one messages
+        // may be dispatched from. Replaced tables are kept alive so readers
+        // never need a lock or a reference count.
+        //
+        std::unique_ptr<DispatchTable> next(
+            new DispatchTable(*table.load(std::memory_order_acquire)));
+        size_t index = static_cast<size_t>(type);
+        if (index < MessageTypeCount)
         {
-            registered_map[type].push_back(std::move(callback));
+            (*next)[index].push_back(Registration { std::move(callback), strand });
         }
+        table.store(next.get(), std::memory_order_release);
+        tables.push_back(std::move(next));
     }
 
+    //
+    // Copy of the callbacks registered for a message type. Dispatch does not
+    // use this.
+    //
     std::vector<Callback> GetRegisteredCallbacks(MessageType type)
     {
-        if (registered_map.find(type) != registered_map.end())
-        {
-            return registered_map[type];
-        }
-        else
+        std::vector<Callback> callbacks;
+        for (const Registration& registration : get_registrations(type))
         {
-            return std::vector<Callback>();
+            callbacks.push_back(registration.callback);
         }
+        return callbacks;
     }
 
 private:
 
+    static boost::shared_ptr<Server> make_server(
+        std::string address, short port, size_t threads, std::true_type)
+    {
+        return boost::make_shared<Server>(
+            address, port, std::max<size_t>(threads, 1));
+    }
+
+    static boost::shared_ptr<Server> make_server(
+        std::string address, short port, size_t threads, std::false_type)
+    {
+        return boost::make_shared<Server>(address, port);
+    }
+
     boost::shared_ptr<Server> server;
 
     const std::shared_ptr<ReplicaSet>& replicaset;
 
-    std::unordered_map<MessageType, std::vector<Callback>> registered_map;
-};
+    struct Registration
+    {
+        Callback callback;
+
+        boost::asio::io_service::strand* strand;
+    };
 
+    using DispatchTable = std::array<std::vector<Registration>, MessageTypeCount>;
+
+    const std::vector<Registration>& get_registrations(MessageType type) const
+    {
+        static const std::vector<Registration> none;
+
+        size_t index = static_cast<size_t>(type);
+        if (index >= MessageTypeCount)
+        {
+            return none;
+        }
+        return (*table.load(std::memory_order_acquire))[index];
+    }
+
+    std::mutex registration_mutex;
+
+    std::atomic<const DispatchTable*> table;
+
+    std::vector<std::unique_ptr<const DispatchTable>> tables;
+
+    boost::asio::io_service dispatch_service;
+
+    std::unique_ptr<boost::asio::io_service::work> work;
+
+    std::unordered_map<Context*,
+                       std::unique_ptr<boost::asio::io_service::strand>> strands;
+
+    std::vector<std::thread> workers;
+};
 
 }
 
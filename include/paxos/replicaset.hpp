@@ -1,10 +1,15 @@
 #ifndef __REPLICASET_HPP_INCLUDED__
 #define __REPLICASET_HPP_INCLUDED__
 
+#include <bitset>
+#include <cstdint>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
 
 
 namespace paxos
@@ -44,6 +49,53 @@ struct compare_replica
 };
 
 
+struct hash_replica
+{
+    size_t operator()(const Replica& replica) const
+    {
+        return std::hash<std::string>()(replica.hostname) ^
+               (std::hash<short>()(replica.port) << 1);
+    }
+};
+
+
+struct equal_replica
+{
+    bool operator()(const Replica& lhs, const Replica& rhs) const
+    {
+        return IsReplicaEqual(lhs, rhs);
+    }
+};
+
+
+//
+// Small integer standing for a replica within this process. Equal replicas
+// always intern to the same id, so ids compare without touching hostnames.
+//
+using ReplicaId = uint32_t;
+
+
+ReplicaId InternReplica(const Replica& replica);
+
+
+Replica InternedReplica(ReplicaId id);
+
+
+//
+// Votes are kept as one bit per replica so a replica set holds at most this
+// many replicas.
+//
+const size_t MaxReplicas = 64;
+
+
+class VoteSet;
+
+
+/*
+ * ReplicaSet is safe to use from several threads. Iterating with begin and end
+ * is not, so iterate over a Copy when the set may change concurrently.
+ */
+
 class ReplicaSet
 {
 public:
@@ -66,6 +118,22 @@ public:
 
     std::shared_ptr<ReplicaSet> Difference(std::shared_ptr<const ReplicaSet> other) const;
 
+    //
+    // Replicas of this set that have no vote in votes.
+    //
+    std::shared_ptr<ReplicaSet> Difference(const VoteSet& votes) const;
+
+    std::shared_ptr<ReplicaSet> Copy() const;
+
+    //
+    // Dense id of the replica within the current membership, or -1 if it is
+    // not a member, along with the epoch the id belongs to. Ids are assigned
+    // again whenever the membership changes and the set moves to a new epoch.
+    //
+    int Id(const Replica& replica, uint64_t& epoch) const;
+
+    uint64_t Epoch() const;
+
     using iterator = std::set<Replica, compare_replica>::iterator;
 
     using const_iterator = std::set<Replica, compare_replica>::const_iterator;
@@ -77,6 +145,46 @@ public:
 private:
 
     std::set<Replica, compare_replica> replicaset;
+
+    std::unordered_map<Replica, int, hash_replica, equal_replica> ids;
+
+    uint64_t epoch;
+
+    mutable std::mutex mutex;
+
+    void renumber();
+};
+
+
+/*
+ * Votes for one decree as a bitset over the dense replica ids of a replica
+ * set. Only members can vote and only votes cast in the current epoch of the
+ * replica set count, so counting a quorum is a popcount. Once the membership
+ * changes the votes cast before no longer count and voting starts over.
+ */
+
+class VoteSet
+{
+public:
+
+    VoteSet();
+
+    //
+    // Record the vote of replica. Returns false if replica is not a member.
+    //
+    bool Add(const Replica& replica, const ReplicaSet& replicaset);
+
+    bool Contains(const Replica& replica, const ReplicaSet& replicaset) const;
+
+    int Count(const ReplicaSet& replicaset) const;
+
+private:
+
+    friend class ReplicaSet;
+
+    uint64_t epoch;
+
+    std::bitset<MaxReplicas> votes;
 };
 
 
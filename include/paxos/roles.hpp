@@ -53,67 +53,79 @@ void RegisterUpdater(
  */
 
 void HandleRequest(
-    Message message,
+    const Message& message,
     std::shared_ptr<ProposerContext> context,
     std::shared_ptr<Sender> sender);
 
 
 void HandlePromise(
-    Message message,
+    const Message& message,
     std::shared_ptr<ProposerContext> context,
     std::shared_ptr<Sender> sender);
 
 
 void HandleNackTie(
-    Message message,
+    const Message& message,
     std::shared_ptr<ProposerContext> context,
     std::shared_ptr<Sender> sender);
 
 
 void HandleNack(
-    Message message,
+    const Message& message,
     std::shared_ptr<ProposerContext> context,
     std::shared_ptr<Sender> sender);
 
 
 void HandleResume(
-    Message message,
+    const Message& message,
     std::shared_ptr<ProposerContext> context,
     std::shared_ptr<Sender> sender);
 
 
 void HandlePrepare(
-    Message message,
+    const Message& message,
     std::shared_ptr<AcceptorContext> context,
     std::shared_ptr<Sender> sender);
 
 
 void HandleAccept(
-    Message message,
+    const Message& message,
     std::shared_ptr<AcceptorContext> context,
     std::shared_ptr<Sender> sender);
 
 
 void HandleCleanup(
-    Message message,
+    const Message& message,
     std::shared_ptr<AcceptorContext> context,
     std::shared_ptr<Sender> sender);
 
 
 void HandleAccepted(
-    Message message,
+    const Message& message,
     std::shared_ptr<LearnerContext> context,
     std::shared_ptr<Sender> sender);
 
 
 void HandleUpdated(
-    Message message,
+    const Message& message,
+    std::shared_ptr<LearnerContext> context,
+    std::shared_ptr<Sender> sender);
+
+
+void HandleUpdatedRange(
+    const Message& message,
+    std::shared_ptr<LearnerContext> context,
+    std::shared_ptr<Sender> sender);
+
+
+void HandleSnapshot(
+    const Message& message,
     std::shared_ptr<LearnerContext> context,
     std::shared_ptr<Sender> sender);
 
 
 void HandleUpdate(
-    Message message,
+    const Message& message,
     std::shared_ptr<UpdaterContext> context,
     std::shared_ptr<Sender> sender);
 
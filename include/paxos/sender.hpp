@@ -2,9 +2,13 @@
 #define __SENDER_HPP_INCLUDED__
 
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -12,6 +16,7 @@
 #include <boost/asio/deadline_timer.hpp>
 
 #include "paxos/messages.hpp"
+#include "paxos/metrics.hpp"
 #include "paxos/replicaset.hpp"
 #include "paxos/serialization.hpp"
 
@@ -36,28 +41,66 @@ class FileSender
 {
 public:
 
-    virtual void SendFile(Replica replica, BootstrapFile file) = 0;
+    //
+    // Returns whether the replica acknowledged writing the file.
+    //
+    virtual bool SendFile(Replica replica, BootstrapFile file) = 0;
 };
 
 
+//
+// Bytes a transport queues for a peer that is not keeping up before it drops
+// the oldest queued messages.
+//
+const size_t TransportMaxPendingBytes = 64 << 20;
+
+
+//
+// Slowest rate in bytes per second a peer may read at before a write to it
+// times out. Each write gets one second plus the time this rate needs for it.
+//
+const size_t TransportMinWriteRate = 1 << 20;
+
+
+/*
+ * BoostTransport keeps a persistent connection to one peer. Write queues the
+ * content and returns at once; the transport's own thread connects on demand
+ * and drains everything queued so far with a single gathered write, so a slow
+ * or dead peer only delays its own messages. Past max_pending_bytes the oldest
+ * queued messages are dropped, just as messages for an unreachable peer are.
+ */
+
 class BoostTransport
 {
 public:
 
-    BoostTransport(std::string hostname, short port);
+    BoostTransport(std::string hostname,
+                   short port,
+                   size_t max_pending_bytes=TransportMaxPendingBytes);
 
     ~BoostTransport();
 
     void Write(std::string content);
 
-    void Read();
+    //
+    // Block until queued writes are flushed and then read a one byte
+    // acknowledgement from the peer. Returns whether the peer acknowledged
+    // success.
+    //
+    bool Read();
 
 private:
 
+    void connect();
+
+    void flush();
+
     void check_deadline();
 
     boost::asio::io_service io_service_;
 
+    std::unique_ptr<boost::asio::io_service::work> work_;
+
     boost::asio::ip::tcp::socket socket_;
 
     boost::asio::ip::tcp::resolver resolver_;
@@ -65,10 +108,38 @@ private:
     boost::asio::ip::basic_resolver_iterator<boost::asio::ip::tcp> endpoint_;
 
     boost::asio::deadline_timer timer_;
+
+    std::mutex mutex_;
+
+    std::condition_variable drained_;
+
+    //
+    // Content waiting for the next write and content of the write in flight.
+    // Only the transport thread touches writing_ and headers_.
+    //
+    std::deque<std::string> pending_;
+
+    size_t pending_bytes_;
+
+    size_t max_pending_bytes_;
+
+    bool is_dropping_;
+
+    std::deque<std::string> writing_;
+
+    std::vector<std::vector<uint8_t>> headers_;
+
+    bool is_connected_;
+
+    bool is_connecting_;
+
+    bool is_writing_;
+
+    std::thread thread_;
 };
 
 
-template<typename Transport>
+template<typename Transport, typename Codec=TextCodec>
 class NetworkSender : public Sender
 {
 public:
@@ -80,36 +151,26 @@ public:
 
     void Reply(Message message)
     {
-        std::lock_guard<std::mutex> guard(mutex);
-
-        std::string key = message.to.hostname + ":" +
-                          std::to_string(message.to.port);
-        if (cached_transports.find(key) == std::end(cached_transports))
-        {
-            cached_transports[key] = std::unique_ptr<Transport>(
-                                        new Transport(message.to.hostname,
-                                                      message.to.port));
-        }
-        auto& transport = cached_transports[key];
-
-        // 1. serialize message
-        std::string message_str = Serialize(message);
-
-        if (IsValidMessageString(message_str))
-        {
-            // 2. write message
-            transport->Write(message_str);
-        }
+        auto start = std::chrono::steady_clock::now();
+        send(message.to, Codec::Serialize(message));
+        GlobalMetrics().send_latency.Record(ElapsedMicroseconds(start));
     }
 
     void ReplyAll(Message message)
     {
-        for (auto r : *replicaset)
+        auto start = std::chrono::steady_clock::now();
+
+        //
+        // Encode the message once and only re-encode the recipient for each
+        // replica.
+        //
+        std::string message_str = Codec::Serialize(message);
+        auto replicas = replicaset->Copy();
+        for (auto r : *replicas)
         {
-            Message m = message;
-            m.to = r;
-            Reply(m);
+            send(r, Codec::Readdress(message_str, message, r));
         }
+        GlobalMetrics().send_latency.Record(ElapsedMicroseconds(start));
     }
 
 private:
@@ -120,6 +181,31 @@ private:
 
     std::mutex mutex;
 
+    void send(const Replica& to, std::string message_str)
+    {
+        if (!IsValidMessageString(message_str))
+        {
+            return;
+        }
+
+        GlobalMetrics().messages_sent.Add();
+        GlobalMetrics().bytes_sent.Add(message_str.size());
+
+        //
+        // The lock only guards the transport cache. Transports queue writes
+        // so no network I/O happens while it is held.
+        //
+        std::lock_guard<std::mutex> guard(mutex);
+
+        std::string key = to.hostname + ":" + std::to_string(to.port);
+        if (cached_transports.find(key) == std::end(cached_transports))
+        {
+            cached_transports[key] = std::unique_ptr<Transport>(
+                                        new Transport(to.hostname, to.port));
+        }
+        cached_transports[key]->Write(std::move(message_str));
+    }
+
     bool IsValidMessageString(const std::string& message_str)
     {
         return message_str.size() > 0;
@@ -128,34 +214,59 @@ private:
 
 
 
-template<typename Transport>
+template<typename Transport, typename Codec=TextCodec>
 class NetworkFileSender : public FileSender
 {
 public:
 
-    void SendFile(Replica replica, BootstrapFile file)
+    //
+    // Connections to a replica are pooled. Each concurrent send takes its own
+    // connection and returns it when done, so a bootstrap streaming chunks
+    // from several threads opens one connection per thread. A connection
+    // whose send fails is dropped and replaced on the next send.
+    //
+    bool SendFile(Replica replica, BootstrapFile file)
     {
-        std::lock_guard<std::mutex> guard(mutex);
-
         std::string key = replica.hostname + ":" +
                           std::to_string(replica.port + 1);
-        auto transport = std::unique_ptr<Transport>(
-                                    new Transport(replica.hostname,
-                                                  replica.port + 1));
+        std::unique_ptr<Transport> transport;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+
+            auto& idle = idle_transports[key];
+            if (!idle.empty())
+            {
+                transport = std::move(idle.back());
+                idle.pop_back();
+            }
+        }
+        if (!transport)
+        {
+            transport = std::unique_ptr<Transport>(
+                new Transport(replica.hostname, replica.port + 1));
+        }
 
         // 1. serialize file
-        std::string file_str = Serialize(file);
+        std::string file_str = Codec::Serialize(file);
 
         // 2. write file
-        transport->Write(file_str);
+        transport->Write(std::move(file_str));
 
         // 3. block until file send completed
-        transport->Read();
+        if (!transport->Read())
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> guard(mutex);
+        idle_transports[key].push_back(std::move(transport));
+        return true;
     }
 
 private:
 
-    std::unordered_map<std::string, std::unique_ptr<Transport>> cached_transports;
+    std::unordered_map<std::string,
+                       std::vector<std::unique_ptr<Transport>>> idle_transports;
 
     std::mutex mutex;
 };
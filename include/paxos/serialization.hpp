@@ -1,11 +1,19 @@
 #ifndef __SERIALIZATION_HPP_INCLUDED__
 #define __SERIALIZATION_HPP_INCLUDED__
 
+#include <cstdint>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 #include "boost/archive/text_iarchive.hpp"
 #include "boost/archive/text_oarchive.hpp"
+#include "boost/iostreams/device/array.hpp"
+#include "boost/iostreams/stream.hpp"
+#include "boost/serialization/vector.hpp"
 
 #include "paxos/decree.hpp"
 #include "paxos/file.hpp"
@@ -68,11 +76,30 @@ void serialize(Archive& ar, BootstrapFile& obj, const unsigned int version)
 {
     ar & obj.name;
     ar & obj.content;
+    ar & obj.offset;
+    ar & obj.checksum;
+    ar & obj.probe;
+}
+
+
+template <typename Archive>
+void serialize(Archive& ar, BootstrapManifestEntry& obj, const unsigned int version)
+{
+    ar & obj.name;
+    ar & obj.size;
+    ar & obj.checksum;
+}
+
+
+template <typename Archive>
+void serialize(Archive& ar, BootstrapManifest& obj, const unsigned int version)
+{
+    ar & obj.files;
 }
 
 
 template <typename T>
-std::string Serialize(T object)
+std::string Serialize(const T& object)
 {
     std::stringstream stream;
     try
@@ -89,10 +116,14 @@ std::string Serialize(T object)
 
 
 template <typename T>
-T Deserialize(std::string string_obj)
+T Deserialize(const char* data, size_t size)
 {
+    //
+    // Parse directly out of the caller's buffer rather than copying it into
+    // a stringstream first.
+    //
     T object;
-    std::stringstream stream(string_obj);
+    boost::iostreams::stream<boost::iostreams::array_source> stream(data, size);
     try
     {
         boost::archive::text_iarchive oa(stream);
@@ -105,15 +136,392 @@ T Deserialize(std::string string_obj)
 }
 
 
+template <typename T>
+T Deserialize(const std::string& string_obj)
+{
+    return Deserialize<T>(string_obj.data(), string_obj.size());
+}
+
+
 template <typename T>
 T Deserialize(std::istream& stream)
 {
-    std::stringstream sstream;
-    sstream << stream.rdbuf();
-    return Deserialize<T>(sstream.str());
+    //
+    // Parse from the stream's current position and only consume the object
+    // rather than copying the remainder of the stream first.
+    //
+    T object;
+    try
+    {
+        boost::archive::text_iarchive oa(stream);
+        oa >> object;
+    }
+    catch (boost::archive::archive_exception& e)
+    {
+    }
+    return object;
 }
 
 
+//
+// Binary wire format. Every encoded object starts with a magic byte and a
+// format version followed by the little-endian length of the body. Integers
+// are written as fixed width little-endian values, enums as 32-bit integers,
+// and strings and vectors as a 32-bit length followed by their elements.
+// Nested structures reuse the serialize() templates above so the field order
+// is shared with the text archive.
+//
+const uint8_t BinaryArchiveMagic = 0xB1;
+
+const uint8_t BinaryArchiveVersion = 1;
+
+const size_t BinaryArchiveHeaderSize = 6;
+
+
+class BinaryArchiveException : public std::runtime_error
+{
+public:
+
+    BinaryArchiveException(const std::string& what)
+        : std::runtime_error(what)
+    {
+    }
+};
+
+
+class BinaryOutputArchive
+{
+public:
+
+    BinaryOutputArchive(std::string& buffer)
+        : buffer(buffer)
+    {
+    }
+
+    template <typename T>
+    BinaryOutputArchive& operator&(T& value)
+    {
+        save(value);
+        return *this;
+    }
+
+    template <typename T>
+    BinaryOutputArchive& operator<<(T& value)
+    {
+        return *this & value;
+    }
+
+private:
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value>::type
+    save(T value)
+    {
+        auto bits = static_cast<typename std::make_unsigned<T>::type>(value);
+        for (size_t i=0; i<sizeof(T); i++)
+        {
+            buffer.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+        }
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type
+    save(T value)
+    {
+        save(static_cast<int32_t>(value));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_same<T, std::string>::value>::type
+    save(T& value)
+    {
+        save(static_cast<uint32_t>(value.size()));
+        buffer.append(value);
+    }
+
+    template <typename T>
+    void save(std::vector<T>& value)
+    {
+        save(static_cast<uint32_t>(value.size()));
+        for (T& element : value)
+        {
+            save(element);
+        }
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_class<T>::value &&
+                            !std::is_same<T, std::string>::value>::type
+    save(T& value)
+    {
+        serialize(*this, value, BinaryArchiveVersion);
+    }
+
+    std::string& buffer;
+};
+
+
+class BinaryInputArchive
+{
+public:
+
+    BinaryInputArchive(const char* data, size_t size)
+        : position(data), end(data + size)
+    {
+    }
+
+    template <typename T>
+    BinaryInputArchive& operator&(T& value)
+    {
+        load(value);
+        return *this;
+    }
+
+    template <typename T>
+    BinaryInputArchive& operator>>(T& value)
+    {
+        return *this & value;
+    }
+
+private:
+
+    void require(size_t size)
+    {
+        if (static_cast<size_t>(end - position) < size)
+        {
+            throw BinaryArchiveException("binary archive truncated");
+        }
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value>::type
+    load(T& value)
+    {
+        require(sizeof(T));
+        typename std::make_unsigned<T>::type bits = 0;
+        for (size_t i=0; i<sizeof(T); i++)
+        {
+            bits |= static_cast<typename std::make_unsigned<T>::type>(
+                static_cast<uint8_t>(position[i])) << (8 * i);
+        }
+        position += sizeof(T);
+        value = static_cast<T>(bits);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type
+    load(T& value)
+    {
+        int32_t underlying;
+        load(underlying);
+        value = static_cast<T>(underlying);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_same<T, std::string>::value>::type
+    load(T& value)
+    {
+        uint32_t size;
+        load(size);
+        require(size);
+        value.assign(position, size);
+        position += size;
+    }
+
+    template <typename T>
+    void load(std::vector<T>& value)
+    {
+        uint32_t size;
+        load(size);
+        value.clear();
+        for (uint32_t i=0; i<size; i++)
+        {
+            T element;
+            load(element);
+            value.push_back(element);
+        }
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_class<T>::value &&
+                            !std::is_same<T, std::string>::value>::type
+    load(T& value)
+    {
+        serialize(*this, value, BinaryArchiveVersion);
+    }
+
+    const char* position;
+
+    const char* end;
+};
+
+
+inline bool IsBinaryArchive(const char* data, size_t size)
+{
+    return size >= BinaryArchiveHeaderSize &&
+           static_cast<uint8_t>(data[0]) == BinaryArchiveMagic;
+}
+
+
+template <typename T>
+std::string BinarySerialize(const T& object)
+{
+    std::string buffer;
+    buffer.reserve(64);
+    buffer.push_back(static_cast<char>(BinaryArchiveMagic));
+    buffer.push_back(static_cast<char>(BinaryArchiveVersion));
+    buffer.append(4, '\0');
+
+    BinaryOutputArchive oa(buffer);
+    oa << const_cast<T&>(object);
+
+    uint32_t body_size = buffer.size() - BinaryArchiveHeaderSize;
+    for (size_t i=0; i<4; i++)
+    {
+        buffer[2 + i] = static_cast<char>((body_size >> (8 * i)) & 0xFF);
+    }
+    return buffer;
+}
+
+
+template <typename T>
+T BinaryDeserialize(const char* data, size_t size)
+{
+    T object;
+    if (!IsBinaryArchive(data, size) ||
+        static_cast<uint8_t>(data[1]) != BinaryArchiveVersion)
+    {
+        return object;
+    }
+
+    uint32_t body_size = 0;
+    for (size_t i=0; i<4; i++)
+    {
+        body_size |= static_cast<uint32_t>(
+            static_cast<uint8_t>(data[2 + i])) << (8 * i);
+    }
+    if (body_size > size - BinaryArchiveHeaderSize)
+    {
+        return object;
+    }
+
+    try
+    {
+        BinaryInputArchive ia(data + BinaryArchiveHeaderSize, body_size);
+        ia >> object;
+    }
+    catch (BinaryArchiveException& e)
+    {
+        return T();
+    }
+    return object;
+}
+
+
+template <typename T>
+T BinaryDeserialize(const std::string& string_obj)
+{
+    return BinaryDeserialize<T>(string_obj.data(), string_obj.size());
+}
+
+
+/*
+ * Codecs select the wire format used by senders and receivers. Both ends of a
+ * connection must agree on the codec, although the binary codec will still
+ * decode text archives so that replicas can be upgraded one at a time.
+ */
+
+struct TextCodec
+{
+    template <typename T>
+    static std::string Serialize(const T& object)
+    {
+        return paxos::Serialize(object);
+    }
+
+    template <typename T>
+    static T Deserialize(const char* data, size_t size)
+    {
+        return paxos::Deserialize<T>(data, size);
+    }
+
+    template <typename T>
+    static T Deserialize(const std::string& string_obj)
+    {
+        return paxos::Deserialize<T>(string_obj.data(), string_obj.size());
+    }
+
+    static std::string Readdress(const std::string&,
+                                 const Message& message,
+                                 const Replica& to)
+    {
+        Message readdressed = message;
+        readdressed.to = to;
+        return Serialize(readdressed);
+    }
+};
+
+
+struct BinaryCodec
+{
+    template <typename T>
+    static std::string Serialize(const T& object)
+    {
+        return BinarySerialize(object);
+    }
+
+    template <typename T>
+    static T Deserialize(const char* data, size_t size)
+    {
+        if (!IsBinaryArchive(data, size))
+        {
+            return paxos::Deserialize<T>(data, size);
+        }
+        return BinaryDeserialize<T>(data, size);
+    }
+
+    template <typename T>
+    static T Deserialize(const std::string& string_obj)
+    {
+        return Deserialize<T>(string_obj.data(), string_obj.size());
+    }
+
+    //
+    // Re-encode an encoded message for another recipient. Only the recipient
+    // is re-encoded and spliced in so that fan-out encodes the decree once.
+    //
+    static std::string Readdress(const std::string& encoded,
+                                 const Message& message,
+                                 const Replica& to)
+    {
+        std::string from_bytes, old_to_bytes, new_to_bytes;
+        BinaryOutputArchive from_archive(from_bytes);
+        from_archive << const_cast<Replica&>(message.from);
+        BinaryOutputArchive old_to_archive(old_to_bytes);
+        old_to_archive << const_cast<Replica&>(message.to);
+        BinaryOutputArchive new_to_archive(new_to_bytes);
+        new_to_archive << const_cast<Replica&>(to);
+
+        size_t offset = BinaryArchiveHeaderSize + from_bytes.size();
+        std::string readdressed;
+        readdressed.reserve(
+            encoded.size() - old_to_bytes.size() + new_to_bytes.size());
+        readdressed.append(encoded, 0, offset);
+        readdressed.append(new_to_bytes);
+        readdressed.append(encoded, offset + old_to_bytes.size(),
+                           std::string::npos);
+
+        uint32_t body_size = readdressed.size() - BinaryArchiveHeaderSize;
+        for (size_t i=0; i<4; i++)
+        {
+            readdressed[2 + i] =
+                static_cast<char>((body_size >> (8 * i)) & 0xFF);
+        }
+        return readdressed;
+    }
+};
+
+
 }
 
 
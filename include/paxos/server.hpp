@@ -18,7 +18,11 @@ public:
 
     SynchronousServer(std::string address, short port);
 
-    void RegisterAction(std::function<void(const std::string& content)> action_);
+    //
+    // Each message is acknowledged with one byte, which is 1 when the action
+    // returned true. A connection may carry any number of messages.
+    //
+    void RegisterAction(std::function<bool(const std::string& content)> action_);
 
     void Start();
 
@@ -28,11 +32,13 @@ private:
 
     void do_accept();
 
+    void serve(boost::asio::ip::tcp::socket& socket);
+
     boost::asio::io_service io_service;
 
     boost::asio::ip::tcp::acceptor acceptor;
 
-    std::function<void(const std::string& content)> action;
+    std::function<bool(const std::string& content)> action;
 };
 
 
@@ -40,7 +46,12 @@ class AsynchronousServer : public boost::enable_shared_from_this<AsynchronousSer
 {
 public:
 
-    AsynchronousServer(std::string address, short port);
+    //
+    // Connections are served by a pool of threads running the io_service.
+    // Reads on one connection never overlap, so its messages are handled in
+    // the order they arrive.
+    //
+    AsynchronousServer(std::string address, short port, size_t threads=1);
 
     ~AsynchronousServer();
 
@@ -54,6 +65,8 @@ private:
 
     void do_accept();
 
+    size_t threads;
+
     boost::asio::io_service io_service;
 
     boost::asio::ip::tcp::acceptor acceptor;
@@ -80,7 +93,13 @@ private:
 
         boost::asio::ip::tcp::socket socket;
 
-        std::vector<uint8_t> readbuf;
+        std::vector<uint8_t> header;
+
+        //
+        // Message bodies are read straight into a string so that the buffer
+        // can be handed to the action without an intermediate copy.
+        //
+        std::string readbuf;
 
         std::function<void(const std::string& content)> action;
     };
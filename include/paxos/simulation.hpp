@@ -0,0 +1,295 @@
+#ifndef __SIMULATION_HPP_INCLUDED__
+#define __SIMULATION_HPP_INCLUDED__
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "paxos/callback.hpp"
+#include "paxos/ledger.hpp"
+#include "paxos/messages.hpp"
+#include "paxos/parliament.hpp"
+#include "paxos/receiver.hpp"
+#include "paxos/replicaset.hpp"
+#include "paxos/sender.hpp"
+
+
+namespace paxos
+{
+
+
+/*
+ * Virtual clock of a discrete event simulation. Events run in time order and
+ * events due at the same time run in the order they were scheduled, so a run
+ * is fully determined by what is scheduled. Nothing here waits on real time.
+ */
+class SimulatedClock
+{
+public:
+
+    using duration = std::chrono::microseconds;
+
+    SimulatedClock();
+
+    duration Now() const;
+
+    void Schedule(duration delay, std::function<void()> event);
+
+    //
+    // Run the next event and advance the clock to it. Returns false when no
+    // events are left.
+    //
+    bool Step();
+
+    //
+    // Run every event due within period and leave the clock at its end.
+    //
+    void RunFor(duration period);
+
+    //
+    // Run events until done returns true or timeout passes. Returns whether
+    // done was reached.
+    //
+    bool RunUntil(std::function<bool()> done, duration timeout);
+
+    size_t Pending() const;
+
+private:
+
+    struct Event
+    {
+        duration time;
+        uint64_t sequence;
+        std::function<void()> action;
+    };
+
+    struct later_event
+    {
+        bool operator()(const Event& lhs, const Event& rhs) const
+        {
+            if (lhs.time != rhs.time)
+            {
+                return lhs.time > rhs.time;
+            }
+            return lhs.sequence > rhs.sequence;
+        }
+    };
+
+    std::priority_queue<Event, std::vector<Event>, later_event> events;
+
+    duration now;
+
+    uint64_t sequence;
+};
+
+
+//
+// Faults injected into every message between two different replicas. Each
+// message is delayed by latency plus a uniform share of jitter, but stays
+// behind earlier messages on its link. Lost messages are dropped and
+// reordered ones are held back an extra reorder_delay so that later messages
+// overtake them. Messages a replica sends to itself are only delayed.
+//
+struct NetworkConditions
+{
+    std::chrono::microseconds latency;
+
+    std::chrono::microseconds jitter;
+
+    double loss;
+
+    double reorder;
+
+    std::chrono::microseconds reorder_delay;
+
+    NetworkConditions(
+        std::chrono::microseconds latency=std::chrono::microseconds(100),
+        std::chrono::microseconds jitter=std::chrono::microseconds(0),
+        double loss=0.0,
+        double reorder=0.0,
+        std::chrono::microseconds reorder_delay=std::chrono::microseconds(1000))
+        : latency(latency),
+          jitter(jitter),
+          loss(loss),
+          reorder(reorder),
+          reorder_delay(reorder_delay)
+    {
+    }
+};
+
+
+class SimulatedReceiver;
+
+
+/*
+ * In-memory network between simulated replicas. Messages are copied rather
+ * than encoded and are delivered as clock events. All randomness comes from
+ * the seed, so a run with the same seed delivers the same messages at the
+ * same virtual times.
+ */
+class SimulatedNetwork
+{
+public:
+
+    SimulatedNetwork(std::shared_ptr<SimulatedClock> clock,
+                     NetworkConditions conditions=NetworkConditions(),
+                     uint32_t seed=1);
+
+    void Attach(const Replica& replica,
+                std::shared_ptr<SimulatedReceiver> receiver);
+
+    void Send(const Message& message);
+
+    void SetConditions(NetworkConditions conditions);
+
+    //
+    // Cut every link between the replicas in side and the rest of the
+    // network until Heal is called.
+    //
+    void Partition(const std::vector<Replica>& side);
+
+    void Heal();
+
+    uint64_t Delivered() const;
+
+    uint64_t Dropped() const;
+
+private:
+
+    bool is_partitioned(const Replica& from, const Replica& to) const;
+
+    std::shared_ptr<SimulatedClock> clock;
+
+    NetworkConditions conditions;
+
+    std::mt19937 random;
+
+    std::unordered_map<Replica,
+                       std::shared_ptr<SimulatedReceiver>,
+                       hash_replica,
+                       equal_replica> receivers;
+
+    std::unordered_set<Replica, hash_replica, equal_replica> partition;
+
+    //
+    // Delivery time of the latest in-order message on each link.
+    //
+    std::unordered_map<uint64_t, SimulatedClock::duration> link_tails;
+
+    uint64_t delivered;
+
+    uint64_t dropped;
+};
+
+
+class SimulatedSender : public Sender
+{
+public:
+
+    SimulatedSender(std::shared_ptr<SimulatedNetwork> network,
+                    std::shared_ptr<ReplicaSet>& replicaset);
+
+    void Reply(Message message) override;
+
+    void ReplyAll(Message message) override;
+
+private:
+
+    std::shared_ptr<SimulatedNetwork> network;
+
+    std::shared_ptr<ReplicaSet>& replicaset;
+};
+
+
+/*
+ * Receiver that hands delivered messages to the registered callbacks on the
+ * simulation thread, dropping messages from replicas outside the replica set
+ * the same way NetworkReceiver does.
+ */
+class SimulatedReceiver : public Receiver
+{
+public:
+
+    SimulatedReceiver(std::shared_ptr<ReplicaSet>& replicaset);
+
+    void RegisterCallback(Callback&& callback, MessageType type) override;
+
+    void Deliver(const Message& message);
+
+private:
+
+    std::shared_ptr<ReplicaSet>& replicaset;
+
+    std::array<std::vector<Callback>, MessageTypeCount> callbacks;
+};
+
+
+/*
+ * Cluster of replicas in one process, each a full set of roles behind a
+ * Parliament with a volatile ledger, all wired to one simulated network. The
+ * roles read time from the simulated clock and pending proposals are nudged
+ * every flush_interval of virtual time the way Parliament nudges them every
+ * second, so the cluster recovers from lost messages without real waiting.
+ */
+class SimulatedCluster
+{
+public:
+
+    using AcceptHandler = std::function<void(size_t replica, std::string entry)>;
+
+    SimulatedCluster(
+        size_t replicas,
+        NetworkConditions conditions=NetworkConditions(),
+        uint32_t seed=1,
+        AcceptHandler accept_handler=[](size_t, std::string){},
+        std::chrono::microseconds flush_interval=std::chrono::seconds(1));
+
+    size_t Size() const;
+
+    Replica GetReplica(size_t index) const;
+
+    Parliament& GetParliament(size_t index);
+
+    std::shared_ptr<Ledger> GetLedger(size_t index);
+
+    SimulatedClock& GetClock();
+
+    SimulatedNetwork& GetNetwork();
+
+private:
+
+    struct Member
+    {
+        Replica replica;
+        std::shared_ptr<ReplicaSet> legislators;
+        std::shared_ptr<Ledger> ledger;
+        std::shared_ptr<Signal> signal;
+        std::shared_ptr<SimulatedReceiver> receiver;
+        std::shared_ptr<SimulatedSender> sender;
+        std::shared_ptr<Parliament> parliament;
+    };
+
+    void flush();
+
+    std::shared_ptr<SimulatedClock> clock;
+
+    std::shared_ptr<SimulatedNetwork> network;
+
+    std::vector<std::unique_ptr<Member>> members;
+
+    std::chrono::microseconds flush_interval;
+};
+
+
+}
+
+
+#endif
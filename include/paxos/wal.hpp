@@ -0,0 +1,817 @@
+#ifndef __WAL_HPP_INCLUDED__
+#define __WAL_HPP_INCLUDED__
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+
+#include "paxos/mapped.hpp"
+#include "paxos/queue.hpp"
+#include "paxos/serialization.hpp"
+
+
+namespace paxos
+{
+
+
+enum class SyncPolicy
+{
+    //
+    // Every Sync() waits for the data to reach the device.
+    //
+    Always,
+
+    //
+    // Sync() returns once the data is written and a background thread makes
+    // it durable at most one interval later. A crash may lose decrees that
+    // were already acknowledged.
+    //
+    Interval,
+
+    //
+    // Leave flushing to the operating system.
+    //
+    Never
+};
+
+
+class WriteAheadLogException : public std::runtime_error
+{
+public:
+
+    WriteAheadLogException(const std::string& what)
+        : std::runtime_error(what)
+    {
+    }
+};
+
+
+/*
+ * Append-only log split into segment files named <filename>.<ordinal> where
+ * ordinal is the position of the first record in the segment. Each record is
+ * framed by a 32-bit little-endian length and a CRC-32 of the binary encoded
+ * element. Enqueue only buffers records; Sync writes everything buffered so
+ * far with one write call and, depending on the policy, one fdatasync. Threads
+ * that call Sync while another thread is syncing wait and are then committed
+ * together as the next group. Segments that are no longer appended to are
+ * sealed and memory mapped so that reads decode records in place. The head
+ * file records how far the log was dequeued. It is only rewritten when whole
+ * segments are dropped, the log drains or the log is closed, so after a crash
+ * a few dequeued records may reappear but none that were not dequeued are lost.
+ */
+
+template <typename T>
+class WriteAheadLog : public BaseQueue<T>
+{
+public:
+
+    WriteAheadLog(
+        std::string dirname,
+        std::string filename,
+        SyncPolicy policy=SyncPolicy::Always,
+        std::chrono::milliseconds interval=std::chrono::milliseconds(100),
+        uint64_t segment_size=DEFAULT_SEGMENT_SIZE
+    ) : dirname(dirname),
+        filename(filename),
+        policy(policy),
+        interval(interval),
+        segment_size(segment_size),
+        segments(),
+        dropped_segments(0),
+        records(),
+        dropped_records(0),
+        first(0),
+        pending(),
+        last(),
+        enqueued(0),
+        synced(0),
+        is_syncing(false),
+        sync_time(std::chrono::steady_clock::now()),
+        is_dirty(false),
+        is_stopping(false),
+        mutex(),
+        synced_condition(),
+        flush_condition(),
+        flusher()
+    {
+        recover();
+        if (policy == SyncPolicy::Interval)
+        {
+            flusher = std::thread([this]() { flush_loop(); });
+        }
+    }
+
+    ~WriteAheadLog()
+    {
+        if (flusher.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                is_stopping = true;
+            }
+            flush_condition.notify_all();
+            flusher.join();
+        }
+
+        try
+        {
+            Sync();
+            if (policy != SyncPolicy::Never)
+            {
+                sync_segment(segments.back());
+            }
+            if (dropped_records + first != load_head())
+            {
+                save_head();
+            }
+        }
+        catch (WriteAheadLogException& e)
+        {
+        }
+        for (Segment& segment : segments)
+        {
+            ::close(segment.fd);
+        }
+    }
+
+    void Enqueue(const T& e)
+    {
+        std::string payload = BinarySerialize(e);
+
+        std::unique_lock<std::mutex> lock(mutex);
+
+        uint64_t end = segments.back().size + pending.size();
+        if (end > 0 && end + FRAME_SIZE + payload.size() > segment_size)
+        {
+            //
+            // The segment being synced must stay open until the sync ends.
+            //
+            synced_condition.wait(lock, [this]() { return !is_syncing; });
+            write_pending();
+            if (policy != SyncPolicy::Never)
+            {
+                sync_segment(segments.back());
+            }
+            seal_segment(segments.back());
+            open_segment(dropped_records + records.size());
+            end = 0;
+        }
+
+        uint32_t length = payload.size();
+        boost::crc_32_type crc;
+        crc.process_bytes(payload.data(), payload.size());
+        append_integer(pending, length);
+        append_integer(pending, static_cast<uint32_t>(crc.checksum()));
+        pending.append(payload);
+
+        records.push_back(
+            Record { dropped_segments + segments.size() - 1,
+                     end + FRAME_SIZE,
+                     length });
+        last = e;
+        enqueued += 1;
+    }
+
+    void Dequeue()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if (first >= records.size())
+        {
+            return;
+        }
+        first += 1;
+
+        //
+        // Delete segments once every record in them has been dequeued. The
+        // segment being appended to is always kept. The head is saved before
+        // any segment is removed so recovery never starts past it.
+        //
+        synced_condition.wait(lock, [this]() { return !is_syncing; });
+        bool is_dropping = segments.size() > 1 &&
+            (first >= records.size() ||
+             records[first].segment > dropped_segments);
+        if (is_dropping || first >= records.size())
+        {
+            save_head();
+        }
+        while (segments.size() > 1 &&
+               (first >= records.size() ||
+                records[first].segment > dropped_segments))
+        {
+            Segment& segment = segments.front();
+            ::close(segment.fd);
+            boost::filesystem::remove(segment.path);
+            while (!records.empty() &&
+                   records.front().segment == dropped_segments)
+            {
+                records.pop_front();
+                dropped_records += 1;
+                first -= 1;
+            }
+            segments.pop_front();
+            dropped_segments += 1;
+        }
+    }
+
+    T Last()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return last;
+    }
+
+    T At(size_t position)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (first + position >= records.size())
+        {
+            return T();
+        }
+        return read_record(first + position);
+    }
+
+    size_t Size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return records.size() - first;
+    }
+
+    void Sync()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        uint64_t target = enqueued;
+        while (synced < target)
+        {
+            if (is_syncing)
+            {
+                synced_condition.wait(lock);
+                continue;
+            }
+
+            //
+            // Become the leader of the next group. Everything buffered so far
+            // is written at once and made durable with a single fdatasync
+            // outside of the lock so that other threads keep enqueueing.
+            //
+            uint64_t group = enqueued;
+            write_pending();
+            is_syncing = true;
+
+            auto now = std::chrono::steady_clock::now();
+            if (policy == SyncPolicy::Always ||
+                (policy == SyncPolicy::Interval && now >= sync_time + interval))
+            {
+                int fd = segments.back().fd;
+                lock.unlock();
+                int result = sync_file(fd);
+                lock.lock();
+                sync_time = now;
+                if (result != 0)
+                {
+                    is_syncing = false;
+                    synced_condition.notify_all();
+                    throw WriteAheadLogException("fdatasync failed");
+                }
+                is_dirty = false;
+            }
+            else if (policy == SyncPolicy::Interval)
+            {
+                is_dirty = true;
+                flush_condition.notify_all();
+            }
+
+            synced = group;
+            is_syncing = false;
+            synced_condition.notify_all();
+        }
+    }
+
+    //
+    // Re-read the segments after they were replaced on disk, e.g. by a
+    // bootstrap. Records enqueued but not yet synced are dropped.
+    //
+    void Reload()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        synced_condition.wait(lock, [this]() { return !is_syncing; });
+        for (Segment& segment : segments)
+        {
+            ::close(segment.fd);
+        }
+        segments.clear();
+        dropped_segments = 0;
+        records.clear();
+        dropped_records = 0;
+        first = 0;
+        pending.clear();
+        last = T();
+        is_dirty = false;
+
+        //
+        // Waiting syncs compare against these counters so they never move
+        // backwards.
+        //
+        uint64_t count = enqueued;
+        recover();
+        enqueued = synced = std::max(count, enqueued);
+        synced_condition.notify_all();
+    }
+
+    //
+    // Whether written records still wait for the background flush of the
+    // interval policy.
+    //
+    bool IsFlushPending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return is_dirty;
+    }
+
+private:
+
+    struct Segment
+    {
+        std::string path;
+
+        int fd;
+
+        uint64_t size;
+
+        std::shared_ptr<MappedFile> mapping;
+    };
+
+    struct Record
+    {
+        uint64_t segment;
+
+        uint64_t offset;
+
+        uint32_t length;
+    };
+
+    T getElementAt(int64_t index)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return read_record(index);
+    }
+
+    int64_t getElementSizeAt(int64_t)
+    {
+        return 1;
+    }
+
+    int64_t getFirstElementIndex()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return first;
+    }
+
+    int64_t getLastElementIndex()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return records.size();
+    }
+
+    static void append_integer(std::string& buffer, uint32_t value)
+    {
+        for (size_t i=0; i<4; i++)
+        {
+            buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    static uint32_t read_integer(const char* data)
+    {
+        uint32_t value = 0;
+        for (size_t i=0; i<4; i++)
+        {
+            value |= static_cast<uint32_t>(
+                static_cast<uint8_t>(data[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    std::string segment_path(uint64_t ordinal)
+    {
+        std::stringstream name;
+        name << filename << "." << std::setw(20) << std::setfill('0')
+             << ordinal;
+        return (boost::filesystem::path(dirname) /
+                boost::filesystem::path(name.str())).string();
+    }
+
+    std::string head_path()
+    {
+        return (boost::filesystem::path(dirname) /
+                boost::filesystem::path(filename + ".head")).string();
+    }
+
+    void open_segment(uint64_t ordinal)
+    {
+        Segment segment { segment_path(ordinal), -1, 0, nullptr };
+        bool is_new = !boost::filesystem::exists(segment.path);
+        segment.fd = ::open(segment.path.c_str(),
+                            O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (segment.fd < 0)
+        {
+            throw WriteAheadLogException("unable to open " + segment.path);
+        }
+        segments.push_back(segment);
+
+        //
+        // Records synced to a new segment are lost with it unless its
+        // directory entry is durable too.
+        //
+        if (is_new && policy != SyncPolicy::Never)
+        {
+            sync_directory();
+        }
+    }
+
+    static int sync_file(int fd)
+    {
+#ifdef __APPLE__
+        return ::fsync(fd);
+#else
+        return ::fdatasync(fd);
+#endif
+    }
+
+    void sync_directory()
+    {
+        int fd = ::open(dirname.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw WriteAheadLogException("unable to open " + dirname);
+        }
+        int result = ::fsync(fd);
+        ::close(fd);
+        if (result != 0)
+        {
+            throw WriteAheadLogException("fsync failed on " + dirname);
+        }
+    }
+
+    void sync_segment(Segment& segment)
+    {
+        if (sync_file(segment.fd) != 0)
+        {
+            throw WriteAheadLogException("fdatasync failed");
+        }
+        sync_time = std::chrono::steady_clock::now();
+        is_dirty = false;
+    }
+
+    void flush_loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            flush_condition.wait(lock, [this]()
+            {
+                return is_stopping || is_dirty;
+            });
+
+            //
+            // Records written since the last fdatasync are made durable no
+            // later than one interval after it, unless a Sync gets there
+            // first. The destructor syncs whatever is left.
+            //
+            flush_condition.wait_until(lock, sync_time + interval, [this]()
+            {
+                return is_stopping || !is_dirty;
+            });
+            synced_condition.wait(lock, [this]() { return !is_syncing; });
+            if (is_stopping)
+            {
+                return;
+            }
+            if (!is_dirty ||
+                std::chrono::steady_clock::now() < sync_time + interval)
+            {
+                continue;
+            }
+
+            is_syncing = true;
+            is_dirty = false;
+            auto now = std::chrono::steady_clock::now();
+            int fd = segments.back().fd;
+            lock.unlock();
+            int result = sync_file(fd);
+            lock.lock();
+            sync_time = now;
+            if (result != 0)
+            {
+                is_dirty = true;
+            }
+            is_syncing = false;
+            synced_condition.notify_all();
+        }
+    }
+
+    void seal_segment(Segment& segment)
+    {
+        segment.mapping = std::make_shared<MappedFile>(segment.path);
+    }
+
+    void write_pending()
+    {
+        Segment& segment = segments.back();
+        size_t written = 0;
+        while (written < pending.size())
+        {
+            ssize_t result = ::write(segment.fd,
+                                     pending.data() + written,
+                                     pending.size() - written);
+            if (result < 0)
+            {
+                throw WriteAheadLogException("write failed");
+            }
+            written += result;
+        }
+        segment.size += pending.size();
+        pending.clear();
+    }
+
+    T read_record(size_t index)
+    {
+        const Record& record = records[index];
+        const Segment& segment = segments[record.segment - dropped_segments];
+
+        if (&segment == &segments.back() && record.offset >= segment.size)
+        {
+            //
+            // Record is still buffered and has not been written yet.
+            //
+            return BinaryDeserialize<T>(
+                pending.data() + (record.offset - segment.size),
+                record.length);
+        }
+
+        if (segment.mapping && segment.mapping->IsMapped() &&
+            record.offset + record.length <= segment.mapping->Size())
+        {
+            return BinaryDeserialize<T>(
+                segment.mapping->Data() + record.offset,
+                record.length);
+        }
+
+        std::string buffer(record.length, '\0');
+        ssize_t result = ::pread(segment.fd, &buffer[0], record.length,
+                                 record.offset);
+        if (result != static_cast<ssize_t>(record.length))
+        {
+            throw WriteAheadLogException("read failed");
+        }
+        return BinaryDeserialize<T>(buffer);
+    }
+
+    void save_head()
+    {
+        //
+        // Replace the head atomically so a crash leaves either the old or the
+        // new position, never an empty or torn file.
+        //
+        std::string path = head_path();
+        std::string temporary = path + ".tmp";
+        std::string content = std::to_string(dropped_records + first);
+
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            throw WriteAheadLogException("unable to open " + temporary);
+        }
+        if (::write(fd, content.data(), content.size()) !=
+                static_cast<ssize_t>(content.size()) ||
+            sync_file(fd) != 0)
+        {
+            ::close(fd);
+            throw WriteAheadLogException("unable to write " + temporary);
+        }
+        ::close(fd);
+
+        if (::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            throw WriteAheadLogException("unable to rename " + temporary);
+        }
+        sync_directory();
+    }
+
+    uint64_t load_head()
+    {
+        std::ifstream head(head_path());
+        uint64_t ordinal = 0;
+        head >> ordinal;
+        return ordinal;
+    }
+
+    void recover()
+    {
+        boost::filesystem::create_directories(dirname);
+
+        std::vector<std::pair<uint64_t, std::string>> paths;
+        std::string prefix = filename + ".";
+        for (auto& entry : boost::filesystem::directory_iterator(dirname))
+        {
+            std::string name = entry.path().filename().string();
+            std::string suffix = name.substr(std::min(prefix.size(),
+                                                      name.size()));
+            if (boost::starts_with(name, prefix) && suffix.size() == 20 &&
+                std::all_of(suffix.begin(), suffix.end(), ::isdigit))
+            {
+                paths.push_back(
+                    std::make_pair(std::stoull(suffix), entry.path().string()));
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+
+        //
+        // Segments that end before the head were dequeued but not removed, or
+        // are left over from the log a bootstrap replaced.
+        //
+        uint64_t head = load_head();
+        size_t start = 0;
+        while (start + 1 < paths.size() && paths[start + 1].first <= head)
+        {
+            boost::filesystem::remove(paths[start].second);
+            start++;
+        }
+
+        for (size_t i=start; i<paths.size(); i++)
+        {
+            if (i == start)
+            {
+                dropped_records = paths[i].first;
+            }
+            else if (paths[i].first != dropped_records + records.size())
+            {
+                //
+                // A torn record ended the previous segment early. Anything
+                // after it is unreachable.
+                //
+                boost::filesystem::remove(paths[i].second);
+                continue;
+            }
+            open_segment(paths[i].first);
+            recover_segment(segments.back());
+        }
+
+        if (segments.empty())
+        {
+            open_segment(0);
+        }
+        for (size_t i=0; i+1<segments.size(); i++)
+        {
+            seal_segment(segments[i]);
+        }
+
+        first = head > dropped_records ?
+            std::min<uint64_t>(head - dropped_records, records.size()) : 0;
+        if (!records.empty())
+        {
+            last = read_record(records.size() - 1);
+        }
+        enqueued = synced = records.size();
+    }
+
+    void recover_segment(Segment& segment)
+    {
+        struct stat status;
+        if (::fstat(segment.fd, &status) != 0)
+        {
+            throw WriteAheadLogException("unable to stat " + segment.path);
+        }
+
+        std::string content(status.st_size, '\0');
+        if (::pread(segment.fd, &content[0], content.size(), 0) !=
+            static_cast<ssize_t>(content.size()))
+        {
+            throw WriteAheadLogException("unable to read " + segment.path);
+        }
+
+        uint64_t position = 0;
+        while (position + FRAME_SIZE <= content.size())
+        {
+            uint32_t length = read_integer(content.data() + position);
+            uint32_t checksum = read_integer(content.data() + position + 4);
+            if (position + FRAME_SIZE + length > content.size())
+            {
+                break;
+            }
+
+            boost::crc_32_type crc;
+            crc.process_bytes(content.data() + position + FRAME_SIZE, length);
+            if (crc.checksum() != checksum)
+            {
+                break;
+            }
+
+            records.push_back(
+                Record { dropped_segments + segments.size() - 1,
+                         position + FRAME_SIZE,
+                         length });
+            position += FRAME_SIZE + length;
+        }
+
+        if (position != content.size())
+        {
+            //
+            // Drop the torn tail left by a crash in the middle of a write.
+            //
+            if (::ftruncate(segment.fd, position) != 0)
+            {
+                throw WriteAheadLogException(
+                    "unable to truncate " + segment.path);
+            }
+        }
+        segment.size = position;
+    }
+
+    std::string dirname;
+
+    std::string filename;
+
+    SyncPolicy policy;
+
+    std::chrono::milliseconds interval;
+
+    uint64_t segment_size;
+
+    std::deque<Segment> segments;
+
+    uint64_t dropped_segments;
+
+    std::deque<Record> records;
+
+    uint64_t dropped_records;
+
+    size_t first;
+
+    std::string pending;
+
+    T last;
+
+    uint64_t enqueued;
+
+    uint64_t synced;
+
+    bool is_syncing;
+
+    std::chrono::steady_clock::time_point sync_time;
+
+    //
+    // Set while records written under the interval policy are not yet known
+    // to be durable.
+    //
+    bool is_dirty;
+
+    bool is_stopping;
+
+    std::mutex mutex;
+
+    std::condition_variable synced_condition;
+
+    std::condition_variable flush_condition;
+
+    std::thread flusher;
+
+    constexpr static const uint64_t FRAME_SIZE = 8;
+
+    constexpr static const uint64_t DEFAULT_SEGMENT_SIZE = 0x4000000;
+};
+
+
+}
+
+
+#endif
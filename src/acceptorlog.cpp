@@ -0,0 +1,441 @@
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+
+#include "paxos/acceptorlog.hpp"
+#include "paxos/serialization.hpp"
+
+
+namespace paxos
+{
+
+
+static const size_t FRAME_SIZE = 8;
+
+
+static void
+append_integer(std::string& buffer, uint32_t value)
+{
+    for (size_t i=0; i<4; i++)
+    {
+        buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+
+static uint32_t
+read_integer(const char* data)
+{
+    uint32_t value = 0;
+    for (size_t i=0; i<4; i++)
+    {
+        value |= static_cast<uint32_t>(
+            static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+
+static std::string
+read_file(const std::string& path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+
+AcceptorLog::AcceptorLog(
+    std::string dirname,
+    std::string filename,
+    size_t compact_records)
+    : dirname(dirname),
+      path((boost::filesystem::path(dirname) /
+            boost::filesystem::path(filename)).string()),
+      compact_records(compact_records),
+      fd(-1),
+      records(0),
+      state(),
+      mutex()
+{
+    boost::filesystem::create_directories(dirname);
+
+    //
+    // A leftover compaction never replaced the log, which is still complete.
+    //
+    boost::filesystem::remove(path + ".tmp");
+
+    std::string content = read_file(path);
+    size_t valid = replay(content, state, records);
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+    {
+        throw AcceptorLogException("unable to open " + path);
+    }
+    if (valid != content.size())
+    {
+        //
+        // Cut off the record torn by a crash so new records follow the last
+        // complete one, and sync the cut before anything is appended after it.
+        //
+        if (::ftruncate(fd, valid) != 0 || ::fsync(fd) != 0)
+        {
+            ::close(fd);
+            throw AcceptorLogException("unable to truncate " + path);
+        }
+    }
+    if (records >= compact_records)
+    {
+        compact();
+    }
+}
+
+
+AcceptorLog::~AcceptorLog()
+{
+    ::close(fd);
+}
+
+
+Decree
+AcceptorLog::Get(AcceptorField field)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return field == AcceptorField::Promised ? state.promised : state.accepted;
+}
+
+
+void
+AcceptorLog::Put(AcceptorField field, const Decree& decree)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    append(AcceptorRecord { field, decree });
+}
+
+
+void
+AcceptorLog::Vote(const Decree& decree)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto vote = state.votes.find(decree.root_number);
+    if (vote != state.votes.end() &&
+        IsDecreeIdentical(vote->second, decree) &&
+        vote->second.content == decree.content)
+    {
+        return;
+    }
+    append(AcceptorRecord { AcceptorField::Accepted, decree });
+}
+
+
+std::vector<Decree>
+AcceptorLog::Votes(int root_number)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<Decree> votes;
+    for (auto it = state.votes.lower_bound(root_number);
+         it != state.votes.end(); ++it)
+    {
+        votes.push_back(it->second);
+    }
+    return votes;
+}
+
+
+void
+AcceptorLog::Retire(int root_number)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    state.votes.erase(state.votes.begin(),
+                      state.votes.upper_bound(root_number));
+}
+
+
+void
+AcceptorLog::Compact()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    compact();
+}
+
+
+size_t
+AcceptorLog::Records()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return records;
+}
+
+
+AcceptorState
+AcceptorLog::Load(std::string dirname, std::string filename)
+{
+    AcceptorState state;
+    size_t records = 0;
+    replay(
+        read_file((boost::filesystem::path(dirname) /
+                   boost::filesystem::path(filename)).string()),
+        state,
+        records);
+    return state;
+}
+
+
+size_t
+AcceptorLog::replay(
+    const std::string& content,
+    AcceptorState& state,
+    size_t& records)
+{
+    size_t position = 0;
+    while (position + FRAME_SIZE <= content.size())
+    {
+        uint32_t length = read_integer(content.data() + position);
+        uint32_t checksum = read_integer(content.data() + position + 4);
+        if (position + FRAME_SIZE + length > content.size())
+        {
+            break;
+        }
+
+        const char* payload = content.data() + position + FRAME_SIZE;
+        boost::crc_32_type crc;
+        crc.process_bytes(payload, length);
+        if (crc.checksum() != checksum)
+        {
+            break;
+        }
+
+        apply(BinaryDeserialize<AcceptorRecord>(payload, length), state);
+        records += 1;
+        position += FRAME_SIZE + length;
+    }
+
+    return position;
+}
+
+
+void
+AcceptorLog::apply(const AcceptorRecord& record, AcceptorState& state)
+{
+    if (record.field == AcceptorField::Promised)
+    {
+        state.promised = record.decree;
+        return;
+    }
+
+    const Decree& decree = record.decree;
+    if (decree.root_number >= state.accepted.root_number)
+    {
+        state.accepted = decree;
+    }
+    if (decree.content.empty())
+    {
+        state.votes.erase(state.votes.begin(),
+                          state.votes.upper_bound(decree.root_number));
+    }
+    else
+    {
+        state.votes[decree.root_number] = decree;
+    }
+}
+
+
+std::string
+AcceptorLog::frame(const AcceptorRecord& record)
+{
+    std::string payload = BinarySerialize(record);
+    boost::crc_32_type crc;
+    crc.process_bytes(payload.data(), payload.size());
+
+    std::string buffer;
+    buffer.reserve(FRAME_SIZE + payload.size());
+    append_integer(buffer, payload.size());
+    append_integer(buffer, static_cast<uint32_t>(crc.checksum()));
+    buffer.append(payload);
+    return buffer;
+}
+
+
+void
+AcceptorLog::append(const AcceptorRecord& record)
+{
+    write_all(fd, frame(record));
+    sync_file(fd);
+    apply(record, state);
+    records += 1;
+
+    if (records >= compact_records)
+    {
+        compact();
+    }
+}
+
+
+void
+AcceptorLog::write_all(int fd, const std::string& buffer)
+{
+    size_t written = 0;
+    while (written < buffer.size())
+    {
+        ssize_t result = ::write(fd,
+                                 buffer.data() + written,
+                                 buffer.size() - written);
+        if (result < 0)
+        {
+            throw AcceptorLogException("write failed on " + path);
+        }
+        written += result;
+    }
+}
+
+
+void
+AcceptorLog::sync_file(int fd)
+{
+#ifdef __APPLE__
+    int result = ::fsync(fd);
+#else
+    int result = ::fdatasync(fd);
+#endif
+    if (result != 0)
+    {
+        throw AcceptorLogException("fdatasync failed on " + path);
+    }
+}
+
+
+void
+AcceptorLog::sync_directory()
+{
+    int directory = ::open(dirname.c_str(), O_RDONLY);
+    if (directory < 0)
+    {
+        throw AcceptorLogException("unable to open " + dirname);
+    }
+    int result = ::fsync(directory);
+    ::close(directory);
+    if (result != 0)
+    {
+        throw AcceptorLogException("fsync failed on " + dirname);
+    }
+}
+
+
+void
+AcceptorLog::compact()
+{
+    std::string temporary = path + ".tmp";
+    int compacted = ::open(temporary.c_str(),
+                           O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (compacted < 0)
+    {
+        throw AcceptorLogException("unable to open " + temporary);
+    }
+
+    //
+    // The accepted decree goes first so that replaying the votes below it
+    // leaves it in place.
+    //
+    std::string buffer =
+        frame(AcceptorRecord { AcceptorField::Promised, state.promised }) +
+        frame(AcceptorRecord { AcceptorField::Accepted, state.accepted });
+    size_t compacted_records = 2;
+    for (const auto& vote : state.votes)
+    {
+        if (vote.first != state.accepted.root_number)
+        {
+            buffer += frame(AcceptorRecord { AcceptorField::Accepted,
+                                             vote.second });
+            compacted_records += 1;
+        }
+    }
+
+    try
+    {
+        write_all(compacted, buffer);
+        sync_file(compacted);
+    }
+    catch (AcceptorLogException& e)
+    {
+        ::close(compacted);
+        throw;
+    }
+
+    if (::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        ::close(compacted);
+        throw AcceptorLogException("unable to rename " + temporary);
+    }
+    sync_directory();
+
+    ::close(fd);
+    fd = compacted;
+    records = compacted_records;
+}
+
+
+AcceptorLogStorage::AcceptorLogStorage(
+    std::shared_ptr<AcceptorLog> log,
+    AcceptorField field)
+    : log(log),
+      field(field)
+{
+}
+
+
+Decree
+AcceptorLogStorage::Get()
+{
+    return log->Get(field);
+}
+
+
+void
+AcceptorLogStorage::Put(Decree decree)
+{
+    log->Put(field, decree);
+}
+
+
+AcceptorLogVotes::AcceptorLogVotes(std::shared_ptr<AcceptorLog> log)
+    : log(log)
+{
+}
+
+
+void
+AcceptorLogVotes::Put(Decree decree)
+{
+    log->Vote(decree);
+}
+
+
+std::vector<Decree>
+AcceptorLogVotes::From(int root_number)
+{
+    return log->Votes(root_number);
+}
+
+
+void
+AcceptorLogVotes::Retire(int root_number)
+{
+    log->Retire(root_number);
+}
+
+
+}
@@ -1,15 +1,255 @@
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "paxos/bootstrap.hpp"
+#include "paxos/logging.hpp"
 
 
 namespace paxos
 {
 
 
+//
+// A file listed in the manifest. Replicated files are read from fd as their
+// chunks are sent; decree files are generated and held in content.
+//
+struct transfer
+{
+    std::string remote;
+
+    std::string content;
+
+    int fd;
+
+    uint64_t size;
+};
+
+
+static std::string
+remote_path(std::string remote_directory, std::string filename)
+{
+    boost::filesystem::path remotepath(remote_directory);
+    remotepath /= filename;
+    return remotepath.native();
+}
+
+
+static std::string
+read_chunk(const transfer& file, uint64_t offset, size_t chunk_size)
+{
+    size_t size = std::min<uint64_t>(chunk_size, file.size - offset);
+    if (file.fd < 0)
+    {
+        return file.content.substr(offset, size);
+    }
+
+    std::string content(size, '\0');
+    size_t read = 0;
+    while (read < size)
+    {
+        ssize_t result = ::pread(file.fd, &content[read], size - read,
+                                 offset + read);
+        if (result <= 0)
+        {
+            //
+            // A short chunk fails verification on the replica.
+            //
+            break;
+        }
+        read += result;
+    }
+    content.resize(read);
+    return content;
+}
+
+
+static uint32_t
+checksum_file(int fd, uint64_t size)
+{
+    boost::crc_32_type crc;
+    std::vector<char> buffer(BootstrapChunkSize);
+    uint64_t offset = 0;
+    while (offset < size)
+    {
+        ssize_t result = ::pread(
+            fd,
+            buffer.data(),
+            std::min<uint64_t>(buffer.size(), size - offset),
+            offset);
+        if (result <= 0)
+        {
+            break;
+        }
+        crc.process_bytes(buffer.data(), result);
+        offset += result;
+    }
+    return crc.checksum();
+}
+
+
+uint32_t
+BootstrapFileChecksum(std::string path, uint64_t size)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return BootstrapChecksum("");
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    uint32_t checksum = checksum_file(fd, size);
+    ::close(fd);
+    return checksum;
+}
+
+
+static bool
+sync_path(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    int result = ::fsync(fd);
+    ::close(fd);
+    return result == 0;
+}
+
+
+static std::string
+directory_of(const std::string& path)
+{
+    std::string directory = boost::filesystem::path(path).parent_path().string();
+    return directory.empty() ? "." : directory;
+}
+
+
+static bool
+rename_path(const std::string& from, const std::string& to)
+{
+    return ::rename(from.c_str(), to.c_str()) == 0;
+}
+
+
+bool
+CommitBootstrap(const std::vector<std::string>& staged,
+                std::string replicaset,
+                std::string content)
+{
+    std::string directory = directory_of(replicaset);
+    std::string staged_replicaset = replicaset + BootstrapPartialSuffix;
+    std::string temporary = staged_replicaset + ".tmp";
+
+    for (const auto& name : staged)
+    {
+        if (!sync_path(name + BootstrapPartialSuffix))
+        {
+            return false;
+        }
+    }
+
+    //
+    // The staged replica set only appears once it is complete. From then on
+    // the commit is rolled forward rather than discarded.
+    //
+    {
+        std::ofstream file(temporary, std::ios::out | std::ios::trunc);
+        file << content;
+        if (!file.flush())
+        {
+            return false;
+        }
+    }
+    if (!sync_path(temporary) ||
+        !rename_path(temporary, staged_replicaset) ||
+        !sync_path(directory))
+    {
+        return false;
+    }
+
+    for (const auto& name : staged)
+    {
+        if (!rename_path(name + BootstrapPartialSuffix, name))
+        {
+            return false;
+        }
+    }
+    return sync_path(directory) &&
+           rename_path(staged_replicaset, replicaset) &&
+           sync_path(directory);
+}
+
+
+void
+RecoverBootstrap(std::string directory)
+{
+    if (!boost::filesystem::is_directory(directory))
+    {
+        return;
+    }
+
+    auto replicaset = boost::filesystem::path(directory) /
+                      boost::filesystem::path(ReplicasetFilename);
+    std::string staged_replicaset =
+        replicaset.string() + BootstrapPartialSuffix;
+    boost::filesystem::remove(staged_replicaset + ".tmp");
+    bool is_committing = boost::filesystem::exists(staged_replicaset);
+
+    std::vector<std::string> partials;
+    for (auto& entry : boost::filesystem::directory_iterator(directory))
+    {
+        std::string name = entry.path().string();
+        if (boost::algorithm::ends_with(name, BootstrapPartialSuffix) &&
+            name != staged_replicaset)
+        {
+            partials.push_back(name);
+        }
+    }
+
+    for (const auto& partial : partials)
+    {
+        if (is_committing)
+        {
+            boost::filesystem::rename(
+                partial,
+                partial.substr(
+                    0, partial.size() - BootstrapPartialSuffix.size()));
+        }
+        else
+        {
+            boost::filesystem::remove(partial);
+        }
+    }
+
+    if (is_committing)
+    {
+        if (!sync_path(directory) ||
+            !rename_path(staged_replicaset, replicaset.string()) ||
+            !sync_path(directory))
+        {
+            throw boost::filesystem::filesystem_error(
+                "unable to commit bootstrap",
+                boost::filesystem::path(directory),
+                boost::system::errc::make_error_code(
+                    boost::system::errc::io_error));
+        }
+    }
+}
+
+
 void SendBootstrap(
     std::string local_directory,
     std::string remote_directory,
     std::vector<boost::filesystem::directory_entry> filepaths,
-    std::function<void(BootstrapFile)> send_file)
+    std::function<void(BootstrapFile)> send_file,
+    size_t chunk_size,
+    size_t streams,
+    std::function<bool(BootstrapFile)> probe_file)
 {
     {
         //
@@ -22,16 +262,14 @@ void SendBootstrap(
         // new replica from issuing PREPARE or ACCEPTED messages before the new
         // replica has been fully integrated into the replicset.
         //
-        BootstrapFile file;
-        boost::filesystem::path remotepath(remote_directory);
-        remotepath /= ReplicasetFilename;
-        file.name = remotepath.native();
-        file.content = "";
-        send_file(file);
+        send_file(BootstrapFile(
+            remote_path(remote_directory, ReplicasetFilename), ""));
     }
 
+    std::vector<transfer> transfers;
     for (auto& entry : filepaths)
     {
+        std::string filename = entry.path().filename().native();
         if (boost::algorithm::ends_with(entry.path().native(), ReplicasetFilename))
         {
             //
@@ -40,72 +278,168 @@ void SendBootstrap(
             //
             continue;
         }
+        if (boost::algorithm::starts_with(filename, ACCEPTOR_LOG_FILENAME))
+        {
+            //
+            // Acceptor state is sent below as individual decree files.
+            //
+            continue;
+        }
+        if (boost::algorithm::ends_with(filename, BootstrapPartialSuffix) ||
+            filename == LogFilename)
+        {
+            //
+            // The diagnostic log belongs to this replica only.
+            //
+            continue;
+        }
 
-        // 1. serialize file
-        std::ifstream filestream(entry.path().native());
-        std::stringstream buffer;
-        buffer << filestream.rdbuf();
-
-        // 2. send bootstrap file
-        BootstrapFile file;
-        boost::filesystem::path remotepath(remote_directory);
-        remotepath /= entry.path().filename();
-        file.name = remotepath.native();
-        file.content = buffer.str();
-        send_file(file);
+        int fd = ::open(entry.path().native().c_str(), O_RDONLY);
+        struct stat status;
+        if (fd < 0)
+        {
+            continue;
+        }
+        if (::fstat(fd, &status) != 0 || !S_ISREG(status.st_mode))
+        {
+            ::close(fd);
+            continue;
+        }
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        transfers.push_back(transfer {
+            remote_path(remote_directory, filename),
+            "",
+            fd,
+            static_cast<uint64_t>(status.st_size) });
     }
 
+    AcceptorState acceptor = AcceptorLog::Load(local_directory);
+    {
+        std::string content = Serialize(acceptor.promised);
+        transfers.push_back(transfer {
+            remote_path(remote_directory, PROMISED_DECREE_FILENAME),
+            content,
+            -1,
+            content.size() });
+    }
     {
-        BootstrapFile file;
-        boost::filesystem::path remotepath(remote_directory);
-
         //
         // Let the new replica decide what is the highest proposed decree. This
         // prevents trying to flush a decree from another replica.
         //
-        remotepath /= HIGHEST_PROPOSED_DECREE_FILENAME;
         auto proposed = PersistentDecree(local_directory,
                                          HIGHEST_PROPOSED_DECREE_FILENAME).Get();
         proposed.content = "";
-        file.name = remotepath.native();
-        file.content = Serialize(proposed);
-        send_file(file);
+        std::string content = Serialize(proposed);
+        transfers.push_back(transfer {
+            remote_path(remote_directory, HIGHEST_PROPOSED_DECREE_FILENAME),
+            content,
+            -1,
+            content.size() });
     }
     {
-        BootstrapFile file;
-        boost::filesystem::path remotepath(remote_directory);
-
         //
         // We must empty the content of accepted decree because actions must be
         // completed before writes to ledger. If we do not, then the accepted
         // decree on the new replica will incorrectly consider current decree as
         // stale accept from a prevous round.
         //
-        remotepath /= ACCEPTED_DECREE_FILENAME;
-        auto accepted = PersistentDecree(local_directory,
-                                         ACCEPTED_DECREE_FILENAME).Get();
+        auto accepted = acceptor.accepted;
         accepted.content = "";
-        file.name = remotepath.native();
-        file.content = Serialize(accepted);
-        send_file(file);
+        std::string content = Serialize(accepted);
+        transfers.push_back(transfer {
+            remote_path(remote_directory, ACCEPTED_DECREE_FILENAME),
+            content,
+            -1,
+            content.size() });
     }
+
+    //
+    // Only the bytes present now are listed and sent, so a file that grows
+    // during the bootstrap still verifies.
+    //
+    BootstrapManifest manifest;
+    std::vector<std::pair<size_t, uint64_t>> chunks;
+    for (size_t i=0; i<transfers.size(); i++)
     {
-        BootstrapFile file;
-        boost::filesystem::path remotepath(remote_directory);
+        const transfer& file = transfers[i];
+        uint32_t checksum = file.fd < 0
+            ? BootstrapChecksum(file.content)
+            : checksum_file(file.fd, file.size);
+        manifest.files.emplace_back(file.remote, file.size, checksum);
 
+        //
+        // An empty file is still sent as one empty chunk so that the replica
+        // creates it.
+        //
+        uint64_t offset = 0;
+        do
+        {
+            chunks.emplace_back(i, offset);
+            offset += chunk_size;
+        } while (offset < file.size);
+    }
+    send_file(BootstrapFile(
+        remote_path(remote_directory, BootstrapManifestFilename),
+        Serialize(manifest)));
+
+    //
+    // Streams take the next chunk from a shared cursor, so one large ledger is
+    // spread over all of them as well as many small files.
+    //
+    std::atomic<size_t> next(0);
+    auto stream = [&]()
+    {
+        for (size_t c = next++; c < chunks.size(); c = next++)
+        {
+            const transfer& file = transfers[chunks[c].first];
+            uint64_t offset = chunks[c].second;
+            std::string content = read_chunk(file, offset, chunk_size);
+            if (probe_file && file.fd >= 0 && !content.empty())
+            {
+                BootstrapFile probe(file.remote, "", offset);
+                probe.checksum = BootstrapChecksum(content);
+                probe.probe = content.size();
+                if (probe_file(probe))
+                {
+                    continue;
+                }
+            }
+            send_file(BootstrapFile(file.remote, std::move(content), offset));
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i=1; i<streams; i++)
+    {
+        threads.emplace_back(stream);
+    }
+    stream();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (auto& file : transfers)
+    {
+        if (file.fd >= 0)
+        {
+            ::close(file.fd);
+        }
+    }
+
+    {
         //
         // Now that the replicated files are all sent we can finally send the
         // "actual" replicaset file allowing the replica to promise and accept
-        // messages.
+        // messages. The replica verifies everything in the manifest before it
+        // accepts it.
         //
         std::ifstream filestream(local_directory + "/" + ReplicasetFilename);
         std::stringstream buffer;
         buffer << filestream.rdbuf();
 
-        remotepath /= ReplicasetFilename;
-        file.name = remotepath.native();
-        file.content = buffer.str();
-        send_file(file);
+        send_file(BootstrapFile(
+            remote_path(remote_directory, ReplicasetFilename), buffer.str()));
     }
 }
 
@@ -11,11 +11,26 @@ Callback::Callback(MessageHandler message_handler_)
 }
 
 
+Callback::Callback(MessageHandler message_handler_,
+                   std::shared_ptr<Context> context_)
+    : message_handler(message_handler_),
+      context(context_)
+{
+}
+
+
 void
-Callback::operator()(Message message)
+Callback::operator()(const Message& message) const
 {
     message_handler(message);
 }
 
 
+Context*
+Callback::GetContext() const
+{
+    return context.get();
+}
+
+
 }
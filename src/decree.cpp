@@ -6,21 +6,21 @@ namespace paxos
 
 
 int
-CompareDecrees(Decree lhs, Decree rhs)
+CompareDecrees(const Decree& lhs, const Decree& rhs)
 {
     return lhs.number - rhs.number;
 }
 
 
 int
-CompareRootDecrees(Decree lhs, Decree rhs)
+CompareRootDecrees(const Decree& lhs, const Decree& rhs)
 {
     return lhs.root_number - rhs.root_number;
 }
 
 
 bool
-IsDecreeHigher(Decree lhs, Decree rhs)
+IsDecreeHigher(const Decree& lhs, const Decree& rhs)
 {
     return (IsRootDecreeEqual(lhs, rhs) && CompareDecrees(lhs, rhs) > 0) ||
             IsRootDecreeHigher(lhs, rhs);
@@ -28,14 +28,14 @@ IsDecreeHigher(Decree lhs, Decree rhs)
 
 
 bool
-IsDecreeHigherOrEqual(Decree lhs, Decree rhs)
+IsDecreeHigherOrEqual(const Decree& lhs, const Decree& rhs)
 {
     return CompareDecrees(lhs, rhs) >= 0;
 }
 
 
 bool
-IsDecreeEqual(Decree lhs, Decree rhs)
+IsDecreeEqual(const Decree& lhs, const Decree& rhs)
 {
     return CompareDecrees(lhs, rhs) == 0 &&
            CompareRootDecrees(lhs, rhs) == 0;
@@ -43,7 +43,7 @@ IsDecreeEqual(Decree lhs, Decree rhs)
 
 
 bool
-IsDecreeIdentical(Decree lhs, Decree rhs)
+IsDecreeIdentical(const Decree& lhs, const Decree& rhs)
 {
     return CompareDecrees(lhs, rhs) == 0 &&
            CompareRootDecrees(lhs, rhs) == 0 &&
@@ -52,7 +52,7 @@ IsDecreeIdentical(Decree lhs, Decree rhs)
 
 
 bool
-IsDecreeLower(Decree lhs, Decree rhs)
+IsDecreeLower(const Decree& lhs, const Decree& rhs)
 {
     return CompareDecrees(lhs, rhs) == 0 ?
            CompareRootDecrees(lhs, rhs) < 0 : CompareDecrees(lhs, rhs) < 0;
@@ -60,49 +60,49 @@ IsDecreeLower(Decree lhs, Decree rhs)
 
 
 bool
-IsDecreeLowerOrEqual(Decree lhs, Decree rhs)
+IsDecreeLowerOrEqual(const Decree& lhs, const Decree& rhs)
 {
     return CompareDecrees(lhs, rhs) <= 0;
 }
 
 
 bool
-IsDecreeOrdered(Decree lhs, Decree rhs)
+IsDecreeOrdered(const Decree& lhs, const Decree& rhs)
 {
     return CompareDecrees(lhs, rhs) == -1;
 }
 
 
 bool
-IsRootDecreeOrdered(Decree lhs, Decree rhs)
+IsRootDecreeOrdered(const Decree& lhs, const Decree& rhs)
 {
     return CompareRootDecrees(lhs, rhs) == -1;
 }
 
 
 bool
-IsRootDecreeEqual(Decree lhs, Decree rhs)
+IsRootDecreeEqual(const Decree& lhs, const Decree& rhs)
 {
     return CompareRootDecrees(lhs, rhs) == 0;
 }
 
 
 bool
-IsRootDecreeHigher(Decree lhs, Decree rhs)
+IsRootDecreeHigher(const Decree& lhs, const Decree& rhs)
 {
     return CompareRootDecrees(lhs, rhs) > 0;
 }
 
 
 bool
-IsRootDecreeLower(Decree lhs, Decree rhs)
+IsRootDecreeLower(const Decree& lhs, const Decree& rhs)
 {
     return CompareRootDecrees(lhs, rhs) < 0;
 }
 
 
 bool
-IsRootDecreeHigherOrEqual(Decree lhs, Decree rhs)
+IsRootDecreeHigherOrEqual(const Decree& lhs, const Decree& rhs)
 {
     return CompareRootDecrees(lhs, rhs) >= 0;
 }
@@ -1,10 +1,17 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <cstdio>
+#include <fstream>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
 #include "paxos/bootstrap.hpp"
 #include "paxos/handler.hpp"
+#include "paxos/logging.hpp"
 #include "paxos/serialization.hpp"
 
 
@@ -12,8 +19,15 @@ namespace paxos
 {
 
 
+std::string
+DecreeHandler::ConflictKey(const std::string&)
+{
+    return "";
+}
+
+
 void
-EmptyDecreeHandler::operator()(std::string entry)
+EmptyDecreeHandler::operator()(std::string)
 {
 }
 
@@ -48,6 +62,197 @@ CompositeHandler::AddHandler(Handler handler)
 }
 
 
+KeyedHandler::KeyedHandler(
+    std::shared_ptr<DecreeHandler> handler,
+    KeyExtractor key)
+    : handler(handler),
+      key(key)
+{
+}
+
+
+void
+KeyedHandler::operator()(std::string entry)
+{
+    (*handler)(entry);
+}
+
+
+std::string
+KeyedHandler::ConflictKey(const std::string& entry)
+{
+    return key(entry);
+}
+
+
+CallbackSnapshotHandler::CallbackSnapshotHandler(
+    std::function<std::string()> take,
+    Handler restore)
+    : take(take),
+      restore(restore)
+{
+}
+
+
+std::string
+CallbackSnapshotHandler::Take()
+{
+    return take();
+}
+
+
+void
+CallbackSnapshotHandler::Restore(std::string snapshot)
+{
+    restore(snapshot);
+}
+
+
+//
+// Staging directories of bootstraps in progress, kept inside the replica's
+// directory so that its files can be hard linked into them.
+//
+static const std::string BootstrapStagingPrefix = "paxos.bootstrap.";
+
+
+//
+// Names of the write-ahead log segments in location that are sealed. Every
+// segment but the last one is never written again.
+//
+static std::vector<std::string>
+sealed_segments(std::string location)
+{
+    std::vector<std::string> segments;
+    std::string prefix = LEDGER_LOG_FILENAME + ".";
+    for (auto& entry : boost::filesystem::directory_iterator(location))
+    {
+        std::string name = entry.path().filename().string();
+        std::string suffix = name.substr(std::min(prefix.size(), name.size()));
+        if (boost::algorithm::starts_with(name, prefix) &&
+            suffix.size() == 20 &&
+            std::all_of(suffix.begin(), suffix.end(), ::isdigit))
+        {
+            segments.push_back(name);
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    if (!segments.empty())
+    {
+        segments.pop_back();
+    }
+    return segments;
+}
+
+
+//
+// Stage the files of a bootstrap as they are at this decree. Snapshots and
+// dequeues wait for the decree to be applied, so nothing but appends changes
+// the files meanwhile. Sealed segments are immutable and hard linked; every
+// other file may be changed in place later and is copied.
+//
+static std::string
+stage_bootstrap_files(std::string location)
+{
+    auto staging =
+        boost::filesystem::path(location) /
+        boost::filesystem::unique_path(
+            BootstrapStagingPrefix + "%%%%-%%%%-%%%%-%%%%");
+    boost::filesystem::create_directories(staging);
+
+    std::vector<std::string> sealed = sealed_segments(location);
+    for (auto& entry : boost::filesystem::directory_iterator(location))
+    {
+        if (!boost::filesystem::is_regular_file(entry.path()))
+        {
+            continue;
+        }
+
+        auto staged = staging / entry.path().filename();
+        boost::system::error_code ec;
+        bool is_sealed = std::binary_search(sealed.begin(), sealed.end(),
+                                            entry.path().filename().string());
+        if (is_sealed)
+        {
+            boost::filesystem::create_hard_link(entry.path(), staged, ec);
+        }
+        if (!is_sealed || ec)
+        {
+            boost::filesystem::copy_file(entry.path(), staged);
+        }
+    }
+    return staging.string();
+}
+
+
+bool
+SendReplicaBootstrap(std::string directory, UpdateReplicaSetDecree decree)
+{
+    std::vector<boost::filesystem::directory_entry> filepaths;
+    if(boost::filesystem::is_directory(directory))
+    {
+        std::copy(boost::filesystem::directory_iterator(directory),
+                  boost::filesystem::directory_iterator(),
+                  std::back_inserter(filepaths));
+    }
+
+    //
+    // Chunks of replicated files are probed first, so a replica that is
+    // re-added with its old data directory is only sent what changed. A
+    // chunk that fails is resent from its offset. Once one gives up the
+    // rest are skipped, and the replica would refuse the final replica
+    // set file anyway because the manifest no longer verifies.
+    //
+    NetworkFileSender<BoostTransport, BinaryCodec> sender;
+    std::atomic<bool> failed(false);
+    SendBootstrap(
+        directory,
+        decree.remote_directory,
+        filepaths,
+        [&](BootstrapFile file){
+            for (size_t attempt=0; !failed; attempt++)
+            {
+                bool sent = false;
+                try
+                {
+                    sent = sender.SendFile(decree.replica, file);
+                }
+                catch (boost::system::system_error& e)
+                {
+                }
+                if (sent)
+                {
+                    return;
+                }
+                if (attempt + 1 == BootstrapRetries)
+                {
+                    LOG(LogLevel::Warning)
+                        << "Bootstrap of " << decree.replica.hostname
+                        << ":" << decree.replica.port << " failed at "
+                        << file.name << " offset " << file.offset;
+                    failed = true;
+                }
+            }
+        },
+        BootstrapChunkSize,
+        BootstrapStreams,
+        [&](BootstrapFile probe){
+            //
+            // A probe that fails for any reason just means the chunk is
+            // sent in full.
+            //
+            try
+            {
+                return !failed && sender.SendFile(decree.replica, probe);
+            }
+            catch (boost::system::system_error& e)
+            {
+                return false;
+            }
+        });
+    return !failed;
+}
+
+
 HandleAddReplica::HandleAddReplica(
     std::string location,
     Replica legislator,
@@ -55,46 +260,121 @@ HandleAddReplica::HandleAddReplica(
     std::shared_ptr<Signal> signal,
     std::function<void(
         std::shared_ptr<ReplicaSet>,
-        std::ostream&)> save_replicaset)
+        std::ostream&)> save_replicaset,
+    std::function<bool(
+        std::string,
+        UpdateReplicaSetDecree)> send_bootstrap)
     : location(location),
       legislator(legislator),
       legislators(legislators),
       signal(signal),
-      save_replicaset(save_replicaset)
+      save_replicaset(save_replicaset),
+      send_bootstrap(send_bootstrap),
+      bootstraps(),
+      is_stopping(false),
+      mutex(),
+      bootstraps_ready(),
+      bootstrapper()
+{
+    //
+    // Remove staging directories left behind by bootstraps that were cut
+    // short.
+    //
+    if (boost::filesystem::is_directory(location))
+    {
+        std::vector<boost::filesystem::path> stale;
+        for (auto& entry : boost::filesystem::directory_iterator(location))
+        {
+            if (boost::algorithm::starts_with(
+                    entry.path().filename().native(), BootstrapStagingPrefix))
+            {
+                stale.push_back(entry.path());
+            }
+        }
+        for (const auto& path : stale)
+        {
+            boost::filesystem::remove_all(path);
+        }
+    }
+}
+
+
+HandleAddReplica::~HandleAddReplica()
 {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        is_stopping = true;
+    }
+    bootstraps_ready.notify_all();
+
+    //
+    // The bootstrapper finishes every queued bootstrap before it exits.
+    //
+    if (bootstrapper.joinable())
+    {
+        bootstrapper.join();
+    }
 }
 
 
 void
 HandleAddReplica::operator()(std::string entry)
 {
-    UpdateReplicaSetDecree decree = Deserialize<UpdateReplicaSetDecree>(entry);
+    UpdateReplicaSetDecree decree =
+        BinaryCodec::Deserialize<UpdateReplicaSetDecree>(entry);
     legislators->Add(decree.replica);
-    std::ofstream replicasetfile(
-        (boost::filesystem::path(location) /
-         boost::filesystem::path(ReplicasetFilename)).string());
-    save_replicaset(legislators, replicasetfile);
+    {
+        std::ofstream replicasetfile(
+            (boost::filesystem::path(location) /
+             boost::filesystem::path(ReplicasetFilename)).string());
+        save_replicaset(legislators, replicasetfile);
+    }
 
     // Only decree author sends bootstrap.
     if (decree.author.hostname == legislator.hostname &&
         decree.author.port == legislator.port)
     {
-        std::vector<boost::filesystem::directory_entry> filepaths;
-        if(boost::filesystem::is_directory(location))
+        std::string staging = stage_bootstrap_files(location);
         {
-            std::copy(boost::filesystem::directory_iterator(location),
-                      boost::filesystem::directory_iterator(),
-                      std::back_inserter(filepaths));
+            std::lock_guard<std::mutex> lock(mutex);
+
+            bootstraps.emplace_back(staging, decree);
+            if (!bootstrapper.joinable())
+            {
+                bootstrapper = std::thread([this]() { bootstrap_loop(); });
+            }
         }
-        SendBootstrap(
-            location,
-            decree.remote_directory,
-            filepaths,
-            [&](BootstrapFile file){
-                NetworkFileSender<BoostTransport> sender;
-                sender.SendFile(decree.replica, file);
+        bootstraps_ready.notify_one();
+    }
+}
+
+
+void
+HandleAddReplica::bootstrap_loop()
+{
+    for (;;)
+    {
+        std::pair<std::string, UpdateReplicaSetDecree> bootstrap;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            bootstraps_ready.wait(lock, [this]()
+            {
+                return is_stopping || !bootstraps.empty();
             });
-        signal->Set(true);
+            if (bootstraps.empty())
+            {
+                return;
+            }
+            bootstrap = bootstraps.front();
+            bootstraps.pop_front();
+        }
+
+        bool sent = send_bootstrap(bootstrap.first, bootstrap.second);
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(bootstrap.first, ec);
+        signal->Set(sent);
     }
 }
 
@@ -119,7 +399,8 @@ HandleRemoveReplica::HandleRemoveReplica(
 void
 HandleRemoveReplica::operator()(std::string entry)
 {
-    UpdateReplicaSetDecree decree = Deserialize<UpdateReplicaSetDecree>(entry);
+    UpdateReplicaSetDecree decree =
+        BinaryCodec::Deserialize<UpdateReplicaSetDecree>(entry);
     legislators->Remove(decree.replica);
     std::ofstream replicasetfile(
         (boost::filesystem::path(location) /
@@ -1,66 +1,706 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "paxos/ledger.hpp"
+#include "paxos/metrics.hpp"
 
 
 namespace paxos
 {
 
 
-Ledger::Ledger(std::shared_ptr<RolloverQueue<Decree>> decrees)
+Ledger::Ledger(std::shared_ptr<BaseQueue<Decree>> decrees)
     : Ledger(decrees, std::make_shared<EmptyDecreeHandler>())
 {
 }
 
 
-Ledger::Ledger(std::shared_ptr<RolloverQueue<Decree>> decrees,
+Ledger::Ledger(std::shared_ptr<BaseQueue<Decree>> decrees,
                std::shared_ptr<DecreeHandler> handler)
-    : decrees(decrees)
+    : Ledger(decrees, handler, std::make_shared<VolatileDecree>())
+{
+}
+
+
+Ledger::Ledger(std::shared_ptr<BaseQueue<Decree>> decrees,
+               std::shared_ptr<DecreeHandler> handler,
+               std::shared_ptr<Storage<Decree>> snapshot)
+    : Ledger(decrees, handler, snapshot, nullptr)
+{
+}
+
+
+Ledger::Ledger(std::shared_ptr<BaseQueue<Decree>> decrees,
+               std::shared_ptr<DecreeHandler> handler,
+               std::shared_ptr<Storage<Decree>> snapshot,
+               std::shared_ptr<Storage<Decree>> applied)
+    : decrees(decrees),
+      snapshot(snapshot),
+      snapshot_tail(),
+      snapshot_interval(0),
+      commit_index(0),
+      applied_index(0),
+      applied_decree(applied),
+      last_applied(),
+      recorded_index(0),
+      record_mutex(),
+      unsynced(),
+      applying(),
+      max_apply_lag(0),
+      is_stopping(false),
+      apply_lanes(1),
+      lanes(),
+      lane_workers(),
+      lane_generation(0),
+      lanes_pending(0),
+      lanes_stopping(false)
 {
     handlers[DecreeType::UserDecree] = handler;
+    load_indexes();
+}
+
+
+void
+Ledger::load_indexes()
+{
+    snapshot_tail = snapshot.Value();
+    snapshot_tail.content.clear();
+
+    //
+    // Without a record, decrees already in the ledger were applied before it
+    // was reopened. With one, those after it are left for Replay. A snapshot
+    // is only taken once everything it covers has been applied.
+    //
+    commit_index = Tail().root_number;
+    if (applied_decree)
+    {
+        std::lock_guard<std::mutex> lock(record_mutex);
+
+        last_applied = applied_decree->Get();
+        recorded_index = last_applied.root_number;
+        applied_index = std::max(recorded_index, snapshot_tail.root_number);
+    }
+    else
+    {
+        applied_index = commit_index.load();
+    }
 }
 
 
 Ledger::~Ledger()
 {
+    {
+        std::lock_guard<std::mutex> lock(apply_mutex);
+
+        is_stopping = true;
+    }
+    apply_ready.notify_all();
+
+    //
+    // The applier finishes every queued decree before it exits.
+    //
+    if (applier.joinable())
+    {
+        applier.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(lane_mutex);
+
+        lanes_stopping = true;
+    }
+    lanes_ready.notify_all();
+    for (auto& worker : lane_workers)
+    {
+        worker.join();
+    }
+
+    try
+    {
+        flush_applied();
+    }
+    catch (StorageException& e)
+    {
+    }
 }
 
 
 void
 Ledger::RegisterHandler(DecreeType key, std::shared_ptr<DecreeHandler> handler)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
     handlers[key] = handler;
 }
 
 
 void
-Ledger::Append(Decree decree)
+Ledger::SetConflictKey(DecreeType key, KeyExtractor extractor)
 {
-    //
-    // A lock must be acquired before executing decree_handler in order to
-    // help prevent out of order decrees.
-    //
     std::lock_guard<std::recursive_mutex> lock(mutex);
 
-    Decree tail = Tail();
-    if (IsRootDecreeOrdered(tail, decree))
+    auto handler = handlers.count(key) > 0
+        ? handlers[key]
+        : std::make_shared<EmptyDecreeHandler>();
+    handlers[key] = std::make_shared<KeyedHandler>(handler, extractor);
+}
+
+
+void
+Ledger::RegisterSnapshotHandler(std::shared_ptr<SnapshotHandler> handler)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    snapshot_handler = handler;
+}
+
+
+void
+Ledger::SetSnapshotInterval(int interval)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    snapshot_interval = interval;
+}
+
+
+void
+Ledger::SetAsynchronousApply(size_t max_lag, size_t workers)
+{
+    std::lock_guard<std::mutex> lock(apply_mutex);
+
+    max_apply_lag = max_lag;
+    apply_lanes = std::max<size_t>(workers, 1);
+    if (max_apply_lag > 0 && !applier.joinable())
+    {
+        applier = std::thread([this]() { apply_loop(); });
+    }
+}
+
+
+void
+Ledger::Append(const Decree& decree)
+{
+    auto start = std::chrono::steady_clock::now();
+    bool is_asynchronous;
     {
+        //
+        // Back-pressure is applied before taking the ledger lock so that the
+        // roles can still read the ledger while the applier catches up.
+        //
+        std::unique_lock<std::mutex> lock(apply_mutex);
+
+        applied.wait(lock, [this]() { return has_capacity(); });
+        is_asynchronous = max_apply_lag > 0;
+    }
+
+    bool is_barrier = false;
+    bool is_snapshot_due = false;
+    {
+        //
+        // A lock must be acquired before executing decree_handler in order to
+        // help prevent out of order decrees.
+        //
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+
+        Decree tail = Tail();
+        if (!IsRootDecreeOrdered(tail, decree))
+        {
+            LOG(LogLevel::Warning)
+                << "Out of order decree. Ledger: "
+                << tail.number << "/" << tail.root_number
+                << " Received: "
+                << decree.number << "/" << decree.root_number;
+            return;
+        }
+
         //
         // Append a system decree before executing handler so that post-
         // processing handlers have a full ledger including current decree.
         //
         decrees->Enqueue(decree);
-        if (handlers.count(decree.type) > 0)
+
+        is_snapshot_due =
+            snapshot_interval > 0 &&
+            decree.root_number - snapshot_tail.root_number >= snapshot_interval;
+        is_barrier = decree.type != DecreeType::UserDecree &&
+                     decree.type != DecreeType::BatchDecree;
+        unsynced.emplace_back(decree, start);
+    }
+
+    //
+    // Wait for durability outside of the lock so that appends from other
+    // threads can join the same group commit. Handlers and snapshots only see
+    // a decree once it is durable, otherwise a crash could erase a decree the
+    // application has already acted on.
+    //
+    decrees->Sync();
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+
+        //
+        // The sync covered every decree enqueued before ours as well, so any
+        // that their own appends have not handed on yet are handed on here
+        // first, in ledger order.
+        //
+        Decree last;
+        while (!unsynced.empty() &&
+               unsynced.front().first.root_number <= decree.root_number)
+        {
+            auto next = unsynced.front();
+            unsynced.pop_front();
+
+            commit_index = next.first.root_number;
+            if (is_asynchronous)
+            {
+                {
+                    std::lock_guard<std::mutex> apply_lock(apply_mutex);
+
+                    applying.push_back(next);
+                }
+                apply_ready.notify_one();
+                continue;
+            }
+
+            apply(next.first, handlers);
+            applied_index = next.first.root_number;
+            last = next.first;
+            if (snapshot_interval > 0 &&
+                last.root_number - snapshot_tail.root_number >=
+                    snapshot_interval)
+            {
+                take_snapshot();
+            }
+        }
+        if (!is_asynchronous && last.root_number > 0)
+        {
+            record_applied(last);
+        }
+    }
+
+    //
+    // System decrees change the replica set the roles run against, so they
+    // take effect before Append returns just as they do inline. A snapshot
+    // must wait for the application state to reach the tail.
+    //
+    if (is_asynchronous && (is_barrier || is_snapshot_due))
+    {
+        WaitForApplied();
+    }
+    if (is_asynchronous && is_snapshot_due)
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+
+        take_snapshot();
+    }
+
+    GlobalMetrics().ledger_appends.Add();
+    GlobalMetrics().ledger_append_latency.Record(ElapsedMicroseconds(start));
+}
+
+
+void
+Ledger::Replay()
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    Decree last;
+    last.root_number = applied_index;
+    for (Decree next = Next(last);
+         next.root_number > last.root_number;
+         next = Next(last))
+    {
+        apply(next, handlers);
+        applied_index = next.root_number;
+        record_applied(next);
+        last = next;
+    }
+    flush_applied();
+}
+
+
+void
+Ledger::Reload()
+{
+    WaitForApplied();
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    decrees->Reload();
+    snapshot.Reload();
+    if (applied_decree)
+    {
+        applied_decree->Reload();
+    }
+    unsynced.clear();
+    load_indexes();
+}
+
+
+int
+Ledger::CommitIndex()
+{
+    return commit_index.load();
+}
+
+
+int
+Ledger::AppliedIndex()
+{
+    return applied_index.load();
+}
+
+
+void
+Ledger::WaitForCapacity()
+{
+    std::unique_lock<std::mutex> lock(apply_mutex);
+
+    applied.wait(lock, [this]() { return has_capacity(); });
+}
+
+
+bool
+Ledger::has_capacity()
+{
+    //
+    // When handlers run inline anything still queued from an earlier
+    // asynchronous period is applied first to keep them in order.
+    //
+    return max_apply_lag == 0 ? applying.empty()
+                              : applying.size() < max_apply_lag;
+}
+
+
+void
+Ledger::WaitForApplied()
+{
+    std::unique_lock<std::mutex> lock(apply_mutex);
+
+    applied.wait(lock, [this]() { return applying.empty(); });
+}
+
+
+void
+Ledger::apply(const Decree& decree, const HandlerMap& handlers)
+{
+    if (decree.type == DecreeType::BatchDecree)
+    {
+        //
+        // A batch is stored as a single ledger entry but every value in
+        // it is handed to the user decree handler in proposal order.
+        //
+        auto handler = handlers.find(DecreeType::UserDecree);
+        if (handler != handlers.end())
+        {
+            auto entries = BinaryDeserialize<std::vector<std::string>>(
+                decree.content);
+            for (const std::string& entry : entries)
+            {
+                (*handler->second)(entry);
+            }
+        }
+    }
+    else
+    {
+        auto handler = handlers.find(decree.type);
+        if (handler != handlers.end())
+        {
+            (*handler->second)(decree.content);
+        }
+    }
+}
+
+
+void
+Ledger::record_applied(Decree decree)
+{
+    if (!applied_decree)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(record_mutex);
+
+    decree.content.clear();
+    last_applied = decree;
+    if (decree.root_number - recorded_index >= AppliedRecordInterval)
+    {
+        applied_decree->Put(decree);
+        recorded_index = decree.root_number;
+    }
+}
+
+
+void
+Ledger::flush_applied()
+{
+    if (!applied_decree)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(record_mutex);
+
+    if (last_applied.root_number != recorded_index)
+    {
+        applied_decree->Put(last_applied);
+        recorded_index = last_applied.root_number;
+    }
+}
+
+
+void
+Ledger::apply_loop()
+{
+    std::vector<std::pair<Decree, std::chrono::steady_clock::time_point>*> batch;
+    for (;;)
+    {
+        size_t lane_count;
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(apply_mutex);
+
+            apply_ready.wait(lock, [this]()
+            {
+                return is_stopping || !applying.empty();
+            });
+            if (applying.empty())
+            {
+                return;
+            }
+            for (auto& queued : applying)
+            {
+                batch.push_back(&queued);
+            }
+            lane_count = apply_lanes;
+        }
+
+        //
+        // Handlers registered while a batch is applied take effect from the
+        // next batch.
+        //
+        HandlerMap current;
+        {
+            std::lock_guard<std::recursive_mutex> lock(mutex);
+
+            current = handlers;
+        }
+
+        //
+        // Everything queued so far is applied before the queue is locked
+        // again. Appends only add to the back of the deque, which never
+        // moves the entries already in it. Handlers run without the ledger
+        // lock so that they may call back into the parliament.
+        //
+        if (lane_count > 1)
+        {
+            apply_parallel(batch, lane_count, current);
+        }
+        else
+        {
+            for (auto queued : batch)
+            {
+                apply(queued->first, current);
+                GlobalMetrics().apply_latency.Record(
+                    ElapsedMicroseconds(queued->second));
+            }
+        }
+
+        record_applied(batch.back()->first);
+        {
+            std::lock_guard<std::mutex> lock(apply_mutex);
+
+            applied_index = batch.back()->first.root_number;
+            applying.erase(applying.begin(), applying.begin() + batch.size());
+        }
+        applied.notify_all();
+    }
+}
+
+
+void
+Ledger::apply_parallel(
+    const std::vector<
+        std::pair<Decree, std::chrono::steady_clock::time_point>*>& batch,
+    size_t lane_count,
+    const HandlerMap& handlers)
+{
+    while (lane_workers.size() + 1 < lane_count)
+    {
+        //
+        // Only the applier advances the generation, so a new worker starts
+        // from the current one and waits for the next run.
+        //
+        size_t lane = lane_workers.size() + 1;
+        uint64_t generation = lane_generation;
+        lanes.resize(lane + 1);
+        lane_workers.emplace_back([this, lane, generation]()
+        {
+            lane_loop(lane, generation);
+        });
+    }
+    lanes.resize(lane_workers.size() + 1);
+
+    //
+    // Entries of a batch decree are unpacked up front so that the lanes can
+    // point into them until the whole batch has been applied.
+    //
+    std::vector<std::vector<std::string>> unpacked;
+    unpacked.reserve(batch.size());
+
+    std::hash<std::string> hash;
+    auto user_handler = handlers.count(DecreeType::UserDecree) > 0
+        ? handlers.at(DecreeType::UserDecree)
+        : nullptr;
+    for (auto queued : batch)
+    {
+        const Decree& decree = queued->first;
+        bool is_user = decree.type == DecreeType::UserDecree ||
+                       decree.type == DecreeType::BatchDecree;
+        if (!is_user || !user_handler)
+        {
+            //
+            // System decrees see the effect of every decree before them.
+            //
+            run_lanes();
+            apply(decree, handlers);
+            continue;
+        }
+
+        std::vector<const std::string*> entries;
+        if (decree.type == DecreeType::BatchDecree)
         {
-            (*handlers[decree.type])(decree.content);
+            unpacked.push_back(BinaryDeserialize<std::vector<std::string>>(
+                decree.content));
+            for (const std::string& entry : unpacked.back())
+            {
+                entries.push_back(&entry);
+            }
         }
-    } else
+        else
+        {
+            entries.push_back(&decree.content);
+        }
+
+        for (auto entry : entries)
+        {
+            std::string key = user_handler->ConflictKey(*entry);
+            if (key.empty())
+            {
+                run_lanes();
+                (*user_handler)(*entry);
+                continue;
+            }
+            lanes[hash(key) % lane_count].emplace_back(
+                user_handler.get(), entry);
+        }
+    }
+    run_lanes();
+
+    //
+    // Decrees of a batch finish together, so each is timed to the end of the
+    // batch.
+    //
+    for (auto queued : batch)
+    {
+        GlobalMetrics().apply_latency.Record(
+            ElapsedMicroseconds(queued->second));
+    }
+}
+
+
+void
+Ledger::run_lanes()
+{
+    size_t busy = 0;
+    for (const auto& lane : lanes)
+    {
+        busy += lane.empty() ? 0 : 1;
+    }
+    if (busy == 0)
+    {
+        return;
+    }
+
+    if (busy > 1)
+    {
+        {
+            std::lock_guard<std::mutex> lock(lane_mutex);
+
+            lane_generation++;
+            lanes_pending = lane_workers.size();
+        }
+        lanes_ready.notify_all();
+    }
+    else
+    {
+        //
+        // A single busy lane is run here rather than handed to a worker.
+        //
+        for (size_t i=1; i<lanes.size(); i++)
+        {
+            if (!lanes[i].empty())
+            {
+                std::swap(lanes[0], lanes[i]);
+            }
+        }
+    }
+
+    for (auto& task : lanes[0])
+    {
+        (*task.first)(*task.second);
+    }
+    lanes[0].clear();
+
+    if (busy > 1)
     {
-        LOG(LogLevel::Warning)
-            << "Out of order decree. Ledger: "
-            << tail.number << "/" << tail.root_number
-            << " Received: "
-            << decree.number << "/" << decree.root_number;
+        std::unique_lock<std::mutex> lock(lane_mutex);
+
+        lanes_done.wait(lock, [this]() { return lanes_pending == 0; });
+    }
+    for (auto& lane : lanes)
+    {
+        lane.clear();
+    }
+}
+
+
+void
+Ledger::lane_loop(size_t lane, uint64_t generation)
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(lane_mutex);
+
+            lanes_ready.wait(lock, [this, generation]()
+            {
+                return lanes_stopping || lane_generation != generation;
+            });
+            if (lane_generation == generation)
+            {
+                return;
+            }
+            generation = lane_generation;
+        }
+
+        for (auto& task : lanes[lane])
+        {
+            (*task.first)(*task.second);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(lane_mutex);
+
+            lanes_pending--;
+        }
+        lanes_done.notify_one();
     }
 }
 
@@ -74,13 +714,102 @@ Ledger::Remove()
 }
 
 
+bool
+Ledger::TakeSnapshot()
+{
+    WaitForApplied();
+
+    bool taken;
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+
+        taken = take_snapshot();
+    }
+
+    decrees->Sync();
+    return taken;
+}
+
+
+bool
+Ledger::take_snapshot()
+{
+    Decree tail = Tail();
+    if (snapshot_handler == nullptr ||
+        !IsRootDecreeHigher(tail, snapshot_tail) ||
+        applied_index != tail.root_number)
+    {
+        return false;
+    }
+
+    //
+    // Handlers run under the ledger lock so the application state matches
+    // the tail exactly. The snapshot is persisted before any decree it covers
+    // is removed so a crash in between only leaves redundant decrees behind.
+    //
+    Decree taken = tail;
+    taken.content = snapshot_handler->Take();
+    snapshot = taken;
+    taken.content.clear();
+    snapshot_tail = taken;
+
+    while (decrees->Size() > 0 &&
+           decrees->At(0).root_number <= snapshot_tail.root_number)
+    {
+        decrees->Dequeue();
+    }
+    return true;
+}
+
+
+bool
+Ledger::RestoreSnapshot(const Decree& restored)
+{
+    WaitForApplied();
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    if (snapshot_handler == nullptr || !IsRootDecreeHigher(restored, Tail()))
+    {
+        return false;
+    }
+
+    snapshot_handler->Restore(restored.content);
+    snapshot = restored;
+    snapshot_tail = restored;
+    snapshot_tail.content.clear();
+
+    //
+    // Every decree we hold is older than the snapshot and is superseded by it.
+    //
+    while (decrees->Size() > 0)
+    {
+        decrees->Dequeue();
+    }
+    unsynced.clear();
+    commit_index = restored.root_number;
+    applied_index = restored.root_number;
+    record_applied(restored);
+    return true;
+}
+
+
+Decree
+Ledger::Snapshot()
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    return snapshot.Value();
+}
+
+
 bool
 Ledger::IsEmpty()
 {
     std::lock_guard<std::recursive_mutex> lock(mutex);
 
     Decree empty;
-    return decrees->Last().number == empty.number;
+    return Tail().number == empty.number;
 }
 
 
@@ -89,13 +818,7 @@ Ledger::Head()
 {
     std::lock_guard<std::recursive_mutex> lock(mutex);
 
-    Decree head;
-    for (const Decree& d : *decrees)
-    {
-        head = d;
-        break;
-    }
-    return head;
+    return decrees->At(0);
 }
 
 
@@ -104,7 +827,16 @@ Ledger::Tail()
 {
     std::lock_guard<std::recursive_mutex> lock(mutex);
 
-    return decrees->Last();
+    //
+    // A compacted ledger may hold no decrees past its snapshot, in which case
+    // the snapshot marks the tail.
+    //
+    Decree last = decrees->Last();
+    if (IsRootDecreeHigher(snapshot_tail, last))
+    {
+        return snapshot_tail;
+    }
+    return last;
 }
 
 
@@ -114,6 +846,32 @@ Ledger::Next(Decree previous)
     std::lock_guard<std::recursive_mutex> lock(mutex);
 
     Decree next;
+    if (decrees->Size() == 0)
+    {
+        return next;
+    }
+
+    //
+    // Root numbers in the ledger are consecutive so the successor can be read
+    // directly at its offset from the head.
+    //
+    int head_root_number = decrees->At(0).root_number;
+    int tail_root_number = decrees->Last().root_number;
+    if (tail_root_number - head_root_number + 1 ==
+        static_cast<int>(decrees->Size()))
+    {
+        int position = previous.root_number + 1 - head_root_number;
+        if (position >= 0 && position < static_cast<int>(decrees->Size()))
+        {
+            next = decrees->At(position);
+        }
+        return next;
+    }
+
+    //
+    // Fall back to a scan for ledgers written with gaps in their root
+    // numbers.
+    //
     for (const Decree& current : *decrees)
     {
         if (IsRootDecreeOrdered(previous, current))
@@ -126,4 +884,55 @@ Ledger::Next(Decree previous)
 }
 
 
+std::vector<Decree>
+Ledger::Range(Decree previous, size_t max_entries, size_t max_bytes)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    std::vector<Decree> range;
+    size_t bytes = 0;
+    auto add = [&](const Decree& next)
+    {
+        if (next.number == 0 || range.size() >= max_entries ||
+            (range.size() > 0 && bytes + next.content.size() > max_bytes))
+        {
+            return false;
+        }
+        bytes += next.content.size();
+        range.push_back(next);
+        return true;
+    };
+
+    size_t size = decrees->Size();
+    if (size == 0)
+    {
+        return range;
+    }
+
+    //
+    // Read the run directly by offset when root numbers are consecutive and
+    // walk decree by decree otherwise.
+    //
+    int head_root_number = decrees->At(0).root_number;
+    int tail_root_number = decrees->Last().root_number;
+    if (tail_root_number - head_root_number + 1 == static_cast<int>(size))
+    {
+        int position = previous.root_number + 1 - head_root_number;
+        while (position >= 0 && position < static_cast<int>(size) &&
+               add(decrees->At(position)))
+        {
+            position += 1;
+        }
+        return range;
+    }
+
+    Decree next = Next(previous);
+    while (add(next))
+    {
+        next = Next(next);
+    }
+    return range;
+}
+
+
 }
@@ -1,5 +1,14 @@
+#include <cstdlib>
+#include <iostream>
+
+#include <boost/core/null_deleter.hpp>
 #include <boost/log/core/core.hpp>
 #include <boost/log/expressions.hpp>
+#include <boost/log/sinks/async_frontend.hpp>
+#include <boost/log/sinks/bounded_fifo_queue.hpp>
+#include <boost/log/sinks/drop_on_overflow.hpp>
+#include <boost/log/sinks/text_file_backend.hpp>
+#include <boost/log/sinks/text_ostream_backend.hpp>
 #include <boost/log/support/date_time.hpp>
 #include <boost/log/utility/setup.hpp>
 
@@ -10,47 +19,126 @@ namespace paxos
 {
 
 
+std::atomic<int> log_level(static_cast<int>(LogLevel::Info));
+
+
+//
+// Asynchronous frontends hand records to a dedicated thread per sink, which
+// does the formatting and the write. The logging thread only enqueues.
+//
+using queue_type = boost::log::sinks::bounded_fifo_queue<
+    LogQueueSize,
+    boost::log::sinks::drop_on_overflow>;
+
+using file_sink = boost::log::sinks::asynchronous_sink<
+    boost::log::sinks::text_file_backend,
+    queue_type>;
+
+using console_sink = boost::log::sinks::asynchronous_sink<
+    boost::log::sinks::text_ostream_backend,
+    queue_type>;
+
+
+static std::atomic<bool> console_enabled(true);
+
+
+static boost::shared_ptr<file_sink> file;
+
+
+static boost::shared_ptr<console_sink> console;
+
+
+static void
+stop_logging()
+{
+    auto core = boost::log::core::get();
+    if (file)
+    {
+        core->remove_sink(file);
+        file->stop();
+        file->flush();
+    }
+    if (console)
+    {
+        core->remove_sink(console);
+        console->stop();
+        console->flush();
+    }
+}
+
+
 BOOST_LOG_GLOBAL_LOGGER_INIT(global_logger, boost::log::sources::severity_logger_mt)
 {
     boost::log::sources::severity_logger_mt<LogLevel> logger;
 
-    boost::log::add_file_log
-    (
-        boost::log::keywords::file_name = "paxos.log",
-        boost::log::keywords::rotation_size = LogFileRotationSize,
-        boost::log::keywords::format =
-        (
-            boost::log::expressions::stream
-                << boost::log::expressions::format_date_time<boost::posix_time::ptime>
-                    ("TimeStamp", "[%Y-%m-%d %H:%M:%S:%f]: ")
-                << boost::log::expressions::message
-        )
-    );
-    boost::log::add_console_log
+    auto format =
     (
-        std::cout,
-        boost::log::keywords::format =
-        (
-            boost::log::expressions::stream
-                << boost::log::expressions::format_date_time<boost::posix_time::ptime>
-                    ("TimeStamp", "[%Y-%m-%d %H:%M:%S:%f]: ")
-                << boost::log::expressions::message
-        )
+        boost::log::expressions::stream
+            << boost::log::expressions::format_date_time<boost::posix_time::ptime>
+                ("TimeStamp", "[%Y-%m-%d %H:%M:%S:%f]: ")
+            << boost::log::expressions::message
     );
-    boost::log::core::get()->set_filter
+
+    file = boost::make_shared<file_sink>
     (
-        boost::log::expressions::attr<LogLevel>("Severity") >= LogLevel::Info
+        boost::log::keywords::file_name = LogFilename,
+        boost::log::keywords::rotation_size = LogFileRotationSize
     );
+    file->set_formatter(format);
+
+    console = boost::make_shared<console_sink>();
+    console->locked_backend()->add_stream(
+        boost::shared_ptr<std::ostream>(&std::cout, boost::null_deleter()));
+    console->set_formatter(format);
+    console->set_filter([](const boost::log::attribute_value_set&)
+    {
+        return console_enabled.load(std::memory_order_relaxed);
+    });
+
+    auto core = boost::log::core::get();
+    core->add_sink(file);
+    core->add_sink(console);
 
     boost::log::add_common_attributes();
 
+    std::atexit(stop_logging);
+
     return logger;
 }
 
 
+void
+SetLogLevel(LogLevel level)
+{
+    log_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+
+LogLevel
+GetLogLevel()
+{
+    return static_cast<LogLevel>(log_level.load(std::memory_order_relaxed));
+}
+
+
+void
+SetConsoleLogging(bool enabled)
+{
+    console_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+
+void
+FlushLogging()
+{
+    boost::log::core::get()->flush();
+}
+
+
 void
 DisableLogging()
 {
+    SetLogLevel(LogLevel::Off);
     boost::log::core::get()->set_logging_enabled(false);
 }
 
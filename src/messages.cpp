@@ -6,11 +6,26 @@ namespace paxos
 
 
 Message
-Response(Message message, MessageType type)
+Response(const Message& message, MessageType type)
 {
     Message response(message.decree, message.to, message.from, type);
     return response;
 }
 
 
+std::ostream&
+operator<<(std::ostream& os, const Message& message)
+{
+    return os << "type=" << static_cast<int>(message.type)
+              << " from=" << message.from.hostname << ":" << message.from.port
+              << " to=" << message.to.hostname << ":" << message.to.port
+              << " author=" << message.decree.author.hostname << ":"
+              << message.decree.author.port
+              << " number=" << message.decree.number
+              << " root=" << message.decree.root_number
+              << " decree_type=" << static_cast<int>(message.decree.type)
+              << " content_size=" << message.decree.content.size();
+}
+
+
 }
@@ -0,0 +1,319 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include "paxos/metrics.hpp"
+#include "paxos/replicaset.hpp"
+
+
+namespace paxos
+{
+
+
+static size_t
+thread_stripe()
+{
+    static std::atomic<size_t> next_stripe(0);
+    thread_local size_t stripe = next_stripe.fetch_add(1) % CounterStripes;
+    return stripe;
+}
+
+
+Counter::Counter()
+{
+    for (auto& stripe : stripes)
+    {
+        stripe.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+void
+Counter::Add(uint64_t n)
+{
+    stripes[thread_stripe()].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+
+uint64_t
+Counter::Value() const
+{
+    uint64_t value = 0;
+    for (const auto& stripe : stripes)
+    {
+        value += stripe.value.load(std::memory_order_relaxed);
+    }
+    return value;
+}
+
+
+uint64_t
+HistogramSnapshot::Quantile(double q) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(std::ceil(q * count));
+    if (target == 0)
+    {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i=0; i<buckets.size(); i++)
+    {
+        seen += buckets[i];
+        if (seen >= target)
+        {
+            return Histogram::BucketUpperBound(i);
+        }
+    }
+    return Histogram::BucketUpperBound(buckets.size() - 1);
+}
+
+
+const int Histogram::SubBucketBits;
+const size_t Histogram::SubBuckets;
+const size_t Histogram::BucketCount;
+
+
+Histogram::Histogram()
+{
+    for (auto& bucket : buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+void
+Histogram::Record(uint64_t value)
+{
+    buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count.Add();
+    sum.Add(value);
+}
+
+
+HistogramSnapshot
+Histogram::Snapshot() const
+{
+    HistogramSnapshot snapshot;
+    snapshot.buckets.reserve(BucketCount);
+    for (const auto& bucket : buckets)
+    {
+        snapshot.buckets.push_back(bucket.load(std::memory_order_relaxed));
+        snapshot.count += snapshot.buckets.back();
+    }
+
+    //
+    // The count is taken from the buckets so that it always agrees with
+    // them, even while other threads are recording.
+    //
+    snapshot.sum = sum.Value();
+    return snapshot;
+}
+
+
+size_t
+Histogram::BucketIndex(uint64_t value)
+{
+    if (value < SubBuckets)
+    {
+        return value;
+    }
+
+    int exponent = 63 - __builtin_clzll(value);
+    size_t sub_bucket = (value >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+    return (exponent - SubBucketBits + 1) * SubBuckets + sub_bucket;
+}
+
+
+uint64_t
+Histogram::BucketUpperBound(size_t index)
+{
+    if (index < SubBuckets)
+    {
+        return index;
+    }
+
+    int shift = index / SubBuckets - 1;
+    uint64_t lower = static_cast<uint64_t>(SubBuckets + index % SubBuckets) << shift;
+    return lower + ((static_cast<uint64_t>(1) << shift) - 1);
+}
+
+
+const size_t PhaseTimer::Slots;
+
+
+PhaseTimer::PhaseTimer()
+{
+    for (auto& slot : slots)
+    {
+        slot.key.store(0, std::memory_order_relaxed);
+        slot.start.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+void
+PhaseTimer::Start(const Decree& decree)
+{
+    uint64_t k = key(decree);
+    Slot& slot = slots[k % Slots];
+
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    slot.start.store(now, std::memory_order_relaxed);
+    slot.key.store(k, std::memory_order_release);
+}
+
+
+bool
+PhaseTimer::Stop(const Decree& decree, Histogram& histogram)
+{
+    uint64_t k = key(decree);
+    Slot& slot = slots[k % Slots];
+
+    uint64_t expected = k;
+    int64_t start = slot.start.load(std::memory_order_relaxed);
+    if (!slot.key.compare_exchange_strong(expected, 0,
+                                          std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    histogram.Record(now > start ? (now - start) / 1000 : 0);
+    return true;
+}
+
+
+uint64_t
+PhaseTimer::key(const Decree& decree)
+{
+    DecreeId id(decree);
+    uint64_t k = combine_hash(hash_decree()(id), std::hash<ReplicaId>()(id.author));
+
+    //
+    // Zero marks an empty slot.
+    //
+    return k == 0 ? 1 : k;
+}
+
+
+MetricsSnapshot
+Metrics::Snapshot() const
+{
+    MetricsSnapshot snapshot;
+
+    snapshot.counters["requests"] = requests.Value();
+    snapshot.counters["prepares"] = prepares.Value();
+    snapshot.counters["promises"] = promises.Value();
+    snapshot.counters["nacks"] = nacks.Value();
+    snapshot.counters["nack_ties"] = nack_ties.Value();
+    snapshot.counters["accepts"] = accepts.Value();
+    snapshot.counters["accepted"] = accepted.Value();
+    snapshot.counters["ledger_appends"] = ledger_appends.Value();
+    snapshot.counters["messages_sent"] = messages_sent.Value();
+    snapshot.counters["bytes_sent"] = bytes_sent.Value();
+    snapshot.counters["messages_dropped"] = messages_dropped.Value();
+    snapshot.counters["messages_received"] = messages_received.Value();
+    snapshot.counters["bytes_received"] = bytes_received.Value();
+
+    snapshot.histograms["prepare_promise_latency"] =
+        prepare_promise_latency.Snapshot();
+    snapshot.histograms["accept_accepted_latency"] =
+        accept_accepted_latency.Snapshot();
+    snapshot.histograms["ledger_append_latency"] =
+        ledger_append_latency.Snapshot();
+    snapshot.histograms["send_latency"] = send_latency.Snapshot();
+    snapshot.histograms["receive_latency"] = receive_latency.Snapshot();
+    snapshot.histograms["apply_latency"] = apply_latency.Snapshot();
+
+    return snapshot;
+}
+
+
+Metrics&
+GlobalMetrics()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+
+uint64_t
+ElapsedMicroseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+
+static std::string
+format_seconds(uint64_t microseconds)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.6f", microseconds / 1e6);
+    return buffer;
+}
+
+
+void
+WritePrometheus(std::ostream& os, const MetricsSnapshot& snapshot)
+{
+    for (const auto& counter : snapshot.counters)
+    {
+        std::string name = "paxos_" + counter.first + "_total";
+        os << "# TYPE " << name << " counter\n"
+           << name << " " << counter.second << "\n";
+    }
+
+    for (const auto& histogram : snapshot.histograms)
+    {
+        //
+        // Only buckets that hold samples are written. Their cumulative counts
+        // are what Prometheus expects for the le labels.
+        //
+        std::string name = "paxos_" + histogram.first + "_seconds";
+        os << "# TYPE " << name << " histogram\n";
+
+        uint64_t cumulative = 0;
+        const auto& buckets = histogram.second.buckets;
+        for (size_t i=0; i<buckets.size(); i++)
+        {
+            if (buckets[i] == 0)
+            {
+                continue;
+            }
+            cumulative += buckets[i];
+            os << name << "_bucket{le=\""
+               << format_seconds(Histogram::BucketUpperBound(i)) << "\"} "
+               << cumulative << "\n";
+        }
+        os << name << "_bucket{le=\"+Inf\"} " << histogram.second.count << "\n"
+           << name << "_sum " << format_seconds(histogram.second.sum) << "\n"
+           << name << "_count " << histogram.second.count << "\n";
+    }
+}
+
+
+void
+WritePrometheusFile(std::string filename, const MetricsSnapshot& snapshot)
+{
+    std::string temporary = filename + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        WritePrometheus(file, snapshot);
+    }
+    boost::filesystem::rename(temporary, filename);
+}
+
+
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <mutex>
 
 #include "paxos/parliament.hpp"
@@ -7,27 +8,140 @@ namespace paxos
 {
 
 
+static std::shared_ptr<ReplicaSet>
+load_replicaset(std::string location)
+{
+    //
+    // A bootstrap a crash interrupted is settled before any of the files it
+    // replaces are read.
+    //
+    RecoverBootstrap(location);
+    return LoadReplicaSet(
+        std::ifstream(
+            (boost::filesystem::path(location) /
+             boost::filesystem::path(ReplicasetFilename)).string()));
+}
+
+
+static std::shared_ptr<BaseQueue<Decree>>
+open_ledger_queue(std::string location, SyncPolicy sync_policy)
+{
+    //
+    // Replicas created before the write-ahead log keep their rollover ledger
+    // so that upgrading does not lose decrees.
+    //
+    if (boost::filesystem::exists(
+            boost::filesystem::path(location) /
+            boost::filesystem::path(LEDGER_FILENAME)))
+    {
+        return std::make_shared<RolloverQueue<Decree>>(
+            location, LEDGER_FILENAME);
+    }
+    return std::make_shared<WriteAheadLog<Decree>>(
+        location, LEDGER_LOG_FILENAME, sync_policy);
+}
+
+
+static std::shared_ptr<Ledger>
+open_ledger(std::string location, SyncPolicy sync_policy)
+{
+    auto decrees = open_ledger_queue(location, sync_policy);
+    auto applied = std::make_shared<PersistentDecree>(
+        location, APPLIED_DECREE_FILENAME);
+
+    //
+    // Ledgers written before the applied decree was recorded were applied up
+    // to their tail.
+    //
+    if (!boost::filesystem::exists(
+            boost::filesystem::path(location) /
+            boost::filesystem::path(APPLIED_DECREE_FILENAME)) &&
+        decrees->Size() > 0)
+    {
+        Decree tail = decrees->Last();
+        tail.content.clear();
+        applied->Put(tail);
+    }
+
+    return std::make_shared<Ledger>(
+        decrees,
+        std::make_shared<EmptyDecreeHandler>(),
+        std::make_shared<PersistentDecree>(location, SNAPSHOT_FILENAME),
+        applied);
+}
+
+
+//
+// Move promised and accepted decree files into the acceptor log. These are
+// left behind by replicas created before the acceptor log and written by
+// bootstrap.
+//
+static void
+import_acceptor_files(std::string location, std::shared_ptr<AcceptorLog> log)
+{
+    std::vector<std::pair<std::string, AcceptorField>> files {
+        { PROMISED_DECREE_FILENAME, AcceptorField::Promised },
+        { ACCEPTED_DECREE_FILENAME, AcceptorField::Accepted },
+    };
+    for (auto& file : files)
+    {
+        boost::filesystem::path path =
+            boost::filesystem::path(location) /
+            boost::filesystem::path(file.first);
+        if (boost::filesystem::exists(path))
+        {
+            log->Put(file.second,
+                     DurableStorage<Decree>(location, file.first).Get());
+            boost::filesystem::remove(path);
+        }
+    }
+}
+
+
+static std::shared_ptr<AcceptorLog>
+open_acceptor_log(std::string location)
+{
+    auto log = std::make_shared<AcceptorLog>(location);
+    import_acceptor_files(location, log);
+    return log;
+}
+
+
 Parliament::Parliament(
     Replica legislator,
     std::string location,
-    Handler accept_handler)
+    Handler accept_handler,
+    SyncPolicy sync_policy,
+    size_t threads)
     : legislator(legislator),
-      legislators(LoadReplicaSet(
-          std::ifstream(
-              (boost::filesystem::path(location) /
-               boost::filesystem::path(ReplicasetFilename)).string()))),
-      receiver(std::make_shared<NetworkReceiver<AsynchronousServer>>(
-               legislator.hostname, legislator.port, legislators)),
-      sender(std::make_shared<NetworkSender<BoostTransport>>(legislators)),
+      legislators(load_replicaset(location)),
+      receiver(std::make_shared<NetworkReceiver<AsynchronousServer, BinaryCodec>>(
+               legislator.hostname, legislator.port, legislators, threads)),
+      sender(std::make_shared<NetworkSender<BoostTransport, BinaryCodec>>(
+               legislators)),
+      highest_proposed_decree(std::make_shared<PersistentDecree>(
+          location, HIGHEST_PROPOSED_DECREE_FILENAME)),
+      acceptor_log(open_acceptor_log(location)),
+      ledger(open_ledger(location, sync_policy)),
       bootstrap(
-          std::make_shared<BootstrapListener<SynchronousServer>>(
+          std::make_shared<BootstrapListener<SynchronousServer, BinaryCodec>>(
               legislators,
               legislator.hostname,
-              legislator.port + 1
+              legislator.port + 1,
+              [this, location]()
+              {
+                  //
+                  // Decree files and the ledger are cached in memory so pick
+                  // up the ones the bootstrap just replaced on disk and move
+                  // the acceptor decrees it sent into the acceptor log.
+                  //
+                  highest_proposed_decree->Reload();
+                  import_acceptor_files(location, acceptor_log);
+                  ledger->Reload();
+                  ledger->Replay();
+              }
           )
       ),
-      ledger(std::make_shared<Ledger>(
-          std::make_shared<RolloverQueue<Decree>>(location, LEDGER_FILENAME))),
       learner(std::make_shared<LearnerContext>(legislators, ledger)),
       location(location),
       signal(std::make_shared<Signal>())
@@ -53,17 +167,23 @@ Parliament::Parliament(
             signal)
     );
 
-    auto proposer = std::make_shared<ProposerContext>(
+    //
+    // Apply whatever was durable but not yet applied when we last stopped.
+    //
+    ledger->Replay();
+
+    proposer = std::make_shared<ProposerContext>(
         legislators,
         ledger,
-        std::make_shared<PersistentDecree>(
-            location,
-            HIGHEST_PROPOSED_DECREE_FILENAME),
+        highest_proposed_decree,
         std::make_shared<RandomPause>(std::chrono::milliseconds(100)),
         signal);
     auto acceptor = std::make_shared<AcceptorContext>(
-        std::make_shared<PersistentDecree>(location, PROMISED_DECREE_FILENAME),
-        std::make_shared<PersistentDecree>(location, ACCEPTED_DECREE_FILENAME),
+        std::make_shared<AcceptorLogStorage>(
+            acceptor_log, AcceptorField::Promised),
+        std::make_shared<AcceptorLogStorage>(
+            acceptor_log, AcceptorField::Accepted),
+        std::make_shared<AcceptorLogVotes>(acceptor_log),
         std::chrono::milliseconds(1000));
     hookup_legislator(legislator, proposer, acceptor);
 
@@ -92,11 +212,13 @@ Parliament::Parliament(
     std::shared_ptr<ProposerContext> proposer,
     std::shared_ptr<LearnerContext> learner
 ) :
+    legislator(legislator),
     legislators(legislators),
     receiver(receiver),
     sender(sender),
     ledger(ledger),
     learner(learner),
+    proposer(proposer),
     signal(proposer->signal)
 {
     hookup_legislator(legislator, proposer, acceptor);
@@ -105,11 +227,16 @@ Parliament::Parliament(
 
 void
 Parliament::hookup_legislator(
-    Replica replica,
+    Replica,
     std::shared_ptr<ProposerContext> proposer,
     std::shared_ptr<AcceptorContext> acceptor)
 {
-    auto updater = std::make_shared<UpdaterContext>(ledger);
+    //
+    // Lagging replicas catch up in runs of decrees rather than one decree per
+    // round trip.
+    //
+    updater = std::make_shared<UpdaterContext>(ledger);
+    updater->update_window_entries = 256;
 
     RegisterProposer(
         receiver,
@@ -142,7 +269,7 @@ Parliament::AddLegislator(
 {
     Decree d;
     d.type = DecreeType::AddReplicaDecree;
-    d.content = Serialize(
+    d.content = BinarySerialize(
         UpdateReplicaSetDecree
         {
             legislator,
@@ -165,7 +292,7 @@ Parliament::RemoveLegislator(
 {
     Decree d;
     d.type = DecreeType::RemoveReplicaDecree;
-    d.content = Serialize(
+    d.content = BinarySerialize(
         UpdateReplicaSetDecree
         {
             legislator,
@@ -264,4 +391,97 @@ Parliament::SetInactive()
 }
 
 
+void
+Parliament::SetPipelineWindow(int window)
+{
+    std::lock_guard<std::mutex> lock(proposer->mutex);
+
+    proposer->pipeline_window = std::max(window, 1);
+}
+
+
+void
+Parliament::SetBatching(size_t max_bytes, std::chrono::milliseconds max_delay)
+{
+    std::lock_guard<std::mutex> lock(proposer->mutex);
+
+    proposer->batch_max_bytes = max_bytes;
+    proposer->batch_max_delay = max_delay;
+}
+
+
+void
+Parliament::SetUpdateWindow(size_t max_entries, size_t max_bytes)
+{
+    updater->update_window_entries = std::max<size_t>(max_entries, 1);
+    updater->update_window_bytes = max_bytes;
+}
+
+
+void
+Parliament::SetSnapshotHandler(
+    std::function<std::string()> take,
+    Handler restore)
+{
+    ledger->RegisterSnapshotHandler(
+        std::make_shared<CallbackSnapshotHandler>(take, restore));
+}
+
+
+void
+Parliament::SetSnapshotInterval(int interval)
+{
+    ledger->SetSnapshotInterval(std::max(interval, 0));
+}
+
+
+bool
+Parliament::TakeSnapshot()
+{
+    return ledger->TakeSnapshot();
+}
+
+
+void
+Parliament::SetAsynchronousApply(size_t max_lag, size_t workers)
+{
+    ledger->SetAsynchronousApply(max_lag, workers);
+}
+
+
+void
+Parliament::SetConflictKey(KeyExtractor key)
+{
+    ledger->SetConflictKey(DecreeType::UserDecree, key);
+}
+
+
+int
+Parliament::GetCommitIndex()
+{
+    return ledger->CommitIndex();
+}
+
+
+int
+Parliament::GetAppliedIndex()
+{
+    return ledger->AppliedIndex();
+}
+
+
+MetricsSnapshot
+Parliament::GetMetrics()
+{
+    return GlobalMetrics().Snapshot();
+}
+
+
+void
+Parliament::DumpMetrics(std::string filename)
+{
+    WritePrometheusFile(filename, GetMetrics());
+}
+
+
 }
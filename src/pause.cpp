@@ -41,4 +41,93 @@ RandomPause::Start(std::function<void(void)> callback)
 }
 
 
+Timer::Timer()
+    : mutex(),
+      changed(),
+      deadline(),
+      callback(),
+      is_stopping(false),
+      thread()
+{
+}
+
+
+Timer::~Timer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        is_stopping = true;
+        callback = nullptr;
+    }
+    changed.notify_all();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+
+void
+Timer::Start(
+    std::chrono::milliseconds delay,
+    std::function<void(void)> callback_)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    deadline = std::chrono::steady_clock::now() + delay;
+    callback = callback_;
+    if (!thread.joinable())
+    {
+        thread = std::thread([this]() { run(); });
+    }
+    changed.notify_all();
+}
+
+
+void
+Timer::Cancel()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    callback = nullptr;
+    changed.notify_all();
+}
+
+
+void
+Timer::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        changed.wait(lock, [this]() { return is_stopping || callback; });
+        if (is_stopping)
+        {
+            return;
+        }
+
+        //
+        // Wake early when the timer is stopped, cancelled or restarted with
+        // a new deadline and look again.
+        //
+        changed.wait_until(lock, deadline);
+        if (!callback || std::chrono::steady_clock::now() < deadline)
+        {
+            continue;
+        }
+
+        //
+        // The callback runs without the lock so that it may start the timer
+        // again.
+        //
+        auto fire = std::move(callback);
+        callback = nullptr;
+        lock.unlock();
+        fire();
+        lock.lock();
+    }
+}
+
+
 }
@@ -1,4 +1,6 @@
+#include <atomic>
 #include <fstream>
+#include <stdexcept>
 #include <vector>
 
 #include <boost/algorithm/string.hpp>
@@ -19,8 +21,55 @@ IsReplicaEqual(const Replica& lhs, const Replica& rhs)
 }
 
 
+//
+// Replicas are never removed from the intern table. It only grows with the
+// distinct replicas a process hears of, which is bounded by its configurations.
+//
+static std::mutex intern_mutex;
+
+static std::unordered_map<Replica, ReplicaId, hash_replica, equal_replica>
+    interned_ids;
+
+static std::vector<Replica> interned_replicas;
+
+
+ReplicaId
+InternReplica(const Replica& replica)
+{
+    std::lock_guard<std::mutex> lock(intern_mutex);
+
+    auto found = interned_ids.find(replica);
+    if (found != interned_ids.end())
+    {
+        return found->second;
+    }
+    ReplicaId id = interned_replicas.size();
+    interned_ids.emplace(replica, id);
+    interned_replicas.push_back(replica);
+    return id;
+}
+
+
+Replica
+InternedReplica(ReplicaId id)
+{
+    std::lock_guard<std::mutex> lock(intern_mutex);
+
+    return id < interned_replicas.size() ? interned_replicas[id] : Replica();
+}
+
+
+//
+// Epochs are unique across every replica set so that votes cast against one
+// set never count against another.
+//
+static std::atomic<uint64_t> next_epoch(1);
+
+
 ReplicaSet::ReplicaSet()
-    : replicaset()
+    : replicaset(),
+      ids(),
+      epoch(next_epoch++)
 {
 }
 
@@ -33,20 +82,39 @@ ReplicaSet::~ReplicaSet()
 void
 ReplicaSet::Add(Replica replica)
 {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (replicaset.find(replica) != replicaset.end())
+    {
+        return;
+    }
+    if (replicaset.size() >= MaxReplicas)
+    {
+        throw std::length_error("replica set holds at most " +
+                                std::to_string(MaxReplicas) + " replicas");
+    }
     replicaset.insert(replica);
+    renumber();
 }
 
 
 void
 ReplicaSet::Remove(Replica replica)
 {
-    replicaset.erase(replica);
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (replicaset.erase(replica) > 0)
+    {
+        renumber();
+    }
 }
 
 
 bool
 ReplicaSet::Contains(const Replica replica) const
 {
+    std::lock_guard<std::mutex> lock(mutex);
+
     return replicaset.find(replica) != replicaset.end();
 }
 
@@ -54,6 +122,8 @@ ReplicaSet::Contains(const Replica replica) const
 int
 ReplicaSet::GetSize() const
 {
+    std::lock_guard<std::mutex> lock(mutex);
+
     return replicaset.size();
 }
 
@@ -61,40 +131,119 @@ ReplicaSet::GetSize() const
 void
 ReplicaSet::Clear()
 {
+    std::lock_guard<std::mutex> lock(mutex);
+
     replicaset.clear();
+    renumber();
 }
 
 
 std::shared_ptr<ReplicaSet>
 ReplicaSet::Intersection(std::shared_ptr<ReplicaSet>& other) const
 {
+    auto others = other->Copy();
     auto intersection = std::make_shared<ReplicaSet>();
-    for (auto r : *other)
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (const Replica& r : others->replicaset)
     {
-        if (Contains(r))
+        if (replicaset.find(r) != replicaset.end())
         {
-            intersection->Add(r);
+            intersection->replicaset.insert(r);
         }
     }
+    intersection->renumber();
     return intersection;
 }
 
 
 std::shared_ptr<ReplicaSet>
 ReplicaSet::Difference(std::shared_ptr<const ReplicaSet> other) const
+{
+    auto others = other->Copy();
+    auto difference = std::make_shared<ReplicaSet>();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (const Replica& r : replicaset)
+    {
+        if (others->replicaset.find(r) == others->replicaset.end())
+        {
+            difference->replicaset.insert(r);
+        }
+    }
+    difference->renumber();
+    return difference;
+}
+
+
+std::shared_ptr<ReplicaSet>
+ReplicaSet::Copy() const
+{
+    auto copy = std::make_shared<ReplicaSet>();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    copy->replicaset = replicaset;
+    copy->ids = ids;
+    copy->epoch = epoch;
+    return copy;
+}
+
+
+std::shared_ptr<ReplicaSet>
+ReplicaSet::Difference(const VoteSet& votes) const
 {
     auto difference = std::make_shared<ReplicaSet>();
-    for (auto r : replicaset)
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (const Replica& r : replicaset)
     {
-        if (!other->Contains(r))
+        if (votes.epoch != epoch || !votes.votes.test(ids.at(r)))
         {
-            difference->Add(r);
+            difference->replicaset.insert(r);
         }
     }
+    difference->renumber();
     return difference;
 }
 
 
+int
+ReplicaSet::Id(const Replica& replica, uint64_t& epoch_) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    epoch_ = epoch;
+    auto found = ids.find(replica);
+    return found == ids.end() ? -1 : found->second;
+}
+
+
+uint64_t
+ReplicaSet::Epoch() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return epoch;
+}
+
+
+void
+ReplicaSet::renumber()
+{
+    ids.clear();
+    int id = 0;
+    for (const Replica& r : replicaset)
+    {
+        ids[r] = id++;
+    }
+    epoch = next_epoch++;
+}
+
+
 ReplicaSet::iterator
 ReplicaSet::begin() const
 {
@@ -109,6 +258,48 @@ ReplicaSet::end() const
 }
 
 
+VoteSet::VoteSet()
+    : epoch(0),
+      votes()
+{
+}
+
+
+bool
+VoteSet::Add(const Replica& replica, const ReplicaSet& replicaset)
+{
+    uint64_t current;
+    int id = replicaset.Id(replica, current);
+    if (current != epoch)
+    {
+        votes.reset();
+        epoch = current;
+    }
+    if (id < 0)
+    {
+        return false;
+    }
+    votes.set(id);
+    return true;
+}
+
+
+bool
+VoteSet::Contains(const Replica& replica, const ReplicaSet& replicaset) const
+{
+    uint64_t current;
+    int id = replicaset.Id(replica, current);
+    return current == epoch && id >= 0 && votes.test(id);
+}
+
+
+int
+VoteSet::Count(const ReplicaSet& replicaset) const
+{
+    return replicaset.Epoch() == epoch ? votes.count() : 0;
+}
+
+
 std::shared_ptr<ReplicaSet>
 LoadReplicaSet(std::istream&& replicasetfile)
 {
@@ -133,7 +324,8 @@ LoadReplicaSet(std::istream&& replicasetfile)
 void
 SaveReplicaSet(std::shared_ptr<ReplicaSet> replicaset, std::ostream& replicasetfile)
 {
-    for (auto r : *replicaset)
+    auto replicas = replicaset->Copy();
+    for (auto r : *replicas)
     {
         replicasetfile << r.hostname << ":" << r.port << "\n";
     }
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <vector>
+
 #include "paxos/logging.hpp"
+#include "paxos/metrics.hpp"
 #include "paxos/roles.hpp"
 
 
@@ -15,23 +19,28 @@ RegisterProposer(
     using namespace std::placeholders;
 
     receiver->RegisterCallback(
-        Callback(std::bind(HandleRequest, std::placeholders::_1, context, sender)),
+        Callback(std::bind(HandleRequest, std::placeholders::_1, context, sender),
+                 context),
         MessageType::RequestMessage
     );
     receiver->RegisterCallback(
-        Callback(std::bind(HandlePromise, std::placeholders::_1, context, sender)),
+        Callback(std::bind(HandlePromise, std::placeholders::_1, context, sender),
+                 context),
         MessageType::PromiseMessage
     );
     receiver->RegisterCallback(
-        Callback(std::bind(HandleNackTie, std::placeholders::_1, context, sender)),
+        Callback(std::bind(HandleNackTie, std::placeholders::_1, context, sender),
+                 context),
         MessageType::NackTieMessage
     );
     receiver->RegisterCallback(
-        Callback(std::bind(HandleNack, std::placeholders::_1, context, sender)),
+        Callback(std::bind(HandleNack, std::placeholders::_1, context, sender),
+                 context),
         MessageType::NackMessage
     );
     receiver->RegisterCallback(
-        Callback(std::bind(HandleResume, std::placeholders::_1, context, sender)),
+        Callback(std::bind(HandleResume, std::placeholders::_1, context, sender),
+                 context),
         MessageType::ResumeMessage
     );
 }
@@ -46,15 +55,18 @@ RegisterAcceptor(
     using namespace std::placeholders;
 
     receiver->RegisterCallback(
-        Callback(std::bind(HandlePrepare, std::placeholders::_1, context, sender)),
+        Callback(std::bind(HandlePrepare, std::placeholders::_1, context, sender),
+                 context),
         MessageType::PrepareMessage
     );
     receiver->RegisterCallback(
-        Callback(std::bind(HandleAccept, std::placeholders::_1, context, sender)),
+        Callback(std::bind(HandleAccept, std::placeholders::_1, context, sender),
+                 context),
         MessageType::AcceptMessage
     );
     receiver->RegisterCallback(
-        Callback(std::bind(HandleCleanup, std::placeholders::_1, context, sender)),
+        Callback(std::bind(HandleCleanup, std::placeholders::_1, context, sender),
+                 context),
         MessageType::ResumeMessage
     );
 }
@@ -69,13 +81,25 @@ RegisterLearner(
     using namespace std::placeholders;
 
     receiver->RegisterCallback(
-        Callback(std::bind(HandleAccepted, std::placeholders::_1, context, sender)),
+        Callback(std::bind(HandleAccepted, std::placeholders::_1, context, sender),
+                 context),
         MessageType::AcceptedMessage
     );
     receiver->RegisterCallback(
-        Callback(std::bind(HandleUpdated, std::placeholders::_1, context, sender)),
+        Callback(std::bind(HandleUpdated, std::placeholders::_1, context, sender),
+                 context),
         MessageType::UpdatedMessage
     );
+    receiver->RegisterCallback(
+        Callback(std::bind(HandleSnapshot, std::placeholders::_1, context, sender),
+                 context),
+        MessageType::SnapshotMessage
+    );
+    receiver->RegisterCallback(
+        Callback(std::bind(HandleUpdatedRange, std::placeholders::_1, context, sender),
+                 context),
+        MessageType::UpdatedRangeMessage
+    );
 }
 
 
@@ -88,20 +112,221 @@ RegisterUpdater(
     using namespace std::placeholders;
 
     receiver->RegisterCallback(
-        Callback(std::bind(HandleUpdate, std::placeholders::_1, context, sender)),
+        Callback(std::bind(HandleUpdate, std::placeholders::_1, context, sender),
+                 context),
         MessageType::UpdateMessage
     );
 }
 
 
+static std::tuple<std::string, DecreeType, Replica>
+take_requested_value(std::shared_ptr<ProposerContext> context)
+{
+    auto value = context->requested_values.front();
+    context->requested_values.pop_front();
+
+    if (context->batch_max_bytes == 0 ||
+        std::get<1>(value) != DecreeType::UserDecree)
+    {
+        return value;
+    }
+
+    //
+    // Coalesce following user decrees from the same author into one batch
+    // decree until the next value would exceed the batch size.
+    //
+    std::vector<std::string> entries { std::get<0>(value) };
+    size_t bytes = std::get<0>(value).size();
+    while (!context->requested_values.empty())
+    {
+        auto& next = context->requested_values.front();
+        if (std::get<1>(next) != DecreeType::UserDecree ||
+            !IsReplicaEqual(std::get<2>(next), std::get<2>(value)) ||
+            bytes + std::get<0>(next).size() > context->batch_max_bytes)
+        {
+            break;
+        }
+        bytes += std::get<0>(next).size();
+        entries.push_back(std::get<0>(next));
+        context->requested_values.pop_front();
+    }
+
+    if (entries.size() == 1)
+    {
+        return value;
+    }
+    return std::make_tuple(BinarySerialize(entries),
+                           DecreeType::BatchDecree,
+                           std::get<2>(value));
+}
+
+
+static bool
+is_batch_pending(
+    const Message& message,
+    std::shared_ptr<ProposerContext> context,
+    std::shared_ptr<Sender> sender)
+{
+    if (context->batch_max_bytes == 0 ||
+        context->batch_max_delay.count() == 0 ||
+        context->requested_values.empty())
+    {
+        return false;
+    }
+
+    auto now = context->now();
+    if (context->batch_deadline ==
+        std::chrono::high_resolution_clock::time_point())
+    {
+        //
+        // First value of a new batch. Schedule a request to flush whatever
+        // has been queued once the maximum delay has passed.
+        //
+        context->batch_deadline = now + context->batch_max_delay;
+
+        Message flush(Decree(), message.to, message.to,
+                      MessageType::RequestMessage);
+        context->batch_timer.Start(context->batch_max_delay, [sender, flush]()
+        {
+            sender->Reply(flush);
+        });
+    }
+
+    size_t bytes = 0;
+    for (const auto& value : context->requested_values)
+    {
+        bytes += std::get<0>(value).size();
+    }
+
+    if (now < context->batch_deadline && bytes < context->batch_max_bytes)
+    {
+        return true;
+    }
+    context->batch_deadline = std::chrono::high_resolution_clock::time_point();
+    return false;
+}
+
+
+static void
+send_pipelined_accepts(
+    const Message& message,
+    std::shared_ptr<ProposerContext> context,
+    std::shared_ptr<Sender> sender)
+{
+    //
+    // Assign pending requested values to the next free root decrees in our
+    // window and send accepts for them under the already prepared ballot.
+    //
+    auto tail = context->ledger->Tail();
+    int next_root = std::max(tail.root_number,
+                             context->leader_decree.root_number);
+    if (!context->inflight_decrees.empty())
+    {
+        next_root = std::max(next_root,
+                             context->inflight_decrees.rbegin()->first);
+    }
+    if (!context->recovering_decrees.empty())
+    {
+        next_root = std::max(next_root,
+                             context->recovering_decrees.rbegin()->first);
+    }
+    next_root += 1;
+
+    while (!context->requested_values.empty() &&
+           next_root - tail.root_number <= context->pipeline_window)
+    {
+        auto value = take_requested_value(context);
+        Decree decree(
+            std::get<2>(value),
+            context->leader_decree.number,
+            std::get<0>(value),
+            std::get<1>(value));
+        decree.root_number = next_root;
+        context->inflight_decrees[next_root] = decree;
+
+        GlobalMetrics().accept_timer.Start(decree);
+        sender->ReplyAll(
+            Message(decree, message.to, message.to, MessageType::AcceptMessage));
+        next_root += 1;
+    }
+}
+
+
+static bool
+is_same_value(const Decree& lhs, const Decree& rhs)
+{
+    return IsReplicaEqual(lhs.author, rhs.author) &&
+           lhs.type == rhs.type &&
+           lhs.content == rhs.content;
+}
+
+
+static void
+recover_decrees(
+    const Message& message,
+    std::shared_ptr<ProposerContext> context)
+{
+    //
+    // A recovering value whose root has been written to the ledger was either
+    // chosen there or lost to another decree, and only a lost one is proposed
+    // again. A root already compacted into a snapshot can not be compared so
+    // its value is dropped rather than risk applying it twice.
+    //
+    std::vector<std::tuple<std::string, DecreeType, Replica>> lost;
+    auto tail_root_number = context->ledger->Tail().root_number;
+    while (!context->recovering_decrees.empty() &&
+           context->recovering_decrees.begin()->first <= tail_root_number)
+    {
+        const Decree& value = context->recovering_decrees.begin()->second;
+        Decree chosen = message.decree;
+        if (!IsRootDecreeEqual(chosen, value))
+        {
+            Decree previous;
+            previous.root_number = value.root_number - 1;
+            chosen = context->ledger->Next(previous);
+        }
+        if (IsRootDecreeEqual(chosen, value) && !is_same_value(chosen, value))
+        {
+            lost.push_back(
+                std::make_tuple(value.content, value.type, value.author));
+        }
+        context->recovering_decrees.erase(
+            context->recovering_decrees.begin());
+    }
+    for (auto it = lost.rbegin(); it != lost.rend(); ++it)
+    {
+        context->requested_values.push_front(*it);
+    }
+}
+
+
+static void
+step_down(std::shared_ptr<ProposerContext> context)
+{
+    //
+    // Our ballot was superseded. A quorum may already have chosen any of our
+    // pipelined values, so rather than proposing them again at new roots keep
+    // them for recovery at the roots they were sent for.
+    //
+    for (const auto& inflight : context->inflight_decrees)
+    {
+        context->recovering_decrees[inflight.first] = inflight.second;
+    }
+    context->inflight_decrees.clear();
+    context->is_leader = false;
+}
+
+
 void
 HandleRequest(
-    Message message,
+    const Message& message,
     std::shared_ptr<ProposerContext> context,
     std::shared_ptr<Sender> sender)
 {
     LOG(LogLevel::Info) << "HandleRequest | " << message.decree.number << "|"
-                        << Serialize(message);
+                        << message;
+
+    GlobalMetrics().requests.Add();
 
     std::lock_guard<std::mutex> lock(context->mutex);
 
@@ -114,6 +339,35 @@ HandleRequest(
                 message.decree.author));
     }
 
+    if (is_batch_pending(message, context, sender))
+    {
+        //
+        // Hold back the prepare while the batch is still filling up.
+        //
+        return;
+    }
+
+    if (context->is_leader)
+    {
+        //
+        // A stable leader has already prepared its ballot so it skips phase 1
+        // and issues accepts directly. An empty request is a nudge to flush
+        // stuck decrees so resend the accept blocking the head of our window.
+        //
+        auto head = context->inflight_decrees.find(
+            context->ledger->Tail().root_number + 1);
+        if (message.decree.content.empty() &&
+            head != context->inflight_decrees.end())
+        {
+            GlobalMetrics().accept_timer.Start(head->second);
+            sender->ReplyAll(
+                Message(head->second, message.to, message.to,
+                        MessageType::AcceptMessage));
+        }
+        send_pipelined_accepts(message, context, sender);
+        return;
+    }
+
     Message response = Response(message, MessageType::PrepareMessage);
     if (!context->ledger->IsEmpty() ||
         context->highest_proposed_decree.Value().number != 0)
@@ -137,8 +391,11 @@ HandleRequest(
     response.decree.author = message.to;
     response.decree.content = "";
 
-    if (context->requested_values.size() > 0)
+    if (context->requested_values.size() > 0 ||
+        !context->recovering_decrees.empty())
     {
+        GlobalMetrics().prepares.Add();
+        GlobalMetrics().prepare_timer.Start(response.decree);
         sender->ReplyAll(response);
     }
 }
@@ -146,15 +403,35 @@ HandleRequest(
 
 void
 HandlePromise(
-    Message message,
+    const Message& message,
     std::shared_ptr<ProposerContext> context,
     std::shared_ptr<Sender> sender)
 {
     LOG(LogLevel::Info) << "HandlePromise | " << message.decree.number << "|"
-                        << Serialize(message);
+                        << message;
+
+    GlobalMetrics().promises.Add();
 
     std::lock_guard<std::mutex> lock(context->mutex);
 
+    auto recovering = context->recovering_decrees.find(
+        message.decree.root_number);
+    if (recovering != context->recovering_decrees.end() &&
+        IsRootDecreeHigher(message.decree, context->ledger->Tail()) &&
+        is_same_value(message.decree, recovering->second))
+    {
+        //
+        // An acceptor returned its vote for one of our recovering values. A
+        // quorum may have chosen it without us learning it, so send the
+        // accept again at its root.
+        //
+        GlobalMetrics().accept_timer.Start(message.decree);
+        sender->ReplyAll(Response(message, MessageType::AcceptMessage));
+        return;
+    }
+
+    DecreeId decree_id(message.decree);
+
     auto highest_proposed_decree = context->highest_proposed_decree.Value();
 
     if (IsDecreeHigherOrEqual(message.decree, highest_proposed_decree) &&
@@ -178,6 +455,7 @@ HandlePromise(
             // in accept state. Therefore we should send accept on this decree
             // again and let propogate through to accepted.
             //
+            GlobalMetrics().accept_timer.Start(message.decree);
             sender->ReplyAll(Response(message, MessageType::AcceptMessage));
             return;
         }
@@ -195,30 +473,24 @@ HandlePromise(
         }
     }
 
-    if (context->promise_map.find(message.decree) == context->promise_map.end())
-    {
-        //
-        // If there is no entry for the messaged decree then make an entry.
-        //
-        context->promise_map[message.decree] = std::make_shared<ReplicaSet>();
-    }
+    //
+    // If there is no entry for the messaged decree then this makes an entry.
+    //
+    VoteSet& promises = context->promise_map[decree_id];
 
     if (IsDecreeIdentical(message.decree, highest_proposed_decree) &&
         IsRootDecreeOrdered(context->ledger->Tail(), message.decree))
     {
-        bool duplicate = context->promise_map[message.decree]
-                                ->Contains(message.from);
+        bool duplicate = promises.Contains(message.from, *context->replicaset);
         //
         // If the messaged decree is the highest promised decree then update
         // our promised decree map and calculate if majority of replicas have
         // sent promises for the decree.
         //
-        context->promise_map[message.decree]->Add(message.from);
+        promises.Add(message.from, *context->replicaset);
 
         int minimum_quorum = context->replicaset->GetSize() / 2 + 1;
-        int received_promises = context->promise_map[message.decree]
-                                       ->Intersection(context->replicaset)
-                                       ->GetSize();
+        int received_promises = promises.Count(*context->replicaset);
 
         //
         // If the messaged decree is a duplicate message allow a possible
@@ -227,8 +499,28 @@ HandlePromise(
         if (received_promises == minimum_quorum ||
             (received_promises >= minimum_quorum && duplicate))
         {
+            GlobalMetrics().prepare_timer.Stop(
+                message.decree, GlobalMetrics().prepare_promise_latency);
+
+            auto recovering = context->recovering_decrees.find(
+                highest_proposed_decree.root_number);
             if (highest_proposed_decree.content.empty() &&
-                !context->requested_values.empty())
+                recovering != context->recovering_decrees.end())
+            {
+                //
+                // A quorum promised our ballot without returning a vote for
+                // a recovering value at this root, so it was not chosen and
+                // is proposed again at the same root.
+                //
+                highest_proposed_decree.content = recovering->second.content;
+                highest_proposed_decree.type = recovering->second.type;
+                highest_proposed_decree.author = recovering->second.author;
+                context->recovering_decrees.erase(recovering);
+
+                context->highest_proposed_decree = highest_proposed_decree;
+            }
+            else if (highest_proposed_decree.content.empty() &&
+                     !context->requested_values.empty())
             {
                 //
                 // If the following are true...
@@ -240,22 +532,57 @@ HandlePromise(
                 // ... then we should update the highest proposed decree with
                 // the requested values.
                 //
-                highest_proposed_decree.content = std::get<0>(
-                    context->requested_values[0]);
-                highest_proposed_decree.type = std::get<1>(
-                    context->requested_values[0]);
-                highest_proposed_decree.author = std::get<2>(
-                    context->requested_values[0]);
+                auto value = take_requested_value(context);
+                highest_proposed_decree.content = std::get<0>(value);
+                highest_proposed_decree.type = std::get<1>(value);
+                highest_proposed_decree.author = std::get<2>(value);
 
                 context->highest_proposed_decree = highest_proposed_decree;
-                context->requested_values.erase(
-                    context->requested_values.begin());
             }
-            message.decree = context->highest_proposed_decree.Value();
+            Message accept = Response(message, MessageType::AcceptMessage);
+            accept.decree = context->highest_proposed_decree.Value();
+
+            if (!accept.decree.content.empty())
+            {
+                GlobalMetrics().accept_timer.Start(accept.decree);
+                sender->ReplyAll(accept);
+            }
 
-            if (!message.decree.content.empty())
+            if (context->pipeline_window > 1)
             {
-                sender->ReplyAll(Response(message, MessageType::AcceptMessage));
+                //
+                // A quorum promised our ballot so we become the stable leader
+                // and fill the rest of the window without further prepares.
+                //
+                context->is_leader = true;
+                context->leader_decree = accept.decree;
+
+                //
+                // Drive the remaining recovering values again at their own
+                // roots under the prepared ballot before the window is
+                // filled with new values.
+                //
+                auto tail_root_number = context->ledger->Tail().root_number;
+                for (auto it = context->recovering_decrees.begin();
+                     it != context->recovering_decrees.end();)
+                {
+                    if (it->first <= tail_root_number ||
+                        it->first == accept.decree.root_number)
+                    {
+                        ++it;
+                        continue;
+                    }
+                    Decree decree = it->second;
+                    decree.number = accept.decree.number;
+                    context->inflight_decrees[it->first] = decree;
+
+                    GlobalMetrics().accept_timer.Start(decree);
+                    sender->ReplyAll(
+                        Message(decree, message.to, message.to,
+                                MessageType::AcceptMessage));
+                    it = context->recovering_decrees.erase(it);
+                }
+                send_pipelined_accepts(message, context, sender);
             }
         }
     }
@@ -264,23 +591,27 @@ HandlePromise(
 
 void
 HandleNackTie(
-    Message message,
+    const Message& message,
     std::shared_ptr<ProposerContext> context,
     std::shared_ptr<Sender> sender)
 {
     LOG(LogLevel::Info) << "HandleNackTie | " << message.decree.number << "|"
-                        << Serialize(message);
+                        << message;
+
+    GlobalMetrics().nack_ties.Add();
 
     std::lock_guard<std::mutex> lock(context->mutex);
 
+    DecreeId decree_id(message.decree);
+
     auto tail_decree = context->ledger->Tail();
-    if (context->ntie_map.find(message.decree) == context->ntie_map.end() &&
+    if (context->ntie_map.find(decree_id) == context->ntie_map.end() &&
         IsRootDecreeHigher(message.decree, tail_decree) &&
         IsRootDecreeEqual(message.decree, context->highest_proposed_decree.Value()) &&
-        context->nacktie_time + context->interval < std::chrono::high_resolution_clock::now())
+        context->nacktie_time + context->interval < context->now())
     {
-        context->ntie_map.insert(message.decree);
-        context->nacktie_time = std::chrono::high_resolution_clock::now();
+        context->ntie_map.insert(decree_id);
+        context->nacktie_time = context->now();
 
         Message nack_response(
             message.decree,
@@ -311,6 +642,8 @@ HandleNackTie(
                 context->ledger->Tail().root_number + 1 == next.root_number)
             {
                 context->highest_proposed_decree = next;
+                GlobalMetrics().prepares.Add();
+                GlobalMetrics().prepare_timer.Start(nack_response.decree);
                 sender->ReplyAll(nack_response);
             }
         });
@@ -320,23 +653,32 @@ HandleNackTie(
 
 void
 HandleNack(
-    Message message,
+    const Message& message,
     std::shared_ptr<ProposerContext> context,
     std::shared_ptr<Sender> sender)
 {
     LOG(LogLevel::Info) << "HandleNack    | " << message.decree.number << "|"
-                        << Serialize(message);
+                        << message;
+
+    GlobalMetrics().nacks.Add();
 
     std::lock_guard<std::mutex> lock(context->mutex);
 
-    if (context->nprepare_map.find(message.decree) == context->nprepare_map.end())
+    DecreeId decree_id(message.decree);
+
+    auto& nacks = context->nprepare_map[decree_id];
+    if (std::get<1>(nacks) == false)
     {
-        context->nprepare_map[message.decree] = std::make_tuple(std::make_shared<ReplicaSet>(), false);
+        std::get<0>(nacks).Add(message.from, *context->replicaset);
     }
 
-    if (std::get<1>(context->nprepare_map[message.decree]) == false)
+    if (context->is_leader)
     {
-        std::get<0>(context->nprepare_map[message.decree])->Add(message.from);;
+        //
+        // An acceptor rejected one of our accepts so a higher ballot has been
+        // promised. Fall back to a full prepare round.
+        //
+        step_down(context);
     }
     sender->Reply(
         Message(
@@ -351,34 +693,67 @@ HandleNack(
 
 void
 HandleResume(
-    Message message,
+    const Message& message,
     std::shared_ptr<ProposerContext> context,
     std::shared_ptr<Sender> sender)
 {
     LOG(LogLevel::Info) << "HandleResume  | " << message.decree.number << "|"
-                        << Serialize(message);
+                        << message;
 
     std::lock_guard<std::mutex> lock(context->mutex);
 
-    if (context->promise_map.find(message.decree) != context->promise_map.end()
-        && context->promise_map[message.decree]
-                  ->Intersection(context->replicaset)
-                  ->GetSize() >= context->replicaset->GetSize())
+    DecreeId decree_id(message.decree);
+
+    auto promises = context->promise_map.find(decree_id);
+    if (promises != context->promise_map.end()
+        && promises->second.Count(*context->replicaset)
+               >= context->replicaset->GetSize())
     {
         //
         // If we have received an accepted message from every replica in the
         // replicaset for the given decree, then we are unlikely to receive
         // them again. Therefore we will reclaim memory.
         //
-        context->promise_map.erase(message.decree);
+        context->promise_map.erase(decree_id);
+    }
+
+    if (context->is_leader)
+    {
+        if (!IsReplicaEqual(message.decree.author, message.to))
+        {
+            //
+            // Another proposer passed a decree so acceptors have promised a
+            // ballot other than ours.
+            //
+            step_down(context);
+        }
+        else
+        {
+            //
+            // Learners may append several pipelined decrees at once when a
+            // hole is filled, so retire everything up to the ledger tail. A
+            // retired root may hold another decree, so it is checked like a
+            // recovering one.
+            //
+            auto tail_root_number = context->ledger->Tail().root_number;
+            while (!context->inflight_decrees.empty() &&
+                   context->inflight_decrees.begin()->first <= tail_root_number)
+            {
+                context->recovering_decrees.insert(
+                    *context->inflight_decrees.begin());
+                context->inflight_decrees.erase(
+                    context->inflight_decrees.begin());
+            }
+        }
     }
+    recover_decrees(message, context);
 
     auto highest_proposed_decree = context->highest_proposed_decree.Value();
     if (IsRootDecreeEqual(message.decree, highest_proposed_decree) &&
-        !context->resume_map.contains(message.decree) &&
+        !context->resume_map.contains(decree_id) &&
         highest_proposed_decree.content != message.decree.content &&
         !highest_proposed_decree.content.empty() &&
-        std::get<1>(context->nprepare_map[message.decree]) == false)
+        std::get<1>(context->nprepare_map[decree_id]) == false)
     {
         //
         // If the root decrees of messaged decree and highest_proposed_decree
@@ -389,8 +764,8 @@ HandleResume(
             std::make_tuple(highest_proposed_decree.content,
                             highest_proposed_decree.type,
                             highest_proposed_decree.author));
-        context->resume_map.insert(message.decree);
-        std::get<1>(context->nprepare_map[message.decree]) = true;
+        context->resume_map.insert(decree_id);
+        std::get<1>(context->nprepare_map[decree_id]) = true;
     }
 
     if (IsRootDecreeHigherOrEqual(message.decree, highest_proposed_decree) &&
@@ -425,26 +800,41 @@ HandleResume(
 
 void
 HandlePrepare(
-    Message message,
+    const Message& message,
     std::shared_ptr<AcceptorContext> context,
     std::shared_ptr<Sender> sender)
 {
     LOG(LogLevel::Info) << "HandlePrepare | " << message.decree.number << "|"
-                        << Serialize(message);
+                        << message;
 
     std::lock_guard<std::mutex> lock(context->mutex);
 
-    if (!context->accepted_decree.Value().content.empty() &&
+    auto accepted_decree = context->accepted_decree.Value();
+    auto votes = context->accepted_votes->From(message.decree.root_number);
+    if ((!accepted_decree.content.empty() || !votes.empty()) &&
         IsDecreeHigherOrEqual(message.decree, context->promised_decree.Value()))
     {
         //
-        // If there is a pending accepted decree then we must reply with a
-        // promise to the previous accepted decree otherwise we risk losing the
-        // decree.
+        // If there are pending accepted decrees then we must reply with a
+        // promise to each of them otherwise we risk losing a decree. A
+        // pipelining leader may have left votes for several roots, so those
+        // at or above the prepared root go out in root order followed by the
+        // accepted decree.
         //
         auto response = Response(message, MessageType::PromiseMessage);
-        response.decree = context->accepted_decree.Value();
-        sender->Reply(response);
+        for (const auto& vote : votes)
+        {
+            if (!IsRootDecreeEqual(vote, accepted_decree))
+            {
+                response.decree = vote;
+                sender->Reply(response);
+            }
+        }
+        if (!accepted_decree.content.empty())
+        {
+            response.decree = accepted_decree;
+            sender->Reply(response);
+        }
     } else if (
         IsDecreeHigher(message.decree, context->promised_decree.Value()) ||
         IsDecreeIdentical(message.decree, context->promised_decree.Value()))
@@ -494,18 +884,33 @@ HandlePrepare(
 
 void
 HandleAccept(
-    Message message,
+    const Message& message,
     std::shared_ptr<AcceptorContext> context,
     std::shared_ptr<Sender> sender)
 {
     LOG(LogLevel::Info) << "HandleAccept  | " << message.decree.number << "|"
-                        << Serialize(message);
+                        << message;
+
+    GlobalMetrics().accepts.Add();
 
     std::lock_guard<std::mutex> lock(context->mutex);
 
+    DecreeId decree_id(message.decree);
+
+    //
+    // A leader pipelining accepts may resend a root decree whose accept was
+    // lost after higher roots got through. As long as its ballot is still
+    // promised we vote for it; votes are kept per root so that promises
+    // return it next to the accepted decree.
+    //
+    bool is_behind =
+        IsRootDecreeLower(message.decree, context->accepted_decree.Value()) &&
+        CompareDecrees(message.decree, context->promised_decree.Value()) >= 0;
+
     if (IsRootDecreeHigher(message.decree, context->promised_decree.Value()) ||
         IsRootDecreeHigher(message.decree, context->accepted_decree.Value()) ||
-        IsDecreeIdentical(message.decree, context->accepted_decree.Value()))
+        IsDecreeIdentical(message.decree, context->accepted_decree.Value()) ||
+        is_behind)
     {
         if (IsRootDecreeHigher(message.decree, context->accepted_decree.Value()))
         {
@@ -514,21 +919,33 @@ HandleAccept(
             // we can update the accepted decree information and send the
             // accepted message.
             //
-            context->accepted_time = std::chrono::high_resolution_clock::now();
+            context->accepted_time = context->now();
             context->accepted_decree = message.decree;
-            context->accepted_set.insert(message.decree);
+            context->accepted_votes->Put(message.decree);
+            context->accepted_set.insert(decree_id);
+            sender->ReplyAll(Response(message, MessageType::AcceptedMessage));
+        }
+        else if (is_behind && !context->accepted_set.contains(decree_id))
+        {
+            //
+            // Vote for a root below the accepted decree without regressing
+            // the accepted decree.
+            //
+            context->accepted_votes->Put(message.decree);
+            context->accepted_set.insert(decree_id);
             sender->ReplyAll(Response(message, MessageType::AcceptedMessage));
         }
         else if (context->accepted_time + context->interval <
-                 std::chrono::high_resolution_clock::now() &&
-                 IsRootDecreeEqual(message.decree,
-                                   context->accepted_decree.Value()))
+                 context->now() &&
+                 (is_behind ||
+                  IsRootDecreeEqual(message.decree,
+                                    context->accepted_decree.Value())))
         {
             //
-            // If the messaged decree is equivalent to than current accepted
-            // decree then we throttle the sending of accepted message.
+            // If the messaged decree is a vote we already cast then we
+            // throttle the sending of accepted message.
             //
-            context->accepted_time = std::chrono::high_resolution_clock::now();
+            context->accepted_time = context->now();
             sender->ReplyAll(Response(message, MessageType::AcceptedMessage));
         }
     }
@@ -545,12 +962,12 @@ HandleAccept(
 
 void
 HandleCleanup(
-    Message message,
+    const Message& message,
     std::shared_ptr<AcceptorContext> context,
     std::shared_ptr<Sender> sender)
 {
     LOG(LogLevel::Info) << "HandleCleanup | " << message.decree.number << "|"
-                        << Serialize(message);
+                        << message;
 
     std::lock_guard<std::mutex> lock(context->mutex);
 
@@ -565,36 +982,50 @@ HandleCleanup(
         d.content = "";
         context->accepted_decree = d;
     }
+
+    //
+    // Votes up to the resumed root have been learned and need not be
+    // returned by promises any more.
+    //
+    context->accepted_votes->Retire(message.decree.root_number);
 }
 
 
 void
 HandleAccepted(
-    Message message,
+    const Message& message,
     std::shared_ptr<LearnerContext> context,
     std::shared_ptr<Sender> sender)
 {
     LOG(LogLevel::Info) << "HandleAccepted| " << message.decree.number << "|"
-                        << Serialize(message);
+                        << message;
+
+    GlobalMetrics().accepted.Add();
+
+    //
+    // Wait for the applier before taking the lock that handlers calling back
+    // into the parliament need.
+    //
+    context->ledger->WaitForCapacity();
 
     std::lock_guard<std::mutex> lock(context->mutex);
 
-    if (context->accepted_map.find(message.decree) == context->accepted_map.end())
-    {
-        context->accepted_map[message.decree] = std::make_shared<ReplicaSet>();
-    }
-    if (context->replicaset->Contains(message.from))
-    {
-        context->accepted_map[message.decree]->Add(message.from);
-    }
+    DecreeId decree_id(message.decree);
+
+    //
+    // Votes from replicas outside of our replica set are not recorded.
+    //
+    VoteSet& votes = context->accepted_map[decree_id];
+    votes.Add(message.from, *context->replicaset);
 
     int minimum_quorum = context->replicaset->GetSize() / 2 + 1;
-    int accepted_quorum = context->accepted_map[message.decree]
-                                 ->Intersection(context->replicaset)
-                                 ->GetSize();
+    int accepted_quorum = votes.Count(*context->replicaset);
 
     if (accepted_quorum >= minimum_quorum)
     {
+        GlobalMetrics().accept_timer.Stop(
+            message.decree, GlobalMetrics().accept_accepted_latency);
+
         if (IsRootDecreeOrdered(context->ledger->Tail(), message.decree)
             && !context->is_observer)
         {
@@ -684,19 +1115,21 @@ HandleAccepted(
         //
         // All votes for decree have been accounted for. Now clean up memory.
         //
-        context->accepted_map.erase(message.decree);
+        context->accepted_map.erase(decree_id);
     }
 }
 
 
 void
 HandleUpdated(
-    Message message,
+    const Message& message,
     std::shared_ptr<LearnerContext> context,
     std::shared_ptr<Sender> sender)
 {
     LOG(LogLevel::Info) << "HandleUpdated | " << message.decree.number << "|"
-                        << Serialize(message);
+                        << message;
+
+    context->ledger->WaitForCapacity();
 
     std::lock_guard<std::mutex> lock(context->mutex);
 
@@ -754,21 +1187,145 @@ HandleUpdated(
 }
 
 
+static void
+append_tracked_future_decrees(std::shared_ptr<LearnerContext> context)
+{
+    //
+    // Append tracked future decrees that continue the ledger and drop the ones
+    // the ledger has already moved past.
+    //
+    while (context->tracked_future_decrees.size() > 0)
+    {
+        Decree current_decree = context->tracked_future_decrees.top();
+
+        if (IsRootDecreeOrdered(context->ledger->Tail(), current_decree))
+        {
+            context->ledger->Append(current_decree);
+        }
+        else if (IsRootDecreeHigher(current_decree, context->ledger->Tail()))
+        {
+            break;
+        }
+        context->tracked_future_decrees.pop();
+    }
+}
+
+
+void
+HandleUpdatedRange(
+    const Message& message,
+    std::shared_ptr<LearnerContext> context,
+    std::shared_ptr<Sender> sender)
+{
+    LOG(LogLevel::Info) << "HandleUpdatedRange| " << message.decree.number;
+
+    context->ledger->WaitForCapacity();
+
+    std::lock_guard<std::mutex> lock(context->mutex);
+
+    Decree tail = context->ledger->Tail();
+    for (const Decree& decree :
+         BinaryDeserialize<std::vector<Decree>>(message.decree.content))
+    {
+        if (IsRootDecreeOrdered(context->ledger->Tail(), decree))
+        {
+            context->ledger->Append(decree);
+        }
+    }
+    append_tracked_future_decrees(context);
+
+    if (IsRootDecreeHigher(context->ledger->Tail(), tail))
+    {
+        //
+        // Pull the next run only after this one has been appended so that a
+        // lagging replica is never sent more than one window at a time.
+        //
+        Message response = Response(message, MessageType::UpdateMessage);
+        response.decree = context->ledger->Tail();
+        sender->Reply(response);
+    }
+}
+
+
+void
+HandleSnapshot(
+    const Message& message,
+    std::shared_ptr<LearnerContext> context,
+    std::shared_ptr<Sender> sender)
+{
+    LOG(LogLevel::Info) << "HandleSnapshot| " << message.decree.number;
+
+    std::lock_guard<std::mutex> lock(context->mutex);
+
+    if (!context->ledger->RestoreSnapshot(message.decree))
+    {
+        return;
+    }
+
+    //
+    // Future decrees covered by the snapshot are already reflected in the
+    // restored state. Append the ones that directly follow it.
+    //
+    append_tracked_future_decrees(context);
+
+    //
+    // Continue catching up from the end of the snapshot.
+    //
+    Message response = Response(message, MessageType::UpdateMessage);
+    response.decree = context->ledger->Tail();
+    sender->Reply(response);
+}
+
+
 void
 HandleUpdate(
-    Message message,
+    const Message& message,
     std::shared_ptr<UpdaterContext> context,
     std::shared_ptr<Sender> sender)
 {
     LOG(LogLevel::Info) << "HandleUpdate| " << message.decree.number << "|"
-                        << Serialize(message);
+                        << message;
 
     //
-    // Get the next logical ordered decree in our ledger. If we do not have the
-    // next logical decree then we get the zero decree.
+    // Get the run of logically ordered decrees following the replica's tail.
+    // If we do not have the next logical decree then we send the zero decree.
     //
-    message.decree = context->ledger->Next(message.decree);
-    sender->Reply(Response(message, MessageType::UpdatedMessage));
+    Message response = Response(message, MessageType::UpdatedMessage);
+    std::vector<Decree> range = context->ledger->Range(
+        message.decree,
+        std::max<size_t>(context->update_window_entries, 1),
+        context->update_window_bytes);
+
+    if (range.size() > 1)
+    {
+        //
+        // Stream a run of decrees in one reply rather than one round trip per
+        // decree.
+        //
+        response.type = MessageType::UpdatedRangeMessage;
+        response.decree = range.back();
+        response.decree.content = BinarySerialize(range);
+        sender->Reply(response);
+        return;
+    }
+
+    response.decree = range.empty() ? Decree() : range.front();
+    if (range.empty() &&
+        IsRootDecreeLower(message.decree, context->ledger->Tail()))
+    {
+        //
+        // The replica is behind our tail but we no longer hold its next
+        // decree, so the decrees must have been compacted into our snapshot.
+        // Ship the snapshot instead.
+        //
+        Decree snapshot = context->ledger->Snapshot();
+        if (IsRootDecreeLower(message.decree, snapshot))
+        {
+            response.type = MessageType::SnapshotMessage;
+            response.decree = snapshot;
+        }
+    }
+    sender->Reply(response);
 }
 
 
@@ -3,7 +3,6 @@
 
 #include <boost/asio/io_service.hpp>
 #include <boost/lambda/bind.hpp>
-#include <boost/lambda/lambda.hpp>
 
 
 namespace paxos
@@ -22,77 +21,219 @@ CreateHeader(size_t message_size)
 }
 
 
-BoostTransport::BoostTransport(std::string hostname, short port)
+BoostTransport::BoostTransport(std::string hostname,
+                               short port,
+                               size_t max_pending_bytes)
     : io_service_(),
+      work_(new boost::asio::io_service::work(io_service_)),
       socket_(io_service_),
       resolver_(io_service_),
-      timer_(io_service_)
+      timer_(io_service_),
+      pending_(),
+      pending_bytes_(0),
+      max_pending_bytes_(max_pending_bytes),
+      is_dropping_(false),
+      is_connected_(false),
+      is_connecting_(false),
+      is_writing_(false)
 {
     endpoint_ = resolver_.resolve({hostname, std::to_string(port)});
-    boost::system::error_code ec;
-    socket_.set_option(boost::asio::socket_base::reuse_address(true), ec);
-    socket_.set_option(boost::asio::socket_base::keep_alive(false), ec);
 
+    timer_.expires_at(boost::posix_time::pos_infin);
     check_deadline();
 
-    //
-    // Set up the variable that receives the result of the asynchronous
-    // operation. The error code is set to would_block to signal that the
-    // operation is incomplete. Asio guarantees that its asynchronous
-    // operations will never fail with would_block, so any other value in
-    // ec indicates completion.
-    //
-    ec = boost::asio::error::would_block;
-    boost::asio::async_connect(socket_, endpoint_,
-                               boost::lambda::var(ec) = boost::lambda::_1);
-    do io_service_.run_one(); while (ec == boost::asio::error::would_block);
+    io_service_.post([this]() { connect(); });
+    thread_ = std::thread([this]() { io_service_.run(); });
 }
 
 
 BoostTransport::~BoostTransport()
 {
-    socket_.close();
+    work_.reset();
+    io_service_.stop();
+    thread_.join();
+
+    boost::system::error_code ignored_ec;
+    socket_.close(ignored_ec);
 }
 
 
 void
 BoostTransport::Write(std::string content)
 {
-    timer_.expires_from_now(boost::posix_time::seconds(1));
-
-    try
     {
-        if (socket_.is_open())
-        {
-            auto header = CreateHeader(content.size());
-            boost::asio::write(socket_, boost::asio::buffer(header,
-                                                            header.size()));
+        std::lock_guard<std::mutex> lock(mutex_);
 
-            boost::asio::write(socket_, boost::asio::buffer(content.c_str(),
-                                                            content.size()));
-        }
-    }
-    catch (const boost::system::system_error& e)
-    {
-        LOG(LogLevel::Warning) << "Could not write to transport - " << e.what();
+        pending_bytes_ += content.size();
+        pending_.push_back(std::move(content));
 
         //
-        // Try to re-establish a connection.
+        // A peer that falls behind loses its oldest messages rather than
+        // growing the queue without bound. Paxos recovers from dropped
+        // messages the same way it does when the peer is unreachable.
         //
-        boost::system::error_code ec = boost::asio::error::would_block;
-        boost::asio::async_connect(socket_, endpoint_,
-                                   boost::lambda::var(ec) = boost::lambda::_1);
+        while (pending_bytes_ > max_pending_bytes_ && pending_.size() > 1)
+        {
+            if (!is_dropping_)
+            {
+                LOG(LogLevel::Warning) << "Transport queue full - "
+                                       << "dropping messages";
+                is_dropping_ = true;
+            }
+            pending_bytes_ -= pending_.front().size();
+            pending_.pop_front();
+            GlobalMetrics().messages_dropped.Add();
+        }
     }
+
+    io_service_.post([this]() { flush(); });
 }
 
 
-void
+bool
 BoostTransport::Read()
 {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        drained_.wait(lock, [this]()
+        {
+            return pending_.empty() && !is_writing_ && !is_connecting_;
+        });
+    }
+
     boost::system::error_code ec;
     std::vector<uint8_t> a_byte{0};
     boost::asio::read(socket_, boost::asio::buffer(a_byte),
                       boost::asio::transfer_exactly(1), ec);
+    return !ec && a_byte[0] == 1;
+}
+
+
+void
+BoostTransport::connect()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        is_connecting_ = true;
+    }
+
+    boost::system::error_code ignored_ec;
+    socket_.close(ignored_ec);
+
+    timer_.expires_from_now(boost::posix_time::seconds(1));
+    boost::asio::async_connect(socket_, endpoint_,
+        [this](const boost::system::error_code& ec,
+               boost::asio::ip::tcp::resolver::iterator)
+        {
+            timer_.expires_at(boost::posix_time::pos_infin);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                is_connecting_ = false;
+                is_connected_ = !ec;
+                if (ec)
+                {
+                    //
+                    // Messages for an unreachable peer are dropped. The next
+                    // write tries to connect again.
+                    //
+                    pending_.clear();
+                    pending_bytes_ = 0;
+                }
+            }
+
+            if (ec)
+            {
+                LOG(LogLevel::Warning) << "Could not connect transport - "
+                                       << ec.message();
+                drained_.notify_all();
+                return;
+            }
+
+            boost::system::error_code option_ec;
+            socket_.set_option(boost::asio::ip::tcp::no_delay(true), option_ec);
+            socket_.set_option(
+                boost::asio::socket_base::keep_alive(false), option_ec);
+            flush();
+        });
+}
+
+
+void
+BoostTransport::flush()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        if (is_writing_ || is_connecting_ || pending_.empty())
+        {
+            return;
+        }
+        if (!is_connected_)
+        {
+            lock.unlock();
+            connect();
+            return;
+        }
+        writing_.swap(pending_);
+        pending_bytes_ = 0;
+        is_writing_ = true;
+    }
+
+    //
+    // Gather every queued message with its length header into one write.
+    //
+    std::vector<boost::asio::const_buffer> buffers;
+    buffers.reserve(writing_.size() * 2);
+    headers_.clear();
+    headers_.reserve(writing_.size());
+    size_t bytes = 0;
+    for (const std::string& content : writing_)
+    {
+        headers_.push_back(CreateHeader(content.size()));
+        buffers.push_back(boost::asio::buffer(headers_.back()));
+        buffers.push_back(boost::asio::buffer(content));
+        bytes += headers_.back().size() + content.size();
+    }
+
+    //
+    // A large gathered write to a slow but healthy peer must not time out,
+    // so the deadline grows with the bytes written.
+    //
+    timer_.expires_from_now(boost::posix_time::milliseconds(
+        1000 + bytes * 1000 / TransportMinWriteRate));
+    boost::asio::async_write(socket_, buffers,
+        [this](const boost::system::error_code& ec, size_t)
+        {
+            timer_.expires_at(boost::posix_time::pos_infin);
+            if (ec)
+            {
+                LOG(LogLevel::Warning) << "Could not write to transport - "
+                                       << ec.message();
+                boost::system::error_code ignored_ec;
+                socket_.close(ignored_ec);
+            }
+
+            writing_.clear();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                is_writing_ = false;
+                if (ec)
+                {
+                    is_connected_ = false;
+                }
+                else
+                {
+                    is_dropping_ = false;
+                }
+            }
+            drained_.notify_all();
+
+            flush();
+        });
 }
 
 
@@ -1,5 +1,9 @@
+#include <algorithm>
+#include <chrono>
+
 #include <boost/make_shared.hpp>
 
+#include "paxos/metrics.hpp"
 #include "paxos/server.hpp"
 
 
@@ -21,7 +25,7 @@ SynchronousServer::SynchronousServer(std::string address, short port)
 
 void
 SynchronousServer::RegisterAction(
-    std::function<void(const std::string& content)> action_)
+    std::function<bool(const std::string& content)> action_)
 {
     action = action_;
 }
@@ -38,50 +42,77 @@ SynchronousServer::Start()
 void
 SynchronousServer::do_accept()
 {
+    //
+    // Every connection is served on its own thread so that a peer can send
+    // over several connections in parallel.
+    //
+    auto self(shared_from_this());
     for (;;)
     {
-        boost::asio::ip::tcp::socket socket(io_service);
-        acceptor.accept(socket);
+        auto socket = std::make_shared<boost::asio::ip::tcp::socket>(io_service);
+        boost::system::error_code ec;
+        acceptor.accept(*socket, ec);
+        if (ec)
+        {
+            continue;
+        }
+        std::thread([this, self, socket]() { serve(*socket); }).detach();
+    }
+}
+
 
+void
+SynchronousServer::serve(boost::asio::ip::tcp::socket& socket)
+{
+    //
+    // Serve messages until the peer closes the connection, so that a sender
+    // streaming many chunks pays for one connection.
+    //
+    for (;;)
+    {
+        boost::system::error_code ec;
         std::vector<uint8_t> read_buffer(HEADER_SIZE);
         boost::asio::read(socket, boost::asio::buffer(read_buffer),
-                          boost::asio::transfer_exactly(HEADER_SIZE));
+                          boost::asio::transfer_exactly(HEADER_SIZE), ec);
+        if (ec)
+        {
+            return;
+        }
 
-        int message_size = 0;
+        uint32_t message_size = 0;
         for (int i=0; i<HEADER_SIZE; i++)
         {
             message_size = message_size * 256 +
                            (static_cast<uint8_t>(read_buffer[i]) & 0xFF);
         }
 
-        std::string content;
-        read_buffer.resize(message_size);
-        while (message_size > 0)
+        std::string content(message_size, '\0');
+        boost::asio::read(socket,
+                          boost::asio::buffer(&content[0], message_size),
+                          boost::asio::transfer_exactly(message_size),
+                          ec);
+        if (ec)
         {
-            read_buffer.resize(message_size >= 1024 ? 1024 : message_size);
-
-            boost::system::error_code ec;
-            int read_bytes = boost::asio::read(
-                socket,
-                boost::asio::buffer(read_buffer),
-                boost::asio::transfer_exactly(message_size),
-                ec);
-            content += std::string(read_buffer.begin(), read_buffer.end());
-            message_size -= read_bytes;
+            return;
         }
 
-        action(content);
-
-        // signal done, syn-ack...
-        std::vector<uint8_t> a_byte{1};
+        std::vector<uint8_t> a_byte{static_cast<uint8_t>(action(content) ? 1 : 0)};
         boost::asio::write(socket, boost::asio::buffer(a_byte,
-                                                       a_byte.size()));
+                                                       a_byte.size()), ec);
+        if (ec)
+        {
+            return;
+        }
     }
 }
 
 
-AsynchronousServer::AsynchronousServer(std::string address, short port)
-    : io_service(),
+AsynchronousServer::AsynchronousServer(
+    std::string address,
+    short port,
+    size_t threads)
+    : threads(std::max<size_t>(threads, 1)),
+      io_service(),
       acceptor(
           io_service,
           tcp::endpoint(boost::asio::ip::address::from_string(address), port)),
@@ -111,7 +142,10 @@ AsynchronousServer::Start()
     // fully instatiated yet. As such, start is expected to be called shortly
     // after construction has finished.
     auto self(shared_from_this());
-    std::thread([this, self]() { io_service.run(); }).detach();
+    for (size_t i=0; i<threads; i++)
+    {
+        std::thread([this, self]() { io_service.run(); }).detach();
+    }
 }
 
 
@@ -151,8 +185,8 @@ AsynchronousServer::Session::Session(
 void
 AsynchronousServer::Session::Start()
 {
-    readbuf.resize(HEADER_SIZE);
-    boost::asio::async_read(socket, boost::asio::buffer(readbuf),
+    header.resize(HEADER_SIZE);
+    boost::asio::async_read(socket, boost::asio::buffer(header),
         boost::bind(&Session::handle_read_header, shared_from_this(),
             boost::asio::placeholders::error));
 }
@@ -168,7 +202,7 @@ AsynchronousServer::Session::handle_read_header(
         for (int i=0; i<HEADER_SIZE; i++)
         {
             message_size = message_size * 256 +
-                           (static_cast<uint8_t>(readbuf[i]) & 0xFF);
+                           (static_cast<uint8_t>(header[i]) & 0xFF);
         }
         handle_read_message(message_size);
     }
@@ -179,9 +213,9 @@ void
 AsynchronousServer::Session::handle_read_message(
     unsigned int message_size)
 {
-    readbuf.resize(HEADER_SIZE + message_size);
+    readbuf.resize(message_size);
     boost::asio::mutable_buffers_1 buf = boost::asio::buffer(
-        &readbuf[HEADER_SIZE], message_size);
+        &readbuf[0], message_size);
 
     boost::asio::async_read(socket, buf,
         boost::bind(&Session::handle_process_message, shared_from_this(),
@@ -195,9 +229,11 @@ AsynchronousServer::Session::handle_process_message(
 {
     if (!err)
     {
-        std::string content(readbuf.begin() + HEADER_SIZE, readbuf.end());
-
-        action(content);
+        auto start = std::chrono::steady_clock::now();
+        action(readbuf);
+        GlobalMetrics().messages_received.Add();
+        GlobalMetrics().bytes_received.Add(readbuf.size());
+        GlobalMetrics().receive_latency.Record(ElapsedMicroseconds(start));
         Start();
     }
 }
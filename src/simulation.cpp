@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <utility>
+
+#include "paxos/pause.hpp"
+#include "paxos/queue.hpp"
+#include "paxos/simulation.hpp"
+
+
+namespace paxos
+{
+
+
+SimulatedClock::SimulatedClock()
+    : events(),
+      now(0),
+      sequence(0)
+{
+}
+
+
+SimulatedClock::duration
+SimulatedClock::Now() const
+{
+    return now;
+}
+
+
+void
+SimulatedClock::Schedule(duration delay, std::function<void()> event)
+{
+    events.push(Event { now + delay, sequence++, std::move(event) });
+}
+
+
+bool
+SimulatedClock::Step()
+{
+    if (events.empty())
+    {
+        return false;
+    }
+
+    //
+    // The event is moved out before popping so that its action, which may
+    // hold a whole message, is not copied. Running it may schedule more
+    // events so it must be off the queue first.
+    //
+    Event event = std::move(const_cast<Event&>(events.top()));
+    events.pop();
+
+    now = event.time;
+    event.action();
+    return true;
+}
+
+
+void
+SimulatedClock::RunFor(duration period)
+{
+    duration end = now + period;
+    while (!events.empty() && events.top().time <= end)
+    {
+        Step();
+    }
+    now = end;
+}
+
+
+bool
+SimulatedClock::RunUntil(std::function<bool()> done, duration timeout)
+{
+    duration end = now + timeout;
+    while (!done())
+    {
+        if (events.empty() || events.top().time > end)
+        {
+            now = end;
+            return false;
+        }
+        Step();
+    }
+    return true;
+}
+
+
+size_t
+SimulatedClock::Pending() const
+{
+    return events.size();
+}
+
+
+SimulatedNetwork::SimulatedNetwork(
+    std::shared_ptr<SimulatedClock> clock,
+    NetworkConditions conditions,
+    uint32_t seed)
+    : clock(clock),
+      conditions(conditions),
+      random(seed),
+      receivers(),
+      partition(),
+      link_tails(),
+      delivered(0),
+      dropped(0)
+{
+}
+
+
+void
+SimulatedNetwork::Attach(
+    const Replica& replica,
+    std::shared_ptr<SimulatedReceiver> receiver)
+{
+    receivers[replica] = receiver;
+}
+
+
+void
+SimulatedNetwork::Send(const Message& message)
+{
+    auto found = receivers.find(message.to);
+    if (found == receivers.end())
+    {
+        dropped++;
+        return;
+    }
+
+    //
+    // Messages without a sender are generated by a replica for itself, such
+    // as the resume a learner sends its own proposer.
+    //
+    bool local = message.from.hostname.empty() ||
+                 IsReplicaEqual(message.from, message.to);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+    if (!local &&
+        (is_partitioned(message.from, message.to) ||
+         (conditions.loss > 0 && chance(random) < conditions.loss)))
+    {
+        dropped++;
+        return;
+    }
+
+    auto delay = conditions.latency;
+    if (conditions.jitter.count() > 0)
+    {
+        std::uniform_int_distribution<int64_t> jitter(
+            0, conditions.jitter.count());
+        delay += std::chrono::microseconds(jitter(random));
+    }
+
+    if (!local && conditions.reorder > 0 && chance(random) < conditions.reorder)
+    {
+        delay += conditions.reorder_delay;
+    }
+    else
+    {
+        //
+        // Links are FIFO like the TCP connections they stand in for, so
+        // jitter never lets a message overtake an earlier one on its link.
+        //
+        uint64_t link = (static_cast<uint64_t>(InternReplica(message.from)) << 32) |
+                        InternReplica(message.to);
+        auto& tail = link_tails[link];
+        tail = std::max(tail, clock->Now() + delay);
+        delay = tail - clock->Now();
+    }
+
+    auto receiver = found->second;
+    clock->Schedule(delay, [this, receiver, message]()
+    {
+        delivered++;
+        receiver->Deliver(message);
+    });
+}
+
+
+void
+SimulatedNetwork::SetConditions(NetworkConditions conditions_)
+{
+    conditions = conditions_;
+}
+
+
+void
+SimulatedNetwork::Partition(const std::vector<Replica>& side)
+{
+    partition.clear();
+    partition.insert(side.begin(), side.end());
+}
+
+
+void
+SimulatedNetwork::Heal()
+{
+    partition.clear();
+}
+
+
+uint64_t
+SimulatedNetwork::Delivered() const
+{
+    return delivered;
+}
+
+
+uint64_t
+SimulatedNetwork::Dropped() const
+{
+    return dropped;
+}
+
+
+bool
+SimulatedNetwork::is_partitioned(const Replica& from, const Replica& to) const
+{
+    return (partition.count(from) > 0) != (partition.count(to) > 0);
+}
+
+
+SimulatedSender::SimulatedSender(
+    std::shared_ptr<SimulatedNetwork> network,
+    std::shared_ptr<ReplicaSet>& replicaset)
+    : network(network),
+      replicaset(replicaset)
+{
+}
+
+
+void
+SimulatedSender::Reply(Message message)
+{
+    network->Send(message);
+}
+
+
+void
+SimulatedSender::ReplyAll(Message message)
+{
+    auto replicas = replicaset->Copy();
+    for (auto r : *replicas)
+    {
+        message.to = r;
+        network->Send(message);
+    }
+}
+
+
+SimulatedReceiver::SimulatedReceiver(std::shared_ptr<ReplicaSet>& replicaset)
+    : replicaset(replicaset),
+      callbacks()
+{
+}
+
+
+void
+SimulatedReceiver::RegisterCallback(Callback&& callback, MessageType type)
+{
+    size_t index = static_cast<size_t>(type);
+    if (index < MessageTypeCount)
+    {
+        callbacks[index].push_back(std::move(callback));
+    }
+}
+
+
+void
+SimulatedReceiver::Deliver(const Message& message)
+{
+    if (!replicaset->Contains(message.from) &&
+        !message.from.hostname.empty() && message.from.port != 0)
+    {
+        return;
+    }
+
+    size_t index = static_cast<size_t>(message.type);
+    if (index >= MessageTypeCount)
+    {
+        return;
+    }
+    for (const Callback& callback : callbacks[index])
+    {
+        callback(message);
+    }
+}
+
+
+SimulatedCluster::SimulatedCluster(
+    size_t replicas,
+    NetworkConditions conditions,
+    uint32_t seed,
+    AcceptHandler accept_handler,
+    std::chrono::microseconds flush_interval)
+    : clock(std::make_shared<SimulatedClock>()),
+      network(std::make_shared<SimulatedNetwork>(clock, conditions, seed)),
+      members(),
+      flush_interval(flush_interval)
+{
+    std::vector<Replica> legislators;
+    for (size_t i=0; i<replicas; i++)
+    {
+        legislators.emplace_back("replica" + std::to_string(i), 8080);
+    }
+
+    for (size_t i=0; i<replicas; i++)
+    {
+        std::unique_ptr<Member> member(new Member());
+        member->replica = legislators[i];
+        member->legislators = std::make_shared<ReplicaSet>();
+        for (const Replica& legislator : legislators)
+        {
+            member->legislators->Add(legislator);
+        }
+        member->ledger = std::make_shared<Ledger>(
+            std::make_shared<VolatileQueue<Decree>>());
+        member->ledger->RegisterHandler(
+            DecreeType::UserDecree,
+            std::make_shared<CompositeHandler>([accept_handler, i](std::string entry)
+            {
+                accept_handler(i, entry);
+            }));
+        member->signal = std::make_shared<Signal>();
+        member->receiver = std::make_shared<SimulatedReceiver>(
+            member->legislators);
+        member->sender = std::make_shared<SimulatedSender>(
+            network, member->legislators);
+
+        auto proposer = std::make_shared<ProposerContext>(
+            member->legislators,
+            member->ledger,
+            std::make_shared<VolatileDecree>(),
+            std::make_shared<NoPause>(),
+            member->signal);
+        auto acceptor = std::make_shared<AcceptorContext>(
+            std::make_shared<VolatileDecree>(),
+            std::make_shared<VolatileDecree>(),
+            std::make_shared<VolatileVotes>(),
+            std::chrono::milliseconds(1000));
+
+        //
+        // Resend throttles run on the virtual clock. The real clock barely
+        // moves during a simulation and would make runs depend on how fast
+        // the host is.
+        //
+        SimulatedClock* virtual_clock = clock.get();
+        auto now = [virtual_clock]()
+        {
+            return std::chrono::high_resolution_clock::time_point(
+                std::chrono::duration_cast<
+                    std::chrono::high_resolution_clock::duration>(
+                        virtual_clock->Now()));
+        };
+        proposer->now = now;
+        proposer->nacktie_time = now();
+        acceptor->now = now;
+        acceptor->accepted_time = now();
+
+        auto learner = std::make_shared<LearnerContext>(
+            member->legislators,
+            member->ledger);
+
+        member->parliament = std::make_shared<Parliament>(
+            member->replica,
+            member->legislators,
+            member->ledger,
+            member->receiver,
+            member->sender,
+            acceptor,
+            proposer,
+            learner);
+
+        network->Attach(member->replica, member->receiver);
+        members.push_back(std::move(member));
+    }
+
+    clock->Schedule(flush_interval, [this]() { flush(); });
+}
+
+
+size_t
+SimulatedCluster::Size() const
+{
+    return members.size();
+}
+
+
+Replica
+SimulatedCluster::GetReplica(size_t index) const
+{
+    return members.at(index)->replica;
+}
+
+
+Parliament&
+SimulatedCluster::GetParliament(size_t index)
+{
+    return *members.at(index)->parliament;
+}
+
+
+std::shared_ptr<Ledger>
+SimulatedCluster::GetLedger(size_t index)
+{
+    return members.at(index)->ledger;
+}
+
+
+SimulatedClock&
+SimulatedCluster::GetClock()
+{
+    return *clock;
+}
+
+
+SimulatedNetwork&
+SimulatedCluster::GetNetwork()
+{
+    return *network;
+}
+
+
+void
+SimulatedCluster::flush()
+{
+    for (auto& member : members)
+    {
+        member->parliament->SendProposal("");
+    }
+    clock->Schedule(flush_interval, [this]() { flush(); });
+}
+
+
+}
@@ -0,0 +1,228 @@
+#include <fstream>
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include "paxos/acceptorlog.hpp"
+
+
+class AcceptorLogTest : public testing::Test
+{
+public:
+
+    AcceptorLogTest()
+        : directory(boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path())
+    {
+    }
+
+    ~AcceptorLogTest()
+    {
+        boost::filesystem::remove_all(directory);
+    }
+
+    boost::filesystem::path directory;
+};
+
+
+TEST_F(AcceptorLogTest, testEmptyLogHasDefaultDecrees)
+{
+    paxos::AcceptorLog log(directory.string());
+
+    ASSERT_EQ(0, log.Get(paxos::AcceptorField::Promised).number);
+    ASSERT_EQ(0, log.Get(paxos::AcceptorField::Accepted).number);
+    ASSERT_EQ(0, log.Records());
+}
+
+
+TEST_F(AcceptorLogTest, testEachPutAppendsOneRecord)
+{
+    paxos::AcceptorLog log(directory.string());
+    log.Put(paxos::AcceptorField::Promised,
+            paxos::Decree(paxos::Replica("an_author"), 1, "", paxos::DecreeType::UserDecree));
+    log.Put(paxos::AcceptorField::Accepted,
+            paxos::Decree(paxos::Replica("an_author"), 1, "a_content", paxos::DecreeType::UserDecree));
+
+    ASSERT_EQ(2, log.Records());
+    ASSERT_EQ(1, log.Get(paxos::AcceptorField::Promised).number);
+    ASSERT_EQ("a_content", log.Get(paxos::AcceptorField::Accepted).content);
+}
+
+
+TEST_F(AcceptorLogTest, testLatestStateIsRecoveredOnReopen)
+{
+    {
+        paxos::AcceptorLog log(directory.string());
+        for (int i=1; i<=5; i++)
+        {
+            log.Put(paxos::AcceptorField::Promised,
+                    paxos::Decree(paxos::Replica("an_author"), i, "", paxos::DecreeType::UserDecree));
+        }
+        log.Put(paxos::AcceptorField::Accepted,
+                paxos::Decree(paxos::Replica("an_author"), 4, "a_content", paxos::DecreeType::UserDecree));
+    }
+
+    paxos::AcceptorLog log(directory.string());
+
+    ASSERT_EQ(5, log.Get(paxos::AcceptorField::Promised).number);
+    ASSERT_EQ(4, log.Get(paxos::AcceptorField::Accepted).number);
+    ASSERT_EQ("a_content", log.Get(paxos::AcceptorField::Accepted).content);
+}
+
+
+TEST_F(AcceptorLogTest, testTornRecordIsDiscardedOnReopen)
+{
+    {
+        paxos::AcceptorLog log(directory.string());
+        log.Put(paxos::AcceptorField::Promised,
+                paxos::Decree(paxos::Replica("an_author"), 1, "", paxos::DecreeType::UserDecree));
+        log.Put(paxos::AcceptorField::Promised,
+                paxos::Decree(paxos::Replica("an_author"), 2, "", paxos::DecreeType::UserDecree));
+    }
+    auto path = directory / paxos::ACCEPTOR_LOG_FILENAME;
+    boost::filesystem::resize_file(path, boost::filesystem::file_size(path) - 3);
+
+    {
+        paxos::AcceptorLog log(directory.string());
+
+        ASSERT_EQ(1, log.Get(paxos::AcceptorField::Promised).number);
+        ASSERT_EQ(1, log.Records());
+
+        log.Put(paxos::AcceptorField::Promised,
+                paxos::Decree(paxos::Replica("an_author"), 3, "", paxos::DecreeType::UserDecree));
+    }
+
+    paxos::AcceptorLog log(directory.string());
+
+    ASSERT_EQ(3, log.Get(paxos::AcceptorField::Promised).number);
+    ASSERT_EQ(2, log.Records());
+}
+
+
+TEST_F(AcceptorLogTest, testLogIsCompactedAfterCompactRecords)
+{
+    {
+        paxos::AcceptorLog log(directory.string(), "acceptor", 10);
+        for (int i=1; i<=25; i++)
+        {
+            log.Put(paxos::AcceptorField::Promised,
+                    paxos::Decree(paxos::Replica("an_author"), i, "", paxos::DecreeType::UserDecree));
+            log.Put(paxos::AcceptorField::Accepted,
+                    paxos::Decree(paxos::Replica("an_author"), i, "a_content", paxos::DecreeType::UserDecree));
+            log.Retire(i);
+            ASSERT_LT(log.Records(), 10);
+        }
+    }
+
+    paxos::AcceptorLog log(directory.string(), "acceptor", 10);
+
+    ASSERT_EQ(25, log.Get(paxos::AcceptorField::Promised).number);
+    ASSERT_EQ(25, log.Get(paxos::AcceptorField::Accepted).number);
+    ASSERT_FALSE(boost::filesystem::exists(directory / "acceptor.tmp"));
+}
+
+
+TEST_F(AcceptorLogTest, testVotesBelowAcceptedDecreeAreRecoveredOnReopen)
+{
+    paxos::Decree first(paxos::Replica("an_author"), 1, "first", paxos::DecreeType::UserDecree);
+    paxos::Decree second(paxos::Replica("an_author"), 1, "second", paxos::DecreeType::UserDecree);
+    second.root_number = 2;
+    paxos::Decree third(paxos::Replica("an_author"), 1, "third", paxos::DecreeType::UserDecree);
+    third.root_number = 3;
+    {
+        paxos::AcceptorLog log(directory.string());
+        log.Put(paxos::AcceptorField::Accepted, first);
+        log.Put(paxos::AcceptorField::Accepted, third);
+        log.Vote(second);
+        log.Vote(third);
+
+        ASSERT_EQ(3, log.Records());
+    }
+
+    paxos::AcceptorLog log(directory.string());
+
+    ASSERT_EQ("third", log.Get(paxos::AcceptorField::Accepted).content);
+    auto votes = log.Votes(2);
+    ASSERT_EQ(2, votes.size());
+    ASSERT_EQ("second", votes[0].content);
+    ASSERT_EQ("third", votes[1].content);
+    ASSERT_EQ(3, log.Votes(0).size());
+}
+
+
+TEST_F(AcceptorLogTest, testAcceptedDecreeWithoutContentRetiresVotes)
+{
+    paxos::Decree first(paxos::Replica("an_author"), 1, "first", paxos::DecreeType::UserDecree);
+    paxos::Decree second(paxos::Replica("an_author"), 1, "second", paxos::DecreeType::UserDecree);
+    second.root_number = 2;
+    paxos::Decree cleaned = second;
+    cleaned.content = "";
+    {
+        paxos::AcceptorLog log(directory.string());
+        log.Put(paxos::AcceptorField::Accepted, first);
+        log.Put(paxos::AcceptorField::Accepted, second);
+        log.Put(paxos::AcceptorField::Accepted, cleaned);
+
+        ASSERT_EQ(0, log.Votes(0).size());
+    }
+
+    paxos::AcceptorLog log(directory.string());
+
+    ASSERT_EQ(2, log.Get(paxos::AcceptorField::Accepted).root_number);
+    ASSERT_EQ("", log.Get(paxos::AcceptorField::Accepted).content);
+    ASSERT_EQ(0, log.Votes(0).size());
+}
+
+
+TEST_F(AcceptorLogTest, testCompactionKeepsVotesThatAreNotRetired)
+{
+    {
+        paxos::AcceptorLog log(directory.string(), "acceptor", 10);
+        for (int i=1; i<=25; i++)
+        {
+            log.Put(paxos::AcceptorField::Accepted,
+                    paxos::Decree(paxos::Replica("an_author"), i, "a_content", paxos::DecreeType::UserDecree));
+            log.Retire(i - 3);
+        }
+        log.Compact();
+    }
+
+    paxos::AcceptorLog log(directory.string(), "acceptor", 10);
+
+    auto votes = log.Votes(0);
+    ASSERT_EQ(3, votes.size());
+    ASSERT_EQ(23, votes[0].root_number);
+    ASSERT_EQ(25, log.Get(paxos::AcceptorField::Accepted).root_number);
+}
+
+
+TEST_F(AcceptorLogTest, testLoadReadsStateWithoutOpeningLog)
+{
+    paxos::AcceptorLog log(directory.string());
+    log.Put(paxos::AcceptorField::Accepted,
+            paxos::Decree(paxos::Replica("an_author"), 7, "a_content", paxos::DecreeType::UserDecree));
+
+    auto state = paxos::AcceptorLog::Load(directory.string());
+
+    ASSERT_EQ(7, state.accepted.number);
+    ASSERT_EQ("a_content", state.accepted.content);
+    ASSERT_EQ(0, state.promised.number);
+}
+
+
+TEST_F(AcceptorLogTest, testStorageExposesOneField)
+{
+    auto log = std::make_shared<paxos::AcceptorLog>(directory.string());
+    paxos::DecreeField promised(
+        std::make_shared<paxos::AcceptorLogStorage>(
+            log, paxos::AcceptorField::Promised));
+    paxos::DecreeField accepted(
+        std::make_shared<paxos::AcceptorLogStorage>(
+            log, paxos::AcceptorField::Accepted));
+
+    promised = paxos::Decree(paxos::Replica("an_author"), 2, "", paxos::DecreeType::UserDecree);
+
+    ASSERT_EQ(2, promised.Value().number);
+    ASSERT_EQ(0, accepted.Value().number);
+}
@@ -1,9 +1,14 @@
+#include <algorithm>
 #include <functional>
+#include <mutex>
 
 #include "gtest/gtest.h"
 
 #include "paxos/bootstrap.hpp"
+#include "paxos/ledger.hpp"
+#include "paxos/logging.hpp"
 #include "paxos/serialization.hpp"
+#include "paxos/wal.hpp"
 
 
 TEST(BootstrapTest, testBootstrapListenerRegistersAction)
@@ -105,3 +110,718 @@ TEST(BootstrapTest, testSendBootstrapLastFileSentIsActualReplicaSetFile)
     size_t index = sent_files.size() - 1;
     ASSERT_EQ("remote_directory/paxos.replicaset", sent_files[index].name);
 }
+
+
+TEST(BootstrapTest, testSendBootstrapSendsReplicatedFileContents)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    {
+        std::ofstream file((directory / "paxos.ledger").string());
+        file << "ledger contents";
+    }
+
+    std::vector<paxos::BootstrapFile> sent_files;
+    auto send_file = [&](paxos::BootstrapFile file)
+    {
+        sent_files.push_back(file);
+    };
+    paxos::SendBootstrap(
+        directory.string(),
+        "remote_directory",
+        std::vector<boost::filesystem::directory_entry>{
+            boost::filesystem::directory_entry(directory / "paxos.ledger")
+        },
+        send_file);
+
+    ASSERT_EQ("remote_directory/paxos.ledger", sent_files[2].name);
+    ASSERT_EQ("ledger contents", sent_files[2].content);
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testSendBootstrapSendsAcceptorLogAsDecreeFiles)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    {
+        paxos::AcceptorLog log(directory.string());
+        log.Put(paxos::AcceptorField::Promised,
+                paxos::Decree(paxos::Replica("an_author"), 3, "", paxos::DecreeType::UserDecree));
+        log.Put(paxos::AcceptorField::Accepted,
+                paxos::Decree(paxos::Replica("an_author"), 2, "a_content", paxos::DecreeType::UserDecree));
+    }
+
+    std::vector<paxos::BootstrapFile> sent_files;
+    auto send_file = [&](paxos::BootstrapFile file)
+    {
+        sent_files.push_back(file);
+    };
+    paxos::SendBootstrap(
+        directory.string(),
+        "remote_directory",
+        std::vector<boost::filesystem::directory_entry>{
+            boost::filesystem::directory_entry(
+                directory / paxos::ACCEPTOR_LOG_FILENAME)
+        },
+        send_file);
+
+    for (auto& file : sent_files)
+    {
+        ASSERT_NE("remote_directory/paxos.acceptor", file.name);
+    }
+    size_t index = sent_files.size() - 4;
+    ASSERT_EQ("remote_directory/paxos.promised_decree", sent_files[index].name);
+    ASSERT_EQ(3, paxos::Deserialize<paxos::Decree>(sent_files[index].content).number);
+    index = sent_files.size() - 2;
+    ASSERT_EQ("remote_directory/paxos.accepted_decree", sent_files[index].name);
+    ASSERT_EQ(2, paxos::Deserialize<paxos::Decree>(sent_files[index].content).number);
+    ASSERT_EQ("", paxos::Deserialize<paxos::Decree>(sent_files[index].content).content);
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testSendBootstrapSplitsReplicatedFilesIntoChunks)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    {
+        std::ofstream file((directory / "paxos.ledger").string());
+        file << "0123456789";
+    }
+
+    std::vector<paxos::BootstrapFile> sent_files;
+    auto send_file = [&](paxos::BootstrapFile file)
+    {
+        sent_files.push_back(file);
+    };
+    paxos::SendBootstrap(
+        directory.string(),
+        "remote_directory",
+        std::vector<boost::filesystem::directory_entry>{
+            boost::filesystem::directory_entry(directory / "paxos.ledger")
+        },
+        send_file,
+        4);
+
+    ASSERT_EQ("remote_directory/paxos.ledger", sent_files[2].name);
+    ASSERT_EQ("0123", sent_files[2].content);
+    ASSERT_EQ(0, sent_files[2].offset);
+    ASSERT_EQ("remote_directory/paxos.ledger", sent_files[3].name);
+    ASSERT_EQ("4567", sent_files[3].content);
+    ASSERT_EQ(4, sent_files[3].offset);
+    ASSERT_EQ("remote_directory/paxos.ledger", sent_files[4].name);
+    ASSERT_EQ("89", sent_files[4].content);
+    ASSERT_EQ(8, sent_files[4].offset);
+    ASSERT_EQ(paxos::BootstrapChecksum("89"), sent_files[4].checksum);
+    ASSERT_NE("remote_directory/paxos.ledger", sent_files[5].name);
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testSendBootstrapSendsEmptyReplicatedFileAsOneEmptyChunk)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    {
+        std::ofstream file((directory / "paxos.ledger").string());
+    }
+
+    std::vector<paxos::BootstrapFile> sent_files;
+    auto send_file = [&](paxos::BootstrapFile file)
+    {
+        sent_files.push_back(file);
+    };
+    paxos::SendBootstrap(
+        directory.string(),
+        "remote_directory",
+        std::vector<boost::filesystem::directory_entry>{
+            boost::filesystem::directory_entry(directory / "paxos.ledger")
+        },
+        send_file);
+
+    ASSERT_EQ("remote_directory/paxos.ledger", sent_files[2].name);
+    ASSERT_EQ("", sent_files[2].content);
+    ASSERT_NE("remote_directory/paxos.ledger", sent_files[3].name);
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testSendBootstrapDoesNotSendDiagnosticLog)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    {
+        std::ofstream log((directory / paxos::LogFilename).string());
+        log << "diagnostics";
+        std::ofstream wal((directory / "paxos.wal.head").string());
+        wal << "head";
+    }
+
+    std::vector<paxos::BootstrapFile> sent_files;
+    auto send_file = [&](paxos::BootstrapFile file)
+    {
+        sent_files.push_back(file);
+    };
+    paxos::SendBootstrap(
+        directory.string(),
+        "remote_directory",
+        std::vector<boost::filesystem::directory_entry>{
+            boost::filesystem::directory_entry(directory / paxos::LogFilename),
+            boost::filesystem::directory_entry(directory / "paxos.wal.head")
+        },
+        send_file);
+
+    bool is_log_sent = false;
+    bool is_wal_sent = false;
+    for (const auto& file : sent_files)
+    {
+        is_log_sent |= file.name == "remote_directory/" + paxos::LogFilename;
+        is_wal_sent |= file.name == "remote_directory/paxos.wal.head";
+    }
+    ASSERT_FALSE(is_log_sent);
+    ASSERT_TRUE(is_wal_sent);
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testBootstrapListenerWritesChunksAtTheirOffsets)
+{
+    static std::function<bool(std::string)> registered_action;
+
+    class MockServer
+    {
+    public:
+        MockServer(std::string address, short port)
+        {
+        }
+        void RegisterAction(std::function<bool(std::string content)> action)
+        {
+            registered_action = action;
+        }
+        void Start()
+        {
+        }
+    };
+
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    std::string name = (directory / "paxos.ledger").string();
+
+    auto legislators = std::make_shared<paxos::ReplicaSet>();
+    paxos::BootstrapListener<MockServer> listener(legislators, "my-address", 111);
+
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(name, "0123", 0))));
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(name, "4567", 4))));
+
+    //
+    // A chunk resent after a failure overwrites the same range.
+    //
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(name, "4567", 4))));
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(name, "89", 8))));
+
+    std::ifstream file(name);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    ASSERT_EQ("0123456789", contents.str());
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testBootstrapListenerRejectsCorruptChunk)
+{
+    static std::function<bool(std::string)> registered_action;
+
+    class MockServer
+    {
+    public:
+        MockServer(std::string address, short port)
+        {
+        }
+        void RegisterAction(std::function<bool(std::string content)> action)
+        {
+            registered_action = action;
+        }
+        void Start()
+        {
+        }
+    };
+
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    std::string name = (directory / "paxos.ledger").string();
+
+    auto legislators = std::make_shared<paxos::ReplicaSet>();
+    paxos::BootstrapListener<MockServer> listener(legislators, "my-address", 111);
+
+    paxos::BootstrapFile chunk(name, "0123", 0);
+    chunk.content = "0124";
+
+    ASSERT_FALSE(registered_action(paxos::Serialize(chunk)));
+    ASSERT_FALSE(boost::filesystem::exists(name));
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testSendBootstrapSendsManifestBeforeFiles)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    {
+        std::ofstream file((directory / "paxos.ledger").string());
+        file << "ledger contents";
+    }
+
+    std::vector<paxos::BootstrapFile> sent_files;
+    auto send_file = [&](paxos::BootstrapFile file)
+    {
+        sent_files.push_back(file);
+    };
+    paxos::SendBootstrap(
+        directory.string(),
+        "remote_directory",
+        std::vector<boost::filesystem::directory_entry>{
+            boost::filesystem::directory_entry(directory / "paxos.ledger")
+        },
+        send_file);
+
+    ASSERT_EQ("remote_directory/paxos.manifest", sent_files[1].name);
+    auto manifest = paxos::Deserialize<paxos::BootstrapManifest>(
+        sent_files[1].content);
+    ASSERT_EQ(4, manifest.files.size());
+    ASSERT_EQ("remote_directory/paxos.ledger", manifest.files[0].name);
+    ASSERT_EQ(15, manifest.files[0].size);
+    ASSERT_EQ(paxos::BootstrapChecksum("ledger contents"),
+              manifest.files[0].checksum);
+    ASSERT_EQ("remote_directory/paxos.promised_decree", manifest.files[1].name);
+    ASSERT_EQ("remote_directory/paxos.highest_proposed_decree",
+              manifest.files[2].name);
+    ASSERT_EQ("remote_directory/paxos.accepted_decree", manifest.files[3].name);
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testSendBootstrapSendsEveryChunkOverParallelStreams)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    std::string contents;
+    for (int i=0; i<1000; i++)
+    {
+        contents += std::to_string(i);
+    }
+    {
+        std::ofstream file((directory / "paxos.ledger").string());
+        file << contents;
+    }
+
+    std::mutex mutex;
+    std::vector<paxos::BootstrapFile> sent_files;
+    auto send_file = [&](paxos::BootstrapFile file)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sent_files.push_back(file);
+    };
+    paxos::SendBootstrap(
+        directory.string(),
+        "remote_directory",
+        std::vector<boost::filesystem::directory_entry>{
+            boost::filesystem::directory_entry(directory / "paxos.ledger")
+        },
+        send_file,
+        16,
+        4);
+
+    ASSERT_EQ("remote_directory/paxos.replicaset", sent_files.front().name);
+    ASSERT_EQ("", sent_files.front().content);
+    ASSERT_EQ("remote_directory/paxos.manifest", sent_files[1].name);
+    ASSERT_EQ("remote_directory/paxos.replicaset", sent_files.back().name);
+
+    std::string received(contents.size(), '\0');
+    size_t chunks = 0;
+    for (const auto& file : sent_files)
+    {
+        if (file.name == "remote_directory/paxos.ledger")
+        {
+            received.replace(file.offset, file.content.size(), file.content);
+            chunks++;
+        }
+    }
+    ASSERT_EQ((contents.size() + 15) / 16, chunks);
+    ASSERT_EQ(contents, received);
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testBootstrapListenerCommitsManifestFilesOnceAllVerify)
+{
+    static std::function<bool(std::string)> registered_action;
+
+    class MockServer
+    {
+    public:
+        MockServer(std::string address, short port)
+        {
+        }
+        void RegisterAction(std::function<bool(std::string content)> action)
+        {
+            registered_action = action;
+        }
+        void Start()
+        {
+        }
+    };
+
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    std::string ledger = (directory / "paxos.ledger").string();
+    std::string decree = (directory / "paxos.promised_decree").string();
+    std::string replicaset = (directory / "paxos.replicaset").string();
+
+    bool is_bootstrapped = false;
+    auto legislators = std::make_shared<paxos::ReplicaSet>();
+    paxos::BootstrapListener<MockServer> listener(
+        legislators, "my-address", 111, [&]() { is_bootstrapped = true; });
+
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(replicaset, ""))));
+
+    paxos::BootstrapManifest manifest;
+    manifest.files.emplace_back(
+        ledger, 10, paxos::BootstrapChecksum("0123456789"));
+    manifest.files.emplace_back(
+        decree, 6, paxos::BootstrapChecksum("decree"));
+    ASSERT_TRUE(registered_action(paxos::Serialize(paxos::BootstrapFile(
+        (directory / "paxos.manifest").string(),
+        paxos::Serialize(manifest)))));
+
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(ledger, "56789", 5))));
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(decree, "decree", 0))));
+
+    //
+    // The replica set is refused while the ledger is missing a chunk.
+    //
+    is_bootstrapped = false;
+    ASSERT_FALSE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(replicaset, "host:111\n"))));
+    ASSERT_FALSE(is_bootstrapped);
+    ASSERT_FALSE(boost::filesystem::exists(ledger));
+    ASSERT_FALSE(boost::filesystem::exists(decree));
+
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(ledger, "01234", 0))));
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(replicaset, "host:111\n"))));
+    ASSERT_TRUE(is_bootstrapped);
+    ASSERT_EQ(1, legislators->GetSize());
+
+    std::ifstream file(ledger);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    ASSERT_EQ("0123456789", contents.str());
+    ASSERT_TRUE(boost::filesystem::exists(decree));
+    ASSERT_FALSE(boost::filesystem::exists(ledger + ".partial"));
+    ASSERT_FALSE(boost::filesystem::exists(decree + ".partial"));
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testRecoverBootstrapRollsForwardAnInterruptedCommit)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    std::string ledger = (directory / "paxos.ledger").string();
+    std::string decree = (directory / "paxos.promised_decree").string();
+    std::string replicaset = (directory / "paxos.replicaset").string();
+
+    //
+    // The ledger was renamed into place before the crash, the decree and the
+    // replica set were not.
+    //
+    std::ofstream(ledger) << "new ledger";
+    std::ofstream(decree) << "old decree";
+    std::ofstream(decree + ".partial") << "new decree";
+    std::ofstream(replicaset) << "";
+    std::ofstream(replicaset + ".partial") << "host:111\n";
+
+    paxos::RecoverBootstrap(directory.string());
+
+    std::stringstream contents;
+    contents << std::ifstream(decree).rdbuf();
+    ASSERT_EQ("new decree", contents.str());
+    ASSERT_EQ(1, paxos::LoadReplicaSet(std::ifstream(replicaset))->GetSize());
+    ASSERT_FALSE(boost::filesystem::exists(decree + ".partial"));
+    ASSERT_FALSE(boost::filesystem::exists(replicaset + ".partial"));
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testRecoverBootstrapDiscardsAnUncommittedBootstrap)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    std::string decree = (directory / "paxos.promised_decree").string();
+
+    std::ofstream(decree) << "old decree";
+    std::ofstream(decree + ".partial") << "new";
+
+    paxos::RecoverBootstrap(directory.string());
+
+    std::stringstream contents;
+    contents << std::ifstream(decree).rdbuf();
+    ASSERT_EQ("old decree", contents.str());
+    ASSERT_FALSE(boost::filesystem::exists(decree + ".partial"));
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testSendBootstrapSkipsChunksTheReplicaAlreadyHolds)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    {
+        std::ofstream file((directory / "paxos.ledger").string());
+        file << "0123456789";
+    }
+
+    std::vector<paxos::BootstrapFile> sent_files;
+    auto send_file = [&](paxos::BootstrapFile file)
+    {
+        sent_files.push_back(file);
+    };
+    std::vector<paxos::BootstrapFile> probes;
+    auto probe_file = [&](paxos::BootstrapFile probe)
+    {
+        probes.push_back(probe);
+        return probe.offset == 0;
+    };
+    paxos::SendBootstrap(
+        directory.string(),
+        "remote_directory",
+        std::vector<boost::filesystem::directory_entry>{
+            boost::filesystem::directory_entry(directory / "paxos.ledger")
+        },
+        send_file,
+        4,
+        1,
+        probe_file);
+
+    ASSERT_EQ(3, probes.size());
+    ASSERT_EQ("remote_directory/paxos.ledger", probes[0].name);
+    ASSERT_EQ("", probes[0].content);
+    ASSERT_EQ(4, probes[0].probe);
+    ASSERT_EQ(paxos::BootstrapChecksum("0123"), probes[0].checksum);
+    ASSERT_EQ(2, probes[2].probe);
+
+    ASSERT_EQ("remote_directory/paxos.ledger", sent_files[2].name);
+    ASSERT_EQ("4567", sent_files[2].content);
+    ASSERT_EQ("remote_directory/paxos.ledger", sent_files[3].name);
+    ASSERT_EQ("89", sent_files[3].content);
+    ASSERT_NE("remote_directory/paxos.ledger", sent_files[4].name);
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testBootstrapListenerReusesChunksAlreadyOnDisk)
+{
+    static std::function<bool(std::string)> registered_action;
+
+    class MockServer
+    {
+    public:
+        MockServer(std::string address, short port)
+        {
+        }
+        void RegisterAction(std::function<bool(std::string content)> action)
+        {
+            registered_action = action;
+        }
+        void Start()
+        {
+        }
+    };
+
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    std::string ledger = (directory / "paxos.ledger").string();
+    std::string replicaset = (directory / "paxos.replicaset").string();
+    {
+        std::ofstream file(ledger);
+        file << "0123xxxx";
+    }
+
+    auto legislators = std::make_shared<paxos::ReplicaSet>();
+    paxos::BootstrapListener<MockServer> listener(legislators, "my-address", 111);
+
+    auto probe = [](std::string name, uint64_t offset, std::string content)
+    {
+        paxos::BootstrapFile probe(name, "", offset);
+        probe.checksum = paxos::BootstrapChecksum(content);
+        probe.probe = content.size();
+        return paxos::Serialize(probe);
+    };
+
+    //
+    // Without a manifest there is nothing to stage the reused bytes into.
+    //
+    ASSERT_FALSE(registered_action(probe(ledger, 0, "0123")));
+
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(replicaset, ""))));
+    paxos::BootstrapManifest manifest;
+    manifest.files.emplace_back(
+        ledger, 12, paxos::BootstrapChecksum("0123456789AB"));
+    ASSERT_TRUE(registered_action(paxos::Serialize(paxos::BootstrapFile(
+        (directory / "paxos.manifest").string(),
+        paxos::Serialize(manifest)))));
+
+    ASSERT_TRUE(registered_action(probe(ledger, 0, "0123")));
+    ASSERT_FALSE(registered_action(probe(ledger, 4, "4567")));
+    ASSERT_FALSE(registered_action(probe(ledger, 8, "89AB")));
+
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(ledger, "4567", 4))));
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(ledger, "89AB", 8))));
+    ASSERT_TRUE(registered_action(
+        paxos::Serialize(paxos::BootstrapFile(replicaset, "host:111\n"))));
+
+    std::ifstream file(ledger);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    ASSERT_EQ("0123456789AB", contents.str());
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(BootstrapTest, testBootstrapReloadsAnOpenLedger)
+{
+    static std::function<bool(std::string)> registered_action;
+
+    class MockServer
+    {
+    public:
+        MockServer(std::string address, short port)
+        {
+        }
+        void RegisterAction(std::function<bool(std::string content)> action)
+        {
+            registered_action = action;
+        }
+        void Start()
+        {
+        }
+    };
+
+    auto open_ledger = [](boost::filesystem::path directory)
+    {
+        //
+        // Segments this small hold a single decree each.
+        //
+        auto ledger = std::make_shared<paxos::Ledger>(
+            std::make_shared<paxos::WriteAheadLog<paxos::Decree>>(
+                directory.string(),
+                paxos::LEDGER_LOG_FILENAME,
+                paxos::SyncPolicy::Always,
+                std::chrono::milliseconds(100),
+                16),
+            std::make_shared<paxos::EmptyDecreeHandler>(),
+            std::make_shared<paxos::PersistentDecree>(
+                directory.string(), paxos::SNAPSHOT_FILENAME));
+        ledger->RegisterSnapshotHandler(
+            std::make_shared<paxos::CallbackSnapshotHandler>(
+                []() { return "state"; },
+                [](std::string snapshot) {}));
+        return ledger;
+    };
+
+    auto source = boost::filesystem::temp_directory_path() /
+                  boost::filesystem::unique_path();
+    auto target = boost::filesystem::temp_directory_path() /
+                  boost::filesystem::unique_path();
+    boost::filesystem::create_directories(source);
+    boost::filesystem::create_directories(target);
+    {
+        auto ledger = open_ledger(source);
+        ledger->Append(paxos::Decree(paxos::Replica("an_author"), 1, "a", paxos::DecreeType::UserDecree));
+        ledger->Append(paxos::Decree(paxos::Replica("an_author"), 2, "b", paxos::DecreeType::UserDecree));
+        ledger->TakeSnapshot();
+        ledger->Append(paxos::Decree(paxos::Replica("an_author"), 3, "c", paxos::DecreeType::UserDecree));
+        ledger->Append(paxos::Decree(paxos::Replica("an_author"), 4, "d", paxos::DecreeType::UserDecree));
+    }
+    {
+        std::ofstream file((source / paxos::ReplicasetFilename).string());
+        file << "host:111\n";
+    }
+
+    auto ledger = open_ledger(target);
+    for (int i=1; i<=3; i++)
+    {
+        ledger->Append(paxos::Decree(paxos::Replica("an_author"), i, "stale", paxos::DecreeType::UserDecree));
+    }
+
+    auto legislators = std::make_shared<paxos::ReplicaSet>();
+    paxos::BootstrapListener<MockServer> listener(
+        legislators, "my-address", 111, [&]() { ledger->Reload(); });
+
+    std::vector<boost::filesystem::directory_entry> files(
+        (boost::filesystem::directory_iterator(source)),
+        boost::filesystem::directory_iterator());
+    paxos::SendBootstrap(
+        source.string(),
+        target.string(),
+        files,
+        [](paxos::BootstrapFile file)
+        {
+            registered_action(paxos::Serialize(file));
+        });
+
+    ASSERT_EQ("c", ledger->Head().content);
+    ASSERT_EQ("d", ledger->Tail().content);
+    ASSERT_EQ(2, ledger->Snapshot().root_number);
+    ASSERT_EQ("state", ledger->Snapshot().content);
+
+    // Later decrees go to the files the bootstrap wrote.
+    ledger->Append(paxos::Decree(paxos::Replica("an_author"), 5, "e", paxos::DecreeType::UserDecree));
+    ledger.reset();
+    ledger = open_ledger(target);
+    ASSERT_EQ("c", ledger->Head().content);
+    ASSERT_EQ("e", ledger->Tail().content);
+
+    ledger.reset();
+    boost::filesystem::remove_all(source);
+    boost::filesystem::remove_all(target);
+}
@@ -16,6 +16,8 @@ TEST(MessageTest, testMessageTypeHashFunction)
     ASSERT_EQ(8, std::hash<paxos::MessageType>{}(paxos::MessageType::ResumeMessage));
     ASSERT_EQ(9, std::hash<paxos::MessageType>{}(paxos::MessageType::UpdateMessage));
     ASSERT_EQ(10, std::hash<paxos::MessageType>{}(paxos::MessageType::UpdatedMessage));
+    ASSERT_EQ(11, std::hash<paxos::MessageType>{}(paxos::MessageType::SnapshotMessage));
+    ASSERT_EQ(12, std::hash<paxos::MessageType>{}(paxos::MessageType::UpdatedRangeMessage));
 }
 
 
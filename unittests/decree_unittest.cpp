@@ -365,3 +365,24 @@ TEST(DecreeUnitTest, testCompareMapDecreeUsingKeyWithSameNumberButDiffeerntAutho
     ASSERT_TRUE(compare_map.find(decree_with_author_a) != compare_map.end());
     ASSERT_TRUE(compare_map.find(decree_with_author_b) == compare_map.end());
 }
+
+
+TEST(DecreeUnitTest, testDecreeIdIgnoresContent)
+{
+    paxos::DecreeId lhs(paxos::Decree(paxos::Replica("host", 80), 2, "lhs", paxos::DecreeType::UserDecree));
+    paxos::DecreeId rhs(paxos::Decree(paxos::Replica("host", 80), 2, "rhs", paxos::DecreeType::UserDecree));
+
+    ASSERT_TRUE(paxos::equal_map_decree()(lhs, rhs));
+    ASSERT_EQ(paxos::hash_map_decree()(lhs), paxos::hash_map_decree()(rhs));
+}
+
+
+TEST(DecreeUnitTest, testDecreeIdDistinguishesAuthors)
+{
+    paxos::DecreeId lhs(paxos::Decree(paxos::Replica("host", 80), 2, "", paxos::DecreeType::UserDecree));
+    paxos::DecreeId rhs(paxos::Decree(paxos::Replica("host", 81), 2, "", paxos::DecreeType::UserDecree));
+
+    ASSERT_FALSE(paxos::equal_map_decree()(lhs, rhs));
+    ASSERT_TRUE(paxos::equal_decree()(lhs, rhs));
+    ASSERT_TRUE(IsReplicaEqual(paxos::Replica("host", 81), paxos::InternedReplica(rhs.author)));
+}
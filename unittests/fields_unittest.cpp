@@ -90,3 +90,66 @@ TEST(FieldsTest, testCanUpdateValueOfPersistentStorageField)
 
     ASSERT_EQ(field.Value(), 3);
 }
+
+
+TEST(FieldsTest, testDurableStorageValueSurvivesReopen)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    {
+        paxos::DurableStorage<int> storage(directory.string(), "a_field");
+        ASSERT_EQ(0, storage.Get());
+        storage.Put(12345);
+        storage.Put(7);
+    }
+
+    paxos::DurableStorage<int> storage(directory.string(), "a_field");
+    ASSERT_EQ(7, storage.Get());
+    ASSERT_FALSE(boost::filesystem::exists(directory / "a_field.tmp"));
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(FieldsTest, testCachedStorageReadsUnderlyingStorageOnce)
+{
+    struct CountingStorage : public paxos::Storage<int>
+    {
+        int Get() { gets += 1; return data; }
+        void Put(int value) { puts += 1; data = value; }
+        int data = 3;
+        int gets = 0;
+        int puts = 0;
+    };
+
+    auto underlying = std::make_shared<CountingStorage>();
+    paxos::Field<int> field(
+        std::make_shared<paxos::CachedStorage<int>>(underlying));
+    ASSERT_EQ(3, field.Value());
+    field = 5;
+    ASSERT_EQ(5, field.Value());
+    ASSERT_EQ(5, field.Value());
+
+    ASSERT_EQ(1, underlying->gets);
+    ASSERT_EQ(1, underlying->puts);
+    ASSERT_EQ(5, underlying->data);
+}
+
+
+TEST(FieldsTest, testCachedStorageReloadPicksUpReplacedFile)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+
+    paxos::CachedStorage<int> cached(directory.string(), "a_field");
+    cached.Put(1);
+    paxos::DurableStorage<int>(directory.string(), "a_field").Put(2);
+    ASSERT_EQ(1, cached.Get());
+
+    cached.Reload();
+    ASSERT_EQ(2, cached.Get());
+
+    boost::filesystem::remove_all(directory);
+}
@@ -1,4 +1,9 @@
+#include <condition_variable>
+#include <fstream>
 #include <functional>
+#include <mutex>
+
+#include <boost/filesystem.hpp>
 
 #include "gtest/gtest.h"
 
@@ -74,6 +79,94 @@ TEST(HandlerTest, testHandleAddReplicaSavesNewReplicaSet)
 }
 
 
+TEST(HandlerTest, testHandleAddReplicaBootstrapsOffTheHandlerPath)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    {
+        std::ofstream file((directory / "paxos.snapshot").string());
+        file << "before";
+    }
+    std::string segment = "paxos.wal.00000000000000000000";
+    {
+        std::ofstream file((directory / segment).string());
+        file << "before";
+    }
+
+    auto replica = paxos::Replica("myhost", 8080);
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(replica);
+    auto signal = std::make_shared<paxos::Signal>();
+
+    std::mutex mutex;
+    std::condition_variable released;
+    bool is_released = false;
+    std::string staged;
+    std::string staged_log;
+    {
+        paxos::HandleAddReplica handler(
+            directory.string(),
+            replica,
+            replicaset,
+            signal,
+            [](std::shared_ptr<paxos::ReplicaSet>, std::ostream&) {},
+            [&](std::string staging, paxos::UpdateReplicaSetDecree decree)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                released.wait(lock, [&]() { return is_released; });
+
+                std::ifstream file(
+                    (boost::filesystem::path(staging) / "paxos.snapshot").string());
+                file >> staged;
+                std::ifstream log(
+                    (boost::filesystem::path(staging) / segment).string());
+                log >> staged_log;
+                return true;
+            }
+        );
+        handler(
+            paxos::Serialize<paxos::UpdateReplicaSetDecree>(
+                {
+                    replica,                          // author
+                    paxos::Replica("yourhost", 8080), // replica
+                    "remote_directory"
+                }
+            )
+        );
+
+        // The handler returned while the bootstrap is still running, and
+        // files replaced or appended to from now on do not change what it
+        // sends.
+        boost::filesystem::rename(directory / "paxos.snapshot",
+                                  directory / "old");
+        {
+            std::ofstream file((directory / "paxos.snapshot").string());
+            file << "after";
+        }
+        {
+            std::ofstream file((directory / segment).string(),
+                               std::ios::app);
+            file << "after";
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            is_released = true;
+        }
+        released.notify_all();
+
+        ASSERT_TRUE(signal->Wait());
+    }
+
+    ASSERT_EQ("before", staged);
+    ASSERT_EQ("before", staged_log);
+    ASSERT_EQ(4, std::distance(boost::filesystem::directory_iterator(directory),
+                               boost::filesystem::directory_iterator()));
+
+    boost::filesystem::remove_all(directory);
+}
+
+
 TEST(HandlerTest, testHandleRemoveReplicaSavesNewReplicaSet)
 {
     auto replica = paxos::Replica("myhost", 8080);
@@ -1,6 +1,15 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
 #include "gtest/gtest.h"
 
 #include "paxos/ledger.hpp"
+#include "paxos/wal.hpp"
 
 
 class LedgerUnitTest: public testing::Test
@@ -272,3 +281,597 @@ TEST_F(LedgerUnitTest, testRegisteredDecreeHandlerExecuted)
 
     ASSERT_TRUE(handler->is_executed);
 }
+
+
+TEST_F(LedgerUnitTest, testBatchDecreeHandlerExecutedForEachEntryInOrder)
+{
+    std::vector<std::string> entries;
+    auto handler = [&](std::string entry) { entries.push_back(entry); };
+
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    paxos::Ledger ledger(
+        queue,
+        std::make_shared<paxos::CompositeHandler>(handler));
+    ledger.Append(paxos::Decree(paxos::Replica("a_author"), 1, "AAAAA", paxos::DecreeType::UserDecree));
+    ledger.Append(
+        paxos::Decree(
+            paxos::Replica("a_author"),
+            2,
+            paxos::BinarySerialize(std::vector<std::string> { "BBBBB", "CCCCC" }),
+            paxos::DecreeType::BatchDecree));
+
+    ASSERT_EQ(GetQueueSize(queue), 2);
+    ASSERT_EQ(std::vector<std::string>({ "AAAAA", "BBBBB", "CCCCC" }), entries);
+}
+
+
+TEST_F(LedgerUnitTest, testDecreeHandlerRunsOnlyAfterTheLedgerSyncs)
+{
+    class CountingQueue : public paxos::VolatileQueue<paxos::Decree>
+    {
+    public:
+
+        CountingQueue()
+            : syncs(0)
+        {
+        }
+
+        virtual void Sync() override
+        {
+            syncs++;
+        }
+
+        int syncs;
+    };
+
+    auto queue = std::make_shared<CountingQueue>();
+    std::vector<int> syncs_seen;
+    auto handler = [&](std::string entry) { syncs_seen.push_back(queue->syncs); };
+
+    paxos::Ledger ledger(
+        queue,
+        std::make_shared<paxos::CompositeHandler>(handler));
+    ledger.Append(paxos::Decree(paxos::Replica("a_author"), 1, "AAAAA", paxos::DecreeType::UserDecree));
+    ledger.Append(paxos::Decree(paxos::Replica("a_author"), 2, "BBBBB", paxos::DecreeType::UserDecree));
+
+    ASSERT_EQ(std::vector<int>({ 1, 2 }), syncs_seen);
+}
+
+
+TEST_F(LedgerUnitTest, testNextWithLastDecreeReturnsDefaultDecree)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    paxos::Ledger ledger(queue);
+    ledger.Append(paxos::Decree(paxos::Replica("a_author"), 1, "a_content", paxos::DecreeType::UserDecree));
+    ledger.Append(paxos::Decree(paxos::Replica("b_author"), 2, "b_content", paxos::DecreeType::UserDecree));
+
+    paxos::Decree expected, actual = ledger.Next(ledger.Tail());
+
+    ASSERT_EQ(expected.number, actual.number);
+    ASSERT_EQ(expected.content, actual.content);
+}
+
+
+TEST_F(LedgerUnitTest, testHeadAndNextAfterRemove)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    paxos::Ledger ledger(queue);
+    ledger.Append(paxos::Decree(paxos::Replica("a_author"), 1, "a_content", paxos::DecreeType::UserDecree));
+    ledger.Append(paxos::Decree(paxos::Replica("b_author"), 2, "b_content", paxos::DecreeType::UserDecree));
+    ledger.Append(paxos::Decree(paxos::Replica("c_author"), 3, "c_content", paxos::DecreeType::UserDecree));
+    ledger.Remove();
+
+    ASSERT_EQ("b_content", ledger.Head().content);
+    ASSERT_EQ("c_content", ledger.Next(ledger.Head()).content);
+    ASSERT_EQ("", ledger.Next(paxos::Decree()).content);
+}
+
+
+TEST_F(LedgerUnitTest, testLedgerOverWriteAheadLog)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    {
+        paxos::Ledger ledger(
+            std::make_shared<paxos::WriteAheadLog<paxos::Decree>>(
+                directory.string(), "ledger"));
+        ledger.Append(paxos::Decree(paxos::Replica("a_author"), 1, "a_content", paxos::DecreeType::UserDecree));
+        ledger.Append(paxos::Decree(paxos::Replica("b_author"), 2, "b_content", paxos::DecreeType::UserDecree));
+    }
+
+    paxos::Ledger ledger(
+        std::make_shared<paxos::WriteAheadLog<paxos::Decree>>(
+            directory.string(), "ledger"));
+
+    ASSERT_EQ("a_content", ledger.Head().content);
+    ASSERT_EQ("b_content", ledger.Tail().content);
+    ASSERT_EQ("b_content", ledger.Next(ledger.Head()).content);
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST_F(LedgerUnitTest, testTakeSnapshotRemovesCoveredDecrees)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    std::vector<std::string> applied;
+    paxos::Ledger ledger(
+        queue,
+        std::make_shared<paxos::CompositeHandler>(
+            [&applied](std::string entry) { applied.push_back(entry); }),
+        std::make_shared<paxos::VolatileDecree>());
+    ledger.RegisterSnapshotHandler(
+        std::make_shared<paxos::CallbackSnapshotHandler>(
+            [&applied]() { return std::to_string(applied.size()); },
+            [](std::string snapshot) {}));
+
+    ASSERT_FALSE(ledger.TakeSnapshot());
+
+    ledger.Append(paxos::Decree(paxos::Replica("a_author"), 1, "a_content", paxos::DecreeType::UserDecree));
+    ledger.Append(paxos::Decree(paxos::Replica("b_author"), 2, "b_content", paxos::DecreeType::UserDecree));
+
+    ASSERT_TRUE(ledger.TakeSnapshot());
+    ASSERT_FALSE(ledger.TakeSnapshot());
+    ASSERT_EQ(GetQueueSize(queue), 0);
+    ASSERT_EQ("2", ledger.Snapshot().content);
+    ASSERT_EQ(2, ledger.Snapshot().root_number);
+
+    // The snapshot stands in for the tail of a compacted ledger.
+    ASSERT_FALSE(ledger.IsEmpty());
+    ASSERT_EQ(2, ledger.Tail().number);
+
+    ledger.Append(paxos::Decree(paxos::Replica("c_author"), 3, "c_content", paxos::DecreeType::UserDecree));
+
+    ASSERT_EQ(GetQueueSize(queue), 1);
+    ASSERT_EQ("c_content", ledger.Head().content);
+    ASSERT_EQ("c_content", ledger.Tail().content);
+}
+
+
+TEST_F(LedgerUnitTest, testSnapshotIntervalCompactsAutomatically)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    paxos::Ledger ledger(queue);
+    ledger.RegisterSnapshotHandler(
+        std::make_shared<paxos::CallbackSnapshotHandler>(
+            []() { return std::string("state"); },
+            [](std::string snapshot) {}));
+    ledger.SetSnapshotInterval(3);
+
+    for (int i=1; i<=7; i++)
+    {
+        ledger.Append(paxos::Decree(paxos::Replica("an_author"), i, "content", paxos::DecreeType::UserDecree));
+    }
+
+    ASSERT_EQ(6, ledger.Snapshot().root_number);
+    ASSERT_EQ(GetQueueSize(queue), 1);
+    ASSERT_EQ(7, ledger.Tail().number);
+}
+
+
+TEST_F(LedgerUnitTest, testRestoreSnapshotReplacesLedger)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+    std::string state;
+    {
+        paxos::Ledger ledger(
+            std::make_shared<paxos::WriteAheadLog<paxos::Decree>>(
+                directory.string(), "ledger"),
+            std::make_shared<paxos::EmptyDecreeHandler>(),
+            std::make_shared<paxos::PersistentDecree>(
+                directory.string(), "snapshot"));
+        ledger.RegisterSnapshotHandler(
+            std::make_shared<paxos::CallbackSnapshotHandler>(
+                []() { return std::string(); },
+                [&state](std::string snapshot) { state = snapshot; }));
+        ledger.Append(paxos::Decree(paxos::Replica("a_author"), 1, "a_content", paxos::DecreeType::UserDecree));
+
+        ASSERT_FALSE(ledger.RestoreSnapshot(paxos::Decree(paxos::Replica("b_author"), 1, "stale", paxos::DecreeType::UserDecree)));
+        ASSERT_TRUE(ledger.RestoreSnapshot(paxos::Decree(paxos::Replica("b_author"), 5, "state", paxos::DecreeType::UserDecree)));
+        ASSERT_EQ("state", state);
+        ASSERT_EQ(5, ledger.Tail().number);
+
+        ledger.Append(paxos::Decree(paxos::Replica("c_author"), 6, "c_content", paxos::DecreeType::UserDecree));
+        ASSERT_EQ("c_content", ledger.Tail().content);
+    }
+
+    // Snapshot and compacted ledger survive a restart.
+    paxos::Ledger ledger(
+        std::make_shared<paxos::WriteAheadLog<paxos::Decree>>(
+            directory.string(), "ledger"),
+        std::make_shared<paxos::EmptyDecreeHandler>(),
+        std::make_shared<paxos::PersistentDecree>(
+            directory.string(), "snapshot"));
+
+    ASSERT_EQ("state", ledger.Snapshot().content);
+    ASSERT_EQ("c_content", ledger.Head().content);
+    ASSERT_EQ(6, ledger.Tail().number);
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST_F(LedgerUnitTest, testAsynchronousApplyRunsHandlersInOrderOnAnotherThread)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    std::vector<std::string> applied;
+    std::atomic<bool> is_on_appending_thread(false);
+    auto appending_thread = std::this_thread::get_id();
+    paxos::Ledger ledger(
+        queue,
+        std::make_shared<paxos::CompositeHandler>([&](std::string entry)
+        {
+            if (std::this_thread::get_id() == appending_thread)
+            {
+                is_on_appending_thread = true;
+            }
+            applied.push_back(entry);
+        }));
+    ledger.SetAsynchronousApply(16);
+
+    for (int i=1; i<=100; i++)
+    {
+        ledger.Append(paxos::Decree(paxos::Replica("an_author"), i, std::to_string(i), paxos::DecreeType::UserDecree));
+    }
+    ledger.WaitForApplied();
+
+    ASSERT_FALSE(is_on_appending_thread);
+    ASSERT_EQ(100, applied.size());
+    for (int i=1; i<=100; i++)
+    {
+        ASSERT_EQ(std::to_string(i), applied[i - 1]);
+    }
+    ASSERT_EQ(100, ledger.CommitIndex());
+    ASSERT_EQ(100, ledger.AppliedIndex());
+}
+
+
+TEST_F(LedgerUnitTest, testReplayAppliesDecreesAfterTheRecordedAppliedDecree)
+{
+    auto queue = std::make_shared<paxos::VolatileQueue<paxos::Decree>>();
+    auto applied_decree = std::make_shared<paxos::VolatileDecree>();
+    {
+        paxos::Ledger ledger(
+            queue,
+            std::make_shared<paxos::EmptyDecreeHandler>(),
+            std::make_shared<paxos::VolatileDecree>(),
+            applied_decree);
+        ledger.Append(paxos::Decree(paxos::Replica("an_author"), 1, "1", paxos::DecreeType::UserDecree));
+        ledger.Append(paxos::Decree(paxos::Replica("an_author"), 2, "2", paxos::DecreeType::UserDecree));
+    }
+
+    // Decree 3 reached the log but the process stopped before applying it.
+    queue->Enqueue(paxos::Decree(paxos::Replica("an_author"), 3, "3", paxos::DecreeType::UserDecree));
+
+    std::vector<std::string> applied;
+    paxos::Ledger ledger(
+        queue,
+        std::make_shared<paxos::CompositeHandler>([&](std::string entry)
+        {
+            applied.push_back(entry);
+        }),
+        std::make_shared<paxos::VolatileDecree>(),
+        applied_decree);
+
+    ASSERT_EQ(3, ledger.CommitIndex());
+    ASSERT_EQ(2, ledger.AppliedIndex());
+
+    ledger.Replay();
+
+    ASSERT_EQ(std::vector<std::string>({ "3" }), applied);
+    ASSERT_EQ(3, ledger.AppliedIndex());
+    ASSERT_EQ(3, applied_decree->Get().root_number);
+}
+
+
+TEST_F(LedgerUnitTest, testAppliedDecreeIsRecordedOncePerInterval)
+{
+    auto queue = std::make_shared<paxos::VolatileQueue<paxos::Decree>>();
+    auto applied_decree = std::make_shared<paxos::VolatileDecree>();
+    {
+        paxos::Ledger ledger(
+            queue,
+            std::make_shared<paxos::EmptyDecreeHandler>(),
+            std::make_shared<paxos::VolatileDecree>(),
+            applied_decree);
+        for (int i = 1; i <= paxos::AppliedRecordInterval + 1; i++)
+        {
+            ledger.Append(paxos::Decree(paxos::Replica("an_author"), i, "content", paxos::DecreeType::UserDecree));
+            if (i < paxos::AppliedRecordInterval)
+            {
+                ASSERT_EQ(0, applied_decree->Get().root_number);
+            }
+        }
+
+        ASSERT_EQ(paxos::AppliedRecordInterval, applied_decree->Get().root_number);
+    }
+
+    // Closing the ledger records the decrees applied since.
+    ASSERT_EQ(paxos::AppliedRecordInterval + 1, applied_decree->Get().root_number);
+}
+
+
+TEST_F(LedgerUnitTest, testAsynchronousApplyPushesBackOnceLagIsReached)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    std::mutex mutex;
+    std::condition_variable released;
+    bool is_released = false;
+    paxos::Ledger ledger(
+        queue,
+        std::make_shared<paxos::CompositeHandler>([&](std::string entry)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            released.wait(lock, [&]() { return is_released; });
+        }));
+    ledger.SetAsynchronousApply(2);
+
+    ledger.Append(paxos::Decree(paxos::Replica("an_author"), 1, "content", paxos::DecreeType::UserDecree));
+    ledger.Append(paxos::Decree(paxos::Replica("an_author"), 2, "content", paxos::DecreeType::UserDecree));
+
+    // Consensus moves on while the first handler is still running.
+    ASSERT_EQ(2, ledger.CommitIndex());
+    ASSERT_EQ(0, ledger.AppliedIndex());
+
+    std::thread appender([&]()
+    {
+        ledger.Append(paxos::Decree(paxos::Replica("an_author"), 3, "content", paxos::DecreeType::UserDecree));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(2, ledger.CommitIndex());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_released = true;
+    }
+    released.notify_all();
+    appender.join();
+    ledger.WaitForApplied();
+
+    ASSERT_EQ(3, ledger.CommitIndex());
+    ASSERT_EQ(3, ledger.AppliedIndex());
+}
+
+
+TEST_F(LedgerUnitTest, testAsynchronousApplyAppliesSystemDecreesBeforeAppendReturns)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    std::vector<std::string> applied;
+    auto record = [&applied](std::string entry) { applied.push_back(entry); };
+    paxos::Ledger ledger(
+        queue,
+        std::make_shared<paxos::CompositeHandler>(record));
+    ledger.RegisterHandler(
+        paxos::DecreeType::AddReplicaDecree,
+        std::make_shared<paxos::CompositeHandler>(record));
+    ledger.SetAsynchronousApply(16);
+
+    ledger.Append(paxos::Decree(paxos::Replica("an_author"), 1, "user", paxos::DecreeType::UserDecree));
+    ledger.Append(paxos::Decree(paxos::Replica("an_author"), 2, "system", paxos::DecreeType::AddReplicaDecree));
+
+    ASSERT_EQ(2, ledger.AppliedIndex());
+    ASSERT_EQ((std::vector<std::string>{"user", "system"}), applied);
+}
+
+
+TEST_F(LedgerUnitTest, testAsynchronousApplySnapshotsMatchTheTail)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    std::atomic<int> applied(0);
+    paxos::Ledger ledger(
+        queue,
+        std::make_shared<paxos::CompositeHandler>([&applied](std::string entry)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            applied++;
+        }));
+    ledger.RegisterSnapshotHandler(
+        std::make_shared<paxos::CallbackSnapshotHandler>(
+            [&applied]() { return std::to_string(applied.load()); },
+            [](std::string snapshot) {}));
+    ledger.SetSnapshotInterval(3);
+    ledger.SetAsynchronousApply(16);
+
+    for (int i=1; i<=7; i++)
+    {
+        ledger.Append(paxos::Decree(paxos::Replica("an_author"), i, "content", paxos::DecreeType::UserDecree));
+    }
+
+    ASSERT_EQ(6, ledger.Snapshot().root_number);
+    ASSERT_EQ("6", ledger.Snapshot().content);
+    ASSERT_EQ(GetQueueSize(queue), 1);
+}
+
+
+TEST_F(LedgerUnitTest, testParallelApplyKeepsLedgerOrderPerKey)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    std::mutex mutex;
+    std::map<std::string, std::vector<int>> applied;
+    paxos::Ledger ledger(
+        queue,
+        std::make_shared<paxos::CompositeHandler>([&](std::string entry)
+        {
+            std::string key = entry.substr(0, entry.find(':'));
+            int value = std::stoi(entry.substr(entry.find(':') + 1));
+            std::lock_guard<std::mutex> lock(mutex);
+            applied[key].push_back(value);
+        }));
+    ledger.SetConflictKey(
+        paxos::DecreeType::UserDecree,
+        [](std::string entry) { return entry.substr(0, entry.find(':')); });
+    ledger.SetAsynchronousApply(64, 4);
+
+    int root = 1;
+    for (int i=0; i<200; i++)
+    {
+        std::string entry = std::to_string(i % 8) + ":" + std::to_string(i);
+        if (i % 10 == 0)
+        {
+            ledger.Append(paxos::Decree(paxos::Replica("an_author"), root++, paxos::BinarySerialize(std::vector<std::string> { entry, "batch:" + std::to_string(i) }), paxos::DecreeType::BatchDecree));
+        }
+        else
+        {
+            ledger.Append(paxos::Decree(paxos::Replica("an_author"), root++, entry, paxos::DecreeType::UserDecree));
+        }
+    }
+    ledger.WaitForApplied();
+
+    ASSERT_EQ(9, applied.size());
+    size_t total = 0;
+    for (const auto& key : applied)
+    {
+        ASSERT_TRUE(std::is_sorted(key.second.begin(), key.second.end()));
+        total += key.second.size();
+    }
+    ASSERT_EQ(220, total);
+    ASSERT_EQ(200, ledger.AppliedIndex());
+}
+
+
+TEST_F(LedgerUnitTest, testParallelApplyRunsDifferentKeysConcurrently)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    std::mutex mutex;
+    std::condition_variable other_applied;
+    bool is_other_applied = false;
+    bool is_concurrent = false;
+    paxos::Ledger ledger(
+        queue,
+        std::make_shared<paxos::CompositeHandler>([&](std::string entry)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (entry == "a")
+            {
+                is_concurrent = other_applied.wait_for(
+                    lock,
+                    std::chrono::seconds(5),
+                    [&]() { return is_other_applied; });
+            }
+            else
+            {
+                is_other_applied = true;
+                other_applied.notify_all();
+            }
+        }));
+    ledger.SetConflictKey(
+        paxos::DecreeType::UserDecree,
+        [](std::string entry) { return entry; });
+    ledger.SetAsynchronousApply(16, 2);
+
+    //
+    // The entries share a decree so that they are scheduled together. At
+    // least one of the other keys lands on another worker than a.
+    //
+    std::vector<std::string> entries { "a" };
+    for (char c='b'; c<='z'; c++)
+    {
+        entries.push_back(std::string(1, c));
+    }
+    ledger.Append(paxos::Decree(paxos::Replica("an_author"), 1, paxos::BinarySerialize(entries), paxos::DecreeType::BatchDecree));
+    ledger.WaitForApplied();
+
+    ASSERT_TRUE(is_concurrent);
+}
+
+
+TEST_F(LedgerUnitTest, testParallelApplyTreatsEmptyKeysAsBarriers)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    std::mutex mutex;
+    std::vector<std::string> applied;
+    paxos::Ledger ledger(
+        queue,
+        std::make_shared<paxos::CompositeHandler>([&](std::string entry)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            applied.push_back(entry);
+        }));
+    ledger.SetConflictKey(
+        paxos::DecreeType::UserDecree,
+        [](std::string entry) { return entry == "barrier" ? "" : entry; });
+    ledger.SetAsynchronousApply(16, 4);
+
+    ledger.Append(paxos::Decree(paxos::Replica("an_author"), 1, paxos::BinarySerialize(std::vector<std::string> { "1", "2", "3", "barrier", "4", "5" }), paxos::DecreeType::BatchDecree));
+    ledger.WaitForApplied();
+
+    ASSERT_EQ(6, applied.size());
+    ASSERT_EQ("barrier", applied[3]);
+    std::sort(applied.begin(), applied.begin() + 3);
+    std::sort(applied.begin() + 4, applied.end());
+    ASSERT_EQ((std::vector<std::string>{"1", "2", "3", "barrier", "4", "5"}), applied);
+}
+
+
+TEST_F(LedgerUnitTest, testHandlerRegisteredWhileApplyingTakesEffectAfterwards)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    std::mutex mutex;
+    std::vector<std::string> applied;
+    paxos::Ledger ledger(queue);
+    ledger.SetAsynchronousApply(16, 2);
+
+    std::thread appender([&]()
+    {
+        for (int i=1; i<=100; i++)
+        {
+            ledger.Append(paxos::Decree(paxos::Replica("an_author"), i, std::to_string(i), paxos::DecreeType::UserDecree));
+        }
+    });
+    ledger.RegisterHandler(
+        paxos::DecreeType::UserDecree,
+        std::make_shared<paxos::CompositeHandler>([&](std::string entry)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            applied.push_back(entry);
+        }));
+    ledger.SetConflictKey(
+        paxos::DecreeType::UserDecree,
+        [](std::string entry) { return entry; });
+    appender.join();
+    ledger.Append(paxos::Decree(paxos::Replica("an_author"), 101, "101", paxos::DecreeType::UserDecree));
+    ledger.WaitForApplied();
+
+    ASSERT_FALSE(applied.empty());
+    ASSERT_EQ("101", applied.back());
+}
+
+
+TEST_F(LedgerUnitTest, testRangeIsBoundedByEntriesAndBytes)
+{
+    std::stringstream ss;
+    auto queue = std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss);
+    paxos::Ledger ledger(queue);
+    for (int i=1; i<=5; i++)
+    {
+        ledger.Append(paxos::Decree(paxos::Replica("an_author"), i, "0123456789", paxos::DecreeType::UserDecree));
+    }
+
+    auto range = ledger.Range(ledger.Head(), 3, 1024);
+    ASSERT_EQ(3, range.size());
+    ASSERT_EQ(2, range.front().number);
+    ASSERT_EQ(4, range.back().number);
+
+    range = ledger.Range(paxos::Decree(), 10, 25);
+    ASSERT_EQ(2, range.size());
+    ASSERT_EQ(1, range.front().number);
+
+    // The first decree is always sent even if it exceeds the byte budget.
+    ASSERT_EQ(1, ledger.Range(paxos::Decree(), 10, 1).size());
+    ASSERT_EQ(0, ledger.Range(ledger.Tail(), 10, 1024).size());
+}
@@ -0,0 +1,87 @@
+#include "gtest/gtest.h"
+
+#include "paxos/logging.hpp"
+
+
+namespace paxos
+{
+
+
+class LoggingTest: public testing::Test
+{
+    virtual void SetUp()
+    {
+        level = GetLogLevel();
+    }
+
+    virtual void TearDown()
+    {
+        SetLogLevel(level);
+    }
+
+    LogLevel level;
+};
+
+
+static int
+count_evaluation(int& evaluations)
+{
+    return ++evaluations;
+}
+
+
+TEST_F(LoggingTest, testSetLogLevelIsVisibleThroughGetLogLevel)
+{
+    SetLogLevel(LogLevel::Warning);
+
+    ASSERT_EQ(LogLevel::Warning, GetLogLevel());
+}
+
+
+TEST_F(LoggingTest, testLevelsBelowTheLogLevelAreDisabled)
+{
+    SetLogLevel(LogLevel::Warning);
+
+    ASSERT_FALSE(IsLogLevelEnabled(LogLevel::Info));
+    ASSERT_TRUE(IsLogLevelEnabled(LogLevel::Warning));
+    ASSERT_TRUE(IsLogLevelEnabled(LogLevel::Error));
+}
+
+
+TEST_F(LoggingTest, testOffDisablesEveryLevel)
+{
+    SetLogLevel(LogLevel::Off);
+
+    ASSERT_FALSE(IsLogLevelEnabled(LogLevel::Info));
+    ASSERT_FALSE(IsLogLevelEnabled(LogLevel::Warning));
+    ASSERT_FALSE(IsLogLevelEnabled(LogLevel::Error));
+}
+
+
+TEST_F(LoggingTest, testDisabledLevelDoesNotEvaluateArguments)
+{
+    int evaluations = 0;
+    SetLogLevel(LogLevel::Error);
+
+    LOG(LogLevel::Info) << count_evaluation(evaluations);
+    LOG(LogLevel::Warning) << count_evaluation(evaluations);
+
+    ASSERT_EQ(0, evaluations);
+}
+
+
+TEST_F(LoggingTest, testLogMacroBindsAsSingleStatement)
+{
+    int evaluations = 0;
+    SetLogLevel(LogLevel::Off);
+
+    if (evaluations == 0)
+        LOG(LogLevel::Info) << count_evaluation(evaluations);
+    else
+        evaluations = 100;
+
+    ASSERT_EQ(0, evaluations);
+}
+
+
+}
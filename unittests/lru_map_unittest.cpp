@@ -1,5 +1,9 @@
+#include <utility>
+#include <vector>
+
 #include "gtest/gtest.h"
 
+#include "paxos/decree.hpp"
 #include "paxos/lru_map.hpp"
 
 
@@ -54,3 +58,72 @@ TEST(LruMapTest, testEraseCreatesSpaceForNextElementWithoutEvicting)
     lruset[3] = 3;
     ASSERT_NE(lruset.end(), lruset.find(1));
 }
+
+
+TEST(LruMapTest, testAssigningExistingElementMakesItMostRecentlyUsed)
+{
+    paxos::lru_map<int, int> lruset(2);
+
+    lruset[1] = 1;
+    lruset[2] = 2;
+    lruset[1] = 3;
+    lruset[4] = 4;
+    ASSERT_NE(lruset.end(), lruset.find(1));
+    ASSERT_EQ(lruset.end(), lruset.find(2));
+    ASSERT_EQ(3, lruset.find(1)->second);
+}
+
+
+TEST(LruMapTest, testEraseRemovesOnlyMatchingElementFromRecencyOrder)
+{
+    paxos::lru_map<int, int> lruset(3);
+
+    lruset[1] = 1;
+    lruset[2] = 2;
+    lruset[3] = 3;
+    lruset.erase(3);
+    lruset[4] = 4;
+    lruset[5] = 5;
+
+    // Erasing 3 leaves 1 as the least recently used entry to evict.
+    ASSERT_EQ(lruset.end(), lruset.find(1));
+    ASSERT_NE(lruset.end(), lruset.find(2));
+    ASSERT_NE(lruset.end(), lruset.find(4));
+    ASSERT_NE(lruset.end(), lruset.find(5));
+    ASSERT_EQ(3, lruset.size());
+}
+
+
+TEST(LruMapTest, testIterationVisitsLeastRecentlyUsedFirst)
+{
+    paxos::lru_map<int, int> lruset(5);
+
+    lruset[3] = 30;
+    lruset[1] = 10;
+    lruset[2] = 20;
+    lruset[3] = 31;
+
+    std::vector<std::pair<int, int>> visited;
+    for (auto kv : lruset)
+    {
+        visited.push_back(std::make_pair(kv.first, kv.second));
+    }
+    std::vector<std::pair<int, int>> expected { {1, 10}, {2, 20}, {3, 31} };
+    ASSERT_EQ(expected, visited);
+}
+
+
+TEST(LruMapTest, testDecreeIdsAreKeyedByHashAndEquality)
+{
+    paxos::lru_map<paxos::DecreeId,
+                   int,
+                   paxos::hash_map_decree,
+                   paxos::equal_map_decree> lruset(10);
+
+    lruset[paxos::DecreeId(paxos::Decree(paxos::Replica("host", 1), 1, "a", paxos::DecreeType::UserDecree))] = 1;
+    lruset[paxos::DecreeId(paxos::Decree(paxos::Replica("host", 2), 1, "a", paxos::DecreeType::UserDecree))] = 2;
+    lruset[paxos::DecreeId(paxos::Decree(paxos::Replica("host", 1), 1, "b", paxos::DecreeType::UserDecree))] = 3;
+
+    ASSERT_EQ(2, lruset.size());
+    ASSERT_EQ(3, lruset.find(paxos::DecreeId(paxos::Decree(paxos::Replica("host", 1), 1, "", paxos::DecreeType::UserDecree)))->second);
+}
@@ -41,3 +41,31 @@ TEST(LruSetTest, testInsertSameElementDoesNotEvictElements)
     lruset.insert(2);
     ASSERT_TRUE(lruset.contains(1));
 }
+
+
+TEST(LruSetTest, testInsertingExistingElementMakesItMostRecentlyUsed)
+{
+    paxos::lru_set<int> lruset(2);
+
+    lruset.insert(1);
+    lruset.insert(2);
+    lruset.insert(1);
+    lruset.insert(3);
+    ASSERT_TRUE(lruset.contains(1));
+    ASSERT_FALSE(lruset.contains(2));
+    ASSERT_TRUE(lruset.contains(3));
+}
+
+
+TEST(LruSetTest, testEraseCreatesSpaceForNextElementWithoutEvicting)
+{
+    paxos::lru_set<int> lruset(2);
+
+    lruset.insert(1);
+    lruset.insert(2);
+    lruset.erase(2);
+    lruset.insert(3);
+    ASSERT_TRUE(lruset.contains(1));
+    ASSERT_FALSE(lruset.contains(2));
+    ASSERT_EQ(2, lruset.size());
+}
@@ -0,0 +1,41 @@
+#include <fstream>
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include "paxos/mapped.hpp"
+
+
+TEST(MappedFileTest, testMappedFileExposesFileContents)
+{
+    auto path = boost::filesystem::temp_directory_path() /
+                boost::filesystem::unique_path();
+    {
+        std::ofstream file(path.string());
+        file << "narf zort poit";
+    }
+
+    paxos::MappedFile mapped(path.string());
+
+    ASSERT_TRUE(mapped.IsMapped());
+    ASSERT_EQ("narf zort poit", std::string(mapped.Data(), mapped.Size()));
+
+    boost::filesystem::remove(path);
+}
+
+
+TEST(MappedFileTest, testMappedFileOfMissingOrEmptyFileIsNotMapped)
+{
+    auto path = boost::filesystem::temp_directory_path() /
+                boost::filesystem::unique_path();
+
+    ASSERT_FALSE(paxos::MappedFile(path.string()).IsMapped());
+
+    std::ofstream(path.string()).close();
+
+    ASSERT_FALSE(paxos::MappedFile(path.string()).IsMapped());
+    ASSERT_EQ(0, paxos::MappedFile(path.string()).Size());
+
+    boost::filesystem::remove(path);
+}
@@ -1,3 +1,6 @@
+#include <sstream>
+#include <string>
+
 #include "gtest/gtest.h"
 
 #include "paxos/messages.hpp"
@@ -17,3 +20,24 @@ TEST(MessageTest, testMessageResponseUpdatesSenderAndReceiver)
     ASSERT_EQ(response.to.hostname, m.from.hostname);
     ASSERT_EQ(response.type, paxos::MessageType::PromiseMessage);
 }
+
+
+TEST(MessageTest, testMessageStreamsStructuredFields)
+{
+    paxos::Replica from("from_hostname", 111);
+    paxos::Replica to("to_hostname", 222);
+
+    paxos::Decree the_decree(from, 7, "content", paxos::DecreeType::UserDecree);
+    the_decree.root_number = 3;
+    paxos::Message m(the_decree, from, to, paxos::MessageType::AcceptMessage);
+
+    std::stringstream stream;
+    stream << m;
+
+    ASSERT_EQ("type=" + std::to_string(static_cast<int>(paxos::MessageType::AcceptMessage)) +
+              " from=from_hostname:111 to=to_hostname:222"
+              " author=from_hostname:111 number=7 root=3"
+              " decree_type=" + std::to_string(static_cast<int>(paxos::DecreeType::UserDecree)) +
+              " content_size=7",
+              stream.str());
+}
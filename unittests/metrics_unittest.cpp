@@ -0,0 +1,167 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "gtest/gtest.h"
+
+#include "paxos/metrics.hpp"
+
+
+TEST(MetricsTest, testCounterSumsAddsFromEveryThread)
+{
+    paxos::Counter counter;
+
+    std::vector<std::thread> threads;
+    for (int t=0; t<8; t++)
+    {
+        threads.emplace_back([&counter]()
+        {
+            for (int i=0; i<1000; i++)
+            {
+                counter.Add();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ(8000, counter.Value());
+}
+
+
+TEST(MetricsTest, testHistogramBucketBoundsContainTheirValues)
+{
+    for (uint64_t value : { 0ull, 1ull, 7ull, 8ull, 9ull, 15ull, 16ull, 17ull,
+                            1000ull, 123456789ull, 0xffffffffffffffffull })
+    {
+        size_t index = paxos::Histogram::BucketIndex(value);
+
+        ASSERT_LT(index, paxos::Histogram::BucketCount);
+        ASSERT_GE(paxos::Histogram::BucketUpperBound(index), value);
+        if (index > 0)
+        {
+            ASSERT_LT(paxos::Histogram::BucketUpperBound(index - 1), value);
+        }
+    }
+}
+
+
+TEST(MetricsTest, testHistogramBucketErrorIsBoundedByOneEighth)
+{
+    for (uint64_t value=8; value<100000; value+=37)
+    {
+        uint64_t upper = paxos::Histogram::BucketUpperBound(
+            paxos::Histogram::BucketIndex(value));
+
+        ASSERT_LE(upper - value, value / 8);
+    }
+}
+
+
+TEST(MetricsTest, testHistogramSnapshotCountsSumsAndQuantiles)
+{
+    paxos::Histogram histogram;
+    for (uint64_t value=1; value<=100; value++)
+    {
+        histogram.Record(value);
+    }
+
+    auto snapshot = histogram.Snapshot();
+
+    ASSERT_EQ(100, snapshot.count);
+    ASSERT_EQ(5050, snapshot.sum);
+    ASSERT_EQ(paxos::Histogram::BucketUpperBound(
+                  paxos::Histogram::BucketIndex(50)),
+              snapshot.Quantile(0.5));
+    ASSERT_EQ(paxos::Histogram::BucketUpperBound(
+                  paxos::Histogram::BucketIndex(100)),
+              snapshot.Quantile(1.0));
+}
+
+
+TEST(MetricsTest, testEmptyHistogramQuantileIsZero)
+{
+    paxos::Histogram histogram;
+
+    ASSERT_EQ(0, histogram.Snapshot().Quantile(0.99));
+}
+
+
+TEST(MetricsTest, testPhaseTimerRecordsOnceAfterStart)
+{
+    paxos::PhaseTimer timer;
+    paxos::Histogram histogram;
+    paxos::Decree decree(paxos::Replica("host"), 1, "", paxos::DecreeType::UserDecree);
+
+    timer.Start(decree);
+
+    ASSERT_TRUE(timer.Stop(decree, histogram));
+    ASSERT_FALSE(timer.Stop(decree, histogram));
+    ASSERT_EQ(1, histogram.Snapshot().count);
+}
+
+
+TEST(MetricsTest, testPhaseTimerIgnoresStopForAnotherDecree)
+{
+    paxos::PhaseTimer timer;
+    paxos::Histogram histogram;
+    paxos::Decree started(paxos::Replica("host"), 1, "", paxos::DecreeType::UserDecree);
+    paxos::Decree other(paxos::Replica("host"), 2, "", paxos::DecreeType::UserDecree);
+
+    timer.Start(started);
+
+    ASSERT_FALSE(timer.Stop(other, histogram));
+    ASSERT_EQ(0, histogram.Snapshot().count);
+}
+
+
+TEST(MetricsTest, testWritePrometheusWritesCountersAndCumulativeBuckets)
+{
+    paxos::Histogram histogram;
+    histogram.Record(1);
+    histogram.Record(3);
+    paxos::MetricsSnapshot snapshot;
+    snapshot.counters["nacks"] = 4;
+    snapshot.histograms["send_latency"] = histogram.Snapshot();
+
+    std::stringstream stream;
+    paxos::WritePrometheus(stream, snapshot);
+
+    ASSERT_EQ("# TYPE paxos_nacks_total counter\n"
+              "paxos_nacks_total 4\n"
+              "# TYPE paxos_send_latency_seconds histogram\n"
+              "paxos_send_latency_seconds_bucket{le=\"0.000001\"} 1\n"
+              "paxos_send_latency_seconds_bucket{le=\"0.000003\"} 2\n"
+              "paxos_send_latency_seconds_bucket{le=\"+Inf\"} 2\n"
+              "paxos_send_latency_seconds_sum 0.000004\n"
+              "paxos_send_latency_seconds_count 2\n",
+              stream.str());
+}
+
+
+TEST(MetricsTest, testWritePrometheusFileReplacesFile)
+{
+    auto filename = (boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path()).string();
+    paxos::MetricsSnapshot snapshot;
+    snapshot.counters["requests"] = 1;
+    paxos::WritePrometheusFile(filename, snapshot);
+    snapshot.counters["requests"] = 2;
+
+    paxos::WritePrometheusFile(filename, snapshot);
+
+    std::ifstream file(filename);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    ASSERT_EQ("# TYPE paxos_requests_total counter\n"
+              "paxos_requests_total 2\n",
+              contents.str());
+    ASSERT_FALSE(boost::filesystem::exists(filename + ".tmp"));
+    boost::filesystem::remove(filename);
+}
@@ -103,6 +103,7 @@ class ParliamentTest: public testing::Test
         auto acceptor = std::make_shared<paxos::AcceptorContext>(
             std::make_shared<paxos::VolatileDecree>(),
             std::make_shared<paxos::VolatileDecree>(),
+            std::make_shared<paxos::VolatileVotes>(),
             std::chrono::milliseconds(1000)
         );
         auto learner = std::make_shared<paxos::LearnerContext>(
@@ -344,3 +345,26 @@ TEST_F(ParliamentTest, testGetAbsenteeBallotsOf1WithAcceptedDecreeComparesAgains
     ASSERT_TRUE(parliament->GetAbsenteeBallots(1)[decree]->Contains(paxos::Replica("yourhost", 2222)));
     ASSERT_FALSE(parliament->GetAbsenteeBallots(1)[decree]->Contains(replica));
 }
+
+
+TEST_F(ParliamentTest, testGetMetricsCountsAcceptedAndLedgerAppends)
+{
+    parliament->SetActive();
+    auto before = parliament->GetMetrics();
+
+    receiver->ReceiveMessage(
+        paxos::Message(
+            paxos::Decree(replica, 1, "my decree content", paxos::DecreeType::UserDecree),
+            replica,
+            replica,
+            paxos::MessageType::AcceptedMessage
+        )
+    );
+
+    auto after = parliament->GetMetrics();
+    ASSERT_EQ(before.counters["accepted"] + 1, after.counters["accepted"]);
+    ASSERT_EQ(before.counters["ledger_appends"] + 1,
+              after.counters["ledger_appends"]);
+    ASSERT_EQ(before.histograms["ledger_append_latency"].count + 1,
+              after.histograms["ledger_append_latency"].count);
+}
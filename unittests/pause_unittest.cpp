@@ -1,5 +1,7 @@
+#include <atomic>
 #include <chrono>
 #include <functional>
+#include <thread>
 
 #include "gtest/gtest.h"
 
@@ -19,3 +21,50 @@ TEST(PauseTest, testRnadomPauseStartRunsCallbackHandler)
     ASSERT_TRUE(is_handler_called);
 }
 
+
+
+TEST(PauseTest, testTimerRunsCallbackOnceAfterDelay)
+{
+    std::atomic<int> calls(0);
+
+    paxos::Timer timer;
+    auto start = std::chrono::steady_clock::now();
+    timer.Start(std::chrono::milliseconds(20), [&calls]() { calls++; });
+    while (calls.load() == 0 &&
+           std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ASSERT_GE(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(20));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(1, calls.load());
+}
+
+
+TEST(PauseTest, testTimerDestroyedBeforeDelayDoesNotRunCallback)
+{
+    std::atomic<int> calls(0);
+    auto start = std::chrono::steady_clock::now();
+    {
+        paxos::Timer timer;
+        timer.Start(std::chrono::milliseconds(60000), [&calls]() { calls++; });
+    }
+
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    ASSERT_EQ(0, calls.load());
+}
+
+
+TEST(PauseTest, testTimerCancelDropsPendingCallback)
+{
+    std::atomic<int> calls(0);
+
+    paxos::Timer timer;
+    timer.Start(std::chrono::milliseconds(10), [&calls]() { calls++; });
+    timer.Cancel();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    ASSERT_EQ(0, calls.load());
+}
@@ -239,3 +239,109 @@ TEST(QueueTest, testThatRolloverQueueCanDequeue)
 
     ASSERT_EQ(GetQueueSize(queue), 2);
 }
+
+
+TEST(QueueTest, testThatRolloverQueueAtReturnsElementsFromTheFirstElement)
+{
+    std::stringstream file;
+
+    auto queue = std::make_shared<paxos::RolloverQueue<std::string>>(file);
+
+    queue->Enqueue("narf");
+    queue->Enqueue("zort");
+    queue->Enqueue("poit");
+    queue->Dequeue();
+
+    ASSERT_EQ(queue->Size(), 2);
+    ASSERT_EQ(queue->At(0), "zort");
+    ASSERT_EQ(queue->At(1), "poit");
+    ASSERT_EQ(queue->At(2), "");
+}
+
+
+TEST(QueueTest, testThatRolloverQueueCanRehydrateFromAPreviousRolloverQueue)
+{
+    std::stringstream file;
+
+    auto queue = std::make_shared<paxos::RolloverQueue<std::string>>(file);
+
+    queue->Enqueue("narf");
+    queue->Enqueue("zort");
+    queue->Enqueue("poit");
+    queue->Dequeue();
+
+    auto next_queue = std::make_shared<paxos::RolloverQueue<std::string>>(file);
+
+    ASSERT_EQ(GetQueueSize(next_queue), 2);
+    ASSERT_EQ(next_queue->At(0), "zort");
+    ASSERT_EQ(next_queue->Last(), "poit");
+}
+
+
+TEST(QueueTest, testThatRolloverQueueRebuildsMissingIndexFile)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+
+    {
+        paxos::RolloverQueue<std::string> queue(directory.string(), "queue");
+        queue.Enqueue("narf");
+        queue.Enqueue("zort");
+        queue.Enqueue("poit");
+    }
+
+    ASSERT_TRUE(boost::filesystem::exists(directory / "queue.index"));
+    {
+        paxos::RolloverQueue<std::string> queue(directory.string(), "queue");
+        ASSERT_EQ(queue.Size(), 3);
+        ASSERT_EQ(queue.At(1), "zort");
+    }
+
+    boost::filesystem::remove(directory / "queue.index");
+    {
+        paxos::RolloverQueue<std::string> queue(directory.string(), "queue");
+        ASSERT_EQ(queue.Size(), 3);
+        ASSERT_EQ(queue.At(1), "zort");
+        queue.Enqueue("zoit");
+        ASSERT_EQ(queue.Last(), "zoit");
+    }
+    ASSERT_TRUE(boost::filesystem::exists(directory / "queue.index"));
+
+    boost::filesystem::remove_all(directory);
+}
+
+
+TEST(QueueTest, testThatRolloverQueueReloadsReplacedFiles)
+{
+    auto directory = boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+
+    {
+        paxos::RolloverQueue<std::string> queue(directory.string(), "other");
+        queue.Enqueue("narf");
+        queue.Enqueue("zort");
+        queue.Enqueue("poit");
+    }
+
+    paxos::RolloverQueue<std::string> queue(directory.string(), "queue");
+    queue.Enqueue("stale");
+
+    boost::filesystem::rename(directory / "other", directory / "queue");
+    boost::filesystem::rename(directory / "other.index",
+                              directory / "queue.index");
+    queue.Reload();
+
+    ASSERT_EQ(queue.Size(), 3);
+    ASSERT_EQ(queue.At(1), "zort");
+    queue.Enqueue("zoit");
+    ASSERT_EQ(queue.Last(), "zoit");
+    {
+        paxos::RolloverQueue<std::string> reopened(directory.string(), "queue");
+        ASSERT_EQ(reopened.Size(), 4);
+        ASSERT_EQ(reopened.Last(), "zoit");
+    }
+
+    boost::filesystem::remove_all(directory);
+}
@@ -1,4 +1,8 @@
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
@@ -112,3 +116,143 @@ TEST(NetworkReceiverTest, testProcessMessageDoesNotRunCallbacksFromUnknownReplic
 
     ASSERT_FALSE(was_callback_called);
 }
+
+
+TEST(NetworkReceiverTest, testProcessMessageWithBinaryCodecRunsCallbacks)
+{
+    paxos::Message received;
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();;
+    replicaset->Add(paxos::Replica("A"));
+    paxos::NetworkReceiver<MockServer, paxos::BinaryCodec> receiver("myhost", 1111, replicaset);
+    receiver.RegisterCallback(
+        paxos::Callback([&received](paxos::Message m){received = m;}),
+        paxos::MessageType::PrepareMessage);
+
+    receiver.ProcessContent(
+        paxos::BinarySerialize(
+            paxos::Message(
+                paxos::Decree(paxos::Replica("A"), 3, "content", paxos::DecreeType::UserDecree),
+                paxos::Replica("A"),
+                paxos::Replica("B"),
+                paxos::MessageType::PrepareMessage
+            )
+        )
+    );
+
+    ASSERT_EQ(paxos::MessageType::PrepareMessage, received.type);
+    ASSERT_EQ(3, received.decree.number);
+    ASSERT_EQ("content", received.decree.content);
+}
+
+
+TEST(NetworkReceiverTest, testThreadedReceiverRunsRolesInParallelAndEachRoleInOrder)
+{
+    struct RoleContext : public paxos::Context
+    {
+    };
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<int> proposer_numbers;
+    bool is_learner_running = false;
+    bool was_proposer_concurrent = false;
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    paxos::NetworkReceiver<MockServer, paxos::BinaryCodec> receiver("myhost", 1111, replicaset, 4);
+    auto proposer = std::make_shared<RoleContext>();
+    auto learner = std::make_shared<RoleContext>();
+
+    receiver.RegisterCallback(
+        paxos::Callback(
+            [&](const paxos::Message& m)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                is_learner_running = true;
+                condition.notify_all();
+
+                // Hold the learner strand until every proposer message ran.
+                condition.wait_for(lock, std::chrono::seconds(5),
+                                   [&]() { return proposer_numbers.size() == 100; });
+                was_proposer_concurrent = proposer_numbers.size() == 100;
+            },
+            learner),
+        paxos::MessageType::AcceptedMessage);
+    receiver.RegisterCallback(
+        paxos::Callback(
+            [&](const paxos::Message& m)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                proposer_numbers.push_back(m.decree.number);
+                condition.notify_all();
+            },
+            proposer),
+        paxos::MessageType::RequestMessage);
+
+    receiver.ProcessContent(
+        paxos::BinarySerialize(
+            paxos::Message(paxos::Decree(), paxos::Replica(), paxos::Replica(),
+                           paxos::MessageType::AcceptedMessage)));
+    for (int i=0; i<100; i++)
+    {
+        receiver.ProcessContent(
+            paxos::BinarySerialize(
+                paxos::Message(
+                    paxos::Decree(paxos::Replica("A"), i, "", paxos::DecreeType::UserDecree),
+                    paxos::Replica(), paxos::Replica(),
+                    paxos::MessageType::RequestMessage)));
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait_for(lock, std::chrono::seconds(5),
+                       [&]() { return is_learner_running && proposer_numbers.size() == 100; });
+    ASSERT_EQ(100, proposer_numbers.size());
+    for (int i=0; i<100; i++)
+    {
+        ASSERT_EQ(i, proposer_numbers[i]);
+    }
+    condition.wait_for(lock, std::chrono::seconds(5), [&]() { return was_proposer_concurrent; });
+    ASSERT_TRUE(was_proposer_concurrent);
+}
+
+
+TEST(NetworkReceiverTest, testProcessMessageIgnoresUnknownMessageType)
+{
+    bool was_callback_called = false;
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    paxos::NetworkReceiver<MockServer, paxos::BinaryCodec> receiver("myhost", 1111, replicaset);
+    receiver.RegisterCallback(
+        paxos::Callback([&was_callback_called](paxos::Message m){was_callback_called = true;}),
+        paxos::MessageType::RequestMessage);
+
+    paxos::Message message;
+    message.type = static_cast<paxos::MessageType>(paxos::MessageTypeCount);
+    receiver.ProcessContent(paxos::BinarySerialize(message));
+
+    ASSERT_FALSE(was_callback_called);
+    ASSERT_EQ(0, receiver.GetRegisteredCallbacks(message.type).size());
+}
+
+
+TEST(NetworkReceiverTest, testCallbackRegisteredAfterDispatchIsRun)
+{
+    int calls = 0;
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    paxos::NetworkReceiver<MockServer, paxos::BinaryCodec> receiver("myhost", 1111, replicaset);
+    receiver.RegisterCallback(
+        paxos::Callback([&calls](paxos::Message m){calls += 1;}),
+        paxos::MessageType::RequestMessage);
+
+    paxos::Message message;
+    message.type = paxos::MessageType::RequestMessage;
+    receiver.ProcessContent(paxos::BinarySerialize(message));
+
+    receiver.RegisterCallback(
+        paxos::Callback([&calls](paxos::Message m){calls += 10;}),
+        paxos::MessageType::RequestMessage);
+    receiver.ProcessContent(paxos::BinarySerialize(message));
+
+    ASSERT_EQ(12, calls);
+}
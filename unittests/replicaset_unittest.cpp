@@ -162,3 +162,105 @@ TEST(ReplicaTest, testSaveReplicaSetWritesIntoStream)
     paxos::SaveReplicaSet(set, replicasetstream);
     ASSERT_EQ("host1:80\nhost2:8080\n", replicasetstream.str());
 }
+
+
+TEST(ReplicaTest, testCopyIsIndependentOfOriginal)
+{
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("host1"));
+    replicaset->Add(paxos::Replica("host2"));
+
+    auto copy = replicaset->Copy();
+    replicaset->Remove(paxos::Replica("host1"));
+
+    ASSERT_EQ(2, copy->GetSize());
+    ASSERT_TRUE(copy->Contains(paxos::Replica("host1")));
+    ASSERT_EQ(1, replicaset->GetSize());
+}
+
+
+TEST(ReplicaSetUnittest, testVoteSetCountsEachMemberOnce)
+{
+    paxos::ReplicaSet set;
+    set.Add(paxos::Replica("host1"));
+    set.Add(paxos::Replica("host2"));
+    set.Add(paxos::Replica("host3"));
+
+    paxos::VoteSet votes;
+    ASSERT_TRUE(votes.Add(paxos::Replica("host1"), set));
+    ASSERT_TRUE(votes.Add(paxos::Replica("host1"), set));
+    ASSERT_TRUE(votes.Add(paxos::Replica("host3"), set));
+
+    ASSERT_EQ(2, votes.Count(set));
+    ASSERT_TRUE(votes.Contains(paxos::Replica("host3"), set));
+    ASSERT_FALSE(votes.Contains(paxos::Replica("host2"), set));
+}
+
+
+TEST(ReplicaSetUnittest, testVoteSetIgnoresReplicasOutsideOfSet)
+{
+    paxos::ReplicaSet set;
+    set.Add(paxos::Replica("host1"));
+
+    paxos::VoteSet votes;
+    ASSERT_FALSE(votes.Add(paxos::Replica("stranger"), set));
+
+    ASSERT_EQ(0, votes.Count(set));
+}
+
+
+TEST(ReplicaSetUnittest, testVotesNoLongerCountOnceMembershipChanges)
+{
+    paxos::ReplicaSet set;
+    set.Add(paxos::Replica("host1"));
+    set.Add(paxos::Replica("host3"));
+
+    paxos::VoteSet votes;
+    votes.Add(paxos::Replica("host3"), set);
+
+    // host2 takes the id host3 voted with.
+    set.Add(paxos::Replica("host2"));
+    ASSERT_EQ(0, votes.Count(set));
+    ASSERT_FALSE(votes.Contains(paxos::Replica("host2"), set));
+
+    votes.Add(paxos::Replica("host2"), set);
+    ASSERT_EQ(1, votes.Count(set));
+    ASSERT_EQ(1, votes.Count(*set.Copy()));
+}
+
+
+TEST(ReplicaSetUnittest, testDifferenceWithVotesReturnsReplicasThatDidNotVote)
+{
+    paxos::ReplicaSet set;
+    set.Add(paxos::Replica("host1"));
+    set.Add(paxos::Replica("host2"));
+
+    paxos::VoteSet votes;
+    votes.Add(paxos::Replica("host2"), set);
+
+    auto absent = set.Difference(votes);
+    ASSERT_EQ(1, absent->GetSize());
+    ASSERT_TRUE(absent->Contains(paxos::Replica("host1")));
+}
+
+
+TEST(ReplicaSetUnittest, testAddingMoreThanMaxReplicasThrows)
+{
+    paxos::ReplicaSet set;
+    for (size_t i=0; i<paxos::MaxReplicas; i++)
+    {
+        set.Add(paxos::Replica("host", i));
+    }
+
+    ASSERT_THROW(set.Add(paxos::Replica("one_too_many")), std::length_error);
+}
+
+
+TEST(ReplicaSetUnittest, testInternReplicaReturnsSameIdForEqualReplicas)
+{
+    auto id = paxos::InternReplica(paxos::Replica("interned_host", 80));
+
+    ASSERT_EQ(id, paxos::InternReplica(paxos::Replica("interned_host", 80)));
+    ASSERT_NE(id, paxos::InternReplica(paxos::Replica("interned_host", 81)));
+    ASSERT_EQ("interned_host", paxos::InternedReplica(id).hostname);
+}
@@ -81,6 +81,7 @@ std::shared_ptr<paxos::AcceptorContext> createAcceptorContext()
     return std::make_shared<paxos::AcceptorContext>(
         std::make_shared<paxos::VolatileDecree>(),
         std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::VolatileVotes>(),
         std::chrono::milliseconds(0)
     );
 }
@@ -495,10 +496,9 @@ TEST_F(ProposerTest, testHandlePromiseWillSendAcceptAgainIfDuplicatePromiseIsSen
     context->replicaset->Add(paxos::Replica("host1"));
     context->replicaset->Add(paxos::Replica("host2"));
     context->replicaset->Add(paxos::Replica("host3"));
-    context->promise_map[message.decree] = std::make_shared<paxos::ReplicaSet>();
-    context->promise_map[message.decree]->Add(paxos::Replica("host1"));
-    context->promise_map[message.decree]->Add(paxos::Replica("host2"));
-    context->promise_map[message.decree]->Add(paxos::Replica("host3"));
+    context->promise_map[paxos::DecreeId(message.decree)].Add(paxos::Replica("host1"), *context->replicaset);
+    context->promise_map[paxos::DecreeId(message.decree)].Add(paxos::Replica("host2"), *context->replicaset);
+    context->promise_map[paxos::DecreeId(message.decree)].Add(paxos::Replica("host3"), *context->replicaset);
     context->requested_values.push_back(std::make_tuple("a_requested_value", paxos::DecreeType::UserDecree, paxos::Replica("author")));
 
     auto sender = std::make_shared<FakeSender>(context->replicaset);
@@ -535,9 +535,8 @@ TEST_F(ProposerTest, testHandlePromiseWillNotSendAcceptAgainIfPromiseIsUnique)
     context->replicaset->Add(paxos::Replica("host1"));
     context->replicaset->Add(paxos::Replica("host2"));
     context->replicaset->Add(paxos::Replica("host3"));
-    context->promise_map[message.decree] = std::make_shared<paxos::ReplicaSet>();
-    context->promise_map[message.decree]->Add(paxos::Replica("host2"));
-    context->promise_map[message.decree]->Add(paxos::Replica("host3"));
+    context->promise_map[paxos::DecreeId(message.decree)].Add(paxos::Replica("host2"), *context->replicaset);
+    context->promise_map[paxos::DecreeId(message.decree)].Add(paxos::Replica("host3"), *context->replicaset);
 
     auto sender = std::make_shared<FakeSender>(context->replicaset);
 
@@ -951,7 +950,7 @@ TEST_F(ProposerTest, testHandleNackInsertsReplicaIntoNackMap)
         sender
     );
 
-    ASSERT_TRUE(std::get<0>(context->nprepare_map[decree])->Contains(replica));
+    ASSERT_TRUE(std::get<0>(context->nprepare_map[paxos::DecreeId(decree)]).Contains(replica, *context->replicaset));
 }
 
 
@@ -1111,8 +1110,7 @@ TEST_F(ProposerTest, testHandleAcceptRemovesEntriesInThePromiseMap)
         std::make_shared<paxos::NoPause>(),
         signal
     );
-    context->promise_map[message.decree] = std::make_shared<paxos::ReplicaSet>();
-    context->promise_map[message.decree]->Add(message.from);
+    context->promise_map[paxos::DecreeId(message.decree)].Add(message.from, *context->replicaset);
 
     ASSERT_EQ(context->promise_map.size(), 1);
 
@@ -1220,6 +1218,505 @@ TEST_F(ProposerTest, testHandleResumeWithHigherDecreeThanHighestProposedDecreeWi
 }
 
 
+TEST_F(ProposerTest, testHandlePromiseWithPipelineWindowSendsAcceptsForConsecutiveRootDecrees)
+{
+    paxos::Message message(paxos::Decree(paxos::Replica("host"), 1, "", paxos::DecreeType::UserDecree), paxos::Replica("host"), paxos::Replica("host"), paxos::MessageType::PromiseMessage);
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("host"));
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    auto signal = std::make_shared<paxos::Signal>();
+    auto context = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal
+    );
+    context->pipeline_window = 3;
+    context->highest_proposed_decree = paxos::Decree(paxos::Replica("host"), 1, "", paxos::DecreeType::UserDecree);
+    context->requested_values.push_back(std::make_tuple("first", paxos::DecreeType::UserDecree, paxos::Replica("host")));
+    context->requested_values.push_back(std::make_tuple("second", paxos::DecreeType::UserDecree, paxos::Replica("host")));
+    context->requested_values.push_back(std::make_tuple("third", paxos::DecreeType::UserDecree, paxos::Replica("host")));
+    context->requested_values.push_back(std::make_tuple("fourth", paxos::DecreeType::UserDecree, paxos::Replica("host")));
+
+    auto sender = std::make_shared<FakeSender>(context->replicaset);
+
+    HandlePromise(message, context, sender);
+
+    ASSERT_EQ(3, sender->sentMessages().size());
+    for (int i=0; i<3; i++)
+    {
+        ASSERT_EQ(paxos::MessageType::AcceptMessage, sender->sentMessages()[i].type);
+        ASSERT_EQ(1, sender->sentMessages()[i].decree.number);
+        ASSERT_EQ(i + 1, sender->sentMessages()[i].decree.root_number);
+    }
+    ASSERT_EQ("first", sender->sentMessages()[0].decree.content);
+    ASSERT_EQ("second", sender->sentMessages()[1].decree.content);
+    ASSERT_EQ("third", sender->sentMessages()[2].decree.content);
+    ASSERT_TRUE(context->is_leader);
+    ASSERT_EQ(1, context->requested_values.size());
+}
+
+
+TEST_F(ProposerTest, testHandleRequestAsLeaderSkipsPrepareAndSendsAccept)
+{
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("host"));
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    ledger->Append(paxos::Decree(paxos::Replica("host"), 1, "first", paxos::DecreeType::UserDecree));
+    auto signal = std::make_shared<paxos::Signal>();
+    auto context = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal
+    );
+    context->pipeline_window = 3;
+    context->is_leader = true;
+    context->leader_decree = paxos::Decree(paxos::Replica("host"), 1, "first", paxos::DecreeType::UserDecree);
+
+    auto sender = std::make_shared<FakeSender>(context->replicaset);
+
+    HandleRequest(
+        paxos::Message(
+            paxos::Decree(paxos::Replica("host"), -1, "second", paxos::DecreeType::UserDecree),
+            paxos::Replica("host"),
+            paxos::Replica("host"),
+            paxos::MessageType::RequestMessage
+        ),
+        context,
+        sender
+    );
+
+    ASSERT_MESSAGE_TYPE_NOT_SENT(sender, paxos::MessageType::PrepareMessage);
+    ASSERT_EQ(1, sender->sentMessages().size());
+    ASSERT_EQ(paxos::MessageType::AcceptMessage, sender->sentMessages()[0].type);
+    ASSERT_EQ(1, sender->sentMessages()[0].decree.number);
+    ASSERT_EQ(2, sender->sentMessages()[0].decree.root_number);
+    ASSERT_EQ("second", sender->sentMessages()[0].decree.content);
+}
+
+
+TEST_F(ProposerTest, testHandleRequestAsLeaderDoesNotExceedPipelineWindow)
+{
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("host"));
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    auto signal = std::make_shared<paxos::Signal>();
+    auto context = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal
+    );
+    context->pipeline_window = 2;
+    context->is_leader = true;
+    context->leader_decree = paxos::Decree(paxos::Replica("host"), 1, "first", paxos::DecreeType::UserDecree);
+
+    auto sender = std::make_shared<FakeSender>(context->replicaset);
+
+    for (auto content : {"second", "third", "fourth"})
+    {
+        HandleRequest(
+            paxos::Message(
+                paxos::Decree(paxos::Replica("host"), -1, content, paxos::DecreeType::UserDecree),
+                paxos::Replica("host"),
+                paxos::Replica("host"),
+                paxos::MessageType::RequestMessage
+            ),
+            context,
+            sender
+        );
+    }
+
+    // Root decree 1 is still in flight so only root decree 2 fits the window.
+    ASSERT_EQ(1, sender->sentMessages().size());
+    ASSERT_EQ(2, sender->sentMessages()[0].decree.root_number);
+    ASSERT_EQ(2, context->requested_values.size());
+}
+
+
+TEST_F(ProposerTest, testHandleNackAsLeaderStepsDownAndKeepsInflightDecreesForRecovery)
+{
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("host"));
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    auto signal = std::make_shared<paxos::Signal>();
+    auto context = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal
+    );
+    paxos::Decree second(paxos::Replica("host"), 1, "second", paxos::DecreeType::UserDecree);
+    second.root_number = 2;
+    paxos::Decree third(paxos::Replica("host"), 1, "third", paxos::DecreeType::UserDecree);
+    third.root_number = 3;
+    context->pipeline_window = 3;
+    context->is_leader = true;
+    context->inflight_decrees[2] = second;
+    context->inflight_decrees[3] = third;
+    context->requested_values.push_back(std::make_tuple("fourth", paxos::DecreeType::UserDecree, paxos::Replica("host")));
+
+    auto sender = std::make_shared<FakeSender>(context->replicaset);
+
+    HandleNack(
+        paxos::Message(third, paxos::Replica("host"), paxos::Replica("host"), paxos::MessageType::NackMessage),
+        context,
+        sender
+    );
+
+    ASSERT_FALSE(context->is_leader);
+    ASSERT_EQ(0, context->inflight_decrees.size());
+    ASSERT_EQ(2, context->recovering_decrees.size());
+    ASSERT_EQ("second", context->recovering_decrees[2].content);
+    ASSERT_EQ("third", context->recovering_decrees[3].content);
+    ASSERT_EQ(1, context->requested_values.size());
+    ASSERT_EQ("fourth", std::get<0>(context->requested_values[0]));
+}
+
+
+TEST_F(ProposerTest, testHandleResumeAsLeaderRetiresInflightDecreesUpToLedgerTail)
+{
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    auto signal = std::make_shared<paxos::Signal>();
+    auto context = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal
+    );
+    paxos::Decree first(paxos::Replica("host"), 1, "first", paxos::DecreeType::UserDecree);
+    paxos::Decree second(paxos::Replica("host"), 1, "second", paxos::DecreeType::UserDecree);
+    second.root_number = 2;
+    paxos::Decree third(paxos::Replica("host"), 1, "third", paxos::DecreeType::UserDecree);
+    third.root_number = 3;
+    ledger->Append(first);
+    ledger->Append(second);
+    context->pipeline_window = 3;
+    context->is_leader = true;
+    context->inflight_decrees[2] = second;
+    context->inflight_decrees[3] = third;
+
+    HandleResume(
+        paxos::Message(first, paxos::Replica("host"), paxos::Replica("host"), paxos::MessageType::ResumeMessage),
+        context,
+        std::make_shared<FakeSender>()
+    );
+
+    ASSERT_TRUE(context->is_leader);
+    ASSERT_EQ(1, context->inflight_decrees.size());
+    ASSERT_EQ(1, context->inflight_decrees.count(3));
+}
+
+
+TEST_F(ProposerTest, testHandleResumeAsLeaderStepsDownWhenAnotherAuthorPassesDecree)
+{
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    auto signal = std::make_shared<paxos::Signal>();
+    auto context = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal
+    );
+    paxos::Decree other(paxos::Replica("other"), 2, "other", paxos::DecreeType::UserDecree);
+    other.root_number = 1;
+    paxos::Decree ours(paxos::Replica("host"), 1, "ours", paxos::DecreeType::UserDecree);
+    ledger->Append(other);
+    context->pipeline_window = 3;
+    context->is_leader = true;
+    context->inflight_decrees[1] = ours;
+
+    HandleResume(
+        paxos::Message(other, paxos::Replica("host"), paxos::Replica("host"), paxos::MessageType::ResumeMessage),
+        context,
+        std::make_shared<FakeSender>()
+    );
+
+    ASSERT_FALSE(context->is_leader);
+    ASSERT_EQ(0, context->inflight_decrees.size());
+    ASSERT_EQ(0, context->recovering_decrees.size());
+    ASSERT_EQ(1, context->requested_values.size());
+    ASSERT_EQ("ours", std::get<0>(context->requested_values[0]));
+}
+
+
+TEST_F(ProposerTest, testHandleResumeDropsRecoveringDecreesChosenAtTheirRoots)
+{
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    auto signal = std::make_shared<paxos::Signal>();
+    auto context = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal
+    );
+    paxos::Decree first(paxos::Replica("host"), 1, "first", paxos::DecreeType::UserDecree);
+    paxos::Decree second(paxos::Replica("host"), 1, "second", paxos::DecreeType::UserDecree);
+    second.root_number = 2;
+    paxos::Decree other(paxos::Replica("other"), 2, "other", paxos::DecreeType::UserDecree);
+    other.root_number = 2;
+    paxos::Decree third(paxos::Replica("host"), 1, "third", paxos::DecreeType::UserDecree);
+    third.root_number = 3;
+    ledger->Append(first);
+    ledger->Append(other);
+    context->recovering_decrees[1] = first;
+    context->recovering_decrees[2] = second;
+    context->recovering_decrees[3] = third;
+
+    HandleResume(
+        paxos::Message(other, paxos::Replica("host"), paxos::Replica("host"), paxos::MessageType::ResumeMessage),
+        context,
+        std::make_shared<FakeSender>()
+    );
+
+    ASSERT_EQ(1, context->recovering_decrees.size());
+    ASSERT_EQ(1, context->recovering_decrees.count(3));
+    ASSERT_EQ(1, context->requested_values.size());
+    ASSERT_EQ("second", std::get<0>(context->requested_values[0]));
+}
+
+
+TEST_F(ProposerTest, testHandlePromiseWithVoteForRecoveringDecreeResendsAccept)
+{
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("host"));
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    auto signal = std::make_shared<paxos::Signal>();
+    auto context = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal
+    );
+    paxos::Decree second(paxos::Replica("host"), 1, "second", paxos::DecreeType::UserDecree);
+    second.root_number = 2;
+    context->pipeline_window = 3;
+    context->highest_proposed_decree = paxos::Decree(paxos::Replica("host"), 2, "", paxos::DecreeType::UserDecree);
+    context->recovering_decrees[2] = second;
+
+    auto sender = std::make_shared<FakeSender>(context->replicaset);
+
+    HandlePromise(
+        paxos::Message(second, paxos::Replica("host"), paxos::Replica("host"), paxos::MessageType::PromiseMessage),
+        context,
+        sender
+    );
+
+    ASSERT_EQ(1, sender->sentMessages().size());
+    ASSERT_EQ(paxos::MessageType::AcceptMessage, sender->sentMessages()[0].type);
+    ASSERT_EQ(2, sender->sentMessages()[0].decree.root_number);
+    ASSERT_EQ("second", sender->sentMessages()[0].decree.content);
+    ASSERT_FALSE(context->is_leader);
+    ASSERT_EQ(1, context->recovering_decrees.size());
+}
+
+
+TEST_F(ProposerTest, testHandlePromiseWithQuorumProposesRecoveringDecreesAtTheirRoots)
+{
+    paxos::Message message(paxos::Decree(paxos::Replica("host"), 2, "", paxos::DecreeType::UserDecree), paxos::Replica("host"), paxos::Replica("host"), paxos::MessageType::PromiseMessage);
+    message.decree.root_number = 1;
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("host"));
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    auto signal = std::make_shared<paxos::Signal>();
+    auto context = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal
+    );
+    paxos::Decree first(paxos::Replica("host"), 1, "first", paxos::DecreeType::UserDecree);
+    paxos::Decree second(paxos::Replica("host"), 1, "second", paxos::DecreeType::UserDecree);
+    second.root_number = 2;
+    context->pipeline_window = 3;
+    context->highest_proposed_decree = message.decree;
+    context->recovering_decrees[1] = first;
+    context->recovering_decrees[2] = second;
+    context->requested_values.push_back(std::make_tuple("third", paxos::DecreeType::UserDecree, paxos::Replica("host")));
+
+    auto sender = std::make_shared<FakeSender>(context->replicaset);
+
+    HandlePromise(message, context, sender);
+
+    ASSERT_EQ(3, sender->sentMessages().size());
+    for (int i=0; i<3; i++)
+    {
+        ASSERT_EQ(paxos::MessageType::AcceptMessage, sender->sentMessages()[i].type);
+        ASSERT_EQ(2, sender->sentMessages()[i].decree.number);
+        ASSERT_EQ(i + 1, sender->sentMessages()[i].decree.root_number);
+    }
+    ASSERT_EQ("first", sender->sentMessages()[0].decree.content);
+    ASSERT_EQ("second", sender->sentMessages()[1].decree.content);
+    ASSERT_EQ("third", sender->sentMessages()[2].decree.content);
+    ASSERT_TRUE(context->is_leader);
+    ASSERT_EQ(0, context->recovering_decrees.size());
+    ASSERT_EQ(0, context->requested_values.size());
+}
+
+
+TEST_F(ProposerTest, testHandlePromiseWithBatchingCoalescesRequestedValuesIntoBatchDecree)
+{
+    paxos::Message message(paxos::Decree(paxos::Replica("host"), 1, "", paxos::DecreeType::UserDecree), paxos::Replica("host"), paxos::Replica("host"), paxos::MessageType::PromiseMessage);
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("host"));
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    auto signal = std::make_shared<paxos::Signal>();
+    auto context = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal
+    );
+    context->batch_max_bytes = 10;
+    context->highest_proposed_decree = paxos::Decree(paxos::Replica("host"), 1, "", paxos::DecreeType::UserDecree);
+    context->requested_values.push_back(std::make_tuple("aaaa", paxos::DecreeType::UserDecree, paxos::Replica("host")));
+    context->requested_values.push_back(std::make_tuple("bbbb", paxos::DecreeType::UserDecree, paxos::Replica("host")));
+    context->requested_values.push_back(std::make_tuple("cccc", paxos::DecreeType::UserDecree, paxos::Replica("host")));
+
+    auto sender = std::make_shared<FakeSender>(context->replicaset);
+
+    HandlePromise(message, context, sender);
+
+    ASSERT_EQ(1, sender->sentMessages().size());
+    ASSERT_EQ(paxos::MessageType::AcceptMessage, sender->sentMessages()[0].type);
+    ASSERT_EQ(paxos::DecreeType::BatchDecree, sender->sentMessages()[0].decree.type);
+    ASSERT_EQ(
+        std::vector<std::string>({ "aaaa", "bbbb" }),
+        paxos::BinaryDeserialize<std::vector<std::string>>(sender->sentMessages()[0].decree.content));
+    ASSERT_EQ(1, context->requested_values.size());
+}
+
+
+TEST_F(ProposerTest, testHandlePromiseWithBatchingDoesNotBatchSystemDecrees)
+{
+    paxos::Message message(paxos::Decree(paxos::Replica("host"), 1, "", paxos::DecreeType::UserDecree), paxos::Replica("host"), paxos::Replica("host"), paxos::MessageType::PromiseMessage);
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("host"));
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    auto signal = std::make_shared<paxos::Signal>();
+    auto context = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal
+    );
+    context->batch_max_bytes = 1024;
+    context->highest_proposed_decree = paxos::Decree(paxos::Replica("host"), 1, "", paxos::DecreeType::UserDecree);
+    context->requested_values.push_back(std::make_tuple("aaaa", paxos::DecreeType::UserDecree, paxos::Replica("host")));
+    context->requested_values.push_back(std::make_tuple("add", paxos::DecreeType::AddReplicaDecree, paxos::Replica("host")));
+
+    auto sender = std::make_shared<FakeSender>(context->replicaset);
+
+    HandlePromise(message, context, sender);
+
+    ASSERT_EQ(1, sender->sentMessages().size());
+    ASSERT_EQ(paxos::DecreeType::UserDecree, sender->sentMessages()[0].decree.type);
+    ASSERT_EQ("aaaa", sender->sentMessages()[0].decree.content);
+    ASSERT_EQ(1, context->requested_values.size());
+}
+
+
+TEST_F(ProposerTest, testHandleRequestWithBatchDelayHoldsPrepareUntilBatchIsFull)
+{
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("host"));
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    auto signal = std::make_shared<paxos::Signal>();
+    auto context = std::make_shared<paxos::ProposerContext>(
+        replicaset,
+        ledger,
+        std::make_shared<paxos::VolatileDecree>(),
+        std::make_shared<paxos::NoPause>(),
+        signal
+    );
+    context->batch_max_bytes = 8;
+    context->batch_max_delay = std::chrono::milliseconds(60000);
+
+    auto sender = std::make_shared<FakeSender>(context->replicaset);
+
+    HandleRequest(
+        paxos::Message(
+            paxos::Decree(paxos::Replica("host"), -1, "aaaa", paxos::DecreeType::UserDecree),
+            paxos::Replica("host"),
+            paxos::Replica("host"),
+            paxos::MessageType::RequestMessage
+        ),
+        context,
+        sender
+    );
+
+    ASSERT_MESSAGE_TYPE_NOT_SENT(sender, paxos::MessageType::PrepareMessage);
+
+    HandleRequest(
+        paxos::Message(
+            paxos::Decree(paxos::Replica("host"), -1, "bbbb", paxos::DecreeType::UserDecree),
+            paxos::Replica("host"),
+            paxos::Replica("host"),
+            paxos::MessageType::RequestMessage
+        ),
+        context,
+        sender
+    );
+
+    ASSERT_MESSAGE_TYPE_SENT(sender, paxos::MessageType::PrepareMessage);
+}
+
+
 class AcceptorTest: public testing::Test
 {
     virtual void SetUp()
@@ -1463,6 +1960,156 @@ TEST_F(AcceptorTest, testHandleAcceptWithHigherDecreeDoesUpdateAcceptedDecree)
 }
 
 
+TEST_F(AcceptorTest, testHandleAcceptWithPipelinedDecreeOvertakenByHigherRootSendsAccepted)
+{
+    paxos::Decree promised(paxos::Replica("the_author"), 1, "", paxos::DecreeType::UserDecree);
+    paxos::Decree second(paxos::Replica("the_author"), 1, "second", paxos::DecreeType::UserDecree);
+    second.root_number = 2;
+    paxos::Decree third(paxos::Replica("the_author"), 1, "third", paxos::DecreeType::UserDecree);
+    third.root_number = 3;
+
+    auto context = createAcceptorContext();
+    context->interval = std::chrono::milliseconds(1000);
+    context->promised_decree = promised;
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("the_author"));
+    auto sender = std::make_shared<FakeSender>(replicaset);
+
+    HandleAccept(paxos::Message(third, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::AcceptMessage), context, sender);
+    HandleAccept(paxos::Message(second, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::AcceptMessage), context, sender);
+    HandleAccept(paxos::Message(second, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::AcceptMessage), context, sender);
+
+    ASSERT_EQ(2, sender->sentMessages().size());
+    ASSERT_EQ(3, sender->sentMessages()[0].decree.root_number);
+    ASSERT_EQ(2, sender->sentMessages()[1].decree.root_number);
+    ASSERT_EQ(paxos::MessageType::AcceptedMessage, sender->sentMessages()[1].type);
+    ASSERT_EQ(3, context->accepted_decree.Value().root_number);
+}
+
+
+TEST_F(AcceptorTest, testHandleAcceptWithPreparedDecreeOvertakenByPipelinedRootSendsAccepted)
+{
+    paxos::Decree promised(paxos::Replica("the_author"), 1, "", paxos::DecreeType::UserDecree);
+    promised.root_number = 1;
+    paxos::Decree first(paxos::Replica("the_author"), 1, "first", paxos::DecreeType::UserDecree);
+    first.root_number = 1;
+    paxos::Decree second(paxos::Replica("the_author"), 1, "second", paxos::DecreeType::UserDecree);
+    second.root_number = 2;
+
+    auto context = createAcceptorContext();
+    context->promised_decree = promised;
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("the_author"));
+    auto sender = std::make_shared<FakeSender>(replicaset);
+
+    HandleAccept(paxos::Message(second, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::AcceptMessage), context, sender);
+    HandleAccept(paxos::Message(first, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::AcceptMessage), context, sender);
+
+    ASSERT_MESSAGE_TYPE_NOT_SENT(sender, paxos::MessageType::NackMessage);
+    ASSERT_EQ(2, sender->sentMessages().size());
+    ASSERT_EQ(1, sender->sentMessages()[1].decree.root_number);
+    ASSERT_EQ(paxos::MessageType::AcceptedMessage, sender->sentMessages()[1].type);
+    ASSERT_EQ(2, context->accepted_decree.Value().root_number);
+}
+
+
+TEST_F(AcceptorTest, testHandleAcceptResendOfOvertakenDecreeRepeatsAccepted)
+{
+    paxos::Decree promised(paxos::Replica("the_author"), 1, "", paxos::DecreeType::UserDecree);
+    paxos::Decree second(paxos::Replica("the_author"), 1, "second", paxos::DecreeType::UserDecree);
+    second.root_number = 2;
+    paxos::Decree third(paxos::Replica("the_author"), 1, "third", paxos::DecreeType::UserDecree);
+    third.root_number = 3;
+
+    auto context = createAcceptorContext();
+    context->interval = std::chrono::milliseconds(0);
+    context->promised_decree = promised;
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("the_author"));
+    auto sender = std::make_shared<FakeSender>(replicaset);
+
+    HandleAccept(paxos::Message(second, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::AcceptMessage), context, sender);
+    HandleAccept(paxos::Message(third, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::AcceptMessage), context, sender);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    HandleAccept(paxos::Message(second, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::AcceptMessage), context, sender);
+
+    ASSERT_MESSAGE_TYPE_NOT_SENT(sender, paxos::MessageType::NackMessage);
+    ASSERT_EQ(3, sender->sentMessages().size());
+    ASSERT_EQ(2, sender->sentMessages()[2].decree.root_number);
+    ASSERT_EQ(paxos::MessageType::AcceptedMessage, sender->sentMessages()[2].type);
+    ASSERT_EQ(3, context->accepted_decree.Value().root_number);
+}
+
+
+TEST_F(AcceptorTest, testHandleAcceptWithLostMiddleRootIsAcceptedAndReturnedByPrepare)
+{
+    paxos::Decree promised(paxos::Replica("the_author"), 1, "", paxos::DecreeType::UserDecree);
+    paxos::Decree first(paxos::Replica("the_author"), 1, "first", paxos::DecreeType::UserDecree);
+    paxos::Decree second(paxos::Replica("the_author"), 1, "second", paxos::DecreeType::UserDecree);
+    second.root_number = 2;
+    paxos::Decree third(paxos::Replica("the_author"), 1, "third", paxos::DecreeType::UserDecree);
+    third.root_number = 3;
+
+    auto context = createAcceptorContext();
+    context->promised_decree = promised;
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("the_author"));
+    auto sender = std::make_shared<FakeSender>(replicaset);
+
+    //
+    // The accept for root 2 is lost and only resent after root 3 got through.
+    //
+    HandleAccept(paxos::Message(first, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::AcceptMessage), context, sender);
+    HandleAccept(paxos::Message(third, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::AcceptMessage), context, sender);
+    HandleAccept(paxos::Message(second, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::AcceptMessage), context, sender);
+
+    ASSERT_MESSAGE_TYPE_NOT_SENT(sender, paxos::MessageType::NackMessage);
+    ASSERT_EQ(3, sender->sentMessages().size());
+    ASSERT_EQ(2, sender->sentMessages()[2].decree.root_number);
+    ASSERT_EQ(paxos::MessageType::AcceptedMessage, sender->sentMessages()[2].type);
+    ASSERT_EQ(3, context->accepted_decree.Value().root_number);
+
+    //
+    // A new prepare for root 2 learns every vote at or above it.
+    //
+    paxos::Decree prepare(paxos::Replica("other"), 2, "", paxos::DecreeType::UserDecree);
+    HandlePrepare(paxos::Message(prepare, paxos::Replica("other"), paxos::Replica("to"), paxos::MessageType::PrepareMessage), context, sender);
+
+    ASSERT_EQ(5, sender->sentMessages().size());
+    ASSERT_EQ(paxos::MessageType::PromiseMessage, sender->sentMessages()[3].type);
+    ASSERT_EQ("second", sender->sentMessages()[3].decree.content);
+    ASSERT_EQ(paxos::MessageType::PromiseMessage, sender->sentMessages()[4].type);
+    ASSERT_EQ("third", sender->sentMessages()[4].decree.content);
+}
+
+
+TEST_F(AcceptorTest, testHandleAcceptWithPipelinedDecreeFromSupersededBallotIsIgnored)
+{
+    paxos::Decree promised(paxos::Replica("other"), 5, "", paxos::DecreeType::UserDecree);
+    promised.root_number = 1;
+    paxos::Decree accepted(paxos::Replica("other"), 5, "accepted", paxos::DecreeType::UserDecree);
+    accepted.root_number = 3;
+    paxos::Decree stale(paxos::Replica("the_author"), 1, "stale", paxos::DecreeType::UserDecree);
+    stale.root_number = 2;
+
+    auto context = createAcceptorContext();
+    context->promised_decree = promised;
+    context->accepted_decree = accepted;
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("the_author"));
+    auto sender = std::make_shared<FakeSender>(replicaset);
+
+    HandleAccept(paxos::Message(stale, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::AcceptMessage), context, sender);
+
+    ASSERT_MESSAGE_TYPE_NOT_SENT(sender, paxos::MessageType::AcceptedMessage);
+}
+
+
 TEST_F(AcceptorTest, testHandleCleanupResetsAcceptDecreeContentsWhenDecreeIsEqual)
 {
     paxos::Message message(paxos::Decree(paxos::Replica("the_author"), 2, "accepted decree content", paxos::DecreeType::UserDecree), paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::ResumeMessage);
@@ -1496,6 +2143,29 @@ TEST_F(AcceptorTest, testHandleCleanupDoesNotResetAcceptDecreeContentsWhenDecree
 }
 
 
+TEST_F(AcceptorTest, testHandleCleanupRetiresVotesUpToResumedDecree)
+{
+    paxos::Decree first(paxos::Replica("the_author"), 1, "first", paxos::DecreeType::UserDecree);
+    paxos::Decree second(paxos::Replica("the_author"), 1, "second", paxos::DecreeType::UserDecree);
+    second.root_number = 2;
+    paxos::Decree third(paxos::Replica("the_author"), 1, "third", paxos::DecreeType::UserDecree);
+    third.root_number = 3;
+
+    auto context = createAcceptorContext();
+    context->accepted_decree = third;
+    context->accepted_votes->Put(first);
+    context->accepted_votes->Put(second);
+    context->accepted_votes->Put(third);
+
+    HandleCleanup(paxos::Message(second, paxos::Replica("from"), paxos::Replica("to"), paxos::MessageType::ResumeMessage), context, std::make_shared<FakeSender>());
+
+    auto votes = context->accepted_votes->From(0);
+    ASSERT_EQ(1, votes.size());
+    ASSERT_EQ("third", votes[0].content);
+    ASSERT_EQ("third", context->accepted_decree.Value().content);
+}
+
+
 class LearnerTest: public testing::Test
 {
     virtual void SetUp()
@@ -1537,6 +2207,8 @@ TEST_F(LearnerTest, testRegisterLearnerWillRegistereMessageTypes)
 
     ASSERT_TRUE(receiver->IsMessageTypeRegister(paxos::MessageType::AcceptedMessage));
     ASSERT_TRUE(receiver->IsMessageTypeRegister(paxos::MessageType::UpdatedMessage));
+    ASSERT_TRUE(receiver->IsMessageTypeRegister(paxos::MessageType::SnapshotMessage));
+    ASSERT_TRUE(receiver->IsMessageTypeRegister(paxos::MessageType::UpdatedRangeMessage));
 
     ASSERT_FALSE(receiver->IsMessageTypeRegister(paxos::MessageType::RequestMessage));
     ASSERT_FALSE(receiver->IsMessageTypeRegister(paxos::MessageType::PrepareMessage));
@@ -1632,7 +2304,7 @@ TEST_F(LearnerTest, testAcceptedHandleCleansUpAcceptedMapAfterAllVotesReceived)
         std::shared_ptr<FakeSender>(new FakeSender())
     );
 
-    ASSERT_FALSE(context->accepted_map.find(decree) == context->accepted_map.end());
+    ASSERT_FALSE(context->accepted_map.find(paxos::DecreeId(decree)) == context->accepted_map.end());
 
     HandleAccepted(
         paxos::Message(
@@ -1645,7 +2317,7 @@ TEST_F(LearnerTest, testAcceptedHandleCleansUpAcceptedMapAfterAllVotesReceived)
         std::shared_ptr<FakeSender>(new FakeSender())
     );
 
-    ASSERT_FALSE(context->accepted_map.find(decree) == context->accepted_map.end());
+    ASSERT_FALSE(context->accepted_map.find(paxos::DecreeId(decree)) == context->accepted_map.end());
 
     HandleAccepted(
         paxos::Message(
@@ -1658,7 +2330,7 @@ TEST_F(LearnerTest, testAcceptedHandleCleansUpAcceptedMapAfterAllVotesReceived)
         std::shared_ptr<FakeSender>(new FakeSender())
     );
 
-    ASSERT_TRUE(context->accepted_map.find(decree) == context->accepted_map.end());
+    ASSERT_TRUE(context->accepted_map.find(paxos::DecreeId(decree)) == context->accepted_map.end());
 }
 
 
@@ -2080,6 +2752,106 @@ TEST_F(LearnerTest, testHandleUpdatedReceivesMessageWithNextOrderedDecreeAndTrac
 }
 
 
+TEST_F(LearnerTest, testHandleUpdatedRangeAppendsRunAndRequestsNextRun)
+{
+    std::vector<paxos::Decree> range {
+        paxos::Decree(paxos::Replica("A"), 1, "", paxos::DecreeType::UserDecree),
+        paxos::Decree(paxos::Replica("A"), 2, "", paxos::DecreeType::UserDecree),
+        paxos::Decree(paxos::Replica("A"), 3, "", paxos::DecreeType::UserDecree),
+    };
+    paxos::Decree decree(paxos::Replica("A"), 3, paxos::BinarySerialize(range), paxos::DecreeType::UserDecree);
+    context->tracked_future_decrees.push(paxos::Decree(paxos::Replica("A"), 2, "", paxos::DecreeType::UserDecree));
+    context->tracked_future_decrees.push(paxos::Decree(paxos::Replica("A"), 4, "", paxos::DecreeType::UserDecree));
+    auto sender = std::make_shared<FakeSender>();
+
+    HandleUpdatedRange(
+        paxos::Message(decree, paxos::Replica("B"), paxos::Replica("A"), paxos::MessageType::UpdatedRangeMessage),
+        context,
+        sender
+    );
+
+    // Run and the tracked decree that follows it are appended.
+    ASSERT_EQ(GetQueueSize(queue), 4);
+    ASSERT_EQ(0, context->tracked_future_decrees.size());
+    ASSERT_MESSAGE_TYPE_SENT(sender, paxos::MessageType::UpdateMessage);
+    ASSERT_EQ(4, sender->sentMessages()[0].decree.number);
+
+    // Replaying the same run appends nothing and does not ask for more.
+    sender = std::make_shared<FakeSender>();
+    HandleUpdatedRange(
+        paxos::Message(decree, paxos::Replica("B"), paxos::Replica("A"), paxos::MessageType::UpdatedRangeMessage),
+        context,
+        sender
+    );
+
+    ASSERT_EQ(GetQueueSize(queue), 4);
+    ASSERT_EQ(0, sender->sentMessages().size());
+}
+
+
+TEST_F(LearnerTest, testHandleSnapshotRestoresStateAndRequestsUpdate)
+{
+    std::string state;
+    ledger->RegisterSnapshotHandler(
+        std::make_shared<paxos::CallbackSnapshotHandler>(
+            []() { return std::string(); },
+            [&state](std::string snapshot) { state = snapshot; }));
+    context->ledger->Append(paxos::Decree(paxos::Replica("A"), 1, "", paxos::DecreeType::UserDecree));
+    context->tracked_future_decrees.push(paxos::Decree(paxos::Replica("A"), 4, "", paxos::DecreeType::UserDecree));
+    context->tracked_future_decrees.push(paxos::Decree(paxos::Replica("A"), 6, "", paxos::DecreeType::UserDecree));
+    context->tracked_future_decrees.push(paxos::Decree(paxos::Replica("A"), 8, "", paxos::DecreeType::UserDecree));
+    auto sender = std::make_shared<FakeSender>();
+
+    HandleSnapshot(
+        paxos::Message(
+            paxos::Decree(paxos::Replica("A"), 5, "state", paxos::DecreeType::UserDecree),
+            paxos::Replica("B"), paxos::Replica("A"),
+            paxos::MessageType::SnapshotMessage
+        ),
+        context,
+        sender
+    );
+
+    ASSERT_EQ("state", state);
+
+    // Decree 1 is superseded and decree 6 directly follows the snapshot.
+    ASSERT_EQ(GetQueueSize(queue), 1);
+    ASSERT_EQ(6, context->ledger->Tail().number);
+    ASSERT_EQ(1, context->tracked_future_decrees.size());
+
+    // Ask for the decrees that follow the snapshot.
+    ASSERT_MESSAGE_TYPE_SENT(sender, paxos::MessageType::UpdateMessage);
+    ASSERT_EQ(6, sender->sentMessages()[0].decree.number);
+}
+
+
+TEST_F(LearnerTest, testHandleSnapshotIgnoresSnapshotBehindLedger)
+{
+    std::string state;
+    ledger->RegisterSnapshotHandler(
+        std::make_shared<paxos::CallbackSnapshotHandler>(
+            []() { return std::string(); },
+            [&state](std::string snapshot) { state = snapshot; }));
+    context->ledger->Append(paxos::Decree(paxos::Replica("A"), 1, "", paxos::DecreeType::UserDecree));
+    context->ledger->Append(paxos::Decree(paxos::Replica("A"), 2, "", paxos::DecreeType::UserDecree));
+    auto sender = std::make_shared<FakeSender>();
+
+    HandleSnapshot(
+        paxos::Message(
+            paxos::Decree(paxos::Replica("A"), 2, "state", paxos::DecreeType::UserDecree),
+            paxos::Replica("B"), paxos::Replica("A"),
+            paxos::MessageType::SnapshotMessage
+        ),
+        context,
+        sender
+    );
+
+    ASSERT_EQ("", state);
+    ASSERT_EQ(GetQueueSize(queue), 2);
+    ASSERT_EQ(0, sender->sentMessages().size());
+}
+
+
 class UpdaterTest: public testing::Test
 {
     virtual void SetUp()
@@ -2171,3 +2943,106 @@ TEST_F(UpdaterTest, testHandleUpdateReceivesMessageWithDecreeAndLedgerHasNextDec
     // Our ledger contained next decree so we shoul send an updated message.
     ASSERT_MESSAGE_TYPE_SENT(sender, paxos::MessageType::UpdatedMessage);
 }
+
+
+TEST_F(UpdaterTest, testHandleUpdateSendsSnapshotWhenNextDecreeWasCompacted)
+{
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    ledger->RegisterSnapshotHandler(
+        std::make_shared<paxos::CallbackSnapshotHandler>(
+            []() { return std::string("state"); },
+            [](std::string snapshot) {}));
+    auto context = std::make_shared<paxos::UpdaterContext>(
+        ledger
+    );
+    auto sender = std::make_shared<FakeSender>();
+
+    context->ledger->Append(paxos::Decree(paxos::Replica("A"), 1, "", paxos::DecreeType::UserDecree));
+    context->ledger->Append(paxos::Decree(paxos::Replica("A"), 2, "", paxos::DecreeType::UserDecree));
+    context->ledger->TakeSnapshot();
+    context->ledger->Append(paxos::Decree(paxos::Replica("A"), 3, "", paxos::DecreeType::UserDecree));
+
+    HandleUpdate(
+        paxos::Message(
+            paxos::Decree(paxos::Replica("A"), 0, "", paxos::DecreeType::UserDecree),
+            paxos::Replica("A"), paxos::Replica("A"),
+            paxos::MessageType::UpdateMessage
+        ),
+        context,
+        sender
+    );
+
+    // Decrees 1 and 2 are only available through the snapshot.
+    ASSERT_MESSAGE_TYPE_SENT(sender, paxos::MessageType::SnapshotMessage);
+    ASSERT_EQ(2, sender->sentMessages()[0].decree.root_number);
+    ASSERT_EQ("state", sender->sentMessages()[0].decree.content);
+
+    sender = std::make_shared<FakeSender>();
+    HandleUpdate(
+        paxos::Message(
+            paxos::Decree(paxos::Replica("A"), 2, "", paxos::DecreeType::UserDecree),
+            paxos::Replica("A"), paxos::Replica("A"),
+            paxos::MessageType::UpdateMessage
+        ),
+        context,
+        sender
+    );
+
+    // Decree 3 is still in the ledger.
+    ASSERT_MESSAGE_TYPE_SENT(sender, paxos::MessageType::UpdatedMessage);
+    ASSERT_EQ(3, sender->sentMessages()[0].decree.number);
+}
+
+
+TEST_F(UpdaterTest, testHandleUpdateSendsRunOfDecreesWithinWindow)
+{
+    std::stringstream ss;
+    auto ledger = std::make_shared<paxos::Ledger>(
+        std::make_shared<paxos::RolloverQueue<paxos::Decree>>(ss)
+    );
+    auto context = std::make_shared<paxos::UpdaterContext>(
+        ledger
+    );
+    context->update_window_entries = 3;
+    auto sender = std::make_shared<FakeSender>();
+
+    for (int i=1; i<=5; i++)
+    {
+        context->ledger->Append(paxos::Decree(paxos::Replica("A"), i, "", paxos::DecreeType::UserDecree));
+    }
+
+    HandleUpdate(
+        paxos::Message(
+            paxos::Decree(paxos::Replica("A"), 1, "", paxos::DecreeType::UserDecree),
+            paxos::Replica("A"), paxos::Replica("A"),
+            paxos::MessageType::UpdateMessage
+        ),
+        context,
+        sender
+    );
+
+    ASSERT_MESSAGE_TYPE_SENT(sender, paxos::MessageType::UpdatedRangeMessage);
+    auto range = paxos::BinaryDeserialize<std::vector<paxos::Decree>>(
+        sender->sentMessages()[0].decree.content);
+    ASSERT_EQ(3, range.size());
+    ASSERT_EQ(2, range.front().number);
+    ASSERT_EQ(4, range.back().number);
+
+    // A single remaining decree is sent the same way as before.
+    sender = std::make_shared<FakeSender>();
+    HandleUpdate(
+        paxos::Message(
+            paxos::Decree(paxos::Replica("A"), 4, "", paxos::DecreeType::UserDecree),
+            paxos::Replica("A"), paxos::Replica("A"),
+            paxos::MessageType::UpdateMessage
+        ),
+        context,
+        sender
+    );
+
+    ASSERT_MESSAGE_TYPE_SENT(sender, paxos::MessageType::UpdatedMessage);
+    ASSERT_EQ(5, sender->sentMessages()[0].decree.number);
+}
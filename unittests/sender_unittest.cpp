@@ -1,10 +1,14 @@
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 #include "paxos/messages.hpp"
 #include "paxos/sender.hpp"
+#include "paxos/server.hpp"
 
 
 TEST(SenderTest, testReplyAllSendsMultipleMessages)
@@ -45,6 +49,142 @@ TEST(SenderTest, testReplyAllSendsMultipleMessages)
 }
 
 
+TEST(SenderTest, testReplyWithBinaryCodecWritesBinaryArchive)
+{
+    static std::vector<std::string> transport_writes; // Yuck, a static...
+
+    class MockTransport
+    {
+    public:
+        MockTransport(std::string hostname, short port)
+        {
+        }
+        void Write(std::string content)
+        {
+            transport_writes.push_back(content);
+        }
+    };
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("A", 111));
+
+    paxos::NetworkSender<MockTransport, paxos::BinaryCodec> sender(replicaset);
+
+    sender.ReplyAll(
+        paxos::Message(
+            paxos::Decree(),
+            paxos::Replica("from", 111),
+            paxos::Replica("to", 111),
+            paxos::MessageType::RequestMessage
+        )
+    );
+
+    auto message = paxos::BinaryDeserialize<paxos::Message>(transport_writes[0]);
+    ASSERT_EQ(paxos::BinaryArchiveMagic, static_cast<uint8_t>(transport_writes[0][0]));
+    ASSERT_EQ("A", message.to.hostname);
+    ASSERT_EQ(paxos::MessageType::RequestMessage, message.type);
+}
+
+
+TEST(SenderTest, testReplyAllWithBinaryCodecAddressesEachReplica)
+{
+    static std::vector<std::string> transport_writes; // Yuck, a static...
+
+    class MockTransport
+    {
+    public:
+        MockTransport(std::string hostname, short port)
+        {
+        }
+        void Write(std::string content)
+        {
+            transport_writes.push_back(content);
+        }
+    };
+
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("A", 111));
+    replicaset->Add(paxos::Replica("a_longer_hostname", 222));
+
+    paxos::NetworkSender<MockTransport, paxos::BinaryCodec> sender(replicaset);
+
+    sender.ReplyAll(
+        paxos::Message(
+            paxos::Decree(paxos::Replica("author", 111), 7, "content", paxos::DecreeType::UserDecree),
+            paxos::Replica("from", 111),
+            paxos::Replica("to", 111),
+            paxos::MessageType::AcceptMessage
+        )
+    );
+
+    ASSERT_EQ(2, transport_writes.size());
+    for (const std::string& write : transport_writes)
+    {
+        auto message = paxos::BinaryDeserialize<paxos::Message>(write);
+        ASSERT_TRUE(replicaset->Contains(message.to));
+        ASSERT_EQ("from", message.from.hostname);
+        ASSERT_EQ(paxos::MessageType::AcceptMessage, message.type);
+        ASSERT_EQ(7, message.decree.number);
+        ASSERT_EQ("content", message.decree.content);
+    }
+    ASSERT_NE(
+        paxos::BinaryDeserialize<paxos::Message>(transport_writes[0]).to.hostname,
+        paxos::BinaryDeserialize<paxos::Message>(transport_writes[1]).to.hostname);
+}
+
+
+TEST(SenderTest, testBoostTransportDeliversQueuedWritesInOrder)
+{
+    std::mutex mutex;
+    std::condition_variable received_all;
+    std::vector<std::string> received;
+
+    auto server = boost::make_shared<paxos::AsynchronousServer>("127.0.0.1", 18181);
+    server->RegisterAction([&](const std::string& content)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(content);
+        received_all.notify_all();
+    });
+    server->Start();
+
+    {
+        paxos::BoostTransport transport("127.0.0.1", 18181);
+        for (int i=0; i<100; i++)
+        {
+            transport.Write(std::to_string(i));
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        received_all.wait_for(lock, std::chrono::seconds(5),
+                              [&]() { return received.size() == 100; });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(100, received.size());
+    for (int i=0; i<100; i++)
+    {
+        ASSERT_EQ(std::to_string(i), received[i]);
+    }
+}
+
+
+TEST(SenderTest, testBoostTransportDropsOldestWritesPastTheCap)
+{
+    auto dropped = paxos::GlobalMetrics().messages_dropped.Value();
+    {
+        // Nothing listens on the port, so writes pile up between attempts.
+        paxos::BoostTransport transport("127.0.0.1", 18182, 4096);
+        for (int i=0; i<1000; i++)
+        {
+            transport.Write(std::string(1024, 'x'));
+        }
+    }
+
+    ASSERT_GT(paxos::GlobalMetrics().messages_dropped.Value(), dropped);
+}
+
+
 TEST(SenderTest, testSendFileAlongTransport)
 {
     static std::vector<std::string> transport_writes; // Yuck, a static...
@@ -60,7 +200,7 @@ TEST(SenderTest, testSendFileAlongTransport)
             transport_writes.push_back(content);
         }
 
-        void Read(){}
+        bool Read(){ return true; }
     };
 
     paxos::NetworkFileSender<MockTransport> sender;
@@ -75,6 +215,41 @@ TEST(SenderTest, testSendFileAlongTransport)
 }
 
 
+TEST(SenderTest, testSendFileReusesTransportUntilSendFails)
+{
+    static int transports_created = 0;
+    static bool acknowledge = true;
+
+    class MockTransport
+    {
+    public:
+        MockTransport(std::string hostname, short port)
+        {
+            transports_created++;
+        }
+        void Write(std::string content)
+        {
+        }
+
+        bool Read(){ return acknowledge; }
+    };
+
+    paxos::NetworkFileSender<MockTransport> sender;
+    paxos::Replica replica("A", 111);
+
+    ASSERT_TRUE(sender.SendFile(replica, paxos::BootstrapFile("file", "0123", 0)));
+    ASSERT_TRUE(sender.SendFile(replica, paxos::BootstrapFile("file", "4567", 4)));
+    ASSERT_EQ(1, transports_created);
+
+    acknowledge = false;
+    ASSERT_FALSE(sender.SendFile(replica, paxos::BootstrapFile("file", "89", 8)));
+
+    acknowledge = true;
+    ASSERT_TRUE(sender.SendFile(replica, paxos::BootstrapFile("file", "89", 8)));
+    ASSERT_EQ(2, transports_created);
+}
+
+
 TEST(SenderTest, testCreateHeader)
 {
     ASSERT_THAT(paxos::CreateHeader(0), testing::ElementsAre('\0', '\0', '\0', '\0'));
@@ -157,3 +157,212 @@ TEST(SerializationUnitTest, testMessageDeserializionOfCorruptedStringReturnsInva
     paxos::Message message = paxos::Deserialize<paxos::Message>(string_obj);
     ASSERT_EQ(paxos::MessageType::InvalidMessage, message.type);
 }
+
+
+TEST(SerializationUnitTest, testDecreeIsBinarySerializableAndDeserializable)
+{
+    paxos::Decree expected(paxos::Replica("an_author_1", 8081), 7, "the_decree_contents", paxos::DecreeType::AddReplicaDecree), actual;
+    expected.root_number = 5;
+
+    std::string string_obj = paxos::BinarySerialize(expected);
+    actual = paxos::BinaryDeserialize<paxos::Decree>(string_obj);
+
+    ASSERT_EQ(expected.author.hostname, actual.author.hostname);
+    ASSERT_EQ(expected.author.port, actual.author.port);
+    ASSERT_EQ(expected.content, actual.content);
+    ASSERT_EQ(expected.number, actual.number);
+    ASSERT_EQ(expected.root_number, actual.root_number);
+    ASSERT_EQ(expected.type, actual.type);
+}
+
+
+TEST(SerializationUnitTest, testUpdateReplicaSetDecreeIsBinarySerializableAndDeserializable)
+{
+    paxos::UpdateReplicaSetDecree expected
+    {
+        paxos::Replica("author"),
+        paxos::Replica("myhost"),
+        "remote/directory/path"
+    }, actual;
+
+    std::string string_obj = paxos::BinarySerialize(expected);
+    actual = paxos::BinaryDeserialize<paxos::UpdateReplicaSetDecree>(string_obj);
+
+    ASSERT_EQ(expected.author.hostname, actual.author.hostname);
+    ASSERT_EQ(expected.author.port, actual.author.port);
+    ASSERT_EQ(expected.replica.hostname, actual.replica.hostname);
+    ASSERT_EQ(expected.replica.port, actual.replica.port);
+    ASSERT_EQ(expected.remote_directory, actual.remote_directory);
+}
+
+
+TEST(SerializationUnitTest, testReplicaIsBinarySerializableAndDeserializable)
+{
+    paxos::Replica expected("hostname", -123), actual;
+
+    std::string string_obj = paxos::BinarySerialize(expected);
+    actual = paxos::BinaryDeserialize<paxos::Replica>(string_obj);
+
+    ASSERT_EQ(expected.hostname, actual.hostname);
+    ASSERT_EQ(expected.port, actual.port);
+}
+
+
+TEST(SerializationUnitTest, testMessageIsBinarySerializableAndDeserializable)
+{
+    paxos::Message expected(
+        paxos::Decree(paxos::Replica("author-hostname", 0), 1, std::string("binary\0contents\n", 16), paxos::DecreeType::UserDecree),
+        paxos::Replica("hostname-A", 111),
+        paxos::Replica("hostname-B", 111),
+        paxos::MessageType::PrepareMessage),
+    actual;
+
+    std::string string_obj = paxos::BinarySerialize(expected);
+    actual = paxos::BinaryDeserialize<paxos::Message>(string_obj);
+
+    ASSERT_EQ(expected.decree.author.hostname, actual.decree.author.hostname);
+    ASSERT_EQ(expected.decree.author.port, actual.decree.author.port);
+    ASSERT_EQ(expected.decree.number, actual.decree.number);
+    ASSERT_EQ(expected.decree.content, actual.decree.content);
+    ASSERT_EQ(expected.from.hostname, actual.from.hostname);
+    ASSERT_EQ(expected.from.port, actual.from.port);
+    ASSERT_EQ(expected.to.hostname, actual.to.hostname);
+    ASSERT_EQ(expected.to.port, actual.to.port);
+    ASSERT_EQ(expected.type, actual.type);
+}
+
+
+TEST(SerializationUnitTest, testBootstrapFileIsBinarySerializableAndDeserializable)
+{
+    paxos::BootstrapFile expected(
+        "the_filename",
+        "content of the bootstrap file."),
+    actual;
+
+    std::string string_obj = paxos::BinarySerialize(expected);
+    actual = paxos::BinaryDeserialize<paxos::BootstrapFile>(string_obj);
+
+    ASSERT_EQ(expected.name, actual.name);
+    ASSERT_EQ(expected.content, actual.content);
+}
+
+
+TEST(SerializationUnitTest, testBootstrapManifestIsSerializableAndDeserializable)
+{
+    paxos::BootstrapManifest expected, actual;
+    expected.files.emplace_back("the_ledger", 1ull << 33, 0xDEADBEEF);
+    expected.files.emplace_back("the_decree", 12, 7);
+
+    for (const std::string& string_obj : { paxos::Serialize(expected),
+                                           paxos::BinarySerialize(expected) })
+    {
+        actual = paxos::BinaryCodec::Deserialize<paxos::BootstrapManifest>(
+            string_obj);
+
+        ASSERT_EQ(2, actual.files.size());
+        ASSERT_EQ("the_ledger", actual.files[0].name);
+        ASSERT_EQ(1ull << 33, actual.files[0].size);
+        ASSERT_EQ(0xDEADBEEF, actual.files[0].checksum);
+        ASSERT_EQ("the_decree", actual.files[1].name);
+        ASSERT_EQ(12, actual.files[1].size);
+        ASSERT_EQ(7, actual.files[1].checksum);
+    }
+}
+
+
+TEST(SerializationUnitTest, testVectorOfStringsIsBinarySerializableAndDeserializable)
+{
+    std::vector<std::string> expected { "first", "", "third entry" }, actual;
+
+    std::string string_obj = paxos::BinarySerialize(expected);
+    actual = paxos::BinaryDeserialize<std::vector<std::string>>(string_obj);
+
+    ASSERT_EQ(expected, actual);
+}
+
+
+TEST(SerializationUnitTest, testBinarySerializationHasVersionedLengthPrefixedHeader)
+{
+    paxos::Replica replica("abc", 0x0102);
+
+    std::string string_obj = paxos::BinarySerialize(replica);
+
+    ASSERT_EQ(paxos::BinaryArchiveHeaderSize + 4 + 3 + 2, string_obj.size());
+    ASSERT_EQ(paxos::BinaryArchiveMagic, static_cast<uint8_t>(string_obj[0]));
+    ASSERT_EQ(paxos::BinaryArchiveVersion, static_cast<uint8_t>(string_obj[1]));
+    ASSERT_EQ(std::string("\x09\x00\x00\x00", 4), string_obj.substr(2, 4));
+    ASSERT_EQ(std::string("\x03\x00\x00\x00" "abc" "\x02\x01", 9), string_obj.substr(6));
+}
+
+
+TEST(SerializationUnitTest, testBinarySerializationWithPaddedFluffOnTheEndOfTheBuffer)
+{
+    paxos::Decree expected(paxos::Replica("an_author_1", 0), 1, "the_decree_contents", paxos::DecreeType::UserDecree), actual;
+
+    actual = paxos::BinaryDeserialize<paxos::Decree>(
+        paxos::BinarySerialize(expected) + "THIS IS FLUFF!!!");
+
+    ASSERT_EQ(expected.author.hostname, actual.author.hostname);
+    ASSERT_EQ(expected.content, actual.content);
+    ASSERT_EQ(expected.number, actual.number);
+}
+
+
+TEST(SerializationUnitTest, testMessageBinaryDeserializionOfTruncatedStringReturnsInvalidMessage)
+{
+    std::string string_obj = paxos::BinarySerialize(
+        paxos::Message(
+            paxos::Decree(paxos::Replica("author"), 1, "contents", paxos::DecreeType::UserDecree),
+            paxos::Replica("hostname-A", 111),
+            paxos::Replica("hostname-B", 111),
+            paxos::MessageType::PrepareMessage));
+
+    paxos::Message message = paxos::BinaryDeserialize<paxos::Message>(
+        string_obj.substr(0, string_obj.size() - 1));
+    ASSERT_EQ(paxos::MessageType::InvalidMessage, message.type);
+}
+
+
+TEST(SerializationUnitTest, testMessageBinaryDeserializionOfUnknownVersionReturnsInvalidMessage)
+{
+    std::string string_obj = paxos::BinarySerialize(
+        paxos::Message(
+            paxos::Decree(),
+            paxos::Replica("hostname-A", 111),
+            paxos::Replica("hostname-B", 111),
+            paxos::MessageType::PrepareMessage));
+    string_obj[1] = static_cast<char>(paxos::BinaryArchiveVersion + 1);
+
+    paxos::Message message = paxos::BinaryDeserialize<paxos::Message>(string_obj);
+    ASSERT_EQ(paxos::MessageType::InvalidMessage, message.type);
+}
+
+
+TEST(SerializationUnitTest, testBinaryCodecDecodesTextArchives)
+{
+    paxos::Replica expected("hostname", 123), actual;
+
+    actual = paxos::BinaryCodec::Deserialize<paxos::Replica>(
+        paxos::TextCodec::Serialize(expected));
+
+    ASSERT_EQ(expected.hostname, actual.hostname);
+    ASSERT_EQ(expected.port, actual.port);
+}
+
+
+TEST(SerializationUnitTest, testCodecsDeserializeFromASliceOfALargerBuffer)
+{
+    paxos::Replica expected("hostname", 123);
+
+    for (auto encoded : {paxos::TextCodec::Serialize(expected),
+                         paxos::BinaryCodec::Serialize(expected)})
+    {
+        std::string buffer = "HEADER" + encoded + "TRAILER";
+
+        auto actual = paxos::BinaryCodec::Deserialize<paxos::Replica>(
+            buffer.data() + 6, encoded.size());
+
+        ASSERT_EQ(expected.hostname, actual.hostname);
+        ASSERT_EQ(expected.port, actual.port);
+    }
+}
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "paxos/logging.hpp"
+#include "paxos/simulation.hpp"
+
+
+class SimulationTest: public testing::Test
+{
+    virtual void SetUp()
+    {
+        paxos::DisableLogging();
+    }
+
+public:
+
+    //
+    // Run a cluster until replica has applied every one of entries.
+    //
+    bool RunUntilApplied(paxos::SimulatedCluster& cluster,
+                         std::vector<std::vector<std::string>>& applied,
+                         size_t replica,
+                         size_t entries)
+    {
+        return cluster.GetClock().RunUntil(
+            [&]() { return applied[replica].size() >= entries; },
+            std::chrono::seconds(60));
+    }
+};
+
+
+TEST_F(SimulationTest, testClockRunsEventsInTimeThenSchedulingOrder)
+{
+    paxos::SimulatedClock clock;
+    std::vector<int> order;
+
+    clock.Schedule(std::chrono::microseconds(20), [&]() { order.push_back(3); });
+    clock.Schedule(std::chrono::microseconds(10), [&]() { order.push_back(1); });
+    clock.Schedule(std::chrono::microseconds(10), [&]() { order.push_back(2); });
+    clock.RunFor(std::chrono::microseconds(100));
+
+    ASSERT_EQ(std::vector<int>({ 1, 2, 3 }), order);
+    ASSERT_EQ(std::chrono::microseconds(100), clock.Now());
+}
+
+
+TEST_F(SimulationTest, testClockRunUntilStopsAtTimeout)
+{
+    paxos::SimulatedClock clock;
+    bool ran = false;
+    clock.Schedule(std::chrono::microseconds(500), [&]() { ran = true; });
+
+    ASSERT_FALSE(clock.RunUntil([&]() { return ran; },
+                                std::chrono::microseconds(100)));
+    ASSERT_EQ(std::chrono::microseconds(100), clock.Now());
+    ASSERT_TRUE(clock.RunUntil([&]() { return ran; },
+                               std::chrono::microseconds(1000)));
+    ASSERT_EQ(std::chrono::microseconds(500), clock.Now());
+}
+
+
+TEST_F(SimulationTest, testReceiverDropsMessagesFromUnknownReplicas)
+{
+    auto replicaset = std::make_shared<paxos::ReplicaSet>();
+    replicaset->Add(paxos::Replica("known"));
+    paxos::SimulatedReceiver receiver(replicaset);
+    int received = 0;
+    receiver.RegisterCallback(
+        paxos::Callback([&](const paxos::Message&) { received++; }),
+        paxos::MessageType::PrepareMessage);
+
+    receiver.Deliver(paxos::Message(paxos::Decree(), paxos::Replica("known"),
+                                    paxos::Replica("known"),
+                                    paxos::MessageType::PrepareMessage));
+    receiver.Deliver(paxos::Message(paxos::Decree(), paxos::Replica("unknown"),
+                                    paxos::Replica("known"),
+                                    paxos::MessageType::PrepareMessage));
+
+    ASSERT_EQ(1, received);
+}
+
+
+TEST_F(SimulationTest, testClusterAppliesProposalOnEveryReplica)
+{
+    std::vector<std::vector<std::string>> applied(3);
+    paxos::SimulatedCluster cluster(
+        3, paxos::NetworkConditions(), 1,
+        [&](size_t replica, std::string entry) { applied[replica].push_back(entry); });
+
+    cluster.GetParliament(0).SendProposal("first");
+
+    for (size_t i=0; i<cluster.Size(); i++)
+    {
+        ASSERT_TRUE(RunUntilApplied(cluster, applied, i, 1));
+        ASSERT_EQ(std::vector<std::string>({ "first" }), applied[i]);
+    }
+}
+
+
+TEST_F(SimulationTest, testClusterAppliesProposalsDespiteLossAndReordering)
+{
+    std::vector<std::vector<std::string>> applied(5);
+    paxos::SimulatedCluster cluster(
+        5,
+        paxos::NetworkConditions(std::chrono::microseconds(100),
+                                 std::chrono::microseconds(50),
+                                 0.1,
+                                 0.1),
+        7,
+        [&](size_t replica, std::string entry) { applied[replica].push_back(entry); });
+
+    for (int i=0; i<5; i++)
+    {
+        cluster.GetParliament(0).SendProposal("entry" + std::to_string(i));
+        ASSERT_TRUE(RunUntilApplied(cluster, applied, 0, i + 1));
+    }
+
+    ASSERT_GT(cluster.GetNetwork().Dropped(), 0);
+    ASSERT_EQ(std::vector<std::string>({ "entry0", "entry1", "entry2",
+                                         "entry3", "entry4" }),
+              applied[0]);
+}
+
+
+TEST_F(SimulationTest, testPartitionedMinorityAppliesOnlyAfterHeal)
+{
+    std::vector<std::vector<std::string>> applied(3);
+    paxos::SimulatedCluster cluster(
+        3, paxos::NetworkConditions(), 1,
+        [&](size_t replica, std::string entry) { applied[replica].push_back(entry); });
+
+    cluster.GetNetwork().Partition({ cluster.GetReplica(0) });
+    cluster.GetParliament(0).SendProposal("isolated");
+
+    ASSERT_FALSE(RunUntilApplied(cluster, applied, 0, 1));
+
+    cluster.GetNetwork().Heal();
+
+    ASSERT_TRUE(RunUntilApplied(cluster, applied, 0, 1));
+    ASSERT_EQ(std::vector<std::string>({ "isolated" }), applied[0]);
+}
+
+
+TEST_F(SimulationTest, testSameSeedReplaysTheSameRun)
+{
+    std::vector<std::chrono::microseconds> times;
+    std::vector<uint64_t> delivered;
+    for (int run=0; run<2; run++)
+    {
+        std::vector<std::vector<std::string>> applied(3);
+        paxos::SimulatedCluster cluster(
+            3,
+            paxos::NetworkConditions(std::chrono::microseconds(100),
+                                     std::chrono::microseconds(400),
+                                     0.2),
+            42,
+            [&](size_t replica, std::string entry) { applied[replica].push_back(entry); });
+
+        cluster.GetParliament(1).SendProposal("entry");
+        ASSERT_TRUE(RunUntilApplied(cluster, applied, 1, 1));
+
+        times.push_back(cluster.GetClock().Now());
+        delivered.push_back(cluster.GetNetwork().Delivered());
+    }
+
+    ASSERT_EQ(times[0], times[1]);
+    ASSERT_EQ(delivered[0], delivered[1]);
+}
+
+
+TEST_F(SimulationTest, testPipelinedProposalsAreAppliedOnceDespiteLostAccepts)
+{
+    const int entries = 40;
+    std::vector<std::vector<std::string>> applied(3);
+    paxos::SimulatedCluster cluster(
+        3,
+        paxos::NetworkConditions(std::chrono::microseconds(100),
+                                 std::chrono::microseconds(50),
+                                 0.05),
+        15,
+        [&](size_t replica, std::string entry) { applied[replica].push_back(entry); });
+    cluster.GetParliament(0).SetPipelineWindow(8);
+
+    //
+    // Accepts lost in the middle of the window are resent after later roots
+    // were accepted. None of the values may be proposed again at a new root.
+    //
+    std::vector<std::string> expected;
+    for (int i=0; i<entries; i++)
+    {
+        expected.push_back("entry" + std::to_string(i));
+        cluster.GetParliament(0).SendProposal(expected.back());
+    }
+    ASSERT_TRUE(RunUntilApplied(cluster, applied, 0, entries));
+    cluster.GetClock().RunFor(std::chrono::seconds(5));
+
+    ASSERT_GT(cluster.GetNetwork().Dropped(), 0);
+    for (size_t i=0; i<cluster.Size(); i++)
+    {
+        std::vector<std::string> sorted = applied[i];
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<std::string> unique = sorted;
+        unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+        ASSERT_EQ(unique, sorted);
+    }
+    std::vector<std::string> sorted = applied[0];
+    std::sort(sorted.begin(), sorted.end());
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(expected, sorted);
+}
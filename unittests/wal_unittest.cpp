@@ -0,0 +1,229 @@
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "paxos/wal.hpp"
+
+
+class WriteAheadLogTest: public testing::Test
+{
+    virtual void SetUp()
+    {
+        directory = (boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path()).string();
+    }
+
+    virtual void TearDown()
+    {
+        boost::filesystem::remove_all(directory);
+    }
+
+public:
+
+    int CountSegments()
+    {
+        int count = 0;
+        for (auto& entry : boost::filesystem::directory_iterator(directory))
+        {
+            if (entry.path().extension() != ".head")
+            {
+                count += 1;
+            }
+        }
+        return count;
+    }
+
+    std::string directory;
+};
+
+
+TEST_F(WriteAheadLogTest, testEnqueueIsReadableBeforeSync)
+{
+    paxos::WriteAheadLog<std::string> log(directory, "log");
+
+    log.Enqueue("narf");
+    log.Enqueue("zort");
+
+    ASSERT_EQ(log.Size(), 2);
+    ASSERT_EQ(log.At(0), "narf");
+    ASSERT_EQ(log.At(1), "zort");
+    ASSERT_EQ(log.Last(), "zort");
+}
+
+
+TEST_F(WriteAheadLogTest, testRecoversRecordsAfterReopen)
+{
+    {
+        paxos::WriteAheadLog<std::string> log(
+            directory, "log", paxos::SyncPolicy::Always);
+        log.Enqueue("narf");
+        log.Enqueue("zort");
+        log.Enqueue("poit");
+        log.Sync();
+        log.Dequeue();
+    }
+
+    paxos::WriteAheadLog<std::string> log(directory, "log");
+
+    ASSERT_EQ(log.Size(), 2);
+    ASSERT_EQ(log.At(0), "zort");
+    ASSERT_EQ(log.Last(), "poit");
+}
+
+
+TEST_F(WriteAheadLogTest, testRecoveryTruncatesTornRecord)
+{
+    {
+        paxos::WriteAheadLog<std::string> log(directory, "log");
+        log.Enqueue("narf");
+        log.Enqueue("zort");
+    }
+
+    auto segment = boost::filesystem::path(directory) /
+                   "log.00000000000000000000";
+    boost::filesystem::resize_file(
+        segment, boost::filesystem::file_size(segment) - 1);
+
+    {
+        paxos::WriteAheadLog<std::string> log(directory, "log");
+
+        ASSERT_EQ(log.Size(), 1);
+        ASSERT_EQ(log.Last(), "narf");
+
+        log.Enqueue("poit");
+    }
+
+    paxos::WriteAheadLog<std::string> log(directory, "log");
+
+    ASSERT_EQ(log.Size(), 2);
+    ASSERT_EQ(log.At(1), "poit");
+}
+
+
+TEST_F(WriteAheadLogTest, testSegmentsRollAndAreRemovedAfterDequeue)
+{
+    paxos::WriteAheadLog<std::string> log(
+        directory, "log", paxos::SyncPolicy::Never,
+        std::chrono::milliseconds(0), 32);
+
+    log.Enqueue("narf");
+    log.Enqueue("zort");
+    log.Enqueue("poit");
+    log.Sync();
+
+    ASSERT_EQ(CountSegments(), 3);
+
+    log.Dequeue();
+    log.Dequeue();
+
+    ASSERT_EQ(CountSegments(), 1);
+    ASSERT_EQ(log.Size(), 1);
+    ASSERT_EQ(log.At(0), "poit");
+}
+
+
+TEST_F(WriteAheadLogTest, testHeadIsOnlySavedWhenSegmentsAreDropped)
+{
+    auto head = boost::filesystem::path(directory) /
+                boost::filesystem::path("log.head");
+    paxos::WriteAheadLog<std::string> log(
+        directory, "log", paxos::SyncPolicy::Always,
+        std::chrono::milliseconds(0), 48);
+
+    log.Enqueue("narf");
+    log.Enqueue("narf");
+    log.Enqueue("zort");
+    log.Sync();
+    log.Dequeue();
+
+    ASSERT_FALSE(boost::filesystem::exists(head));
+
+    log.Dequeue();
+
+    std::ifstream file(head.string());
+    uint64_t ordinal = 0;
+    file >> ordinal;
+    ASSERT_EQ(ordinal, 2);
+    ASSERT_EQ(CountSegments(), 1);
+}
+
+
+TEST_F(WriteAheadLogTest, testSealedSegmentsAreReadableAfterReopen)
+{
+    {
+        paxos::WriteAheadLog<std::string> log(
+            directory, "log", paxos::SyncPolicy::Never,
+            std::chrono::milliseconds(0), 32);
+        log.Enqueue("narf");
+        log.Enqueue("zort");
+        log.Enqueue("poit");
+    }
+
+    paxos::WriteAheadLog<std::string> log(
+        directory, "log", paxos::SyncPolicy::Never,
+        std::chrono::milliseconds(0), 32);
+
+    std::vector<std::string> elements;
+    for (auto element : log)
+    {
+        elements.push_back(element);
+    }
+
+    ASSERT_EQ(std::vector<std::string>({ "narf", "zort", "poit" }), elements);
+}
+
+
+TEST_F(WriteAheadLogTest, testIntervalPolicyFlushesAnIdleLog)
+{
+    paxos::WriteAheadLog<std::string> log(
+        directory, "log", paxos::SyncPolicy::Interval,
+        std::chrono::milliseconds(1000));
+
+    log.Enqueue("narf");
+    log.Sync();
+    ASSERT_TRUE(log.IsFlushPending());
+
+    auto start = std::chrono::steady_clock::now();
+    while (log.IsFlushPending() &&
+           std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    ASSERT_FALSE(log.IsFlushPending());
+    ASSERT_GE(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(900));
+}
+
+
+TEST_F(WriteAheadLogTest, testConcurrentSyncCommitsEveryRecord)
+{
+    {
+        paxos::WriteAheadLog<std::string> log(
+            directory, "log", paxos::SyncPolicy::Always);
+
+        std::vector<std::thread> threads;
+        for (int i=0; i<4; i++)
+        {
+            threads.push_back(std::thread([&log]()
+            {
+                for (int j=0; j<25; j++)
+                {
+                    log.Enqueue("narf");
+                    log.Sync();
+                }
+            }));
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    paxos::WriteAheadLog<std::string> log(directory, "log");
+
+    ASSERT_EQ(log.Size(), 100);
+}